@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+
+
+// a problem sums its input into *result
+struct sum_problem
+{
+  const int *data;
+  std::size_t n;
+  int *result;
+
+  __host__ __device__
+  std::size_t size() const
+  {
+    return n;
+  }
+};
+
+
+// each tile reduces its items, and a problem's tiles combine their sums atomically
+struct sum_tile
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, sum_problem problem, std::size_t first, std::size_t last)
+  {
+    int sum = bulk::reduce(g, problem.data + first, problem.data + last, 0, thrust::plus<int>());
+
+    if(g.this_exec.index() == 0)
+    {
+      atomicAdd(problem.result, sum);
+    }
+  }
+};
+
+
+int main()
+{
+  const int num_problems = 5000;
+
+  thrust::default_random_engine rng;
+
+  // mostly tiny problems, with the occasional large one
+  std::vector<std::size_t> sizes(num_problems);
+  std::size_t total = 0;
+  for(int i = 0; i < num_problems; ++i)
+  {
+    sizes[i] = (i % 1000 == 0) ? 100000 : rng() % 300;
+    total += sizes[i];
+  }
+
+  thrust::device_vector<int> data(total, 1);
+  thrust::device_vector<int> results(num_problems, 0);
+
+  std::vector<sum_problem> problems(num_problems);
+  std::size_t offset = 0;
+  for(int i = 0; i < num_problems; ++i)
+  {
+    problems[i].data   = thrust::raw_pointer_cast(data.data()) + offset;
+    problems[i].n      = sizes[i];
+    problems[i].result = thrust::raw_pointer_cast(results.data()) + i;
+    offset += sizes[i];
+  }
+
+  // one launch for all of them
+  bulk::async_batch(bulk::con<128,4>(bulk::use_default), &problems[0], problems.size(), sum_tile()).wait();
+
+  thrust::host_vector<int> h_results = results;
+  for(int i = 0; i < num_problems; ++i)
+  {
+    assert(h_results[i] == static_cast<int>(sizes[i]));
+  }
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
+
@@ -0,0 +1,590 @@
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/copy.h>
+#include <thrust/for_each.h>
+#include <thrust/reduce.h>
+#include <thrust/scan.h>
+#include <thrust/adjacent_difference.h>
+#include <thrust/gather.h>
+#include <thrust/scatter.h>
+#include <thrust/merge.h>
+#include <thrust/sort.h>
+#include <thrust/sequence.h>
+#include <thrust/functional.h>
+#include <cstdlib>
+#include "benchmark.hpp"
+
+
+// each benchmark applies a bulk algorithm to each tile of its input with a grid of these groups,
+// and compares against thrust applying the analogous algorithm to the whole input
+// thrust's numbers are a reference for throughput rather than an identical computation
+const std::size_t groupsize = 128;
+const std::size_t grainsize = 7;
+const std::size_t tile_size = groupsize * grainsize;
+
+typedef bulk::concurrent_group<bulk::agent<grainsize>, groupsize> group_type;
+
+
+inline std::size_t num_tiles(std::size_t n)
+{
+  return (n + tile_size - 1) / tile_size;
+}
+
+
+// room for an input & output tile staged on chip, plus the heap's bookkeeping
+template<typename T>
+inline std::size_t heap_size()
+{
+  return 4 * tile_size * sizeof(T) + 4 * 64;
+}
+
+
+struct tile
+{
+  std::size_t first;
+  std::size_t size;
+
+  __device__
+  tile(group_type &g, std::size_t n)
+    : first(g.index() * tile_size),
+      size(thrust::min<std::size_t>(tile_size, n - first))
+  {}
+};
+
+
+struct copy_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::copy_n(g, input + t.first, t.size, result + t.first);
+  }
+};
+
+
+template<typename T>
+struct increment
+{
+  __host__ __device__
+  void operator()(T &x) const
+  {
+    x += T(1);
+  }
+};
+
+
+struct for_each_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, T *data, std::size_t n)
+  {
+    tile t(g, n);
+    bulk::for_each_n(g, data + t.first, t.size, increment<T>());
+  }
+};
+
+
+struct accumulate_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    T sum = bulk::accumulate(g, input + t.first, input + t.first + t.size, T(0), thrust::plus<T>());
+
+    if(g.this_exec.index() == 0) result[g.index()] = sum;
+  }
+};
+
+
+struct reduce_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    T sum = bulk::reduce(g, input + t.first, input + t.first + t.size, T(0), thrust::plus<T>());
+
+    if(g.this_exec.index() == 0) result[g.index()] = sum;
+  }
+};
+
+
+struct inclusive_scan_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::inclusive_scan(g, input + t.first, input + t.first + t.size, result + t.first, thrust::plus<T>());
+  }
+};
+
+
+struct exclusive_scan_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::exclusive_scan(g, input + t.first, input + t.first + t.size, result + t.first, T(0), thrust::plus<T>());
+  }
+};
+
+
+struct adjacent_difference_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::adjacent_difference(g, input + t.first, input + t.first + t.size, result + t.first, thrust::minus<T>());
+  }
+};
+
+
+struct gather_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const unsigned int *map, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::gather(g, map + t.first, map + t.first + t.size, input, result + t.first);
+  }
+};
+
+
+struct scatter_if_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, const unsigned int *map, const bool *stencil, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    bulk::scatter_if(g, input + t.first, input + t.first + t.size, map + t.first, stencil + t.first, result);
+  }
+};
+
+
+// merges the two sorted halves of each tile
+struct merge_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const T *input, std::size_t n, T *result)
+  {
+    tile t(g, n);
+    const T *first1 = input + t.first;
+    const T *mid    = first1 + t.size / 2;
+    const T *last2  = first1 + t.size;
+
+    bulk::merge(g, first1, mid, mid, last2, result + t.first, thrust::less<T>());
+  }
+};
+
+
+struct stable_sort_by_key_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, T *keys, unsigned int *values, std::size_t n)
+  {
+    tile t(g, n);
+    bulk::stable_sort_by_key(bulk::bound<tile_size>(g), keys + t.first, keys + t.first + t.size, values + t.first, thrust::less<T>());
+  }
+};
+
+
+struct radix_sort_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, T *keys, std::size_t n)
+  {
+    tile t(g, n);
+    bulk::radix_sort(g, keys + t.first, keys + t.first + t.size);
+  }
+};
+
+
+struct reduce_by_key_kernel
+{
+  template<typename T>
+  __device__ void operator()(group_type &g, const unsigned int *keys, const T *values, std::size_t n, unsigned int *keys_result, T *values_result)
+  {
+    tile t(g, n);
+
+    bulk::reduce_by_key(g,
+                        keys + t.first + 1, keys + t.first + t.size,
+                        values + t.first + 1,
+                        keys_result + t.first,
+                        values_result + t.first,
+                        keys[t.first],
+                        values[t.first],
+                        thrust::equal_to<unsigned int>(),
+                        thrust::plus<T>());
+  }
+};
+
+
+// bulk::async(grid, kernel, root.this_exec, args...) for each tile of n
+template<typename T, typename Kernel>
+struct bulk_launch
+{
+  Kernel kernel;
+  std::size_t n;
+
+  bulk_launch(Kernel kernel, std::size_t n) : kernel(kernel), n(n) {}
+
+  bulk::parallel_group<group_type> grid() const
+  {
+    return bulk::grid<groupsize,grainsize>(num_tiles(n), heap_size<T>());
+  }
+};
+
+
+template<typename T, typename Kernel, typename Arg1, typename Arg2, typename Arg3>
+struct bulk_launch3 : bulk_launch<T,Kernel>
+{
+  Arg1 arg1; Arg2 arg2; Arg3 arg3;
+
+  bulk_launch3(Kernel k, std::size_t n, Arg1 a1, Arg2 a2, Arg3 a3)
+    : bulk_launch<T,Kernel>(k,n), arg1(a1), arg2(a2), arg3(a3)
+  {}
+
+  void operator()() const
+  {
+    bulk::async(this->grid(), this->kernel, bulk::root.this_exec, arg1, arg2, arg3);
+  }
+};
+
+
+template<typename T, typename Kernel, typename Arg1, typename Arg2>
+struct bulk_launch2 : bulk_launch<T,Kernel>
+{
+  Arg1 arg1; Arg2 arg2;
+
+  bulk_launch2(Kernel k, std::size_t n, Arg1 a1, Arg2 a2)
+    : bulk_launch<T,Kernel>(k,n), arg1(a1), arg2(a2)
+  {}
+
+  void operator()() const
+  {
+    bulk::async(this->grid(), this->kernel, bulk::root.this_exec, arg1, arg2);
+  }
+};
+
+
+template<typename T, typename Kernel, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+struct bulk_launch4 : bulk_launch<T,Kernel>
+{
+  Arg1 arg1; Arg2 arg2; Arg3 arg3; Arg4 arg4;
+
+  bulk_launch4(Kernel k, std::size_t n, Arg1 a1, Arg2 a2, Arg3 a3, Arg4 a4)
+    : bulk_launch<T,Kernel>(k,n), arg1(a1), arg2(a2), arg3(a3), arg4(a4)
+  {}
+
+  void operator()() const
+  {
+    bulk::async(this->grid(), this->kernel, bulk::root.this_exec, arg1, arg2, arg3, arg4);
+  }
+};
+
+
+template<typename T, typename Kernel, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+struct bulk_launch5 : bulk_launch<T,Kernel>
+{
+  Arg1 arg1; Arg2 arg2; Arg3 arg3; Arg4 arg4; Arg5 arg5;
+
+  bulk_launch5(Kernel k, std::size_t n, Arg1 a1, Arg2 a2, Arg3 a3, Arg4 a4, Arg5 a5)
+    : bulk_launch<T,Kernel>(k,n), arg1(a1), arg2(a2), arg3(a3), arg4(a4), arg5(a5)
+  {}
+
+  void operator()() const
+  {
+    bulk::async(this->grid(), this->kernel, bulk::root.this_exec, arg1, arg2, arg3, arg4, arg5);
+  }
+};
+
+
+template<typename T>
+struct thrust_copy
+{
+  thrust::device_vector<T> *input, *result;
+  void operator()() const { thrust::copy(input->begin(), input->end(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_for_each
+{
+  thrust::device_vector<T> *data;
+  void operator()() const { thrust::for_each(data->begin(), data->end(), increment<T>()); }
+};
+
+
+template<typename T>
+struct thrust_reduce
+{
+  thrust::device_vector<T> *input;
+  void operator()() const { thrust::reduce(input->begin(), input->end()); }
+};
+
+
+template<typename T>
+struct thrust_inclusive_scan
+{
+  thrust::device_vector<T> *input, *result;
+  void operator()() const { thrust::inclusive_scan(input->begin(), input->end(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_exclusive_scan
+{
+  thrust::device_vector<T> *input, *result;
+  void operator()() const { thrust::exclusive_scan(input->begin(), input->end(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_adjacent_difference
+{
+  thrust::device_vector<T> *input, *result;
+  void operator()() const { thrust::adjacent_difference(input->begin(), input->end(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_gather
+{
+  thrust::device_vector<unsigned int> *map;
+  thrust::device_vector<T> *input, *result;
+  void operator()() const { thrust::gather(map->begin(), map->end(), input->begin(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_scatter_if
+{
+  thrust::device_vector<T> *input, *result;
+  thrust::device_vector<unsigned int> *map;
+  thrust::device_vector<bool> *stencil;
+  void operator()() const { thrust::scatter_if(input->begin(), input->end(), map->begin(), stencil->begin(), result->begin()); }
+};
+
+
+template<typename T>
+struct thrust_merge
+{
+  thrust::device_vector<T> *input, *result;
+  void operator()() const
+  {
+    typename thrust::device_vector<T>::iterator mid = input->begin() + input->size() / 2;
+    thrust::merge(input->begin(), mid, mid, input->end(), result->begin());
+  }
+};
+
+
+// resets the keys before each sort, so each trial sorts the same input
+template<typename T>
+struct thrust_sort_by_key
+{
+  thrust::device_vector<T> *original_keys, *keys;
+  thrust::device_vector<unsigned int> *values;
+  void operator()() const
+  {
+    thrust::copy(original_keys->begin(), original_keys->end(), keys->begin());
+    thrust::sort_by_key(keys->begin(), keys->end(), values->begin());
+  }
+};
+
+
+template<typename T>
+struct thrust_sort
+{
+  thrust::device_vector<T> *original_keys, *keys;
+  void operator()() const
+  {
+    thrust::copy(original_keys->begin(), original_keys->end(), keys->begin());
+    thrust::sort(keys->begin(), keys->end());
+  }
+};
+
+
+template<typename T>
+struct thrust_reduce_by_key
+{
+  thrust::device_vector<unsigned int> *keys, *keys_result;
+  thrust::device_vector<T> *values, *values_result;
+  void operator()() const { thrust::reduce_by_key(keys->begin(), keys->end(), values->begin(), keys_result->begin(), values_result->begin()); }
+};
+
+
+template<typename Launch>
+struct with_reset
+{
+  Launch launch;
+  const void *original;
+  void *data;
+  std::size_t bytes;
+
+  void operator()() const
+  {
+    cudaMemcpyAsync(data, original, bytes, cudaMemcpyDeviceToDevice);
+    launch();
+  }
+};
+
+
+template<typename Launch>
+with_reset<Launch> make_with_reset(Launch launch, const void *original, void *data, std::size_t bytes)
+{
+  with_reset<Launch> result = {launch, original, data, bytes};
+  return result;
+}
+
+
+template<typename T>
+T *raw(thrust::device_vector<T> &vec)
+{
+  return thrust::raw_pointer_cast(vec.data());
+}
+
+
+template<typename T>
+void run_benchmarks(std::size_t n, const benchmark_options &options)
+{
+  const char *type = type_name<T>();
+  const std::size_t bytes = n * sizeof(T);
+
+  thrust::host_vector<T> h_random(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    h_random[i] = static_cast<T>(std::rand() % 1000);
+  }
+
+  thrust::device_vector<T> random = h_random;
+  thrust::device_vector<T> sorted(n);
+  thrust::sequence(sorted.begin(), sorted.end());
+  thrust::device_vector<T> result(n), keys(n);
+  thrust::device_vector<T> partials(num_tiles(n));
+
+  // reverse every tile, so gather & scatter stay within a tile
+  thrust::host_vector<unsigned int> h_map(n);
+  thrust::host_vector<bool> h_stencil(n);
+  thrust::host_vector<unsigned int> h_segments(n);
+  for(std::size_t i = 0; i < n; ++i)
+  {
+    std::size_t first = (i / tile_size) * tile_size;
+    std::size_t last  = std::min(first + tile_size, n);
+    h_map[i] = static_cast<unsigned int>(first + (last - 1 - i));
+    h_stencil[i] = (i % 2) == 0;
+    h_segments[i] = static_cast<unsigned int>(i / 10);
+  }
+
+  thrust::device_vector<unsigned int> map = h_map;
+  thrust::device_vector<bool> stencil = h_stencil;
+  thrust::device_vector<unsigned int> segments = h_segments, segments_result(n), values(n);
+
+  print_benchmark_result(benchmark("copy_n", "bulk", type, n, 2 * bytes,
+                                   bulk_launch3<T,copy_kernel,const T*,std::size_t,T*>(copy_kernel(), n, raw(random), n, raw(result)),
+                                   options), options);
+  thrust_copy<T> tc = {&random, &result};
+  print_benchmark_result(benchmark("copy_n", "thrust", type, n, 2 * bytes, tc, options), options);
+
+  print_benchmark_result(benchmark("for_each_n", "bulk", type, n, 2 * bytes,
+                                   bulk_launch2<T,for_each_kernel,T*,std::size_t>(for_each_kernel(), n, raw(result), n),
+                                   options), options);
+  thrust_for_each<T> tfe = {&result};
+  print_benchmark_result(benchmark("for_each_n", "thrust", type, n, 2 * bytes, tfe, options), options);
+
+  print_benchmark_result(benchmark("accumulate", "bulk", type, n, bytes,
+                                   bulk_launch3<T,accumulate_kernel,const T*,std::size_t,T*>(accumulate_kernel(), n, raw(random), n, raw(partials)),
+                                   options), options);
+  print_benchmark_result(benchmark("reduce", "bulk", type, n, bytes,
+                                   bulk_launch3<T,reduce_kernel,const T*,std::size_t,T*>(reduce_kernel(), n, raw(random), n, raw(partials)),
+                                   options), options);
+  thrust_reduce<T> tr = {&random};
+  print_benchmark_result(benchmark("reduce", "thrust", type, n, bytes, tr, options), options);
+
+  print_benchmark_result(benchmark("inclusive_scan", "bulk", type, n, 2 * bytes,
+                                   bulk_launch3<T,inclusive_scan_kernel,const T*,std::size_t,T*>(inclusive_scan_kernel(), n, raw(random), n, raw(result)),
+                                   options), options);
+  thrust_inclusive_scan<T> tis = {&random, &result};
+  print_benchmark_result(benchmark("inclusive_scan", "thrust", type, n, 2 * bytes, tis, options), options);
+
+  print_benchmark_result(benchmark("exclusive_scan", "bulk", type, n, 2 * bytes,
+                                   bulk_launch3<T,exclusive_scan_kernel,const T*,std::size_t,T*>(exclusive_scan_kernel(), n, raw(random), n, raw(result)),
+                                   options), options);
+  thrust_exclusive_scan<T> tes = {&random, &result};
+  print_benchmark_result(benchmark("exclusive_scan", "thrust", type, n, 2 * bytes, tes, options), options);
+
+  print_benchmark_result(benchmark("adjacent_difference", "bulk", type, n, 2 * bytes,
+                                   bulk_launch3<T,adjacent_difference_kernel,const T*,std::size_t,T*>(adjacent_difference_kernel(), n, raw(random), n, raw(result)),
+                                   options), options);
+  thrust_adjacent_difference<T> tad = {&random, &result};
+  print_benchmark_result(benchmark("adjacent_difference", "thrust", type, n, 2 * bytes, tad, options), options);
+
+  const std::size_t gather_bytes = 2 * bytes + n * sizeof(unsigned int);
+  print_benchmark_result(benchmark("gather", "bulk", type, n, gather_bytes,
+                                   bulk_launch4<T,gather_kernel,const unsigned int*,const T*,std::size_t,T*>(gather_kernel(), n, raw(map), raw(random), n, raw(result)),
+                                   options), options);
+  thrust_gather<T> tg = {&map, &random, &result};
+  print_benchmark_result(benchmark("gather", "thrust", type, n, gather_bytes, tg, options), options);
+
+  const std::size_t scatter_bytes = gather_bytes + n * sizeof(bool);
+  print_benchmark_result(benchmark("scatter_if", "bulk", type, n, scatter_bytes,
+                                   bulk_launch5<T,scatter_if_kernel,const T*,const unsigned int*,const bool*,std::size_t,T*>(scatter_if_kernel(), n, raw(random), raw(map), raw(stencil), n, raw(result)),
+                                   options), options);
+  thrust_scatter_if<T> tsi = {&random, &result, &map, &stencil};
+  print_benchmark_result(benchmark("scatter_if", "thrust", type, n, scatter_bytes, tsi, options), options);
+
+  print_benchmark_result(benchmark("merge", "bulk", type, n, 2 * bytes,
+                                   bulk_launch3<T,merge_kernel,const T*,std::size_t,T*>(merge_kernel(), n, raw(sorted), n, raw(result)),
+                                   options), options);
+  thrust_merge<T> tm = {&sorted, &result};
+  print_benchmark_result(benchmark("merge", "thrust", type, n, 2 * bytes, tm, options), options);
+
+  // the sorts reset their keys before each trial, which is included in their times
+  const std::size_t sort_by_key_bytes = 2 * (bytes + n * sizeof(unsigned int));
+  print_benchmark_result(benchmark("stable_sort_by_key", "bulk", type, n, sort_by_key_bytes,
+                                   make_with_reset(bulk_launch3<T,stable_sort_by_key_kernel,T*,unsigned int*,std::size_t>(stable_sort_by_key_kernel(), n, raw(keys), raw(values), n),
+                                                   raw(random), raw(keys), bytes),
+                                   options), options);
+  thrust_sort_by_key<T> tsbk = {&random, &keys, &values};
+  print_benchmark_result(benchmark("stable_sort_by_key", "thrust", type, n, sort_by_key_bytes, tsbk, options), options);
+
+  print_benchmark_result(benchmark("radix_sort", "bulk", type, n, 2 * bytes,
+                                   make_with_reset(bulk_launch2<T,radix_sort_kernel,T*,std::size_t>(radix_sort_kernel(), n, raw(keys), n),
+                                                   raw(random), raw(keys), bytes),
+                                   options), options);
+  thrust_sort<T> ts = {&random, &keys};
+  print_benchmark_result(benchmark("radix_sort", "thrust", type, n, 2 * bytes, ts, options), options);
+
+  const std::size_t reduce_by_key_bytes = 2 * (bytes + n * sizeof(unsigned int));
+  print_benchmark_result(benchmark("reduce_by_key", "bulk", type, n, reduce_by_key_bytes,
+                                   bulk_launch5<T,reduce_by_key_kernel,const unsigned int*,const T*,std::size_t,unsigned int*,T*>(reduce_by_key_kernel(), n, raw(segments), raw(random), n, raw(segments_result), raw(result)),
+                                   options), options);
+  thrust_reduce_by_key<T> trbk = {&segments, &segments_result, &random, &result};
+  print_benchmark_result(benchmark("reduce_by_key", "thrust", type, n, reduce_by_key_bytes, trbk, options), options);
+}
+
+
+int main(int argc, char **argv)
+{
+  benchmark_options options = parse_benchmark_options(argc, argv);
+
+  print_benchmark_header(options);
+
+  for(int log_n = options.min_log_n; log_n <= options.max_log_n; log_n += options.log_n_step)
+  {
+    std::size_t n = std::size_t(1) << log_n;
+
+    run_benchmarks<int>(n, options);
+    run_benchmarks<unsigned int>(n, options);
+    run_benchmarks<float>(n, options);
+    run_benchmarks<double>(n, options);
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+
+struct benchmark_options
+{
+  std::size_t num_warmup_trials;
+  std::size_t num_trials;
+
+  // evict the inputs from L2 before each trial, so small problems aren't timed from cache
+  bool flush_l2;
+
+  // print comma-separated values rather than a table
+  bool csv;
+
+  // sweep problem sizes 2^min_log_n, 2^(min_log_n + log_n_step), ... 2^max_log_n
+  int min_log_n;
+  int max_log_n;
+  int log_n_step;
+
+  benchmark_options()
+    : num_warmup_trials(3),
+      num_trials(20),
+      flush_l2(true),
+      csv(false),
+      min_log_n(16),
+      max_log_n(24),
+      log_n_step(4)
+  {}
+};
+
+
+// --warmup N --trials N --min-log-n N --max-log-n N --log-n-step N --no-flush --csv
+inline benchmark_options parse_benchmark_options(int argc, char **argv)
+{
+  benchmark_options result;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+
+    if(arg == "--warmup" && has_value)          result.num_warmup_trials = std::atoi(argv[++i]);
+    else if(arg == "--trials" && has_value)     result.num_trials        = std::max(1, std::atoi(argv[++i]));
+    else if(arg == "--min-log-n" && has_value)  result.min_log_n         = std::atoi(argv[++i]);
+    else if(arg == "--max-log-n" && has_value)  result.max_log_n         = std::atoi(argv[++i]);
+    else if(arg == "--log-n-step" && has_value) result.log_n_step        = std::max(1, std::atoi(argv[++i]));
+    else if(arg == "--no-flush")                result.flush_l2          = false;
+    else if(arg == "--csv")                     result.csv               = true;
+    else
+    {
+      std::fprintf(stderr, "usage: %s [--warmup N] [--trials N] [--min-log-n N] [--max-log-n N] [--log-n-step N] [--no-flush] [--csv]\n", argv[0]);
+      std::exit(1);
+    }
+  }
+
+  return result;
+}
+
+
+struct benchmark_result
+{
+  std::string algorithm;
+  std::string implementation;
+  std::string type;
+  std::size_t n;
+  std::size_t bytes;
+  double min_msecs;
+  double median_msecs;
+  double p10_msecs;
+  double p90_msecs;
+  double max_msecs;
+};
+
+
+template<typename T> inline const char *type_name();
+template<> inline const char *type_name<char>()               { return "char"; }
+template<> inline const char *type_name<int>()                { return "int"; }
+template<> inline const char *type_name<unsigned int>()       { return "unsigned int"; }
+template<> inline const char *type_name<long>()               { return "long"; }
+template<> inline const char *type_name<unsigned long long>() { return "unsigned long long"; }
+template<> inline const char *type_name<float>()              { return "float"; }
+template<> inline const char *type_name<double>()             { return "double"; }
+
+
+// overwrites a buffer twice the size of L2 to evict whatever the last trial left there
+class l2_flusher
+{
+  public:
+    l2_flusher()
+      : m_ptr(0), m_size(0), m_value(0)
+    {
+      int device = 0, l2_size = 0;
+      cudaGetDevice(&device);
+      cudaDeviceGetAttribute(&l2_size, cudaDevAttrL2CacheSize, device);
+
+      m_size = 2 * static_cast<std::size_t>(l2_size);
+
+      if(m_size > 0 && cudaMalloc(&m_ptr, m_size) != cudaSuccess)
+      {
+        cudaGetLastError();
+        m_ptr = 0;
+        m_size = 0;
+      }
+    }
+
+    ~l2_flusher()
+    {
+      if(m_ptr) cudaFree(m_ptr);
+    }
+
+    void flush()
+    {
+      if(m_ptr) cudaMemsetAsync(m_ptr, ++m_value, m_size);
+    }
+
+  private:
+    void *m_ptr;
+    std::size_t m_size;
+    int m_value;
+
+    l2_flusher(const l2_flusher &);
+    l2_flusher &operator=(const l2_flusher &);
+};
+
+
+inline l2_flusher &the_l2_flusher()
+{
+  static l2_flusher flusher;
+  return flusher;
+}
+
+
+// sorted must be sorted and non-empty
+inline double percentile(const std::vector<float> &sorted, double p)
+{
+  double position = p * (sorted.size() - 1);
+  std::size_t lower = static_cast<std::size_t>(position);
+  std::size_t upper = std::min(lower + 1, sorted.size() - 1);
+  double fraction = position - lower;
+
+  return (1. - fraction) * sorted[lower] + fraction * sorted[upper];
+}
+
+
+// times each trial of f() with its own pair of events
+// bytes is the number of bytes each invocation of f reads & writes
+template<typename Function>
+benchmark_result benchmark(const char *algorithm, const char *implementation, const char *type,
+                           std::size_t n, std::size_t bytes,
+                           Function f,
+                           const benchmark_options &options)
+{
+  for(std::size_t i = 0; i < options.num_warmup_trials; ++i)
+  {
+    f();
+  }
+
+  cudaEvent_t start, stop;
+  cudaEventCreate(&start);
+  cudaEventCreate(&stop);
+
+  std::vector<float> msecs(options.num_trials);
+
+  for(std::size_t i = 0; i < options.num_trials; ++i)
+  {
+    if(options.flush_l2) the_l2_flusher().flush();
+
+    cudaEventRecord(start);
+    f();
+    cudaEventRecord(stop);
+    cudaEventSynchronize(stop);
+
+    cudaEventElapsedTime(&msecs[i], start, stop);
+  }
+
+  cudaEventDestroy(start);
+  cudaEventDestroy(stop);
+
+  std::sort(msecs.begin(), msecs.end());
+
+  benchmark_result result;
+  result.algorithm      = algorithm;
+  result.implementation = implementation;
+  result.type           = type;
+  result.n              = n;
+  result.bytes          = bytes;
+  result.min_msecs      = msecs.front();
+  result.median_msecs   = percentile(msecs, 0.5);
+  result.p10_msecs      = percentile(msecs, 0.1);
+  result.p90_msecs      = percentile(msecs, 0.9);
+  result.max_msecs      = msecs.back();
+
+  return result;
+}
+
+
+inline void print_benchmark_header(const benchmark_options &options)
+{
+  if(options.csv)
+  {
+    std::printf("algorithm,implementation,type,n,bytes,min_ms,median_ms,p10_ms,p90_ms,max_ms,GB/s,Gelements/s\n");
+  }
+  else
+  {
+    std::printf("%-24s %-8s %-20s %12s %10s %10s %10s %10s %10s\n", "algorithm", "impl", "type", "n", "median ms", "p10 ms", "p90 ms", "GB/s", "Gelem/s");
+  }
+}
+
+
+// rates are computed from the median
+inline void print_benchmark_result(const benchmark_result &r, const benchmark_options &options)
+{
+  double seconds = r.median_msecs / 1000.;
+  double gbytes_per_second = seconds > 0 ? r.bytes / seconds / 1e9 : 0;
+  double gelements_per_second = seconds > 0 ? r.n / seconds / 1e9 : 0;
+
+  if(options.csv)
+  {
+    std::printf("%s,%s,%s,%lu,%lu,%f,%f,%f,%f,%f,%f,%f\n",
+                r.algorithm.c_str(), r.implementation.c_str(), r.type.c_str(),
+                (unsigned long)r.n, (unsigned long)r.bytes,
+                r.min_msecs, r.median_msecs, r.p10_msecs, r.p90_msecs, r.max_msecs,
+                gbytes_per_second, gelements_per_second);
+  }
+  else
+  {
+    std::printf("%-24s %-8s %-20s %12lu %10.4f %10.4f %10.4f %10.2f %10.3f\n",
+                r.algorithm.c_str(), r.implementation.c_str(), r.type.c_str(),
+                (unsigned long)r.n,
+                r.median_msecs, r.p10_msecs, r.p90_msecs,
+                gbytes_per_second, gelements_per_second);
+  }
+
+  std::fflush(stdout);
+}
+
@@ -18,6 +18,8 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/copy.hpp> 
+#include <bulk/algorithm/async_copy.hpp>
+#include <bulk/algorithm/exchange.hpp>
 #include <bulk/algorithm/reduce.hpp>
 #include <bulk/algorithm/scan.hpp>
 #include <bulk/algorithm/accumulate.hpp>
@@ -26,5 +28,11 @@
 #include <bulk/algorithm/adjacent_difference.hpp>
 #include <bulk/algorithm/reduce_by_key.hpp>
 #include <bulk/algorithm/sort.hpp>
+#include <bulk/algorithm/radix_sort.hpp>
 #include <bulk/algorithm/gather.hpp>
+#include <bulk/algorithm/broadcast.hpp>
+#include <bulk/algorithm/load_balance.hpp>
+#include <bulk/algorithm/histogram.hpp>
+#include <bulk/algorithm/multiway_merge.hpp>
+#include <bulk/algorithm/set_operations.hpp>
 
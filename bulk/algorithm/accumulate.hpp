@@ -18,6 +18,7 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/algorithm/reduce.hpp>
+#include <bulk/malloc.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/detail/type_traits/function_traits.h>
@@ -137,12 +138,9 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     T
   > buffer_type;
 
-#if __CUDA_ARCH__ >= 200
-  buffer_type *buffer = reinterpret_cast<buffer_type*>(bulk::malloc(g, sizeof(buffer_type)));
-#else
+  // the group's size is known at compile time, so the buffer needn't come from the heap
   __shared__ uninitialized<buffer_type> buffer_impl;
   buffer_type *buffer = &buffer_impl.get();
-#endif
   
   for(; first < last; first += elements_per_group)
   {
@@ -181,9 +179,43 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     sum = accumulate_detail::destructive_accumulate_n(g, buffer->sums.data(), thrust::min<size_type>(groupsize,n), sum, binary_op);
   } // end for
 
-#if __CUDA_ARCH__ >= 200
+  return sum;
+} // end accumulate
+
+
+// the size of a dynamic group is only known at runtime, so it accumulates through the heap
+// one element per agent at a time
+template<typename RandomAccessIterator, typename T, typename BinaryFunction>
+__device__
+T accumulate(bulk::concurrent_group<> &g,
+             RandomAccessIterator first,
+             RandomAccessIterator last,
+             T init,
+             BinaryFunction binary_op)
+{
+  typedef typename bulk::concurrent_group<>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  T sum = init;
+
+  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, g.size() * sizeof(T)));
+
+  for(; first < last; first += g.size())
+  {
+    size_type partition_size = thrust::min<size_type>(g.size(), last - first);
+
+    if(tid < partition_size)
+    {
+      buffer[tid] = first[tid];
+    } // end if
+
+    g.wait();
+
+    sum = accumulate_detail::destructive_accumulate_n(g, buffer, partition_size, sum, binary_op);
+  } // end for
+
   bulk::free(g, buffer);
-#endif
 
   return sum;
 } // end accumulate
@@ -213,6 +245,28 @@ T accumulate(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g,
 } // end accumulate()
 
 
+template<typename RandomAccessIterator, typename T, typename BinaryFunction>
+__device__
+T accumulate(bulk::concurrent_group<> &g,
+             RandomAccessIterator first,
+             RandomAccessIterator last,
+             T init,
+             BinaryFunction binary_op)
+{
+  // use reduce when the operator is commutative
+  if(thrust::detail::is_commutative<BinaryFunction>::value)
+  {
+    init = bulk::reduce(g, first, last, init, binary_op);
+  } // end if
+  else
+  {
+    init = detail::accumulate_detail::accumulate(g, first, last, init, binary_op);
+  } // end else
+
+  return init;
+} // end accumulate()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -0,0 +1,218 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/detail/pointer_traits.hpp>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+// cp.async first appeared in sm_80 & CUDA 11
+#if defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 800) && defined(CUDART_VERSION) && (CUDART_VERSION >= 11000)
+#  define __BULK_HAS_CP_ASYNC__ 1
+#else
+#  define __BULK_HAS_CP_ASYNC__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace async_copy_detail
+{
+
+
+// XXX the bulk tensor copies of sm_90 (TMA) need a tensor map built on the host,
+//     so we only use cp.async for now
+__forceinline__ __device__
+void cp_async_16(void *on_chip_ptr, const void *global_ptr)
+{
+#if __BULK_HAS_CP_ASYNC__
+  unsigned int on_chip_address = static_cast<unsigned int>(__cvta_generic_to_shared(on_chip_ptr));
+
+  asm volatile("cp.async.cg.shared.global [%0], [%1], 16;\n" :: "r"(on_chip_address), "l"(global_ptr) : "memory");
+#else
+  *reinterpret_cast<uint4*>(on_chip_ptr) = *reinterpret_cast<const uint4*>(global_ptr);
+#endif
+} // end cp_async_16()
+
+
+__forceinline__ __device__
+void cp_async_commit()
+{
+#if __BULK_HAS_CP_ASYNC__
+  asm volatile("cp.async.commit_group;\n" ::: "memory");
+#endif
+} // end cp_async_commit()
+
+
+template<int num_pending>
+__forceinline__ __device__
+void cp_async_wait()
+{
+#if __BULK_HAS_CP_ASYNC__
+  asm volatile("cp.async.wait_group %0;\n" :: "n"(num_pending) : "memory");
+#endif
+} // end cp_async_wait()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+void synchronous_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  for(Size i = g.this_exec.index(); i < n; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+} // end synchronous_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  !is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value
+>::type
+  async_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  synchronous_copy_n(g, first, n, result);
+} // end async_copy_n()
+
+
+// copies the vector-aligned body of the range with cp.async, and the misaligned edges synchronously
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value
+>::type
+  async_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+  const value_type *raw_first  = thrust::raw_pointer_cast(&*first);
+  value_type       *raw_result = thrust::raw_pointer_cast(&*result);
+
+  std::size_t first_misalignment  = reinterpret_cast<std::size_t>(raw_first)  % copy_vector_size;
+  std::size_t result_misalignment = reinterpret_cast<std::size_t>(raw_result) % copy_vector_size;
+
+  // cp.async only copies from global memory into on-chip memory
+  if(!bulk::detail::is_global(raw_first) || !bulk::detail::is_shared(raw_result) ||
+     first_misalignment != result_misalignment || first_misalignment % sizeof(value_type) != 0)
+  {
+    synchronous_copy_n(g, raw_first, n, raw_result);
+    return;
+  } // end if
+
+  const Size elements_per_vector = copy_vector_size / sizeof(value_type);
+
+  Size num_prologue = first_misalignment ? (copy_vector_size - first_misalignment) / sizeof(value_type) : 0;
+  num_prologue = thrust::min<Size>(num_prologue, n);
+
+  Size num_vectors = (n - num_prologue) / elements_per_vector;
+  Size epilogue_begin = num_prologue + num_vectors * elements_per_vector;
+
+  Size tid = g.this_exec.index();
+
+  for(Size i = tid; i < num_prologue; i += g.size())
+  {
+    raw_result[i] = raw_first[i];
+  } // end for i
+
+  const uint4 *vector_first  = reinterpret_cast<const uint4*>(raw_first + num_prologue);
+  uint4       *vector_result = reinterpret_cast<uint4*>(raw_result + num_prologue);
+
+  for(Size i = tid; i < num_vectors; i += g.size())
+  {
+    cp_async_16(vector_result + i, vector_first + i);
+  } // end for i
+
+  for(Size i = epilogue_begin + tid; i < n; i += g.size())
+  {
+    raw_result[i] = raw_first[i];
+  } // end for i
+} // end async_copy_n()
+
+
+} // end async_copy_detail
+} // end detail
+
+
+// begins copying [first, first + n) to result without waiting for the copy to complete,
+// so that the group may compute on a previously-staged tile in the meantime
+// each call begins a new batch of copies; wait_for_async_copies() completes them in order
+// result should point into the on-chip heap; when the copy can't be performed asynchronously
+// (pre-sm_80, non-contiguous or misaligned ranges, or an off-chip result), it is performed synchronously
+//
+// double buffering example:
+//
+//   bulk::async_copy_n(g, first, tile_size, stage[0]);
+//
+//   for(int tile = 0; tile < num_tiles; ++tile)
+//   {
+//     if(tile + 1 < num_tiles)
+//     {
+//       bulk::async_copy_n(g, first + (tile + 1) * tile_size, tile_size, stage[(tile + 1) % 2]);
+//       bulk::wait_for_async_copies<1>(g);
+//     }
+//     else
+//     {
+//       bulk::wait_for_async_copies<0>(g);
+//     }
+//
+//     compute(stage[tile % 2]);
+//
+//     g.wait();
+//   }
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2>
+__forceinline__ __device__
+void async_copy_n(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 first,
+                  Size n,
+                  RandomAccessIterator2 result)
+{
+  detail::async_copy_detail::async_copy_n(g, first, n, result);
+  detail::async_copy_detail::cp_async_commit();
+} // end async_copy_n()
+
+
+// waits until no more than num_pending of the most recent batches of copies begun by async_copy_n()
+// remain in flight, then waits for the group so the completed batches are visible to every agent
+template<int num_pending,
+         std::size_t groupsize,
+         std::size_t grainsize>
+__forceinline__ __device__
+void wait_for_async_copies(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g)
+{
+  detail::async_copy_detail::cp_async_wait<num_pending>();
+  g.wait();
+} // end wait_for_async_copies()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
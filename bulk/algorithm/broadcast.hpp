@@ -0,0 +1,40 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/shuffle.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// every agent of the warp receives the x of the agent with index root
+template<typename ExecutionAgent, typename T>
+__device__
+T broadcast(bulk::warp_group<ExecutionAgent> &g, const T &x, typename bulk::warp_group<ExecutionAgent>::size_type root = 0)
+{
+  return bulk::detail::shuffle(x, root);
+} // end broadcast()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -21,6 +21,10 @@
 #include <bulk/detail/is_contiguous_iterator.hpp>
 #include <bulk/detail/pointer_traits.hpp>
 #include <thrust/detail/type_traits.h>
+#include <thrust/detail/raw_pointer_cast.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
 
 
 BULK_NAMESPACE_PREFIX
@@ -166,6 +170,107 @@ typename thrust::detail::enable_if<
 } // end simple_copy_n()
 
 
+// the size of the transactions vectorized_copy_n issues
+const std::size_t copy_vector_size = sizeof(uint4);
+
+
+// we can copy in vector transactions between contiguous ranges of the same small, trivially-copyable type
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct is_vectorizable_copy
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type1;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type2;
+
+  static const bool value =
+    is_contiguous_iterator<RandomAccessIterator1>::value &&
+    is_contiguous_iterator<RandomAccessIterator2>::value &&
+    thrust::detail::is_same<value_type1,value_type2>::value &&
+    thrust::detail::has_trivial_assign<value_type1>::value &&
+    (sizeof(value_type1) < copy_vector_size) &&
+    (copy_vector_size % sizeof(value_type1) == 0);
+};
+
+
+// copies [first, first + n) with a scalar prologue up to the first vector-aligned element,
+// vector transactions through the aligned body, and a scalar epilogue for the remainder
+// first and result must be equally misaligned
+template<typename ConcurrentGroup, typename T, typename Size>
+__forceinline__ __device__
+void vectorized_copy_n(ConcurrentGroup &g, const T *first, Size n, T *result)
+{
+  const Size elements_per_vector = copy_vector_size / sizeof(T);
+
+  Size misalignment = reinterpret_cast<std::size_t>(first) % copy_vector_size;
+  Size num_prologue = misalignment ? (copy_vector_size - misalignment) / sizeof(T) : 0;
+  num_prologue = thrust::min<Size>(num_prologue, n);
+
+  Size num_vectors = (n - num_prologue) / elements_per_vector;
+  Size epilogue_begin = num_prologue + num_vectors * elements_per_vector;
+
+  Size tid = g.this_exec.index();
+
+  for(Size i = tid; i < num_prologue; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+
+  const uint4 *vector_first  = reinterpret_cast<const uint4*>(first + num_prologue);
+  uint4       *vector_result = reinterpret_cast<uint4*>(result + num_prologue);
+
+  for(Size i = tid; i < num_vectors; i += g.size())
+  {
+    vector_result[i] = vector_first[i];
+  } // end for i
+
+  for(Size i = epilogue_begin + tid; i < n; i += g.size())
+  {
+    result[i] = first[i];
+  } // end for i
+
+  g.wait();
+} // end vectorized_copy_n()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  !is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value,
+  bool
+>::type
+  try_vectorized_copy_n(ConcurrentGroup &, RandomAccessIterator1, Size, RandomAccessIterator2)
+{
+  return false;
+} // end try_vectorized_copy_n()
+
+
+// returns false without copying anything when first and result can't be aligned to a vector together
+template<typename ConcurrentGroup, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  is_vectorizable_copy<RandomAccessIterator1,RandomAccessIterator2>::value,
+  bool
+>::type
+  try_vectorized_copy_n(ConcurrentGroup &g, RandomAccessIterator1 first, Size n, RandomAccessIterator2 result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+  const value_type *raw_first  = thrust::raw_pointer_cast(&*first);
+  value_type       *raw_result = thrust::raw_pointer_cast(&*result);
+
+  std::size_t first_misalignment  = reinterpret_cast<std::size_t>(raw_first)  % copy_vector_size;
+  std::size_t result_misalignment = reinterpret_cast<std::size_t>(raw_result) % copy_vector_size;
+
+  if(first_misalignment != result_misalignment || first_misalignment % sizeof(value_type) != 0)
+  {
+    return false;
+  } // end if
+
+  vectorized_copy_n(g, raw_first, n, raw_result);
+
+  return true;
+} // end try_vectorized_copy_n()
+
+
 template<std::size_t size,
          std::size_t grainsize,
          typename RandomAccessIterator1,
@@ -180,10 +285,48 @@ RandomAccessIterator2 copy_n(concurrent_group<
                              Size n,
                              RandomAccessIterator2 result)
 {
+  if(detail::try_vectorized_copy_n(g, first, n, result))
+  {
+    return result + n;
+  } // end if
+
   return detail::simple_copy_n(g, first, n, result);
 } // end copy_n()
 
 
+// copies [first1, first1 + n1) followed by [first2, first2 + n2) to result,
+// as through a join_iterator, but split into a loop per range rather than
+// choosing a range at every element
+// the ranges share a single barrier
+template<typename ConcurrentGroup,
+         typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3>
+__forceinline__ __device__
+RandomAccessIterator3 copy_joined_n(ConcurrentGroup &g,
+                                    RandomAccessIterator1 first1, Size n1,
+                                    RandomAccessIterator2 first2, Size n2,
+                                    RandomAccessIterator3 result)
+{
+  for(Size i = g.this_exec.index(); i < n1; i += g.size())
+  {
+    result[i] = first1[i];
+  } // end for i
+
+  RandomAccessIterator3 result2 = result + n1;
+
+  for(Size i = g.this_exec.index(); i < n2; i += g.size())
+  {
+    result2[i] = first2[i];
+  } // end for i
+
+  g.wait();
+
+  return result2 + n2;
+} // end copy_joined_n()
+
+
 } // end detail
 
 
@@ -231,6 +374,11 @@ copy_n(bulk::bounded<
 
   typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
 
+  if(detail::try_vectorized_copy_n(g, first, thrust::min<Size>(g.size() * grainsize, n), result))
+  {
+    return result + thrust::min<Size>(g.size() * grainsize, n);
+  } // end if
+
   // XXX make this an uninitialized array
   value_type stage[grainsize];
 
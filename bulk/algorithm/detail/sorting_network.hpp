@@ -0,0 +1,234 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <thrust/detail/swap.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace sorting_network_detail
+{
+
+
+// Batcher's merge-exchange network, generated at compile time for any bound.
+// For the bounds we sort in registers it performs far fewer compare-exchanges than odd-even
+// transposition sort (e.g. 16 vs 21 at 7, 59 vs 105 at 15), and since every index is a
+// compile-time constant, arrays in registers stay in registers.
+// The network doesn't only exchange neighbors, so ties are broken by each element's original
+// position to keep the sort stable
+
+
+struct no_values {};
+
+
+template<typename RandomAccessIterator>
+__forceinline__ __device__
+void swap_at(RandomAccessIterator x, int a, int b)
+{
+  using thrust::swap;
+  swap(x[a], x[b]);
+} // end swap_at()
+
+
+__forceinline__ __device__
+void swap_at(no_values, int, int) {}
+
+
+// elements at positions beyond n behave as if they were larger than every other element
+template<int a, int b>
+struct compare_exchange
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    if(b < n)
+    {
+      if(comp(keys[b], keys[a]) || (!comp(keys[a], keys[b]) && order[b] < order[a]))
+      {
+        swap_at(keys, a, b);
+        swap_at(values, a, b);
+        swap_at(order, a, b);
+      } // end if
+    } // end if
+  } // end apply()
+};
+
+
+// the four loops of the merge-exchange, each unrolled by recursion:
+//
+//   for(p = 1; p < bound; p *= 2)
+//     for(k = p; k >= 1; k /= 2)
+//       for(j = k % p; j < bound - k; j += 2 * k)
+//         for(i = 0; i < k && i < bound - j - k; ++i)
+//           if((i + j) / (2 * p) == (i + j + k) / (2 * p))
+//             compare_exchange(i + j, i + j + k)
+
+
+template<int p, int i, int j, int k, bool = ((i + j) / (2 * p) == (i + j + k) / (2 * p))>
+struct maybe_compare_exchange
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    compare_exchange<i + j, i + j + k>::apply(keys, values, order, n, comp);
+  }
+};
+
+
+template<int p, int i, int j, int k>
+struct maybe_compare_exchange<p,i,j,k,false>
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) {}
+};
+
+
+template<int bound, int p, int k, int j, int i, bool = (i < k) && (i < bound - j - k)>
+struct merge_exchange_i
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    maybe_compare_exchange<p,i,j,k>::apply(keys, values, order, n, comp);
+    merge_exchange_i<bound,p,k,j,i+1>::apply(keys, values, order, n, comp);
+  }
+};
+
+
+template<int bound, int p, int k, int j, int i>
+struct merge_exchange_i<bound,p,k,j,i,false>
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) {}
+};
+
+
+template<int bound, int p, int k, int j, bool = (j < bound - k)>
+struct merge_exchange_j
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    merge_exchange_i<bound,p,k,j,0>::apply(keys, values, order, n, comp);
+    merge_exchange_j<bound,p,k,j + 2 * k>::apply(keys, values, order, n, comp);
+  }
+};
+
+
+template<int bound, int p, int k, int j>
+struct merge_exchange_j<bound,p,k,j,false>
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) {}
+};
+
+
+template<int bound, int p, int k, bool = (k >= 1)>
+struct merge_exchange_k
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    merge_exchange_j<bound,p,k,k % p>::apply(keys, values, order, n, comp);
+    merge_exchange_k<bound,p,k / 2>::apply(keys, values, order, n, comp);
+  }
+};
+
+
+template<int bound, int p, int k>
+struct merge_exchange_k<bound,p,k,false>
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) {}
+};
+
+
+template<int bound, int p, bool = (p < bound)>
+struct merge_exchange_p
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1 keys, RandomAccessIterator2 values, int *order, int n, Compare comp)
+  {
+    merge_exchange_k<bound,p,p>::apply(keys, values, order, n, comp);
+    merge_exchange_p<bound,2 * p>::apply(keys, values, order, n, comp);
+  }
+};
+
+
+template<int bound, int p>
+struct merge_exchange_p<bound,p,false>
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+  static __forceinline__ __device__
+  void apply(RandomAccessIterator1, RandomAccessIterator2, int *, int, Compare) {}
+};
+
+
+template<int bound, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+__forceinline__ __device__
+void stable_sort_by_key(RandomAccessIterator1 keys, RandomAccessIterator2 values, int n, Compare comp)
+{
+  int order[bound];
+
+  for(int i = 0; i < bound; ++i)
+  {
+    order[i] = i;
+  } // end for i
+
+  merge_exchange_p<bound,1>::apply(keys, values, order, n, comp);
+} // end stable_sort_by_key()
+
+
+} // end sorting_network_detail
+
+
+// sorts the n <= bound elements of [keys, keys + n) with a sorting network
+template<int bound, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+__forceinline__ __device__
+void stable_sorting_network_sort_by_key(RandomAccessIterator1 keys, RandomAccessIterator2 values, int n, Compare comp)
+{
+  sorting_network_detail::stable_sort_by_key<bound>(keys, values, n, comp);
+} // end stable_sorting_network_sort_by_key()
+
+
+template<int bound, typename RandomAccessIterator, typename Compare>
+__forceinline__ __device__
+void stable_sorting_network_sort(RandomAccessIterator keys, int n, Compare comp)
+{
+  sorting_network_detail::stable_sort_by_key<bound>(keys, sorting_network_detail::no_values(), n, comp);
+} // end stable_sorting_network_sort()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
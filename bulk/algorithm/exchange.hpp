@@ -0,0 +1,271 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a tile of groupsize * grainsize elements may be distributed among a group's agents in two ways:
+//   blocked: agent i holds the consecutive elements [grainsize * i, grainsize * (i + 1))
+//   striped: agent i holds the elements i, i + groupsize, i + 2 * groupsize, ...
+// the striped arrangement makes each step of a traversal of a tile in global memory coalesced,
+// while the blocked arrangement is what sequential per-agent algorithms want
+// the functions below trade one arrangement for the other through a buffer, which
+// should reside in on-chip memory and hold exchange_buffer_size<groupsize * grainsize>::value elements
+
+
+// the buffer skips one slot after every 32 elements, so that agents of the same warp
+// which access consecutive runs of grainsize elements fall onto distinct banks
+template<std::size_t n>
+struct exchange_buffer_size
+{
+  static const std::size_t value = n + n / 32;
+};
+
+
+namespace detail
+{
+namespace exchange_detail
+{
+
+
+__forceinline__ __device__
+int padded_index(int i)
+{
+  return i + (i >> 5);
+} // end padded_index()
+
+
+} // end exchange_detail
+} // end detail
+
+
+// on entry, local holds this agent's elements in the blocked arrangement
+// on exit, local holds this agent's elements in the striped arrangement
+// the buffer may be reused upon return
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename RandomAccessIterator>
+__forceinline__ __device__
+void blocked_to_striped(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                        T (&local)[grainsize],
+                        RandomAccessIterator buffer)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    buffer[detail::exchange_detail::padded_index(grainsize * tid + i)] = local[i];
+  } // end for i
+
+  g.wait();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    local[i] = buffer[detail::exchange_detail::padded_index(groupsize * i + tid)];
+  } // end for i
+
+  g.wait();
+} // end blocked_to_striped()
+
+
+// on entry, local holds this agent's elements in the striped arrangement
+// on exit, local holds this agent's elements in the blocked arrangement
+// the buffer may be reused upon return
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename RandomAccessIterator>
+__forceinline__ __device__
+void striped_to_blocked(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                        T (&local)[grainsize],
+                        RandomAccessIterator buffer)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    buffer[detail::exchange_detail::padded_index(groupsize * i + tid)] = local[i];
+  } // end for i
+
+  g.wait();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    local[i] = buffer[detail::exchange_detail::padded_index(grainsize * tid + i)];
+  } // end for i
+
+  g.wait();
+} // end striped_to_blocked()
+
+
+// loads the first n <= groupsize * grainsize elements of a tile into local in the striped arrangement
+// elements of local beyond the end of the tile are left untouched
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename Size, typename T>
+__forceinline__ __device__
+void load_striped(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator first, Size n,
+                  T (&local)[grainsize])
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  first += tid;
+
+  // important special case which avoids the comparisons below
+  if(n == groupsize * grainsize)
+  {
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      local[i] = first[groupsize * i];
+    } // end for i
+  } // end if
+  else
+  {
+    size_type num_elements = n;
+
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      if(groupsize * i + tid < num_elements)
+      {
+        local[i] = first[groupsize * i];
+      } // end if
+    } // end for i
+  } // end else
+} // end load_striped()
+
+
+// stores the first n <= groupsize * grainsize elements of a tile held in local in the striped arrangement
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename Size, typename RandomAccessIterator>
+__forceinline__ __device__
+void store_striped(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                   const T (&local)[grainsize],
+                   Size n,
+                   RandomAccessIterator result)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+
+  result += tid;
+
+  if(n == groupsize * grainsize)
+  {
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      result[groupsize * i] = local[i];
+    } // end for i
+  } // end if
+  else
+  {
+    size_type num_elements = n;
+
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      if(groupsize * i + tid < num_elements)
+      {
+        result[groupsize * i] = local[i];
+      } // end if
+    } // end for i
+  } // end else
+} // end store_striped()
+
+
+// loads the first n <= groupsize * grainsize elements of a tile with coalesced accesses
+// and delivers them to local in the blocked arrangement
+// elements of local beyond the end of the tile are unspecified
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename T, typename RandomAccessIterator2>
+__forceinline__ __device__
+void load_blocked(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 first, Size n,
+                  T (&local)[grainsize],
+                  RandomAccessIterator2 buffer)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+  size_type num_elements = n;
+
+  // go straight to the buffer rather than through a striped copy of local
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    size_type idx = groupsize * i + tid;
+
+    if(idx < num_elements)
+    {
+      buffer[detail::exchange_detail::padded_index(idx)] = first[idx];
+    } // end if
+  } // end for i
+
+  g.wait();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    local[i] = buffer[detail::exchange_detail::padded_index(grainsize * tid + i)];
+  } // end for i
+
+  g.wait();
+} // end load_blocked()
+
+
+// stores the first n <= groupsize * grainsize elements of a tile held in local
+// in the blocked arrangement with coalesced accesses
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename Size, typename RandomAccessIterator1, typename RandomAccessIterator2>
+__forceinline__ __device__
+void store_blocked(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                   const T (&local)[grainsize],
+                   Size n,
+                   RandomAccessIterator1 result,
+                   RandomAccessIterator2 buffer)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  size_type tid = g.this_exec.index();
+  size_type num_elements = n;
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    buffer[detail::exchange_detail::padded_index(grainsize * tid + i)] = local[i];
+  } // end for i
+
+  g.wait();
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    size_type idx = groupsize * i + tid;
+
+    if(idx < num_elements)
+    {
+      result[idx] = buffer[detail::exchange_detail::padded_index(idx)];
+    } // end if
+  } // end for i
+
+  g.wait();
+} // end store_blocked()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -66,6 +66,8 @@ RandomAccessIterator3 gather(const bounded<bound,agent<grainsize> > &,
 } // end scatter_if()
 
 
+// to gather from a lookup table which the kernel doesn't write through the read-only data cache,
+// pass bulk::make_read_only_iterator(table) as input_first
 template<typename ExecutionGroup, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3>
 __forceinline__ __device__
 RandomAccessIterator3 gather(ExecutionGroup &g,
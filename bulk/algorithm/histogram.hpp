@@ -0,0 +1,184 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// maps samples in [lower, upper) to num_bins bins of equal width
+// samples outside of [lower, upper) map to -1
+template<typename T>
+struct even_bins
+{
+  T      lower;
+  T      upper;
+  int    num_bins;
+  double scale;
+
+  __host__ __device__
+  even_bins(T lower, T upper, int num_bins)
+    : lower(lower), upper(upper), num_bins(num_bins),
+      scale(double(num_bins) / (double(upper) - double(lower)))
+  {}
+
+  __host__ __device__
+  int operator()(const T &x) const
+  {
+    if(x < lower || !(x < upper)) return -1;
+
+    int result = static_cast<int>((double(x) - double(lower)) * scale);
+
+    // guard against rounding past the last bin
+    return result < num_bins ? result : num_bins - 1;
+  }
+};
+
+
+namespace detail
+{
+namespace histogram_detail
+{
+
+
+// returns a buffer all agents of g share from the on-chip heap, or null if it doesn't fit
+// unlike bulk::malloc, this never spills into global memory
+template<typename ConcurrentGroup>
+__device__
+inline void *on_chip_malloc(ConcurrentGroup &g, std::size_t num_bytes)
+{
+  __shared__ void *s_result;
+
+  g.wait();
+
+  if(g.this_exec.index() == 0)
+  {
+    s_result = bulk::detail::unsafe_on_chip_malloc(num_bytes);
+  } // end if
+
+  g.wait();
+
+  return s_result;
+} // end on_chip_malloc()
+
+
+template<typename ConcurrentGroup, typename RandomAccessIterator, typename BinFunction, typename Counter>
+__device__
+void count(ConcurrentGroup &g,
+           RandomAccessIterator first, RandomAccessIterator last,
+           int num_bins,
+           BinFunction bin,
+           Counter *bins,
+           int bins_stride)
+{
+  typedef typename ConcurrentGroup::size_type size_type;
+
+  size_type n = last - first;
+
+  // lanes of a warp share a copy when the bins are privatized per warp
+  Counter *my_bins = bins + (g.this_exec.index() / 32) * bins_stride;
+
+  for(size_type i = g.this_exec.index(); i < n; i += g.size())
+  {
+    int b = bin(first[i]);
+
+    if(0 <= b && b < num_bins)
+    {
+      atomicAdd(my_bins + b, Counter(1));
+    } // end if
+  } // end for i
+} // end count()
+
+
+} // end histogram_detail
+} // end detail
+
+
+// adds the number of elements of [first, last) which bin maps to each of [0, num_bins) to result.
+// Samples which bin maps outside of [0, num_bins) are ignored. Counter must be a type atomicAdd accepts.
+//
+// The group counts into private copies of the bins in the on-chip heap -- one per warp when they fit,
+// otherwise one shared by the whole group -- to spread contention, and then merges them into result
+// with one atomic per nonzero bin. When not even one copy fits, the group counts directly into result
+template<typename ExecutionAgent, std::size_t groupsize, typename RandomAccessIterator, typename BinFunction, typename Counter>
+__device__
+void histogram(bulk::concurrent_group<ExecutionAgent,groupsize> &g,
+               RandomAccessIterator first, RandomAccessIterator last,
+               int num_bins,
+               BinFunction bin,
+               Counter *result)
+{
+  typedef typename bulk::concurrent_group<ExecutionAgent,groupsize>::size_type size_type;
+
+  const size_type num_warps = (g.size() + 31) / 32;
+
+  int num_copies = num_warps;
+  Counter *bins = static_cast<Counter*>(detail::histogram_detail::on_chip_malloc(g, num_copies * num_bins * sizeof(Counter)));
+
+  if(bins == 0 && num_copies > 1)
+  {
+    num_copies = 1;
+    bins = static_cast<Counter*>(detail::histogram_detail::on_chip_malloc(g, num_bins * sizeof(Counter)));
+  } // end if
+
+  if(bins == 0)
+  {
+    // too many bins to privatize
+    detail::histogram_detail::count(g, first, last, num_bins, bin, result, 0);
+    g.wait();
+    return;
+  } // end if
+
+  for(size_type i = g.this_exec.index(); i < num_copies * num_bins; i += g.size())
+  {
+    bins[i] = 0;
+  } // end for i
+  g.wait();
+
+  detail::histogram_detail::count(g, first, last, num_bins, bin, bins, num_copies > 1 ? num_bins : 0);
+  g.wait();
+
+  // merge the private copies into the result
+  for(size_type i = g.this_exec.index(); i < num_bins; i += g.size())
+  {
+    Counter sum = bins[i];
+
+    for(int copy = 1; copy < num_copies; ++copy)
+    {
+      sum += bins[copy * num_bins + i];
+    } // end for copy
+
+    if(sum != Counter(0))
+    {
+      atomicAdd(result + i, sum);
+    } // end if
+  } // end for i
+
+  bulk::free(g, bins);
+} // end histogram()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
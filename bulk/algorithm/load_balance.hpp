@@ -0,0 +1,185 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace load_balance_detail
+{
+
+
+// load-balancing search treats the items & the segments' first items as two sorted sequences
+// to be merged. A segment's start precedes each item at or after it, so that in the merged order
+// each item follows the start of the segment containing it. Splitting the merged sequence into
+// equal tiles gives each group the same amount of work, however the items are distributed among segments
+struct start_precedes_item
+{
+  template<typename Offset, typename Size>
+  __host__ __device__
+  bool operator()(const Offset &segment_first, const Size &item)
+  {
+    return segment_first <= item;
+  }
+};
+
+
+// returns the number of items among the first diag elements of the merged sequence
+template<typename RandomAccessIterator, typename Size>
+__host__ __device__
+Size load_balance_path(RandomAccessIterator offsets_first, Size num_segments, Size num_items, Size diag)
+{
+  // XXX this duplicates bulk::merge_path, which is __device__-only
+  Size begin = thrust::max<Size>(Size(0), diag - num_segments);
+  Size end   = thrust::min<Size>(diag, num_items);
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(start_precedes_item()(offsets_first[diag - 1 - mid], mid))
+    {
+      end = mid;
+    } // end if
+    else
+    {
+      begin = mid + 1;
+    } // end else
+  } // end while
+
+  return begin;
+} // end load_balance_path()
+
+
+// visits each item of the tile [diag_first, diag_last) of the merged sequence, which contains
+// the items [items_first, items_last)
+// stage must hold the tile's segment starts: at most groupsize * grainsize Sizes
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename Size, typename Function>
+__device__
+void load_balance_tile(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator offsets_first,
+                       Size diag_first, Size diag_last,
+                       Size items_first, Size items_last,
+                       Size *stage,
+                       Function f)
+{
+  Size segments_first = diag_first - items_first;
+  Size segments_last  = diag_last  - items_last;
+  Size num_starts     = segments_last - segments_first;
+
+  // stage the starts of the segments beginning in this tile
+  bulk::copy_n(g, offsets_first + segments_first, num_starts, stage);
+  g.wait();
+
+  // find the start of each agent's share of the tile
+  Size local_diag = thrust::min<Size>(grainsize * g.this_exec.index(), diag_last - diag_first);
+
+  Size local_items = bulk::merge_path(thrust::make_counting_iterator<Size>(items_first), items_last - items_first,
+                                      stage, num_starts,
+                                      local_diag,
+                                      start_precedes_item());
+
+  Size item  = items_first + local_items;
+  Size start = local_diag - local_items;
+
+  // the segment containing item began before any start this agent will consume
+  Size segment = segments_first + start - 1;
+  Size segment_first = 0;
+
+  if(segments_first + start > 0)
+  {
+    segment_first = (start > 0) ? stage[start - 1] : offsets_first[segment];
+  } // end if
+
+  // walk the agent's share of the merged sequence
+  Size local_size = thrust::min<Size>(grainsize, diag_last - diag_first - local_diag);
+
+  for(Size i = 0; i < grainsize; ++i)
+  {
+    if(i < local_size)
+    {
+      if(start < num_starts && (item == items_last || start_precedes_item()(stage[start], item)))
+      {
+        segment       = segments_first + start;
+        segment_first = stage[start];
+        ++start;
+      } // end if
+      else
+      {
+        f(item, segment, item - segment_first);
+        ++item;
+      } // end else
+    } // end if
+  } // end for i
+
+  g.wait();
+} // end load_balance_tile()
+
+
+} // end load_balance_detail
+} // end detail
+
+
+// for each of the num_items items distributed among num_segments segments, invokes
+// f(item, segment, rank), where rank is item's position within segment.
+// offsets_first[i] is the first item of segment i, and offsets_first[0] must be 0.
+// Each agent visits the same number of items & segment boundaries, no matter how unevenly
+// the items are distributed among segments
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename Size, typename Function>
+__device__
+void load_balanced_for_each(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                            RandomAccessIterator offsets_first,
+                            Size num_segments,
+                            Size num_items,
+                            Function f)
+{
+  const Size tile_size = groupsize * grainsize;
+
+  Size n = num_items + num_segments;
+
+  Size *stage = static_cast<Size*>(bulk::malloc(g, tile_size * sizeof(Size)));
+
+  Size items_first = 0;
+
+  for(Size diag_first = 0; diag_first < n; diag_first += tile_size)
+  {
+    Size diag_last  = thrust::min<Size>(n, diag_first + tile_size);
+    Size items_last = bulk::detail::load_balance_detail::load_balance_path(offsets_first, num_segments, num_items, diag_last);
+
+    bulk::detail::load_balance_detail::load_balance_tile(g, offsets_first, diag_first, diag_last, items_first, items_last, stage, f);
+
+    items_first = items_last;
+  } // end for
+
+  bulk::free(g, stage);
+} // end load_balanced_for_each()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -20,10 +20,9 @@
 #include <bulk/execution_policy.hpp>
 #include <bulk/malloc.hpp>
 #include <bulk/algorithm/copy.hpp>
-#include <bulk/algorithm/gather.hpp>
+#include <bulk/algorithm/exchange.hpp>
 #include <bulk/uninitialized.hpp>
 #include <thrust/iterator/counting_iterator.h>
-#include <thrust/iterator/detail/join_iterator.h>
 #include <thrust/detail/minmax.h>
 
 
@@ -430,20 +429,30 @@ RandomAccessIterator4
   size_type n1 = last1 - first1;
   size_type n2 = last2 - first2;
 
+  size_type n = n1 + n2;
+
   // copy into the buffer
-  bulk::copy_n(bulk::bound<groupsize * grainsize>(exec),
-               thrust::detail::make_join_iterator(first1, n1, first2),
-               n1 + n2,
-               buffer);
-
-  // inplace merge in the buffer
-  bulk::inplace_merge(bulk::bound<groupsize * grainsize>(exec),
-                      buffer, buffer + n1, buffer + n1 + n2,
-                      comp);
-  
-  // copy to the result
-  // XXX this might be slightly faster with a bounded copy_n
-  return bulk::copy_n(exec, buffer, n1 + n2, result);
+  bulk::detail::copy_joined_n(exec, first1, n1, first2, n2, buffer);
+
+  // find the start of each agent's sequential merge
+  size_type local_offset = grainsize * exec.this_exec.index();
+  size_type diag = thrust::min<size_type>(n, local_offset);
+  size_type mp = bulk::merge_path(buffer, n1, buffer + n1, n2, diag, comp);
+
+  typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
+  value_type local_result[grainsize];
+  bulk::merge(bulk::bound<grainsize>(exec.this_exec),
+              buffer + mp, buffer + n1,
+              buffer + n1 + diag - mp, buffer + n,
+              local_result,
+              comp);
+
+  exec.wait();
+
+  // transpose the merged elements through the buffer & store them with coalesced accesses
+  bulk::store_blocked(exec, local_result, n, result, buffer);
+
+  return result + n;
 } // end bounded_merge_with_buffer()
 
 
@@ -463,7 +472,7 @@ RandomAccessIterator3 merge(bulk::concurrent_group<bulk::agent<grainsize>,groups
 
   typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
 
-  value_type *buffer = reinterpret_cast<value_type*>(bulk::malloc(exec, exec.size() * exec.grainsize() * sizeof(value_type)));
+  value_type *buffer = reinterpret_cast<value_type*>(bulk::malloc(exec, bulk::exchange_buffer_size<groupsize * grainsize>::value * sizeof(value_type)));
 
   size_type chunk_size = exec.size() * exec.this_exec.grainsize();
 
@@ -530,6 +539,8 @@ merge_by_key(bulk::bounded<
 
   typedef typename thrust::iterator_value<RandomAccessIterator5>::type key_type;
 
+  const std::size_t stage_size = bulk::exchange_buffer_size<groupsize * grainsize>::value;
+
 #if __CUDA_ARCH__ >= 200
   union
   {
@@ -537,12 +548,12 @@ merge_by_key(bulk::bounded<
     size_type *indices;
   } stage;
 
-  stage.keys = static_cast<key_type*>(bulk::malloc(g, groupsize * grainsize * thrust::max(sizeof(key_type), sizeof(size_type))));
+  stage.keys = static_cast<key_type*>(bulk::malloc(g, stage_size * thrust::max(sizeof(key_type), sizeof(size_type))));
 #else
   __shared__ union
   {
-    key_type  keys[groupsize * grainsize];
-    size_type indices[groupsize * grainsize];
+    key_type  keys[stage_size];
+    size_type indices[stage_size];
   } stage;
 #endif
 
@@ -551,10 +562,7 @@ merge_by_key(bulk::bounded<
   size_type  n = n1 + n2;
   
   // copy keys into stage
-  bulk::copy_n(g,
-               thrust::detail::make_join_iterator(keys_first1, n1, keys_first2),
-               n,
-               stage.keys);
+  bulk::detail::copy_joined_n(g, keys_first1, n1, keys_first2, n2, stage.keys);
 
   // find the start of each agent's sequential merge
   size_type diag = thrust::min<size_type>(n1 + n2, grainsize * g.this_exec.index());
@@ -580,24 +588,26 @@ merge_by_key(bulk::bounded<
                      comp);
   g.wait();
   
-  // each agent stores merged keys back to the stage
-  size_type local_offset = grainsize * g.this_exec.index();
-  size_type local_size = thrust::max<size_type>(0, thrust::min<size_type>(grainsize, n - local_offset));
-  bulk::copy_n(bulk::bound<grainsize>(g.this_exec), results, local_size, stage.keys + local_offset);
-  g.wait();
-  
-  // store merged keys to the result
-  keys_result = bulk::copy_n(g, stage.keys, n, keys_result);
-  
-  // each agent copies the indices into the stage
-  bulk::copy_n(bulk::bound<grainsize>(g.this_exec), indices, local_size, stage.indices + local_offset);
-  g.wait();
-  
-  // gather values into merged order
-  values_result = bulk::gather(g,
-                               stage.indices, stage.indices + n,
-                               thrust::detail::make_join_iterator(values_first1, n1, values_first2),
-                               values_result);
+  // transpose the merged keys through the stage & store them with coalesced accesses
+  bulk::store_blocked(g, results, n, keys_result, stage.keys);
+  keys_result += n;
+
+  // transpose the indices so that each agent gathers values in the striped arrangement
+  bulk::blocked_to_striped(g, indices, stage.indices);
+
+  for(size_type i = 0; i < grainsize; ++i)
+  {
+    size_type idx = groupsize * i + g.this_exec.index();
+
+    if(idx < n)
+    {
+      size_type src = indices[i];
+
+      values_result[idx] = (src < n1) ? values_first1[src] : values_first2[src - n1];
+    } // end if
+  } // end for i
+
+  values_result += n;
 
 #if __CUDA_ARCH__ >= 200
   bulk::free(g, stage.keys);
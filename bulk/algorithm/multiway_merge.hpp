@@ -0,0 +1,238 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace multiway_merge_detail
+{
+
+
+// returns the number of elements of [first + begin, first + end) which precede key in a stable merge:
+// earlier runs' elements equivalent to key precede it, while later runs' do not
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__host__ __device__
+Size count_preceding(RandomAccessIterator first, Size begin, Size end, const T &key, bool earlier_run, Compare comp)
+{
+  Size n = end - begin;
+  Size lo = 0, hi = n;
+
+  while(lo < hi)
+  {
+    Size mid = (lo + hi) >> 1;
+
+    bool precedes = earlier_run ? !comp(key, first[begin + mid]) : comp(first[begin + mid], key);
+
+    if(precedes)
+    {
+      lo = mid + 1;
+    } // end if
+    else
+    {
+      hi = mid;
+    } // end else
+  } // end while
+
+  return lo;
+} // end count_preceding()
+
+
+// returns the position of first[i], which belongs to the run'th run, in the stable merge of the runs
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+__host__ __device__
+Size rank(RandomAccessIterator1 first, RandomAccessIterator2 run_offsets, int num_runs, int run, Size i, Compare comp)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  key_type key = first[i];
+
+  Size result = i - Size(run_offsets[run]);
+
+  for(int q = 0; q < num_runs; ++q)
+  {
+    if(q != run)
+    {
+      result += count_preceding<RandomAccessIterator1,Size>(first, run_offsets[q], run_offsets[q + 1], key, q < run, comp);
+    } // end if
+  } // end for q
+
+  return result;
+} // end rank()
+
+
+// returns the run containing position i
+template<typename RandomAccessIterator, typename Size>
+__host__ __device__
+int find_run(RandomAccessIterator run_offsets, int num_runs, Size i)
+{
+  // find the last run beginning at or before i, which skips empty runs
+  int lo = 0, hi = num_runs;
+
+  while(lo < hi)
+  {
+    int mid = (lo + hi + 1) >> 1;
+
+    if(Size(run_offsets[mid]) <= i)
+    {
+      lo = mid;
+    } // end if
+    else
+    {
+      hi = mid - 1;
+    } // end else
+  } // end while
+
+  return lo;
+} // end find_run()
+
+
+} // end multiway_merge_detail
+} // end detail
+
+
+// generalizes merge_path to num_runs sorted runs:
+// returns the number of elements of the run'th run which precede the diag'th element of the runs' stable merge.
+// The runs are consecutive: run q is [first + run_offsets[q], first + run_offsets[q + 1]), and
+// equivalent elements of earlier runs precede those of later runs.
+// Summed over every run, the results equal diag, so num_runs agents may search for one diagonal in parallel
+// XXX each step of the search ranks an element among every run, so the cost grows with num_runs^2
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+__host__ __device__
+Size multiway_merge_path(RandomAccessIterator1 first,
+                         RandomAccessIterator2 run_offsets,
+                         int num_runs,
+                         int run,
+                         Size diag,
+                         Compare comp)
+{
+  Size run_begin = run_offsets[run];
+  Size run_size  = Size(run_offsets[run + 1]) - run_begin;
+
+  // within a run, positions in the merge increase with position in the run,
+  // so search for the first element positioned at or after the diagonal
+  Size begin = 0;
+  Size end = thrust::min<Size>(run_size, diag);
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(detail::multiway_merge_detail::rank(first, run_offsets, num_runs, run, run_begin + mid, comp) < diag)
+    {
+      begin = mid + 1;
+    } // end if
+    else
+    {
+      end = mid;
+    } // end else
+  } // end while
+
+  return begin;
+} // end multiway_merge_path()
+
+
+// stably merges the num_runs consecutive sorted runs of keys beginning at keys_first,
+// permuting the corresponding values alike. Run q is [keys_first + run_offsets[q], keys_first + run_offsets[q + 1]),
+// and the merge is written to the ranges beginning at keys_result & values_result.
+// Each agent ranks its elements among the runs before writing them,
+// so the results may alias the inputs
+template<std::size_t bound,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize
+>::type
+multiway_merge_by_key(bulk::bounded<
+                        bound,
+                        bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                      > &g,
+                      RandomAccessIterator1 keys_first,
+                      RandomAccessIterator2 run_offsets,
+                      int num_runs,
+                      RandomAccessIterator3 values_first,
+                      RandomAccessIterator4 keys_result,
+                      RandomAccessIterator5 values_result,
+                      Compare comp)
+{
+  typedef typename bulk::bounded<
+    bound,
+    bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+  >::size_type size_type;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator3>::type value_type;
+
+  size_type begin = run_offsets[0];
+  size_type end   = run_offsets[num_runs];
+
+  key_type   keys[grainsize];
+  value_type values[grainsize];
+  size_type  ranks[grainsize];
+
+  // strided so that neighboring agents read neighboring elements
+  for(size_type k = 0; k < grainsize; ++k)
+  {
+    size_type i = begin + g.this_exec.index() + k * groupsize;
+
+    if(i < end)
+    {
+      int run = detail::multiway_merge_detail::find_run(run_offsets, num_runs, i);
+
+      ranks[k]  = detail::multiway_merge_detail::rank(keys_first, run_offsets, num_runs, run, i, comp);
+      keys[k]   = keys_first[i];
+      values[k] = values_first[i];
+    } // end if
+  } // end for k
+
+  g.wait();
+
+  for(size_type k = 0; k < grainsize; ++k)
+  {
+    size_type i = begin + g.this_exec.index() + k * groupsize;
+
+    if(i < end)
+    {
+      keys_result[ranks[k]]   = keys[k];
+      values_result[ranks[k]] = values[k];
+    } // end if
+  } // end for k
+
+  g.wait();
+} // end multiway_merge_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,426 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <thrust/functional.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/pair.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/swap.h>
+#include <cstring>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace radix_sort_detail
+{
+
+
+// radix_key_traits maps a key to unsigned bits whose unsigned order is the key's order
+template<typename Key> struct radix_key_traits;
+
+
+template<typename Key, typename Bits>
+struct unsigned_radix_key_traits
+{
+  typedef Bits bits_type;
+
+  __host__ __device__
+  static bits_type to_bits(const Key &key)
+  {
+    return key;
+  }
+};
+
+
+template<typename Key, typename Bits>
+struct signed_radix_key_traits
+{
+  typedef Bits bits_type;
+
+  __host__ __device__
+  static bits_type to_bits(const Key &key)
+  {
+    // flip the sign bit so that negative keys sort before positive keys
+    const bits_type sign_bit = bits_type(1) << (8 * sizeof(Bits) - 1);
+
+    return static_cast<bits_type>(key) ^ sign_bit;
+  }
+};
+
+
+template<typename Key, typename Bits>
+struct floating_point_radix_key_traits
+{
+  typedef Bits bits_type;
+
+  __host__ __device__
+  static bits_type to_bits(const Key &key)
+  {
+    const bits_type sign_bit = bits_type(1) << (8 * sizeof(Bits) - 1);
+
+    bits_type bits;
+    std::memcpy(&bits, &key, sizeof(Key));
+
+    // negative keys flip all their bits to reverse their order, positive keys flip just the sign bit
+    bits_type mask = (bits & sign_bit) ? ~bits_type(0) : sign_bit;
+
+    return bits ^ mask;
+  }
+};
+
+
+// the unsigned type of the given size, for keys like long whose size varies by platform
+template<std::size_t size> struct radix_bits_of_size;
+template<> struct radix_bits_of_size<4> { typedef unsigned int       type; };
+template<> struct radix_bits_of_size<8> { typedef unsigned long long type; };
+
+
+template<> struct radix_key_traits<unsigned int>       : unsigned_radix_key_traits<unsigned int, unsigned int> {};
+template<> struct radix_key_traits<int>                : signed_radix_key_traits<int, unsigned int> {};
+template<> struct radix_key_traits<unsigned long long> : unsigned_radix_key_traits<unsigned long long, unsigned long long> {};
+template<> struct radix_key_traits<long long>          : signed_radix_key_traits<long long, unsigned long long> {};
+template<> struct radix_key_traits<unsigned long>      : unsigned_radix_key_traits<unsigned long, radix_bits_of_size<sizeof(unsigned long)>::type> {};
+template<> struct radix_key_traits<long>               : signed_radix_key_traits<long, radix_bits_of_size<sizeof(long)>::type> {};
+template<> struct radix_key_traits<float>              : floating_point_radix_key_traits<float, unsigned int> {};
+template<> struct radix_key_traits<double>             : floating_point_radix_key_traits<double, unsigned long long> {};
+
+
+template<typename Key>
+__host__ __device__
+inline unsigned int digit(const Key &key, int shift, int num_bits)
+{
+  typedef typename radix_key_traits<Key>::bits_type bits_type;
+
+  bits_type bits = radix_key_traits<Key>::to_bits(key);
+
+  return static_cast<unsigned int>((bits >> shift) & ((bits_type(1) << num_bits) - 1));
+}
+
+
+// the number of ints rank_digits() requires for its counts
+template<std::size_t radix_bits, std::size_t groupsize>
+struct num_counts
+{
+  static const std::size_t value = (1 << radix_bits) * groupsize + groupsize;
+};
+
+
+// each agent of g owns a contiguous chunk of [keys, keys + n)
+template<std::size_t groupsize>
+__device__
+inline thrust::pair<int,int> agent_chunk(int agent_idx, int n)
+{
+  int chunk_size = (n + groupsize - 1) / groupsize;
+
+  int first = thrust::min<int>(n, agent_idx * chunk_size);
+  int last  = thrust::min<int>(n, first + chunk_size);
+
+  return thrust::make_pair(first, last);
+}
+
+
+// ranks the digit [shift, shift + num_bits) of each key in [keys, keys + n)
+// counts points to num_counts<radix_bits,groupsize>::value ints, ideally on chip
+// afterwards, counts[d * groupsize + i] is the offset at which the first key of agent i's chunk with digit d belongs,
+// and subsequent keys of agent i's chunk with digit d follow it in order, so the ranking is stable
+template<std::size_t radix_bits, std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator>
+__device__
+void rank_digits(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                 RandomAccessIterator keys,
+                 int n,
+                 int shift,
+                 int num_bits,
+                 int *counts)
+{
+  const int num_digits = 1 << radix_bits;
+
+  int tid = g.this_exec.index();
+
+  thrust::pair<int,int> chunk = agent_chunk<groupsize>(tid, n);
+
+  // each agent counts the digits of its chunk into its own column
+  for(int d = 0; d < num_digits; ++d)
+  {
+    counts[d * groupsize + tid] = 0;
+  }
+
+  for(int i = chunk.first; i < chunk.second; ++i)
+  {
+    ++counts[digit(keys[i], shift, num_bits) * groupsize + tid];
+  }
+
+  g.wait();
+
+  // scan the digit-major counts: each agent rakes num_digits consecutive counts,
+  // then the group scans the raked totals
+  int *totals = counts + num_digits * groupsize;
+
+  int sum = 0;
+  for(int i = tid * num_digits; i < (tid + 1) * num_digits; ++i)
+  {
+    int count = counts[i];
+    counts[i] = sum;
+    sum += count;
+  }
+
+  totals[tid] = sum;
+
+  g.wait();
+
+  bulk::detail::scan_detail::inplace_exclusive_scan(g, totals, 0, thrust::plus<int>());
+
+  int carry = totals[tid];
+
+  for(int i = tid * num_digits; i < (tid + 1) * num_digits; ++i)
+  {
+    counts[i] += carry;
+  }
+
+  g.wait();
+} // end rank_digits()
+
+
+// sorts [keys, keys + n) by the bits [begin_bit, end_bit), ping-ponging with keys_tmp,
+// and permutes values along with the keys if values is not null
+// returns the buffer which holds the sorted keys; the sorted values are in the corresponding values buffer
+template<std::size_t radix_bits, std::size_t groupsize, std::size_t grainsize, typename Key, typename Value>
+__device__
+Key *radix_sort_by_key_on_chip(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                               Key *keys, Key *keys_tmp,
+                               Value *values, Value *values_tmp,
+                               int n,
+                               int begin_bit, int end_bit,
+                               int *counts)
+{
+  int tid = g.this_exec.index();
+
+  thrust::pair<int,int> chunk = agent_chunk<groupsize>(tid, n);
+
+  for(int shift = begin_bit; shift < end_bit; shift += radix_bits)
+  {
+    int num_bits = thrust::min<int>(radix_bits, end_bit - shift);
+
+    rank_digits<radix_bits>(g, keys, n, shift, num_bits, counts);
+
+    // each agent scatters its chunk through its own column of offsets
+    for(int i = chunk.first; i < chunk.second; ++i)
+    {
+      int result = counts[digit(keys[i], shift, num_bits) * groupsize + tid]++;
+
+      keys_tmp[result] = keys[i];
+
+      if(values)
+      {
+        values_tmp[result] = values[i];
+      }
+    }
+
+    g.wait();
+
+    thrust::swap(keys, keys_tmp);
+    thrust::swap(values, values_tmp);
+  }
+
+  return keys;
+} // end radix_sort_by_key_on_chip()
+
+
+template<std::size_t radix_bits,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+void radix_sort_by_key_impl(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                            RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                            RandomAccessIterator2 values_first,
+                            int begin_bit, int end_bit)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  int n = keys_last - keys_first;
+
+  key_type   *keys = 0;
+  value_type *values = 0;
+  int        *counts = 0;
+
+  bulk::malloc_all(g,
+                   keys,   2 * n,
+                   values, 2 * n,
+                   counts, num_counts<radix_bits,groupsize>::value);
+
+  bulk::copy_n(g, keys_first, n, keys);
+  bulk::copy_n(g, values_first, n, values);
+
+  g.wait();
+
+  key_type *sorted_keys = radix_sort_by_key_on_chip<radix_bits>(g, keys, keys + n, values, values + n, n, begin_bit, end_bit, counts);
+
+  value_type *sorted_values = (sorted_keys == keys) ? values : values + n;
+
+  bulk::copy_n(g, sorted_keys, n, keys_first);
+  bulk::copy_n(g, sorted_values, n, values_first);
+
+  bulk::free_all(g, keys, values, counts);
+} // end radix_sort_by_key_impl()
+
+
+template<std::size_t radix_bits,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+void radix_sort_impl(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                     RandomAccessIterator first, RandomAccessIterator last,
+                     int begin_bit, int end_bit)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type key_type;
+
+  int n = last - first;
+
+  key_type *keys = 0;
+  int      *counts = 0;
+
+  bulk::malloc_all(g,
+                   keys,   2 * n,
+                   counts, num_counts<radix_bits,groupsize>::value);
+
+  bulk::copy_n(g, first, n, keys);
+
+  g.wait();
+
+  // there are no values to permute
+  char *no_values = 0;
+
+  key_type *sorted_keys = radix_sort_by_key_on_chip<radix_bits>(g, keys, keys + n, no_values, no_values, n, begin_bit, end_bit, counts);
+
+  bulk::copy_n(g, sorted_keys, n, first);
+
+  bulk::free_all(g, keys, counts);
+} // end radix_sort_impl()
+
+
+} // end radix_sort_detail
+} // end detail
+
+
+// the default number of bits sorted per pass
+const int default_radix_bits = 4;
+
+
+// stably sorts [keys_first, keys_last) by the bits [begin_bit, end_bit) of each key, radix_bits at a time,
+// and permutes [values_first, values_first + (keys_last - keys_first)) along with the keys
+// keys must be unsigned int, int, unsigned long long, long long, float, or double
+// requires (keys_last - keys_first) * (2 * sizeof(key) + 2 * sizeof(value)) + ((1 << radix_bits) + 1) * groupsize * sizeof(int) bytes of heap,
+// which should fit on chip for performance
+template<std::size_t radix_bits,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+void radix_sort_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                       RandomAccessIterator2 values_first,
+                       int begin_bit, int end_bit)
+{
+  detail::radix_sort_detail::radix_sort_by_key_impl<radix_bits>(g, keys_first, keys_last, values_first, begin_bit, end_bit);
+} // end radix_sort_by_key()
+
+
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+void radix_sort_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                       RandomAccessIterator2 values_first,
+                       int begin_bit, int end_bit)
+{
+  detail::radix_sort_detail::radix_sort_by_key_impl<default_radix_bits>(g, keys_first, keys_last, values_first, begin_bit, end_bit);
+} // end radix_sort_by_key()
+
+
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+__device__
+void radix_sort_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                       RandomAccessIterator2 values_first)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  detail::radix_sort_detail::radix_sort_by_key_impl<default_radix_bits>(g, keys_first, keys_last, values_first, 0, 8 * sizeof(key_type));
+} // end radix_sort_by_key()
+
+
+// stably sorts [first, last) by the bits [begin_bit, end_bit) of each key, radix_bits at a time
+// requires (last - first) * 2 * sizeof(key) + ((1 << radix_bits) + 1) * groupsize * sizeof(int) bytes of heap
+template<std::size_t radix_bits,
+         std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+void radix_sort(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                RandomAccessIterator first, RandomAccessIterator last,
+                int begin_bit, int end_bit)
+{
+  detail::radix_sort_detail::radix_sort_impl<radix_bits>(g, first, last, begin_bit, end_bit);
+} // end radix_sort()
+
+
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+void radix_sort(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                RandomAccessIterator first, RandomAccessIterator last,
+                int begin_bit, int end_bit)
+{
+  detail::radix_sort_detail::radix_sort_impl<default_radix_bits>(g, first, last, begin_bit, end_bit);
+} // end radix_sort()
+
+
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator>
+__device__
+void radix_sort(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                RandomAccessIterator first, RandomAccessIterator last)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type key_type;
+
+  detail::radix_sort_detail::radix_sort_impl<default_radix_bits>(g, first, last, 0, 8 * sizeof(key_type));
+} // end radix_sort()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
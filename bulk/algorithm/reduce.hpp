@@ -21,8 +21,19 @@
 #include <bulk/malloc.hpp>
 #include <bulk/uninitialized.hpp>
 #include <bulk/iterator/strided_iterator.hpp>
+#include <bulk/detail/shuffle.hpp>
 #include <thrust/iterator/iterator_traits.h>
 #include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+
+
+// cuda_fp16.h first appeared in CUDA 7.5
+#if defined(__CUDACC__) && defined(CUDART_VERSION) && (CUDART_VERSION >= 7050)
+#  define __BULK_HAS_HALF__ 1
+#  include <cuda_fp16.h>
+#else
+#  define __BULK_HAS_HALF__ 0
+#endif
 
 
 BULK_NAMESPACE_PREFIX
@@ -58,6 +69,169 @@ T reduce(const bulk::bounded<bound,bulk::agent<grainsize> > &exec,
 } // end reduce()
 
 
+#if __BULK_HAS_HALF__
+namespace detail
+{
+namespace reduce_detail
+{
+
+
+// loads first[i] & first[i+1] as one __half2, in a single 32-bit load when first is 4-byte aligned
+// i must be even
+template<bool aligned>
+struct half_pair
+{
+  template<typename Size>
+  __forceinline__ __device__
+  static __half2 load(const __half *first, Size i)
+  {
+    return __halves2half2(first[i], first[i+1]);
+  }
+};
+
+
+template<>
+struct half_pair<true>
+{
+  template<typename Size>
+  __forceinline__ __device__
+  static __half2 load(const __half *first, Size i)
+  {
+    return reinterpret_cast<const __half2*>(first)[i / 2];
+  }
+};
+
+
+// sums the first min(n, bound) halves in two float lanes
+template<std::size_t bound, bool aligned, typename Size>
+__forceinline__ __device__
+float2 sum_halves_as_float2(const __half *first, Size n)
+{
+  float2 sums = make_float2(0.f, 0.f);
+
+  for(Size i = 0; i < bound; i += 2)
+  {
+    if(i + 1 < n)
+    {
+      float2 x = __half22float2(half_pair<aligned>::load(first, i));
+      sums.x += x.x;
+      sums.y += x.y;
+    } // end if
+    else if(i < n)
+    {
+      sums.x += __half2float(first[i]);
+    } // end else if
+  } // end for i
+
+  return sums;
+} // end sum_halves_as_float2()
+
+
+#if __CUDA_ARCH__ >= 530
+// sums the first min(n, bound) halves in two half lanes
+template<std::size_t bound, bool aligned, typename Size>
+__forceinline__ __device__
+__half2 sum_halves(const __half *first, Size n)
+{
+  const __half zero = __float2half(0.f);
+
+  __half2 sums = __halves2half2(zero, zero);
+
+  for(Size i = 0; i < bound; i += 2)
+  {
+    if(i + 1 < n)
+    {
+      sums = __hadd2(sums, half_pair<aligned>::load(first, i));
+    } // end if
+    else if(i < n)
+    {
+      sums = __hadd2(sums, __halves2half2(first[i], zero));
+    } // end else if
+  } // end for i
+
+  return sums;
+} // end sum_halves()
+#endif
+
+
+} // end reduce_detail
+} // end detail
+
+
+// halves are loaded in pairs & accumulate in two independent float lanes,
+// which is no less accurate than a sequential float sum & breaks its dependency chain
+template<std::size_t bound, std::size_t grainsize>
+__forceinline__ __device__
+float reduce(const bulk::bounded<bound,bulk::agent<grainsize> > &,
+             const __half *first,
+             const __half *last,
+             float init,
+             thrust::plus<float>)
+{
+  typedef typename bulk::bounded<bound,bulk::agent<grainsize> >::size_type size_type;
+
+  size_type n = last - first;
+
+  // pairs are loaded as __half2 when first is 4-byte aligned, and a half at a time otherwise
+  float2 sums = (reinterpret_cast<std::size_t>(first) % sizeof(__half2) == 0) ?
+    bulk::detail::reduce_detail::sum_halves_as_float2<bound,true>(first, n) :
+    bulk::detail::reduce_detail::sum_halves_as_float2<bound,false>(first, n);
+
+  return init + (sums.x + sums.y);
+} // end reduce()
+
+
+template<std::size_t bound, std::size_t grainsize>
+__forceinline__ __device__
+float reduce(const bulk::bounded<bound,bulk::agent<grainsize> > &exec,
+             __half *first,
+             __half *last,
+             float init,
+             thrust::plus<float> binary_op)
+{
+  return bulk::reduce(exec, const_cast<const __half*>(first), const_cast<const __half*>(last), init, binary_op);
+} // end reduce()
+
+
+// pairs of halves accumulate with __hadd2 on sm_53 & better
+// XXX the sum is rounded to half at each step; pass a float init & thrust::plus<float> to accumulate in float instead
+template<std::size_t bound, std::size_t grainsize>
+__forceinline__ __device__
+__half reduce(const bulk::bounded<bound,bulk::agent<grainsize> > &exec,
+              const __half *first,
+              const __half *last,
+              __half init,
+              thrust::plus<__half>)
+{
+#if __CUDA_ARCH__ >= 530
+  typedef typename bulk::bounded<bound,bulk::agent<grainsize> >::size_type size_type;
+
+  size_type n = last - first;
+
+  __half2 sums = (reinterpret_cast<std::size_t>(first) % sizeof(__half2) == 0) ?
+    bulk::detail::reduce_detail::sum_halves<bound,true>(first, n) :
+    bulk::detail::reduce_detail::sum_halves<bound,false>(first, n);
+
+  return __hadd(init, __hadd(__low2half(sums), __high2half(sums)));
+#else
+  return __float2half(bulk::reduce(exec, first, last, __half2float(init), thrust::plus<float>()));
+#endif
+} // end reduce()
+
+
+template<std::size_t bound, std::size_t grainsize>
+__forceinline__ __device__
+__half reduce(const bulk::bounded<bound,bulk::agent<grainsize> > &exec,
+              __half *first,
+              __half *last,
+              __half init,
+              thrust::plus<__half> binary_op)
+{
+  return bulk::reduce(exec, const_cast<const __half*>(first), const_cast<const __half*>(last), init, binary_op);
+} // end reduce()
+#endif // __BULK_HAS_HALF__
+
+
 namespace detail
 {
 namespace reduce_detail
@@ -103,6 +277,106 @@ __device__ T destructive_reduce_n(ConcurrentGroup &g, RandomAccessIterator first
 } // end destructive_reduce_n()
 
 
+// reduces the partial sums held by the first num_partials lanes of a warp
+// every lane receives the result
+template<typename WarpGroup, typename T, typename BinaryFunction>
+__device__ T reduce_lanes(WarpGroup &g, T this_sum, int num_partials, BinaryFunction binary_op)
+{
+  typedef int size_type;
+
+  size_type lane = g.this_exec.index();
+
+  for(size_type offset = g.size() / 2; offset > 0; offset /= 2)
+  {
+    // every lane must participate in the shuffle, even those without a partial sum
+    T other = bulk::detail::shuffle_down(this_sum, offset);
+
+    if(lane + offset < num_partials)
+    {
+      this_sum = binary_op(this_sum, other);
+    } // end if
+  } // end for
+
+  return bulk::detail::shuffle(this_sum, 0);
+} // end reduce_lanes()
+
+
+// reduces [first, first + m) into first[0] through a tree which is unrolled at compile time
+// pairs each of the first m/2 elements with its mirror image like destructive_reduce_n
+template<std::size_t m>
+struct static_destructive_reduce
+{
+  template<typename ConcurrentGroup, typename T, typename BinaryFunction>
+  __device__ __forceinline__
+  static void apply(ConcurrentGroup &g, T *first, BinaryFunction binary_op)
+  {
+    const int half_m = m >> 1;
+
+    int tid = g.this_exec.index();
+
+    if(tid < half_m)
+    {
+      first[tid] = binary_op(first[tid], first[m - tid - 1]);
+    } // end if
+
+    g.wait();
+
+    static_destructive_reduce<m - half_m>::apply(g, first, binary_op);
+  } // end apply()
+};
+
+
+template<>
+struct static_destructive_reduce<1>
+{
+  template<typename ConcurrentGroup, typename T, typename BinaryFunction>
+  __device__ __forceinline__
+  static void apply(ConcurrentGroup &, T *, BinaryFunction) {}
+};
+
+
+// reduces the partial sums of the first num_partials agents of a group whose size is known at compile time
+// a group of exactly one warp shuffles its partials; larger groups reduce them through a statically-sized
+// buffer, unrolling the tree when every agent has a partial
+template<std::size_t groupsize, std::size_t grainsize, typename T, typename BinaryFunction>
+__device__
+T reduce_partials(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, T this_sum, int num_partials, T init, BinaryFunction binary_op)
+{
+  if(num_partials == 0) return init;
+
+#if __CUDA_ARCH__ >= 300
+  if(groupsize == 32)
+  {
+    return binary_op(init, reduce_lanes(g, this_sum, num_partials, binary_op));
+  } // end if
+#endif
+
+  __shared__ bulk::uninitialized_array<T,groupsize> buffer;
+
+  int tid = g.this_exec.index();
+
+  if(tid < num_partials)
+  {
+    buffer[tid] = this_sum;
+  } // end if
+
+  g.wait();
+
+  if(num_partials < static_cast<int>(groupsize))
+  {
+    return destructive_reduce_n(g, buffer.data(), num_partials, init, binary_op);
+  } // end if
+
+  static_destructive_reduce<groupsize>::apply(g, buffer.data(), binary_op);
+
+  T result = binary_op(init, buffer[0]);
+
+  g.wait();
+
+  return result;
+} // end reduce_partials()
+
+
 } // end reduce_detail
 } // end detail
 
@@ -194,26 +468,8 @@ T reduce(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     this_sum_defined = true;
   } // end for
 
-#if __CUDA_ARCH__ >= 200
-  T *buffer = reinterpret_cast<T*>(bulk::malloc(g, groupsize * sizeof(T)));
-#else
-  __shared__ bulk::uninitialized_array<T,groupsize> buffer_impl;
-  T *buffer = buffer_impl.data();
-#endif
-
-  if(this_sum_defined)
-  {
-    buffer[tid] = this_sum;
-  } // end if
-
-  g.wait();
-
   // reduce across the group
-  T result = bulk::detail::reduce_detail::destructive_reduce_n(g, buffer, thrust::min<size_type>(groupsize,n), init, binary_op);
-
-#if __CUDA_ARCH__ >= 200
-  bulk::free(g,buffer);
-#endif
+  T result = bulk::detail::reduce_detail::reduce_partials(g, this_sum, thrust::min<size_type>(groupsize,n), init, binary_op);
 
   return result;
 } // end reduce
@@ -264,6 +520,42 @@ T reduce(bulk::concurrent_group<> &g,
 } // end reduce
 
 
+template<typename ExecutionAgent, typename RandomAccessIterator, typename T, typename BinaryFunction>
+__device__
+T reduce(bulk::warp_group<ExecutionAgent> &g,
+         RandomAccessIterator first,
+         RandomAccessIterator last,
+         T init,
+         BinaryFunction binary_op)
+{
+  typedef int size_type;
+
+  size_type lane = g.this_exec.index();
+
+  T this_sum;
+
+  bool this_sum_defined = false;
+
+  size_type n = last - first;
+
+  for(size_type i = lane; i < n; i += g.size())
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator>::type input_type;
+    input_type x = first[i];
+    this_sum = this_sum_defined ? binary_op(this_sum, x) : x;
+
+    this_sum_defined = true;
+  } // end for
+
+  if(n == 0) return init;
+
+  // reduce across the warp
+  this_sum = bulk::detail::reduce_detail::reduce_lanes(g, this_sum, thrust::min<size_type>(g.size(), n), binary_op);
+
+  return binary_op(init, this_sum);
+} // end reduce
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -146,8 +146,9 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   const size_type interval_size = groupsize * grainsize;
 
 #if __CUDA_ARCH__ >= 200
-  size_type *s_flags = reinterpret_cast<size_type*>(bulk::malloc(g, interval_size * sizeof(int)));
-  value_type *s_values = reinterpret_cast<value_type*>(bulk::malloc(g, interval_size * sizeof(value_type)));
+  size_type *s_flags = 0;
+  value_type *s_values = 0;
+  bulk::malloc_all(g, s_flags, interval_size, s_values, interval_size);
 #else
   __shared__ uninitialized_array<size_type,interval_size> s_flags_impl;
   size_type *s_flags = s_flags_impl.data();
@@ -161,19 +162,12 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
     // upper bound on n is interval_size
     size_type n = thrust::min<size_type>(interval_size, keys_last - keys_first);
 
-    bulk::detail::head_flags_with_init<
-      InputIterator1,
-      BinaryPredicate,
-      size_type
-    > flags(keys_first, keys_first + n, init_key, pred);
-
     detail::reduce_by_key_detail::scan_head_flags_functor<size_type, value_type, BinaryFunction> f(binary_op);
 
     // load input into smem
-    bulk::copy_n(bulk::bound<interval_size>(g),
-                 thrust::make_zip_iterator(thrust::make_tuple(flags.begin(), values_first)),
-                 n,
-                 thrust::make_zip_iterator(thrust::make_tuple(s_flags, s_values)));
+    // each key is loaded once, and its agent shares it with its successor's
+    bulk::detail::head_flags_tile_n(g, keys_first, n, init_key, pred, s_flags);
+    bulk::copy_n(bulk::bound<interval_size>(g), values_first, n, s_values);
 
     // scan in smem
     bulk::inclusive_scan(bulk::bound<interval_size>(g),
@@ -208,8 +202,7 @@ reduce_by_key(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
   } // end for
 
 #if __CUDA_ARCH__ >= 200
-  bulk::free(g, s_flags);
-  bulk::free(g, s_values);
+  bulk::free_all(g, s_flags, s_values);
 #endif
 
   return thrust::make_tuple(keys_result, values_result, init_key, init_value);
@@ -21,7 +21,9 @@
 #include <bulk/malloc.hpp>
 #include <bulk/algorithm/copy.hpp>
 #include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/exchange.hpp>
 #include <bulk/uninitialized.hpp>
+#include <bulk/detail/shuffle.hpp>
 #include <thrust/detail/type_traits.h>
 #include <thrust/detail/type_traits/function_traits.h>
 #include <thrust/detail/type_traits/iterator/is_output_iterator.h>
@@ -324,10 +326,12 @@ struct scan_buffer
     BinaryFunction
   >::type intermediate_type;
 
+  static const std::size_t size = bulk::exchange_buffer_size<groupsize * grainsize>::value;
+
   union
   {
-    uninitialized_array<input_type, groupsize * grainsize>        inputs;
-    uninitialized_array<intermediate_type, groupsize * grainsize> results;
+    uninitialized_array<input_type, size>        inputs;
+    uninitialized_array<intermediate_type, size> results;
   };
 };
 
@@ -370,18 +374,52 @@ __device__ void scan_with_buffer(bulk::concurrent_group<bulk::agent<grainsize>,g
   for(; first < last; first += elements_per_group, result += elements_per_group)
   {
     size_type partition_size = thrust::min<size_type>(elements_per_group, last - first);
-    
-    // stage data through shared memory
-    bulk::copy_n(g, first, partition_size, stage.inputs);
-
-    carry_in = scan<inclusive>(bulk::bound<elements_per_group>(g),
-                               stage.inputs, stage.inputs + partition_size,
-                               stage.results,
-                               carry_in,
-                               binary_op);
-    
-    // copy to result 
-    bulk::copy_n(g, stage.results, partition_size, result);
+
+    // load a tile with coalesced accesses & transpose it into each agent's consecutive inputs
+    input_type local_inputs[grainsize];
+    bulk::load_blocked(g, first, partition_size, local_inputs, stage.inputs);
+
+    size_type local_offset = grainsize * tid;
+    size_type local_size = thrust::max<size_type>(0, thrust::min<size_type>(grainsize, partition_size - local_offset));
+
+    // XXX this should be uninitialized<intermediate_type>
+    intermediate_type x;
+
+    if(local_size)
+    {
+      x = local_inputs[0];
+      x = bulk::accumulate(bulk::bound<grainsize-1>(g.this_exec), local_inputs + 1, local_inputs + local_size, x, binary_op);
+
+      stage.results[tid] = x;
+    } // end if
+
+    g.wait();
+
+    // exclusive scan the per-agent sums
+    const size_type spine_n = (partition_size == elements_per_group) ? groupsize : (partition_size + grainsize - 1) / grainsize;
+
+    carry_in = bounded_inplace_exclusive_scan(g, stage.results, spine_n, carry_in, binary_op);
+
+    if(local_size)
+    {
+      x = stage.results[tid];
+    } // end if
+
+    g.wait();
+
+    intermediate_type local_results[grainsize];
+
+    if(inclusive)
+    {
+      bulk::inclusive_scan(bulk::bound<grainsize>(g.this_exec), local_inputs, local_inputs + local_size, local_results, x, binary_op);
+    } // end if
+    else
+    {
+      bulk::exclusive_scan(bulk::bound<grainsize>(g.this_exec), local_inputs, local_inputs + local_size, local_results, x, binary_op);
+    } // end else
+
+    // transpose the results back & store them with coalesced accesses
+    bulk::store_blocked(g, local_results, partition_size, result, stage.results);
   } // end for
 } // end scan_with_buffer()
 
@@ -593,6 +631,158 @@ exclusive_scan(bulk::concurrent_group<agent<grainsize>,groupsize> &g,
 } // end exclusive_scan()
 
 
+namespace detail
+{
+namespace scan_detail
+{
+
+
+// inclusive scan of one value per lane
+template<typename WarpGroup, typename T, typename BinaryFunction>
+__device__ T inclusive_scan_lanes(WarpGroup &g, T x, BinaryFunction binary_op)
+{
+  typedef int size_type;
+
+  size_type lane = g.this_exec.index();
+
+  for(size_type offset = 1; offset < g.size(); offset *= 2)
+  {
+    T other = bulk::detail::shuffle_up(x, offset);
+
+    if(lane >= offset)
+    {
+      x = binary_op(other, x);
+    } // end if
+  } // end for
+
+  return x;
+} // end inclusive_scan_lanes()
+
+
+// scans 32 elements at a time, one per lane, and carries the last sum of each round into the next
+template<bool inclusive, typename WarpGroup, typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+__device__ void warp_scan(WarpGroup &g,
+                          RandomAccessIterator1 first, RandomAccessIterator1 last,
+                          RandomAccessIterator2 result,
+                          T carry,
+                          BinaryFunction binary_op)
+{
+  typedef int size_type;
+
+  size_type lane = g.this_exec.index();
+
+  size_type n = last - first;
+
+  for(size_type offset = 0; offset < n; offset += g.size())
+  {
+    size_type partition_size = thrust::min<size_type>(g.size(), n - offset);
+
+    // lanes past the end of the input only feed lanes which are also past the end
+    T x = carry;
+    if(lane < partition_size)
+    {
+      x = first[offset + lane];
+    } // end if
+
+    x = inclusive_scan_lanes(g, x, binary_op);
+
+    if(inclusive)
+    {
+      if(lane < partition_size)
+      {
+        result[offset + lane] = binary_op(carry, x);
+      } // end if
+    } // end if
+    else
+    {
+      T prev = bulk::detail::shuffle_up(x, 1);
+
+      if(lane < partition_size)
+      {
+        result[offset + lane] = (lane == 0) ? carry : binary_op(carry, prev);
+      } // end if
+    } // end else
+
+    carry = binary_op(carry, bulk::detail::shuffle(x, partition_size - 1));
+  } // end for
+} // end warp_scan()
+
+
+} // end scan_detail
+} // end detail
+
+
+template<typename ExecutionAgent,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename T,
+         typename BinaryFunction>
+__device__ void inclusive_scan(bulk::warp_group<ExecutionAgent> &g,
+                               RandomAccessIterator1 first, RandomAccessIterator1 last,
+                               RandomAccessIterator2 result,
+                               T init,
+                               BinaryFunction binary_op)
+{
+  detail::scan_detail::warp_scan<true>(g, first, last, result, init, binary_op);
+} // end inclusive_scan()
+
+
+template<typename ExecutionAgent,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename BinaryFunction>
+__device__
+RandomAccessIterator2
+inclusive_scan(bulk::warp_group<ExecutionAgent> &g,
+               RandomAccessIterator1 first,
+               RandomAccessIterator1 last,
+               RandomAccessIterator2 result,
+               BinaryFunction binary_op)
+{
+  if(first < last)
+  {
+    // the first input becomes the init
+    // XXX convert to the immediate type when passing init to respect Thrust's semantics
+    typename detail::scan_detail::scan_intermediate<
+      RandomAccessIterator1,
+      RandomAccessIterator2,
+      BinaryFunction
+    >::type init = *first;
+
+    // we need to wait because first may be the same as result
+    g.wait();
+
+    if(g.this_exec.index() == 0)
+    {
+      *result = init;
+    } // end if
+
+    bulk::inclusive_scan(g, first + 1, last, result + 1, init, binary_op);
+  } // end if
+
+  return result + (last - first);
+} // end inclusive_scan()
+
+
+template<typename ExecutionAgent,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename T,
+         typename BinaryFunction>
+__device__
+RandomAccessIterator2
+exclusive_scan(bulk::warp_group<ExecutionAgent> &g,
+               RandomAccessIterator1 first, RandomAccessIterator1 last,
+               RandomAccessIterator2 result,
+               T init,
+               BinaryFunction binary_op)
+{
+  detail::scan_detail::warp_scan<false>(g, first, last, result, init, binary_op);
+
+  return result + (last - first);
+} // end exclusive_scan()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -18,6 +18,12 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/sort.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/functional.h>
+#include <thrust/detail/minmax.h>
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
@@ -197,6 +203,65 @@ void scatter_if(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
 } // end scatter_if
 
 
+// scatters [first, last) to result through map like a plain scatter, but first sorts
+// each tile of groupsize * grainsize elements by destination, so that neighboring agents
+// store to neighboring addresses & writes which fall close together coalesce
+// pays off when the map is scattered at a coarse grain but has locality within a tile,
+// e.g. bucketed or partially sorted destinations
+// requires 2 * groupsize * grainsize * (sizeof(index) + sizeof(value)) bytes of heap,
+// which should fit on chip for performance
+// XXX when destinations repeat within a tile, which element wins is unspecified, as with a plain scatter
+template<std::size_t groupsize,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3>
+__device__
+void sorted_scatter(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                    RandomAccessIterator1 first,
+                    RandomAccessIterator1 last,
+                    RandomAccessIterator2 map,
+                    RandomAccessIterator3 result)
+{
+  typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type index_type;
+
+  const size_type tile_size = groupsize * grainsize;
+
+  index_type *s_map = 0;
+  value_type *s_values = 0;
+  bulk::malloc_all(g, s_map, tile_size, s_values, tile_size);
+
+  size_type tid = g.this_exec.index();
+
+  for(; first < last; first += tile_size, map += tile_size)
+  {
+    size_type n = thrust::min<size_type>(tile_size, last - first);
+
+    bulk::copy_n(bulk::bound<tile_size>(g), map, n, s_map);
+    bulk::copy_n(bulk::bound<tile_size>(g), first, n, s_values);
+
+    bulk::stable_sort_by_key(bulk::bound<tile_size>(g), s_map, s_map + n, s_values, thrust::less<index_type>());
+
+    for(size_type i = 0; i < grainsize; ++i)
+    {
+      size_type idx = groupsize * i + tid;
+
+      if(idx < n)
+      {
+        result[s_map[idx]] = s_values[idx];
+      } // end if
+    } // end for i
+
+    g.wait();
+  } // end for
+
+  bulk::free_all(g, s_map, s_values);
+} // end sorted_scatter()
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -0,0 +1,607 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+#include <thrust/pair.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace set_operation_detail
+{
+
+
+enum set_operation
+{
+  set_union_operation,
+  set_intersection_operation,
+  set_difference_operation,
+  set_symmetric_difference_operation
+};
+
+
+// stands in for the values of a keys-only operation, and for the results of a counting pass
+struct no_values {};
+
+
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size lower_bound_n(RandomAccessIterator first, Size n, const T &x, Compare comp)
+{
+  Size begin = 0;
+  Size end = n;
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(comp(first[mid], x))
+    {
+      begin = mid + 1;
+    } // end if
+    else
+    {
+      end = mid;
+    } // end else
+  } // end while
+
+  return begin;
+} // end lower_bound_n()
+
+
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size upper_bound_n(RandomAccessIterator first, Size n, const T &x, Compare comp)
+{
+  Size begin = 0;
+  Size end = n;
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(comp(x, first[mid]))
+    {
+      end = mid;
+    } // end if
+    else
+    {
+      begin = mid + 1;
+    } // end else
+  } // end while
+
+  return begin;
+} // end upper_bound_n()
+
+
+// searches the staged window [begin, begin + stage_size) of the sorted range [first, first + n),
+// and only searches the rest of the range in memory when x's run crosses the window's first edge
+// every element before the window must not be greater than x
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size staged_lower_bound(RandomAccessIterator first, Size begin, const T *stage, int stage_size, const T &x, Compare comp)
+{
+  int r = lower_bound_n(stage, stage_size, x, comp);
+
+  if(r == 0 && begin > 0 && !comp(first[begin - 1], x))
+  {
+    return lower_bound_n(first, begin, x, comp);
+  } // end if
+
+  return begin + r;
+} // end staged_lower_bound()
+
+
+// every element after the window must not be less than x
+template<typename RandomAccessIterator, typename Size, typename T, typename Compare>
+__device__
+Size staged_upper_bound(RandomAccessIterator first, Size n, Size begin, const T *stage, int stage_size, const T &x, Compare comp)
+{
+  int r = upper_bound_n(stage, stage_size, x, comp);
+
+  Size end = begin + stage_size;
+
+  if(r == stage_size && end < n && !comp(x, first[end]))
+  {
+    return end + upper_bound_n(first + end, n - end, x, comp);
+  } // end if
+
+  return begin + r;
+} // end staged_upper_bound()
+
+
+// set operations merge their inputs in the order which interleaves each pair of equivalent runs a0 b0 a1 b1 ...
+// so that the rank of an element within its own run, together with the size of the other range's run,
+// decides whether it belongs to the result
+// returns true if first2[j] precedes first1[i] in that order
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+__device__
+bool paired_precedes(RandomAccessIterator1 first1, Size i, RandomAccessIterator2 first2, Size j, Compare comp)
+{
+  typename thrust::iterator_value<RandomAccessIterator1>::type x = first1[i];
+
+  if(comp(first2[j], x)) return true;
+  if(comp(x, first2[j])) return false;
+
+  Size rank1 = i - lower_bound_n(first1, i, x, comp);
+  Size rank2 = j - lower_bound_n(first2, j, x, comp);
+
+  return rank2 < rank1;
+} // end paired_precedes()
+
+
+// like bulk::merge_path, in the paired order
+template<typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename Compare>
+__device__
+Size paired_merge_path(RandomAccessIterator1 first1, Size n1,
+                       RandomAccessIterator2 first2, Size n2,
+                       Size diag,
+                       Compare comp)
+{
+  Size begin = thrust::max<Size>(Size(0), diag - n2);
+  Size end = thrust::min<Size>(diag, n1);
+
+  while(begin < end)
+  {
+    Size mid = (begin + end) >> 1;
+
+    if(paired_precedes(first1, mid, first2, diag - 1 - mid, comp))
+    {
+      end = mid;
+    } // end if
+    else
+    {
+      begin = mid + 1;
+    } // end else
+  } // end while
+
+  return begin;
+} // end paired_merge_path()
+
+
+// rank is an element's position within its own run, and count is the size of the other range's run
+template<int operation, typename Size>
+__device__
+bool selects_from_first(Size rank, Size count)
+{
+  return (operation == set_union_operation)        ? true :
+         (operation == set_intersection_operation) ? rank < count :
+                                                     rank >= count;
+} // end selects_from_first()
+
+
+template<int operation, typename Size>
+__device__
+bool selects_from_second(Size rank, Size count)
+{
+  return (operation == set_union_operation || operation == set_symmetric_difference_operation) && rank >= count;
+} // end selects_from_second()
+
+
+template<typename RandomAccessIterator, typename Size, typename T>
+__device__
+void emit_key(RandomAccessIterator result, Size offset, const T &x)
+{
+  result[offset] = x;
+} // end emit_key()
+
+
+template<typename Size, typename T>
+__device__
+void emit_key(no_values, Size, const T &) {}
+
+
+template<typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2>
+__device__
+void emit_value(RandomAccessIterator1 result, Size offset, RandomAccessIterator2 values_first, Size i)
+{
+  result[offset] = values_first[i];
+} // end emit_value()
+
+
+template<typename Size, typename RandomAccessIterator>
+__device__
+void emit_value(no_values, Size, RandomAccessIterator, Size) {}
+
+
+// computes the elements of the result which lie between two paired merge paths:
+// [begin1, begin1 + size1) of the first range & [begin2, begin2 + size2) of the second
+// the tile is staged on chip, where each agent finds the merged position and the fate of its elements from their runs' bounds.
+// The selections are scanned in merged order into their ranks within the tile and scattered to result_offset + rank
+// returns the number of elements the tile selects
+// the results may be no_values to only count them
+template<int operation,
+         std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+int set_operation_tile(bulk::bounded<
+                         bound,
+                         bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                       > &g,
+                       RandomAccessIterator1 keys_first1, Size n1, Size begin1, int size1,
+                       RandomAccessIterator2 keys_first2, Size n2, Size begin2, int size2,
+                       RandomAccessIterator3 values_first1,
+                       RandomAccessIterator4 values_first2,
+                       RandomAccessIterator5 keys_result,
+                       RandomAccessIterator6 values_result,
+                       Size result_offset,
+                       Compare comp)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  int n = size1 + size2;
+
+  if(n == 0) return 0;
+
+  key_type *stage = 0;
+  int *ranks = 0;
+  bulk::malloc_all(g, stage, n, ranks, n);
+
+  bulk::detail::copy_joined_n(g, keys_first1 + begin1, size1, keys_first2 + begin2, size2, stage);
+
+  const key_type *stage1 = stage;
+  const key_type *stage2 = stage + size1;
+
+  Size tile_begin = begin1 + begin2;
+
+  bool selected[grainsize];
+  int  position[grainsize];
+
+  for(int k = 0; k < grainsize; ++k)
+  {
+    int i = g.this_exec.index() + k * g.size();
+
+    selected[k] = false;
+    position[k] = 0;
+
+    if(i < n)
+    {
+      const key_type &x = stage[i];
+
+      Size lower1 = staged_lower_bound(keys_first1, begin1, stage1, size1, x, comp);
+      Size lower2 = staged_lower_bound(keys_first2, begin2, stage2, size2, x, comp);
+
+      if(i < size1)
+      {
+        Size idx   = begin1 + i;
+        Size rank  = idx - lower1;
+        Size count = staged_upper_bound(keys_first2, n2, begin2, stage2, size2, x, comp) - lower2;
+
+        // the equivalent elements of the second range which precede x are those of lesser rank
+        position[k] = idx + lower2 + thrust::min<Size>(rank, count) - tile_begin;
+        selected[k] = selects_from_first<operation>(rank, count);
+      } // end if
+      else
+      {
+        Size idx   = begin2 + (i - size1);
+        Size rank  = idx - lower2;
+        Size count = staged_upper_bound(keys_first1, n1, begin1, stage1, size1, x, comp) - lower1;
+
+        // the equivalent elements of the first range which precede x are those of lesser or equal rank
+        position[k] = idx + lower1 + thrust::min<Size>(rank + 1, count) - tile_begin;
+        selected[k] = selects_from_second<operation>(rank, count);
+      } // end else
+
+      ranks[position[k]] = selected[k];
+    } // end if
+  } // end for k
+
+  g.wait();
+
+  int num_selected = bulk::detail::scan_detail::scan<false>(g, ranks, ranks + n, ranks, 0, thrust::plus<int>());
+
+  for(int k = 0; k < grainsize; ++k)
+  {
+    if(selected[k])
+    {
+      int i = g.this_exec.index() + k * g.size();
+
+      Size offset = result_offset + ranks[position[k]];
+
+      emit_key(keys_result, offset, stage[i]);
+
+      if(i < size1)
+      {
+        emit_value(values_result, offset, values_first1, begin1 + i);
+      } // end if
+      else
+      {
+        emit_value(values_result, offset, values_first2, begin2 + (i - size1));
+      } // end else
+    } // end if
+  } // end for k
+
+  bulk::free_all(g, stage, ranks);
+
+  return num_selected;
+} // end set_operation_tile()
+
+
+template<int operation,
+         std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+int bounded_set_operation(bulk::bounded<
+                            bound,
+                            bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                          > &g,
+                          RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                          RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                          RandomAccessIterator3 values_first1,
+                          RandomAccessIterator4 values_first2,
+                          RandomAccessIterator5 keys_result,
+                          RandomAccessIterator6 values_result,
+                          Compare comp)
+{
+  int n1 = keys_last1 - keys_first1;
+  int n2 = keys_last2 - keys_first2;
+
+  // the whole of both ranges fit in a single tile
+  return set_operation_tile<operation>(g,
+                                       keys_first1, n1, 0, n1,
+                                       keys_first2, n2, 0, n2,
+                                       values_first1, values_first2,
+                                       keys_result, values_result,
+                                       0,
+                                       comp);
+} // end bounded_set_operation()
+
+
+} // end set_operation_detail
+} // end detail
+
+
+// the set operations below follow the std:: algorithms of the same name, including their treatment of
+// equivalent elements, for sorted ranges whose sizes sum to no more than bound.
+// They allocate two arrays of (last1 - first1) + (last2 - first2) keys & ints from g's heap
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  RandomAccessIterator3
+>::type
+set_union(bulk::bounded<
+            bound,
+            bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+          > &g,
+          RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+          RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+          RandomAccessIterator3 result,
+          Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + ns::bounded_set_operation<ns::set_union_operation>(g, first1, last1, first2, last2, ns::no_values(), ns::no_values(), result, ns::no_values(), comp);
+} // end set_union()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  RandomAccessIterator3
+>::type
+set_intersection(bulk::bounded<
+                   bound,
+                   bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                 > &g,
+                 RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                 RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                 RandomAccessIterator3 result,
+                 Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + ns::bounded_set_operation<ns::set_intersection_operation>(g, first1, last1, first2, last2, ns::no_values(), ns::no_values(), result, ns::no_values(), comp);
+} // end set_intersection()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  RandomAccessIterator3
+>::type
+set_difference(bulk::bounded<
+                 bound,
+                 bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+               > &g,
+               RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+               RandomAccessIterator3 result,
+               Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + ns::bounded_set_operation<ns::set_difference_operation>(g, first1, last1, first2, last2, ns::no_values(), ns::no_values(), result, ns::no_values(), comp);
+} // end set_difference()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  RandomAccessIterator3
+>::type
+set_symmetric_difference(bulk::bounded<
+                           bound,
+                           bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                         > &g,
+                         RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                         RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                         RandomAccessIterator3 result,
+                         Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + ns::bounded_set_operation<ns::set_symmetric_difference_operation>(g, first1, last1, first2, last2, ns::no_values(), ns::no_values(), result, ns::no_values(), comp);
+} // end set_symmetric_difference()
+
+
+// each value accompanies its key from whichever range the key came from
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_union_by_key(bulk::bounded<
+                   bound,
+                   bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                 > &g,
+                 RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                 RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                 RandomAccessIterator3 values_first1,
+                 RandomAccessIterator4 values_first2,
+                 RandomAccessIterator5 keys_result,
+                 RandomAccessIterator6 values_result,
+                 Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  int n = ns::bounded_set_operation<ns::set_union_operation>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_union_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_intersection_by_key(bulk::bounded<
+                          bound,
+                          bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                        > &g,
+                        RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                        RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                        RandomAccessIterator3 values_first1,
+                        RandomAccessIterator4 values_first2,
+                        RandomAccessIterator5 keys_result,
+                        RandomAccessIterator6 values_result,
+                        Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  int n = ns::bounded_set_operation<ns::set_intersection_operation>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_intersection_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_difference_by_key(bulk::bounded<
+                        bound,
+                        bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                      > &g,
+                      RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                      RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                      RandomAccessIterator3 values_first1,
+                      RandomAccessIterator4 values_first2,
+                      RandomAccessIterator5 keys_result,
+                      RandomAccessIterator6 values_result,
+                      Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  int n = ns::bounded_set_operation<ns::set_difference_operation>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_difference_by_key()
+
+
+template<std::size_t bound, std::size_t groupsize, std::size_t grainsize,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+__device__
+typename thrust::detail::enable_if<
+  bound <= groupsize * grainsize,
+  thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+>::type
+set_symmetric_difference_by_key(bulk::bounded<
+                                  bound,
+                                  bulk::concurrent_group<bulk::agent<grainsize>,groupsize>
+                                > &g,
+                                RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                RandomAccessIterator3 values_first1,
+                                RandomAccessIterator4 values_first2,
+                                RandomAccessIterator5 keys_result,
+                                RandomAccessIterator6 values_result,
+                                Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  int n = ns::bounded_set_operation<ns::set_symmetric_difference_operation>(g, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_symmetric_difference_by_key()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
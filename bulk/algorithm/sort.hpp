@@ -19,6 +19,8 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/algorithm/detail/stable_merge_sort.hpp>
+#include <bulk/algorithm/detail/sorting_network.hpp>
+#include <thrust/detail/type_traits.h>
 #include <thrust/detail/swap.h>
 
 BULK_NAMESPACE_PREFIX
@@ -117,6 +119,79 @@ void stable_odd_even_transpose_sort(const bounded<bound,agent<grainsize> > &,
 } // end stable_odd_even_transpose_sort()
 
 
+// below this bound, odd-even transposition sort's compare-exchanges are cheaper than
+// a sorting network's, which must also break ties to remain stable
+const std::size_t min_sorting_network_bound = 7;
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Compare>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (bound < min_sorting_network_bound)
+>::type
+stable_sort_by_key(const bounded<bound,agent<grainsize> > &exec,
+                   RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                   RandomAccessIterator2 values_first,
+                   Compare comp)
+{
+  stable_odd_even_transpose_sort_by_key(exec, keys_first, keys_last, values_first, comp);
+} // end stable_sort_by_key()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Compare>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (bound >= min_sorting_network_bound)
+>::type
+stable_sort_by_key(const bounded<bound,agent<grainsize> > &,
+                   RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                   RandomAccessIterator2 values_first,
+                   Compare comp)
+{
+  bulk::detail::stable_sorting_network_sort_by_key<bound>(keys_first, values_first, keys_last - keys_first, comp);
+} // end stable_sort_by_key()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Compare>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (bound < min_sorting_network_bound)
+>::type
+stable_sort(const bounded<bound,agent<grainsize> > &exec,
+            RandomAccessIterator first, RandomAccessIterator last,
+            Compare comp)
+{
+  stable_odd_even_transpose_sort(exec, first, last, comp);
+} // end stable_sort()
+
+
+template<std::size_t bound,
+         std::size_t grainsize,
+         typename RandomAccessIterator,
+         typename Compare>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  (bound >= min_sorting_network_bound)
+>::type
+stable_sort(const bounded<bound,agent<grainsize> > &,
+            RandomAccessIterator first, RandomAccessIterator last,
+            Compare comp)
+{
+  bulk::detail::stable_sorting_network_sort<bound>(first, last - first, comp);
+} // end stable_sort()
+
+
 } // end sort_detail
 } // end detail
 
@@ -132,7 +207,7 @@ void stable_sort_by_key(const bounded<bound,agent<grainsize> > &exec,
                         RandomAccessIterator2 values_first,
                         Compare comp)
 {
-  bulk::detail::sort_detail::stable_odd_even_transpose_sort_by_key(exec, keys_first, keys_last, values_first, comp);
+  bulk::detail::sort_detail::stable_sort_by_key(exec, keys_first, keys_last, values_first, comp);
 } // end stable_sort_by_key()
 
 
@@ -145,7 +220,7 @@ void stable_sort(const bounded<bound,agent<grainsize> > &exec,
                  RandomAccessIterator first, RandomAccessIterator last,
                  Compare comp)
 {
-  bulk::detail::sort_detail::stable_odd_even_transpose_sort(exec, first, last, comp);
+  bulk::detail::sort_detail::stable_sort(exec, first, last, comp);
 } // end stable_sort()
 
 
@@ -28,6 +28,11 @@ namespace bulk
 {
 
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__ __device__
+future<void> async(ExecutionGroup g, Function f, Args&&... args);
+#else
 template<typename ExecutionGroup, typename Function>
 __host__ __device__
 future<void> async(ExecutionGroup g, Function f);
@@ -81,6 +86,71 @@ future<void> async(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3
 template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
 __host__ __device__
 future<void> async(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10);
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
+
+// then(before, g, f, args...) launches f(args...) across g after before completes
+// without blocking the calling thread
+// g may be an async_launch, in which case the launch waits on its other dependencies as well
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Args&&... args);
+#else
+template<typename ExecutionGroup, typename Function>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10);
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
 
 
 } // end bulk
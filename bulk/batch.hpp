@@ -0,0 +1,258 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <thrust/detail/minmax.h>
+#include <vector>
+#include <climits>
+#include <cstring>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the problem descriptor bulk::async_batch expects by default: the range [first, last)
+// any trivially copyable descriptor with a __host__ __device__ size() member will do:
+// the host counts each problem's tiles & each group bounds its tile with it
+template<typename RandomAccessIterator>
+struct batch_problem
+{
+  RandomAccessIterator first;
+  RandomAccessIterator last;
+
+  __host__ __device__
+  std::size_t size() const
+  {
+    return last - first;
+  }
+};
+
+
+template<typename RandomAccessIterator>
+__host__ __device__
+batch_problem<RandomAccessIterator> make_batch_problem(RandomAccessIterator first, RandomAccessIterator last)
+{
+  batch_problem<RandomAccessIterator> result = {first, last};
+  return result;
+} // end make_batch_problem()
+
+
+namespace detail
+{
+namespace batch_detail
+{
+
+
+// the device's view of a descriptor's size
+// XXX a descriptor whose size() is __host__ only fails to compile here
+template<typename Descriptor>
+__device__
+inline std::size_t device_size(const Descriptor &problem)
+{
+  return problem.size();
+} // end device_size()
+
+
+// maps a group of the combined grid to its problem & the items of its tile
+template<typename Function>
+struct batch_task
+{
+  Function f;
+  int tile_size;
+
+  __host__ __device__
+  batch_task(Function f, int tile_size)
+    : f(f), tile_size(tile_size)
+  {}
+
+  template<typename ConcurrentGroup, typename Descriptor>
+  __device__
+  void operator()(ConcurrentGroup &g, const int *tile_offsets, int num_problems, const Descriptor *descriptors)
+  {
+    int tile = g.index();
+
+    // find the last problem whose first tile is no later than ours
+    // empty problems own no tiles, so they're never found
+    int lo = 0, hi = num_problems;
+    while(hi - lo > 1)
+    {
+      int mid = (lo + hi) / 2;
+
+      if(tile_offsets[mid] <= tile)
+      {
+        lo = mid;
+      }
+      else
+      {
+        hi = mid;
+      } // end else
+    } // end while
+
+    Descriptor problem = descriptors[lo];
+
+    std::size_t first = static_cast<std::size_t>(tile - tile_offsets[lo]) * tile_size;
+    std::size_t last  = thrust::min<std::size_t>(batch_detail::device_size(problem), first + tile_size);
+
+    f(g, problem, first, last);
+  } // end operator()
+}; // end batch_task
+
+
+} // end batch_detail
+} // end detail
+
+
+// launches one grid over num_problems problems at once: each problem is cut into tiles of tile_size items,
+// and each tile gets a group of the grid, which invokes f(group, descriptors[problem], first, last)
+// over items [first, last) of its problem.
+// The groups find their problems through a prefix sum of the problems' tile counts,
+// which travels to the device along with the descriptors in a single copy, so that
+// thousands of tiny problems cost one launch rather than one each, e.g.
+//
+//   std::vector<bulk::batch_problem<int*> > problems = ...;
+//   bulk::async_batch(bulk::con<128,4>(bulk::use_default), &problems[0], problems.size(), sum_tile());
+//
+// descriptors is a host array of trivially copyable descriptors with a __host__ __device__ size() member;
+// the pointers they contain must be device-accessible.
+// tile_size defaults to the group's size times its grain size.
+// Problems which span several tiles must combine their tiles' results themselves, e.g. atomically.
+// XXX the copy is from pageable memory so that the table may be discarded as soon as async_batch returns,
+//     but the runtime synchronizes the stream before a pageable copy, so async_batch(before, ...) blocks the host
+//     until before is ready
+template<typename ConcurrentGroup, typename Descriptor, typename Function>
+__host__
+future<void> async_batch(const future<void> &before, ConcurrentGroup g, const Descriptor *descriptors, std::size_t num_problems, Function f, int tile_size = use_default)
+{
+  if(tile_size == use_default)
+  {
+    if(g.size() == use_default)
+    {
+      bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async_batch(): a group of default size requires an explicit tile size");
+    } // end if
+
+    tile_size = g.size() * g.this_exec.grainsize();
+  } // end if
+
+  if(tile_size <= 0)
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async_batch(): the tile size must be positive");
+  } // end if
+
+  // lay out the table of tile offsets & the descriptors one after the other
+  std::vector<int> tile_offsets(num_problems + 1);
+
+  std::size_t num_tiles = 0;
+  for(std::size_t i = 0; i < num_problems; ++i)
+  {
+    tile_offsets[i] = static_cast<int>(num_tiles);
+    num_tiles += (descriptors[i].size() + tile_size - 1) / tile_size;
+  } // end for i
+
+  tile_offsets[num_problems] = static_cast<int>(num_tiles);
+
+  if(num_tiles > static_cast<std::size_t>(INT_MAX))
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async_batch(): the batch has too many tiles");
+  } // end if
+
+  bulk::detail::scratch_partition measure(0);
+  measure.allocate<int>(num_problems + 1);
+  measure.allocate<Descriptor>(num_problems);
+
+  std::size_t num_bytes = measure.size();
+
+  std::vector<char> host_table(num_bytes);
+  bulk::detail::scratch_partition host_partition(&host_table[0]);
+  std::memcpy(host_partition.allocate<int>(num_problems + 1), &tile_offsets[0], (num_problems + 1) * sizeof(int));
+
+  if(num_problems > 0)
+  {
+    std::memcpy(host_partition.allocate<Descriptor>(num_problems), descriptors, num_problems * sizeof(Descriptor));
+  } // end if
+
+  int device = bulk::detail::current_device();
+  cudaStream_t s = bulk::detail::acquire_stream(device);
+
+  void *device_table = 0;
+  future<void> result;
+
+  // until the result takes the stream, anything which throws returns the stream to the pool & the table to the cache
+  try
+  {
+    bulk::detail::stream_wait_on(s, before);
+
+    if(num_tiles == 0)
+    {
+      // the result hands the stream back to the pool when it is destroyed
+      return detail::future_core_access::create(s, true);
+    } // end if
+
+    device_table = bulk::detail::cached_malloc(num_bytes, s);
+
+    bulk::detail::scratch_partition device_partition(device_table);
+    const int *device_tile_offsets    = device_partition.allocate<int>(num_problems + 1);
+    const Descriptor *device_problems = device_partition.allocate<Descriptor>(num_problems);
+
+    bulk::detail::throw_on_error(cudaMemcpyAsync(device_table, &host_table[0], num_bytes, cudaMemcpyHostToDevice, s), "cudaMemcpyAsync in bulk::async_batch");
+
+    result =
+      bulk::detail::launch_in_stream(bulk::par(g, num_tiles),
+                                     bulk::detail::make_closure(bulk::detail::batch_detail::batch_task<Function>(f, tile_size),
+                                                                bulk::root.this_exec, device_tile_offsets, static_cast<int>(num_problems), device_problems),
+                                     s, true, "bulk::async_batch");
+  } // end try
+  catch(...)
+  {
+    // swallow errors, the original exception is more informative
+    if(device_table) bulk::detail::cached_free(device_table, num_bytes, s);
+    bulk::detail::release_stream(device, s);
+    throw;
+  } // end catch
+
+  // later work on s may reuse the table as soon as the launch is through with it
+  bulk::detail::throw_on_error(bulk::detail::cached_free(device_table, num_bytes, s), "cached_free in bulk::async_batch");
+
+  return result;
+} // end async_batch()
+
+
+template<typename ConcurrentGroup, typename Descriptor, typename Function>
+__host__
+future<void> async_batch(ConcurrentGroup g, const Descriptor *descriptors, std::size_t num_problems, Function f, int tile_size = use_default)
+{
+  return bulk::async_batch(future<void>(), g, descriptors, num_problems, f, tile_size);
+} // end async_batch()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -19,10 +19,24 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/execution_policy.hpp>
 #include <bulk/choose_sizes.hpp>
+#include <bulk/tuner.hpp>
+#include <bulk/launch_info.hpp>
 #include <bulk/future.hpp>
 #include <bulk/async.hpp>
+#include <bulk/graph.hpp>
+#include <bulk/device_group.hpp>
+#include <bulk/concurrent_grid.hpp>
+#include <bulk/cluster.hpp>
+#include <bulk/shape.hpp>
+#include <bulk/nested.hpp>
+#include <bulk/host.hpp>
+#include <bulk/prefetch.hpp>
+#include <bulk/batch.hpp>
+#include <bulk/work_queue.hpp>
+#include <bulk/warm_up.hpp>
 #include <bulk/malloc.hpp>
 #include <bulk/algorithm.hpp>
 #include <bulk/iterator.hpp>
 #include <bulk/uninitialized.hpp>
+#include <bulk/compensated.hpp>
 
@@ -26,6 +26,13 @@ namespace bulk
 {
 
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename Function, typename... Args>
+__host__ __device__
+thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
+             typename concurrent_group<>::size_type>
+  choose_sizes(parallel_group<concurrent_group<> > g, Function f, Args&&... args);
+#else
 template<typename Function>
 __host__ __device__
 thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
@@ -73,6 +80,7 @@ __host__ __device__
 thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
              typename concurrent_group<>::size_type>
   choose_sizes(parallel_group<concurrent_group<> > g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6);
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
 
 
 } // end bulk
@@ -0,0 +1,373 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_task.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a level of the hierarchy between the grid and its groups: a cluster of consecutive concurrent groups
+// which are co-scheduled on neighboring multiprocessors, may synchronize with one another,
+// and may address one another's on-chip heaps (sm_90 & better)
+// this_exec.index() is a group's rank within its cluster
+template<typename ExecutionGroup>
+class concurrent_cluster
+  : public detail::group_detail::group_base<ExecutionGroup,dynamic_group_size>
+{
+  private:
+    typedef detail::group_detail::group_base<ExecutionGroup,dynamic_group_size> super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+    typedef typename super_t::size_type  size_type;
+
+    __host__ __device__
+    concurrent_cluster(size_type size, agent_type exec = agent_type(), size_type i = invalid_index)
+      : super_t(size,exec,i)
+    {}
+
+    // every agent of every group in the cluster waits until all have arrived
+    // writes to on-chip memory before the barrier are visible to the cluster after it
+    __device__
+    void wait() const
+    {
+#if __CUDA_ARCH__ >= 900
+      asm volatile("barrier.cluster.arrive.aligned;\n\t"
+                   "barrier.cluster.wait.aligned;" ::: "memory");
+#elif defined(__CUDA_ARCH__)
+      bulk::detail::terminate_with_message("bulk::concurrent_cluster::wait(): clusters require sm_90 or better");
+#endif
+    } // end wait()
+
+    // returns the address within the on-chip memory of the group with the given rank
+    // which corresponds to ptr within this group's on-chip memory
+    template<typename T>
+    __device__
+    T *map(T *ptr, size_type rank) const
+    {
+#if __CUDA_ARCH__ >= 900
+      unsigned long long result = 0;
+      asm volatile("mapa.u64 %0, %1, %2;" : "=l"(result) : "l"(reinterpret_cast<unsigned long long>(ptr)), "r"(rank));
+      return reinterpret_cast<T*>(result);
+#else
+      bulk::detail::terminate_with_message("bulk::concurrent_cluster::map(): clusters require sm_90 or better");
+      return ptr;
+#endif
+    } // end map()
+};
+
+
+// allocates num_bytes from each group's on-chip heap for the other groups of the cluster to address through c.map()
+// returns null in a group whose heap couldn't accommodate the request; the caller should treat any null as a failure
+// of every group in the cluster. Like bulk::malloc, every agent of the cluster must participate
+// XXX the other groups' allocations are at the same address only when every group of the cluster makes the same sequence of allocations
+template<typename ExecutionGroup>
+__device__
+void *on_chip_malloc(concurrent_cluster<ExecutionGroup> &c, std::size_t num_bytes)
+{
+  __shared__ void *s_result;
+
+  c.this_exec.wait();
+
+  if(c.this_exec.this_exec.index() == 0)
+  {
+    s_result = bulk::detail::unsafe_on_chip_malloc(num_bytes);
+  } // end if
+
+  // no group may address another's allocation before it exists
+  c.wait();
+
+  return s_result;
+} // end on_chip_malloc()
+
+
+// frees an allocation of on_chip_malloc once no group of the cluster may still address it
+template<typename ExecutionGroup>
+__device__
+void on_chip_free(concurrent_cluster<ExecutionGroup> &c, void *ptr)
+{
+  c.wait();
+
+  if(ptr != 0 && c.this_exec.this_exec.index() == 0)
+  {
+    bulk::detail::unsafe_on_chip_free(ptr);
+  } // end if
+
+  c.this_exec.wait();
+} // end on_chip_free()
+
+
+// a launch of a grid whose groups are clustered every cluster_size() consecutive groups
+template<typename ExecutionGroup>
+class cluster_launch
+{
+  public:
+    typedef async_launch<parallel_group<ExecutionGroup> > launch_type;
+
+    __host__
+    cluster_launch(int cluster_size, launch_type launch)
+      : m_cluster_size(cluster_size), m_launch(launch)
+    {}
+
+    __host__
+    int cluster_size() const
+    {
+      return m_cluster_size;
+    }
+
+    __host__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    int         m_cluster_size;
+    launch_type m_launch;
+};
+
+
+// shorthand for clustering every cluster_size consecutive groups of g, e.g.
+//
+//   bulk::async(bulk::clustered(2, bulk::grid<128,7>(num_groups, heap_size)), f, bulk::root, ...);
+//
+// f receives a parallel_group of concurrent_clusters in place of bulk::root
+// the number of groups must be a multiple of cluster_size, which should be no greater than 8
+// XXX bulk::root must be f's first argument
+template<typename ExecutionGroup>
+__host__
+cluster_launch<ExecutionGroup> clustered(int cluster_size, parallel_group<ExecutionGroup> g)
+{
+  return cluster_launch<ExecutionGroup>(cluster_size, async_launch<parallel_group<ExecutionGroup> >(g, cudaEvent_t(0)));
+} // end clustered()
+
+
+template<typename ExecutionGroup>
+__host__
+cluster_launch<ExecutionGroup> clustered(int cluster_size, async_launch<parallel_group<ExecutionGroup> > launch)
+{
+  return cluster_launch<ExecutionGroup>(cluster_size, launch);
+} // end clustered()
+
+
+namespace detail
+{
+
+
+// invokes f with its first argument, the grid, replaced with a grid of clusters
+template<typename Function>
+class cluster_function
+{
+  public:
+    __host__ __device__
+    cluster_function(Function f, int cluster_size)
+      : m_f(f), m_cluster_size(cluster_size)
+    {}
+
+    template<typename Grid>
+    __device__
+    void operator()(Grid &g)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg);
+    } // end operator()
+
+    template<typename Grid, typename Arg2>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4, arg5);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8, Arg9 &arg9)
+    {
+      typename cluster_grid<Grid>::type cg = make_cluster_grid(g);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9);
+    } // end operator()
+
+  private:
+    template<typename Grid>
+    struct cluster_grid
+    {
+      typedef parallel_group<concurrent_cluster<typename Grid::agent_type> > type;
+    };
+
+    // re-indexes each group by its rank within its cluster
+    template<typename Grid>
+    __device__
+    typename cluster_grid<Grid>::type make_cluster_grid(Grid &g) const
+    {
+      typedef typename Grid::agent_type block_type;
+      typedef typename Grid::size_type  size_type;
+
+      size_type rank = g.this_exec.index() % m_cluster_size;
+
+      block_type block = make_block<block_type>(g.this_exec.size(), g.this_exec.heap_size(), g.this_exec.this_exec, rank, g.this_exec.heap_policy());
+
+      concurrent_cluster<block_type> cluster(m_cluster_size, block, g.this_exec.index() / m_cluster_size);
+
+      return typename cluster_grid<Grid>::type(g.size() / m_cluster_size, cluster, 0);
+    } // end make_cluster_grid()
+
+    Function m_f;
+    int      m_cluster_size;
+}; // end cluster_function
+
+
+// launches c in clusters and returns a future for its completion
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(cluster_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  typedef parallel_group<ExecutionGroup>                    grid_type;
+  typedef closure<cluster_function<Function>,Arguments>     closure_type;
+  typedef typename grid_type::size_type                     size_type;
+
+  async_launch<grid_type> launch = g.launch();
+
+  int device = bulk::detail::current_device();
+
+  if(bulk::detail::device_properties(device).major < 9)
+  {
+    bulk::detail::throw_on_error(cudaErrorNotSupported, "bulk::async(): clusters require sm_90 or better");
+  } // end if
+
+  size_type cluster_size = g.cluster_size();
+
+  if(cluster_size < 1)
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async(): the cluster size must be positive");
+  } // end if
+
+  bulk::detail::cuda_launcher<grid_type,closure_type> launcher;
+
+  launcher.set_resources(launch.resources());
+
+  size_type num_groups = 0, group_size = 0, heap_size = 0;
+  thrust::tie(num_groups, group_size, heap_size) = launcher.configuration(launch.exec());
+
+  if(num_groups == use_default)
+  {
+    // round the default number of groups down to whole clusters
+    num_groups = launcher.choose_num_groups(use_default, group_size) / cluster_size * cluster_size;
+  } // end if
+
+  if(num_groups % cluster_size != 0)
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async(): the number of groups must be a multiple of the cluster size");
+  } // end if
+
+  // borrow a stream from the pool when the launch doesn't name one
+  bool owns_stream = !launch.is_stream_valid();
+  cudaStream_t s = owns_stream ? bulk::detail::acquire_stream(device, launch.resources().priority) : launch.stream();
+
+  // a borrowed stream goes back to the pool if anything below throws before the future takes it
+  try
+  {
+    bulk::detail::wait_on_before_events(s, launch);
+
+#if __BULK_HAS_LAUNCH_NAMES__
+    launcher.set_name(launch.name());
+#endif
+
+    closure_type cluster_c(cluster_function<Function>(c.function(), cluster_size), c.arguments());
+
+    launcher.set_cluster_size(cluster_size);
+    launcher.launch(bulk::par(launch.exec().this_exec, num_groups), cluster_c, s);
+
+    return future_core_access::create(s, owns_stream, launcher.launch_sequence());
+  } // end try
+  catch(...)
+  {
+    if(owns_stream) bulk::detail::release_stream(device, s);
+    throw;
+  } // end catch
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
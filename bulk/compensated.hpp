@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a running sum which carries the rounding error of its additions alongside it,
+// so that long float reductions lose accuracy like a short reduction rather than a long one
+// pass a compensated<T> as the init of bulk::reduce, bulk::accumulate or a scan together with
+// compensated_plus<T>; the result converts back to T
+template<typename T>
+struct compensated
+{
+  T sum;
+
+  // the error sum accumulated so far, which is added back upon conversion
+  T compensation;
+
+  __host__ __device__
+  compensated()
+    : sum(0), compensation(0)
+  {}
+
+  template<typename U>
+  __host__ __device__
+  compensated(const U &x)
+    : sum(x), compensation(0)
+  {}
+
+  __host__ __device__
+  T value() const
+  {
+    return sum + compensation;
+  }
+
+  __host__ __device__
+  operator T () const
+  {
+    return value();
+  }
+};
+
+
+// Neumaier's variant of Kahan summation, which stays accurate when the next term is larger than the sum
+// the partial sums of agents are combined by adding both their sums & compensations
+// XXX this relies on the compiler not reassociating floating point arithmetic, so avoid -ffast-math style flags
+template<typename T>
+struct compensated_plus
+{
+  typedef compensated<T> result_type;
+
+  __host__ __device__
+  compensated<T> operator()(compensated<T> x, const compensated<T> &y) const
+  {
+    x = (*this)(x, y.sum);
+    x.compensation += y.compensation;
+    return x;
+  }
+
+  template<typename U>
+  __host__ __device__
+  compensated<T> operator()(compensated<T> x, const U &y) const
+  {
+    T term = y;
+    T t = x.sum + term;
+
+    T abs_sum  = x.sum < T(0) ? -x.sum : x.sum;
+    T abs_term = term  < T(0) ? -term  : term;
+
+    // recover the low-order bits of whichever operand was smaller
+    x.compensation += (abs_sum >= abs_term) ? ((x.sum - t) + term) : ((term - t) + x.sum);
+    x.sum = t;
+
+    return x;
+  }
+};
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
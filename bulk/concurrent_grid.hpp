@@ -0,0 +1,318 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the view of a cooperative launch its groups receive: unlike a parallel_group, its groups may synchronize,
+// because a cooperative launch guarantees that they are all resident at once
+// so that multi-phase algorithms may run in a single launch, e.g.
+//
+//   reduce_partitions(g, ...);
+//   g.wait();
+//   if(g.index() == 0) reduce_partials(g.this_exec, ...);
+template<typename ExecutionGroup>
+class concurrent_grid
+  : public parallel_group<ExecutionGroup>
+{
+  private:
+    typedef parallel_group<ExecutionGroup> super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+    typedef typename super_t::size_type  size_type;
+
+    // barrier points to two words of zero-initialized device memory shared by each group of the launch
+    __host__ __device__
+    concurrent_grid(const super_t &g, unsigned int *barrier)
+      : super_t(g),
+        m_barrier(barrier)
+    {}
+
+    // every agent of every group waits until all have arrived
+    // the first word of the barrier counts the groups which have arrived,
+    // and the last group to arrive bumps the second word to release the others
+    __device__
+    void wait()
+    {
+#ifdef __CUDA_ARCH__
+      this->this_exec.wait();
+
+      if(this->this_exec.this_exec.index() == 0)
+      {
+        volatile unsigned int *generation = m_barrier + 1;
+
+        unsigned int my_generation = *generation;
+
+        // publish this group's writes before arriving
+        __threadfence();
+
+        if(atomicAdd(m_barrier, 1) == static_cast<unsigned int>(this->size() - 1))
+        {
+          // the count must be reset before anyone is released into the next barrier
+          atomicExch(m_barrier, 0);
+          __threadfence();
+          atomicAdd(m_barrier + 1, 1);
+        } // end if
+        else
+        {
+          while(*generation == my_generation) {}
+        } // end else
+
+        // observe the other groups' writes after leaving
+        __threadfence();
+      } // end if
+
+      this->this_exec.wait();
+#endif
+    } // end wait()
+
+  private:
+    unsigned int *m_barrier;
+};
+
+
+// a launch of a grid whose groups may synchronize through a concurrent_grid
+// the number of groups is capped at the number which may be co-resident on the device
+template<typename ExecutionGroup>
+class cooperative_launch
+{
+  public:
+    typedef async_launch<parallel_group<ExecutionGroup> > launch_type;
+
+    __host__
+    cooperative_launch(launch_type launch)
+      : m_launch(launch)
+    {}
+
+    __host__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    launch_type m_launch;
+};
+
+
+// shorthand for launching the groups of g cooperatively, e.g.
+//
+//   bulk::async(bulk::cooperative(bulk::grid<128,7>(num_groups, heap_size)), f, bulk::root, ...);
+//
+// f receives a concurrent_grid in place of bulk::root
+// XXX bulk::root must be f's first argument
+template<typename ExecutionGroup>
+__host__
+cooperative_launch<ExecutionGroup> cooperative(parallel_group<ExecutionGroup> g)
+{
+  return cooperative_launch<ExecutionGroup>(async_launch<parallel_group<ExecutionGroup> >(g, cudaEvent_t(0)));
+} // end cooperative()
+
+
+template<typename ExecutionGroup>
+__host__
+cooperative_launch<ExecutionGroup> cooperative(async_launch<parallel_group<ExecutionGroup> > launch)
+{
+  return cooperative_launch<ExecutionGroup>(launch);
+} // end cooperative()
+
+
+namespace detail
+{
+
+
+// invokes f with its first argument, the grid, replaced with a concurrent_grid
+template<typename Function>
+class cooperative_function
+{
+  public:
+    __host__ __device__
+    cooperative_function(Function f, unsigned int *barrier)
+      : m_f(f), m_barrier(barrier)
+    {}
+
+    template<typename Grid>
+    __device__
+    void operator()(Grid &g)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg);
+    } // end operator()
+
+    template<typename Grid, typename Arg2>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4, arg5);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8, Arg9 &arg9)
+    {
+      concurrent_grid<typename Grid::agent_type> cg(g, m_barrier);
+      m_f(cg, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9);
+    } // end operator()
+
+  private:
+    Function      m_f;
+    unsigned int *m_barrier;
+}; // end cooperative_function
+
+
+// launches c cooperatively and returns a future for its completion
+// the requested number of groups, or the launcher's default, is capped at the number which may be co-resident
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(cooperative_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  typedef parallel_group<ExecutionGroup>                           grid_type;
+  typedef closure<cooperative_function<Function>,Arguments>        closure_type;
+  typedef typename grid_type::size_type                            size_type;
+
+  async_launch<grid_type> launch = g.launch();
+
+  int device = bulk::detail::current_device();
+
+  if(!bulk::detail::device_properties(device).cooperativeLaunch)
+  {
+    bulk::detail::throw_on_error(cudaErrorNotSupported, "bulk::async(): this device does not support cooperative launch");
+  } // end if
+
+  // borrow a stream from the pool when the launch doesn't name one
+  bool owns_stream = !launch.is_stream_valid();
+  cudaStream_t s = owns_stream ? bulk::detail::acquire_stream(device, launch.resources().priority) : launch.stream();
+
+  // a borrowed stream goes back to the pool if anything below throws before the future takes it
+  try
+  {
+    bulk::detail::wait_on_before_events(s, launch);
+
+    bulk::detail::cuda_launcher<grid_type,closure_type> launcher;
+
+    launcher.set_resources(launch.resources());
+
+#if __BULK_HAS_LAUNCH_NAMES__
+    launcher.set_name(launch.name());
+#endif
+
+    size_type num_groups = 0, group_size = 0, heap_size = 0;
+    thrust::tie(num_groups, group_size, heap_size) = launcher.configuration(launch.exec());
+
+    size_type max_num_groups = launcher.max_co_resident_groups(group_size, heap_size);
+
+    if(max_num_groups < 1)
+    {
+      bulk::detail::throw_on_error(cudaErrorInvalidConfiguration, "bulk::async(): a cooperative launch's groups are too large to be resident");
+    } // end if
+
+    num_groups = thrust::min(num_groups, max_num_groups);
+
+    const std::size_t barrier_bytes = 2 * sizeof(unsigned int);
+    unsigned int *barrier = static_cast<unsigned int*>(bulk::detail::cached_malloc(barrier_bytes, s));
+    bulk::detail::throw_on_error(cudaMemsetAsync(barrier, 0, barrier_bytes, s), "cudaMemsetAsync in bulk::async");
+
+    closure_type cooperative_c(cooperative_function<Function>(c.function(), barrier), c.arguments());
+
+    launcher.set_cooperative(true);
+    launcher.launch(bulk::par(launch.exec().this_exec, num_groups), cooperative_c, s);
+
+    // the barrier returns to the cache once the launch completes
+    bulk::detail::throw_on_error(bulk::detail::cached_free(barrier, barrier_bytes, s), "cached_free in bulk::async");
+
+    return future_core_access::create(s, owns_stream, launcher.launch_sequence());
+  } // end try
+  catch(...)
+  {
+    if(owns_stream) bulk::detail::release_stream(device, s);
+    throw;
+  } // end catch
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -20,18 +20,115 @@
 #include <bulk/detail/closure.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
 {
+
+
+template<typename ExecutionAgent> class device_group;
+template<typename ExecutionGroup> class cooperative_launch;
+template<typename ExecutionGroup> class cluster_launch;
+template<typename ExecutionGroup> class shaped_launch;
+template<typename ExecutionGroup> class nested_launch;
+template<typename ExecutionGroup> class host_launch;
+template<typename ExecutionGroup> class adaptive_launch;
+template<typename ExecutionGroup> class prefetch_launch;
+
+
 namespace detail
 {
 
 
+// defined in bulk/device_group.hpp
+// XXX declared here so that bulk::async finds it
+template<typename ExecutionAgent, typename Function, typename Arguments>
+__host__
+future<void> async(device_group<ExecutionAgent> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/concurrent_grid.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(cooperative_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/cluster.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(cluster_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/shape.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(shaped_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/nested.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__ __device__
+future<void> async(nested_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/host.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(host_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/host.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(adaptive_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// defined in bulk/prefetch.hpp
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(prefetch_launch<ExecutionGroup> g, closure<Function,Arguments> c);
+
+
+// launches c in stream s and returns a future for its completion
+// name tags the launch's NVTX range when BULK_NVTX is 1 & its launch log entry when BULK_LAUNCH_LOG is 1
+// resources caps the number of groups & sets the L2 access window; s already has its priority
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+future<void> launch_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, bool owns_stream, const char *name = 0, const launch_resources &resources = launch_resources())
+{
+  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
+
+  launcher.set_resources(resources);
+
+#if __BULK_HAS_LAUNCH_NAMES__
+  launcher.set_name(name);
+#else
+  (void)name;
+#endif
+
+#if BULK_HEAP_STATISTICS && !defined(__CUDA_ARCH__)
+  heap_statistics_t *stats = bulk::detail::make_heap_statistics(s);
+  launcher.set_heap_statistics(stats);
+#endif
+
+  launcher.launch(g, c, s);
+
+  future<void> result = future_core_access::create(s, owns_stream, launcher.launch_sequence());
+
+#if BULK_HEAP_STATISTICS && !defined(__CUDA_ARCH__)
+  future_core_access::set_heap_statistics(result, stats);
+#endif
+
+  return result;
+} // end launch_in_stream()
+
+
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
-future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEvent_t before_event)
+future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEvent_t before_event, const char *name = 0, const launch_resources &resources = launch_resources())
 {
 #if __BULK_HAS_CUDART__
   if(before_event != 0)
@@ -42,25 +139,22 @@ future<void> async_in_stream(ExecutionGroup g, Closure c, cudaStream_t s, cudaEv
   bulk::detail::terminate_with_message("async_in_stream(): cudaStreamWaitEvent requires CUDART");
 #endif
 
-  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
-  launcher.launch(g, c, s);
-
-  return future_core_access::create(s, false);
+  return bulk::detail::launch_in_stream(g, c, s, false, name, resources);
 } // end async_in_stream()
 
 
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
-future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event)
+future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event, const char *name = 0, const launch_resources &resources = launch_resources())
 {
-  cudaStream_t s;
+  cudaStream_t s = 0;
 
+  // borrow a stream from the pool rather than creating a new one
   // XXX cudaStreamCreate is __host__-only
   //     figure out a way to support this that does not require creating a new stream
 #if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
-  bulk::detail::throw_on_error(cudaStreamCreate(&s), "cudaStreamCreate in bulk::detail::async");
+  s = bulk::detail::acquire_stream(bulk::detail::current_device(), resources.priority);
 #else
-  s = 0;
   bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() is unsupported in __device__ code.");
 #endif
 
@@ -73,11 +167,9 @@ future<void> async(ExecutionGroup g, Closure c, cudaEvent_t before_event)
   bulk::detail::terminate_with_message("async_in_stream(): cudaStreamWaitEvent requires CUDART");
 #endif
 
-  bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher;
-  launcher.launch(g, c, s);
-
   // note we pass true here, unlike false above
-  return future_core_access::create(s, true);
+  // the future hands the stream back to the pool when it is destroyed
+  return bulk::detail::launch_in_stream(g, c, s, true, name, resources);
 } // end async()
 
 
@@ -89,19 +181,65 @@ future<void> async(ExecutionGroup g, Closure c)
 } // end async()
 
 
+// makes s wait on each of launch's before events
+template<typename ExecutionGroup>
+__host__ __device__
+void wait_on_before_events(cudaStream_t s, const async_launch<ExecutionGroup> &launch)
+{
+  for(int i = 0; i < launch.num_before_events(); ++i)
+  {
+#if __BULK_HAS_CUDART__
+    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, launch.before_event(i), 0), "cudaStreamWaitEvent in wait_on_before_events");
+#else
+    bulk::detail::terminate_with_message("wait_on_before_events(): cudaStreamWaitEvent requires CUDART");
+#endif
+  } // end for i
+} // end wait_on_before_events()
+
+
 template<typename ExecutionGroup, typename Closure>
 __host__ __device__
 future<void> async(async_launch<ExecutionGroup> launch, Closure c)
 {
-  return launch.is_stream_valid() ?
-    bulk::detail::async_in_stream(launch.exec(), c, launch.stream(), launch.before_event()) :
-    bulk::detail::async(launch.exec(), c, launch.before_event());
+  if(launch.num_before_events() <= 1)
+  {
+    return launch.is_stream_valid() ?
+      bulk::detail::async_in_stream(launch.exec(), c, launch.stream(), launch.before_event(), launch.name(), launch.resources()) :
+      bulk::detail::async(launch.exec(), c, launch.before_event(), launch.name(), launch.resources());
+  } // end if
+
+  if(launch.is_stream_valid())
+  {
+    bulk::detail::wait_on_before_events(launch.stream(), launch);
+
+    return bulk::detail::launch_in_stream(launch.exec(), c, launch.stream(), false, launch.name(), launch.resources());
+  } // end if
+
+  cudaStream_t s = 0;
+
+#if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
+  s = bulk::detail::acquire_stream(bulk::detail::current_device(), launch.resources().priority);
+#else
+  bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() is unsupported in __device__ code.");
+#endif
+
+  bulk::detail::wait_on_before_events(s, launch);
+
+  return bulk::detail::launch_in_stream(launch.exec(), c, s, true, launch.name(), launch.resources());
 } // end async()
 
 
 } // end detail
 
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__ __device__
+future<void> async(ExecutionGroup g, Function f, Args&&... args)
+{
+  return bulk::detail::async(g, detail::make_closure(f, bulk::detail::forward<Args>(args)...));
+} // end async()
+#else
 template<typename ExecutionGroup, typename Function>
 __host__ __device__
 future<void> async(ExecutionGroup g, Function f)
@@ -188,6 +326,104 @@ future<void> async(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3
 {
   return bulk::detail::async(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9,arg10));
 } // end async()
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
+
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Args&&... args)
+{
+  return bulk::async(bulk::after(before, g), f, bulk::detail::forward<Args>(args)...);
+} // end then()
+#else
+template<typename ExecutionGroup, typename Function>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f)
+{
+  return bulk::async(bulk::after(before, g), f);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1)
+{
+  return bulk::async(bulk::after(before, g), f, arg1);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5, arg6);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5, arg6, arg7);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9);
+} // end then()
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+__host__
+future<void> then(future<void> &before, ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10)
+{
+  return bulk::async(bulk::after(before, g), f, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9, arg10);
+} // end then()
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
 
 
 } // end bulk
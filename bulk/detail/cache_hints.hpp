@@ -0,0 +1,138 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <thrust/detail/type_traits.h>
+#include <cstring>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace cache_hints_detail
+{
+
+
+// __ldg & st.global.cs are applied only to 4 & 8 byte arithmetic types,
+// whose pointers are known to be suitably aligned
+template<typename T>
+struct has_cache_hints
+  : thrust::detail::integral_constant<
+      bool,
+      thrust::detail::is_arithmetic<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)
+    >
+{};
+
+
+__forceinline__ __device__
+void store_streaming_bits(unsigned int *ptr, unsigned int bits)
+{
+#if __CUDA_ARCH__ >= 200
+  // XXX assumes 64b pointers
+  asm volatile("st.global.cs.u32 [%0], %1;" :: "l"(ptr), "r"(bits) : "memory");
+#else
+  *ptr = bits;
+#endif
+} // end store_streaming_bits()
+
+
+__forceinline__ __device__
+void store_streaming_bits(unsigned long long *ptr, unsigned long long bits)
+{
+#if __CUDA_ARCH__ >= 200
+  asm volatile("st.global.cs.u64 [%0], %1;" :: "l"(ptr), "l"(bits) : "memory");
+#else
+  *ptr = bits;
+#endif
+} // end store_streaming_bits()
+
+
+template<std::size_t size> struct bits_type;
+template<> struct bits_type<4> { typedef unsigned int       type; };
+template<> struct bits_type<8> { typedef unsigned long long type; };
+
+
+} // end cache_hints_detail
+
+
+// loads through the non-coherent read-only data cache on sm_35 and better
+// the caller guarantees that *ptr resides in global memory & is not written to during the kernel
+template<typename T>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  cache_hints_detail::has_cache_hints<T>::value,
+  T
+>::type
+  load_read_only(const T *ptr)
+{
+#if __CUDA_ARCH__ >= 350
+  return __ldg(ptr);
+#else
+  return *ptr;
+#endif
+} // end load_read_only()
+
+
+template<typename T>
+__forceinline__ __device__
+typename thrust::detail::disable_if<
+  cache_hints_detail::has_cache_hints<T>::value,
+  T
+>::type
+  load_read_only(const T *ptr)
+{
+  return *ptr;
+} // end load_read_only()
+
+
+// stores with the evict-first policy, for results which won't be read again soon
+// the caller guarantees that *ptr resides in global memory
+template<typename T>
+__forceinline__ __device__
+typename thrust::detail::enable_if<
+  cache_hints_detail::has_cache_hints<T>::value
+>::type
+  store_streaming(T *ptr, const T &x)
+{
+  typedef typename cache_hints_detail::bits_type<sizeof(T)>::type bits_type;
+
+  bits_type bits;
+  std::memcpy(&bits, &x, sizeof(T));
+
+  cache_hints_detail::store_streaming_bits(reinterpret_cast<bits_type*>(ptr), bits);
+} // end store_streaming()
+
+
+template<typename T>
+__forceinline__ __device__
+typename thrust::detail::disable_if<
+  cache_hints_detail::has_cache_hints<T>::value
+>::type
+  store_streaming(T *ptr, const T &x)
+{
+  *ptr = x;
+} // end store_streaming()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,304 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <thrust/device_ptr.h>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// cudaFree synchronizes the entire device, so the device-wide algorithms' temporaries
+// are recycled through a per-device cache of blocks instead.
+// Blocks are binned by size into powers of two. A block freed on a stream may be reused
+// immediately by later work on that stream, and by any other stream once an event recorded
+// at the point of its release has completed
+// XXX like stream_pool, the cached blocks are deliberately leaked at exit
+class caching_allocator
+{
+  public:
+    // the smallest bin is 2^min_bin bytes
+    static const int min_bin = 9;
+
+    // requests larger than 2^max_bin bytes bypass the cache
+    static const int max_bin = 30;
+
+    // beyond this many idle bytes, released blocks are freed rather than cached
+    static const std::size_t max_cached_bytes = std::size_t(1) << 31;
+
+    inline caching_allocator()
+      : m_cached_bytes(0)
+    {}
+
+    // device_id must name the current device
+    inline void *allocate(int device_id, std::size_t num_bytes, cudaStream_t stream)
+    {
+      int bin = which_bin(num_bytes);
+
+      if(bin <= max_bin)
+      {
+        scoped_spin_lock guard(m_lock);
+
+        std::vector<cached_block> &blocks = m_bins[bin - min_bin];
+
+        for(std::size_t i = 0; i < blocks.size(); ++i)
+        {
+          // work on the block's stream is already ordered after its previous use
+          if(blocks[i].stream == stream || cudaEventQuery(blocks[i].ready) == cudaSuccess)
+          {
+            cached_block result = blocks[i];
+            blocks[i] = blocks.back();
+            blocks.pop_back();
+
+            m_cached_bytes -= bin_size(bin);
+
+            bulk::detail::release_event(device_id, result.ready);
+
+            return result.ptr;
+          } // end if
+        } // end for i
+      } // end if
+
+      std::size_t allocation_size = bin <= max_bin ? bin_size(bin) : num_bytes;
+
+      void *result = 0;
+      cudaError_t error = cudaMalloc(&result, allocation_size);
+
+      if(error == cudaErrorMemoryAllocation)
+      {
+        // the cache may be holding the memory we need
+        cudaGetLastError();
+        free_cached_blocks(device_id);
+
+        error = cudaMalloc(&result, allocation_size);
+      } // end if
+
+      bulk::detail::throw_on_error(error, "cudaMalloc in caching_allocator::allocate");
+
+      return result;
+    } // end allocate()
+
+    // num_bytes must be the size ptr was allocated with
+    // device_id must name the device on which ptr was allocated
+    inline cudaError_t deallocate(int device_id, void *ptr, std::size_t num_bytes, cudaStream_t stream)
+    {
+      int bin = which_bin(num_bytes);
+
+      if(bin <= max_bin)
+      {
+        cudaEvent_t ready = bulk::detail::acquire_event(device_id);
+
+        cudaError_t error = cudaEventRecord(ready, stream);
+        if(error) return error;
+
+        scoped_spin_lock guard(m_lock);
+
+        if(m_cached_bytes + bin_size(bin) <= max_cached_bytes)
+        {
+          cached_block block = {ptr, stream, ready};
+          m_bins[bin - min_bin].push_back(block);
+
+          m_cached_bytes += bin_size(bin);
+
+          return cudaSuccess;
+        } // end if
+
+        bulk::detail::release_event(device_id, ready);
+      } // end if
+
+      return cudaFree(ptr);
+    } // end deallocate()
+
+    // frees every idle block, waiting for their last uses to complete
+    inline void free_cached_blocks(int device_id)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      for(int bin = 0; bin < num_bins; ++bin)
+      {
+        for(std::size_t i = 0; i < m_bins[bin].size(); ++i)
+        {
+          cudaFree(m_bins[bin][i].ptr);
+          bulk::detail::release_event(device_id, m_bins[bin][i].ready);
+        } // end for i
+
+        m_bins[bin].clear();
+      } // end for bin
+
+      m_cached_bytes = 0;
+    } // end free_cached_blocks()
+
+  private:
+    static const int num_bins = max_bin - min_bin + 1;
+
+    struct cached_block
+    {
+      void        *ptr;
+
+      // the stream on which the block was last released
+      cudaStream_t stream;
+
+      // recorded on stream when the block was released
+      cudaEvent_t  ready;
+    };
+
+    inline static int which_bin(std::size_t num_bytes)
+    {
+      int result = min_bin;
+
+      while(result <= max_bin && bin_size(result) < num_bytes)
+      {
+        ++result;
+      } // end while
+
+      return result;
+    } // end which_bin()
+
+    inline static std::size_t bin_size(int bin)
+    {
+      return std::size_t(1) << bin;
+    } // end bin_size()
+
+    spin_lock                 m_lock;
+    std::vector<cached_block> m_bins[num_bins];
+    std::size_t               m_cached_bytes;
+
+    // non-copyable
+    caching_allocator(const caching_allocator &);
+    caching_allocator &operator=(const caching_allocator &);
+}; // end caching_allocator
+
+
+// returns 0 for devices beyond the first few, which bypass the cache
+inline caching_allocator *caching_allocator_for_device(int device_id)
+{
+  // only cache allocations for the first few devices
+  static const int max_num_devices = 16;
+
+  static caching_allocator allocators[max_num_devices];
+
+  return (0 <= device_id && device_id < max_num_devices) ? &allocators[device_id] : 0;
+} // end caching_allocator_for_device()
+
+
+// allocates num_bytes on the current device, for use by work on stream
+inline void *cached_malloc(std::size_t num_bytes, cudaStream_t stream)
+{
+  int device_id = current_device();
+
+  caching_allocator *allocator = caching_allocator_for_device(device_id);
+
+  if(allocator)
+  {
+    return allocator->allocate(device_id, num_bytes, stream);
+  } // end if
+
+  void *result = 0;
+  bulk::detail::throw_on_error(cudaMalloc(&result, num_bytes), "cudaMalloc in cached_malloc");
+  return result;
+} // end cached_malloc()
+
+
+// releases ptr once the work already enqueued on stream has completed
+// ptr must have been allocated on the current device
+inline cudaError_t cached_free(void *ptr, std::size_t num_bytes, cudaStream_t stream)
+{
+  int device_id = current_device();
+
+  caching_allocator *allocator = caching_allocator_for_device(device_id);
+
+  return allocator ? allocator->deallocate(device_id, ptr, num_bytes, stream) : cudaFree(ptr);
+} // end cached_free()
+
+
+// an uninitialized array of trivial T drawn from the cache
+template<typename T>
+class cached_array
+{
+  public:
+    typedef T                       value_type;
+    typedef thrust::device_ptr<T>   iterator;
+    typedef typename iterator::reference reference;
+    typedef std::size_t             size_type;
+
+    inline explicit cached_array(size_type n, cudaStream_t stream = 0)
+      : m_ptr(n ? static_cast<T*>(cached_malloc(n * sizeof(T), stream)) : 0),
+        m_size(n),
+        m_stream(stream)
+    {}
+
+    inline ~cached_array()
+    {
+      if(m_ptr)
+      {
+        // XXX there's no way to report an error from a destructor
+        cached_free(m_ptr, m_size * sizeof(T), m_stream);
+      } // end if
+    }
+
+    inline iterator begin() const
+    {
+      return iterator(m_ptr);
+    }
+
+    inline iterator end() const
+    {
+      return begin() + m_size;
+    }
+
+    inline T *data() const
+    {
+      return m_ptr;
+    }
+
+    inline size_type size() const
+    {
+      return m_size;
+    }
+
+    inline reference operator[](size_type i) const
+    {
+      return begin()[i];
+    }
+
+  private:
+    T           *m_ptr;
+    size_type    m_size;
+    cudaStream_t m_stream;
+
+    // non-copyable
+    cached_array(const cached_array &);
+    cached_array &operator=(const cached_array &);
+}; // end cached_array
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -47,6 +47,16 @@ thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
 } // end detail
 
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename Function, typename... Args>
+__host__ __device__
+thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
+             typename concurrent_group<>::size_type>
+  choose_sizes(parallel_group<concurrent_group<> > g, Function f, Args&&... args)
+{
+  return bulk::detail::choose_sizes(g, detail::make_closure(f, bulk::detail::forward<Args>(args)...));
+}
+#else
 template<typename Function>
 __host__ __device__
 thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
@@ -115,6 +125,7 @@ thrust::pair<typename parallel_group<concurrent_group<> >::size_type,
 {
   return bulk::detail::choose_sizes(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6));
 }
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
 
 
 } // end bulk
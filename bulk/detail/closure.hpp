@@ -18,6 +18,8 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/detail/apply_from_tuple.hpp>
+#include <bulk/detail/compact_tuple.hpp>
+#include <bulk/detail/tuple_transform.hpp>
 
 #include <thrust/detail/config.h>
 #include <thrust/tuple.h>
@@ -43,6 +45,14 @@ class closure
        args(args)
     {}
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+    __host__ __device__
+    closure(function_type f, arguments_type &&args)
+      :f(f),
+       args(bulk::detail::move(args))
+    {}
+#endif
+
 
     __host__ __device__
     void operator()()
@@ -79,6 +89,21 @@ const closure<Function,Arguments> &make_closure(const closure<Function,Arguments
 }
 
 
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+// arguments are forwarded into the closure's storage, which elides empty arguments
+template<typename Function, typename... Args>
+__host__ __device__
+closure<
+  Function,
+  compact_tuple<typename std::decay<Args>::type...>
+>
+  make_closure(Function f, Args&&... args)
+{
+  typedef compact_tuple<typename std::decay<Args>::type...> arguments_type;
+
+  return closure<Function,arguments_type>(f, arguments_type(0, bulk::detail::forward<Args>(args)...));
+}
+#else
 template<typename Function>
 __host__ __device__
 closure<Function, thrust::tuple<> > make_closure(Function f)
@@ -201,6 +226,40 @@ closure<
 {
   return closure<Function,thrust::tuple<Arg1,Arg2,Arg3,Arg4,Arg5,Arg6,Arg7,Arg8,Arg9,Arg10> >(f, thrust::make_tuple(a1,a2,a3,a4,a5,a6,a7,a8,a9,a10));
 }
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
+
+// the type of a closure's arguments after applying UnaryMetaFunction to each
+template<typename Tuple, template<typename> class UnaryMetaFunction>
+struct closure_arguments_meta_transform
+  : tuple_meta_transform<Tuple,UnaryMetaFunction>
+{};
+
+
+template<template<typename> class UnaryMetaFunction, typename Tuple, typename UnaryFunction>
+__host__ __device__
+typename closure_arguments_meta_transform<Tuple,UnaryMetaFunction>::type
+  closure_arguments_transform(const Tuple &args, UnaryFunction f)
+{
+  return bulk::detail::tuple_host_device_transform<UnaryMetaFunction>(args, f);
+}
+
+
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename... Types, template<typename> class UnaryMetaFunction>
+struct closure_arguments_meta_transform<compact_tuple<Types...>,UnaryMetaFunction>
+  : compact_tuple_meta_transform<compact_tuple<Types...>,UnaryMetaFunction>
+{};
+
+
+template<template<typename> class UnaryMetaFunction, typename... Types, typename UnaryFunction>
+__host__ __device__
+typename closure_arguments_meta_transform<compact_tuple<Types...>,UnaryMetaFunction>::type
+  closure_arguments_transform(const compact_tuple<Types...> &args, UnaryFunction f)
+{
+  return bulk::detail::compact_tuple_transform<UnaryMetaFunction>(args, f);
+}
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
 
 
 } // end detail
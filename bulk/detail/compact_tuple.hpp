@@ -0,0 +1,260 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+
+#include <type_traits>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// std::forward & std::move are not __device__ functions
+template<typename T>
+__host__ __device__
+T &&forward(typename std::remove_reference<T>::type &x)
+{
+  return static_cast<T&&>(x);
+} // end forward()
+
+
+template<typename T>
+__host__ __device__
+typename std::remove_reference<T>::type &&move(T &&x)
+{
+  return static_cast<typename std::remove_reference<T>::type&&>(x);
+} // end move()
+
+
+template<std::size_t... Indices>
+struct index_sequence {};
+
+
+template<std::size_t n, std::size_t... Indices>
+struct make_index_sequence_impl
+  : make_index_sequence_impl<n-1, n-1, Indices...>
+{};
+
+
+template<std::size_t... Indices>
+struct make_index_sequence_impl<0, Indices...>
+{
+  typedef index_sequence<Indices...> type;
+};
+
+
+template<std::size_t n>
+struct make_index_sequence
+  : make_index_sequence_impl<n>
+{};
+
+
+namespace compact_tuple_detail
+{
+
+
+// empty elements such as bulk::root occupy no storage
+template<std::size_t i, typename T, bool is_empty = std::is_empty<T>::value>
+class leaf
+{
+  public:
+    __host__ __device__
+    leaf() : m_value() {}
+
+    template<typename U>
+    __host__ __device__
+    explicit leaf(U &&value) : m_value(bulk::detail::forward<U>(value)) {}
+
+    __host__ __device__
+    T &get() { return m_value; }
+
+    __host__ __device__
+    const T &get() const { return m_value; }
+
+  private:
+    T m_value;
+};
+
+
+template<std::size_t i, typename T>
+class leaf<i,T,true>
+  : private T
+{
+  public:
+    __host__ __device__
+    leaf() : T() {}
+
+    template<typename U>
+    __host__ __device__
+    explicit leaf(U &&value) : T(bulk::detail::forward<U>(value)) {}
+
+    __host__ __device__
+    T &get() { return *this; }
+
+    __host__ __device__
+    const T &get() const { return *this; }
+};
+
+
+template<typename IndexSequence, typename... Types> class base;
+
+
+template<std::size_t... Indices, typename... Types>
+class base<index_sequence<Indices...>, Types...>
+  : public leaf<Indices,Types>...
+{
+  public:
+    __host__ __device__
+    base() {}
+
+    template<typename... Args>
+    __host__ __device__
+    explicit base(int, Args&&... args)
+      : leaf<Indices,Types>(bulk::detail::forward<Args>(args))...
+    {}
+};
+
+
+} // end compact_tuple_detail
+
+
+// compact_tuple stores the arguments of a closure
+// unlike thrust::tuple, it holds any number of elements and elides empty ones,
+// which keeps kernel parameter blocks small
+template<typename... Types>
+class compact_tuple
+  : public compact_tuple_detail::base<typename make_index_sequence<sizeof...(Types)>::type, Types...>
+{
+  private:
+    typedef compact_tuple_detail::base<typename make_index_sequence<sizeof...(Types)>::type, Types...> super_t;
+
+  public:
+    __host__ __device__
+    compact_tuple() {}
+
+    // the int disambiguates this from the copy constructor
+    template<typename... Args>
+    __host__ __device__
+    compact_tuple(int, Args&&... args)
+      : super_t(0, bulk::detail::forward<Args>(args)...)
+    {}
+};
+
+
+template<std::size_t i, typename Tuple> struct compact_tuple_element;
+
+
+template<std::size_t i, typename Type1, typename... Types>
+struct compact_tuple_element<i, compact_tuple<Type1, Types...> >
+  : compact_tuple_element<i-1, compact_tuple<Types...> >
+{};
+
+
+template<typename Type1, typename... Types>
+struct compact_tuple_element<0, compact_tuple<Type1, Types...> >
+{
+  typedef Type1 type;
+};
+
+
+template<std::size_t i, typename... Types>
+__host__ __device__
+typename compact_tuple_element<i, compact_tuple<Types...> >::type &
+  get(compact_tuple<Types...> &t)
+{
+  typedef typename compact_tuple_element<i, compact_tuple<Types...> >::type element_type;
+  return static_cast<compact_tuple_detail::leaf<i,element_type>&>(t).get();
+} // end get()
+
+
+template<std::size_t i, typename... Types>
+__host__ __device__
+const typename compact_tuple_element<i, compact_tuple<Types...> >::type &
+  get(const compact_tuple<Types...> &t)
+{
+  typedef typename compact_tuple_element<i, compact_tuple<Types...> >::type element_type;
+  return static_cast<const compact_tuple_detail::leaf<i,element_type>&>(t).get();
+} // end get()
+
+
+namespace compact_tuple_detail
+{
+
+
+template<typename Function, typename... Types, std::size_t... Indices>
+__host__ __device__
+void apply(Function &f, const compact_tuple<Types...> &args, index_sequence<Indices...>)
+{
+  f(bulk::detail::get<Indices>(args)...);
+} // end apply()
+
+
+__bulk_hd_warning_disable__
+template<template<typename> class UnaryMetaFunction, typename UnaryFunction, typename... Types, std::size_t... Indices>
+__host__ __device__
+compact_tuple<typename UnaryMetaFunction<Types>::type...>
+  transform(const compact_tuple<Types...> &t, UnaryFunction f, index_sequence<Indices...>)
+{
+  return compact_tuple<typename UnaryMetaFunction<Types>::type...>(0, f(bulk::detail::get<Indices>(t))...);
+} // end transform()
+
+
+} // end compact_tuple_detail
+
+
+template<typename Function, typename... Types>
+__host__ __device__
+void apply_from_tuple(Function f, const compact_tuple<Types...> &args)
+{
+  compact_tuple_detail::apply(f, args, typename make_index_sequence<sizeof...(Types)>::type());
+} // end apply_from_tuple()
+
+
+template<typename Tuple, template<typename> class UnaryMetaFunction> struct compact_tuple_meta_transform;
+
+
+template<typename... Types, template<typename> class UnaryMetaFunction>
+struct compact_tuple_meta_transform<compact_tuple<Types...>, UnaryMetaFunction>
+{
+  typedef compact_tuple<typename UnaryMetaFunction<Types>::type...> type;
+};
+
+
+template<template<typename> class UnaryMetaFunction, typename UnaryFunction, typename... Types>
+__host__ __device__
+compact_tuple<typename UnaryMetaFunction<Types>::type...>
+  compact_tuple_transform(const compact_tuple<Types...> &t, UnaryFunction f)
+{
+  return compact_tuple_detail::transform<UnaryMetaFunction>(t, f, typename make_index_sequence<sizeof...(Types)>::type());
+} // end compact_tuple_transform()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
@@ -60,3 +60,9 @@
 #  define __BULK_HAS_PRINTF__ 1
 #endif
 
+#if defined(__GXX_EXPERIMENTAL_CXX0X__) || (__cplusplus >= 201103L)
+#  define __BULK_HAS_VARIADIC_TEMPLATES__ 1
+#else
+#  define __BULK_HAS_VARIADIC_TEMPLATES__ 0
+#endif
+
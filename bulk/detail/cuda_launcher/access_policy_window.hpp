@@ -0,0 +1,118 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/execution_policy.hpp>
+#include <cstddef>
+
+
+// L2 access policy windows first appeared in CUDA 11
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 11000)
+#  define __BULK_HAS_ACCESS_POLICY_WINDOW__ 1
+#else
+#  define __BULK_HAS_ACCESS_POLICY_WINDOW__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// gives stream resources' access window for the duration of a launch, and
+// takes it away afterwards so that work which later reuses a pooled stream doesn't inherit it
+// the window is clamped to the device's maximum, and devices without one
+// (or toolkits older than CUDA 11) simply launch without it
+// XXX the legacy default stream carries no attributes, so launches into stream 0 ignore the window
+class scoped_access_policy_window
+{
+  public:
+    inline __host__
+    scoped_access_policy_window(int device, cudaStream_t s, const launch_resources &resources)
+      : m_stream(s), m_active(false)
+    {
+#if __BULK_HAS_CUDART__ && __BULK_HAS_ACCESS_POLICY_WINDOW__
+      if(resources.access_window_bytes == 0 || s == 0) return;
+
+      int max_window_size = 0;
+      bulk::detail::throw_on_error(cudaDeviceGetAttribute(&max_window_size, cudaDevAttrMaxAccessPolicyWindowSize, device),
+                                   "cudaDeviceGetAttribute in scoped_access_policy_window");
+
+      if(max_window_size <= 0) return;
+
+      std::size_t num_bytes = resources.access_window_bytes;
+      if(num_bytes > static_cast<std::size_t>(max_window_size))
+      {
+        num_bytes = max_window_size;
+      } // end if
+
+      cudaStreamAttrValue value;
+      value.accessPolicyWindow.base_ptr  = const_cast<void*>(resources.access_window_base);
+      value.accessPolicyWindow.num_bytes = num_bytes;
+      value.accessPolicyWindow.hitRatio  = resources.access_window_hit_ratio;
+      value.accessPolicyWindow.hitProp   = cudaAccessPropertyPersisting;
+      value.accessPolicyWindow.missProp  = cudaAccessPropertyStreaming;
+
+      bulk::detail::throw_on_error(cudaStreamSetAttribute(s, cudaStreamAttributeAccessPolicyWindow, &value),
+                                   "cudaStreamSetAttribute in scoped_access_policy_window");
+
+      m_active = true;
+#else
+      (void)device;
+      (void)resources;
+#endif
+    } // end scoped_access_policy_window()
+
+    inline __host__
+    ~scoped_access_policy_window()
+    {
+#if __BULK_HAS_CUDART__ && __BULK_HAS_ACCESS_POLICY_WINDOW__
+      if(m_active)
+      {
+        // an empty window resets the stream's policy
+        // XXX a destructor can't throw, so any error is left for the next wait to find
+        cudaStreamAttrValue value;
+        value.accessPolicyWindow.base_ptr  = 0;
+        value.accessPolicyWindow.num_bytes = 0;
+        value.accessPolicyWindow.hitRatio  = 0.f;
+        value.accessPolicyWindow.hitProp   = cudaAccessPropertyNormal;
+        value.accessPolicyWindow.missProp  = cudaAccessPropertyNormal;
+
+        cudaStreamSetAttribute(m_stream, cudaStreamAttributeAccessPolicyWindow, &value);
+      } // end if
+#endif
+    } // end ~scoped_access_policy_window()
+
+  private:
+    cudaStream_t m_stream;
+    bool         m_active;
+
+    scoped_access_policy_window(const scoped_access_policy_window &);
+    scoped_access_policy_window &operator=(const scoped_access_policy_window &);
+}; // end scoped_access_policy_window
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
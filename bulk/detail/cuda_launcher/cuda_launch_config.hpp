@@ -36,14 +36,22 @@ struct device_properties_t
 {
   // mirror the type and spelling of cudaDeviceProp's members
   // keep these alphabetized
+  int    cooperativeLaunch;
+  int    l2CacheSize;
   int    major;
+  int    maxBlocksPerMultiProcessor;
   int    maxGridSize[3];
+  int    maxThreadsDim[3];
   int    maxThreadsPerBlock;
   int    maxThreadsPerMultiProcessor;
   int    minor;
   int    multiProcessorCount;
   int    regsPerBlock;
+  int    regsPerMultiprocessor;
+  size_t reservedSharedMemPerBlock;
   size_t sharedMemPerBlock;
+  size_t sharedMemPerBlockOptin;
+  size_t sharedMemPerMultiprocessor;
   int    warpSize;
 };
 
@@ -113,6 +121,22 @@ size_t max_blocksize_subject_to_smem_usage(const device_properties_t   &properti
                                            UnaryFunction blocksize_to_dynamic_smem_usage);
 
 
+/*! Returns the percentage of the multiprocessor's unified L1 & shared memory storage
+ *  a kernel should prefer as shared memory: just enough for as many blocks to be resident
+ *  as its other limits allow, leaving the rest to L1.
+ *
+ *  \param properties CUDA device properties
+ *  \param attributes CUDA function attributes
+ *  \param CTA_SIZE Number of threads per block
+ *  \param dynamic_smem_bytes Number of bytes of dynamic shared memory per block
+ */
+inline __host__ __device__
+int preferred_shared_memory_carveout(const device_properties_t   &properties,
+                                     const function_attributes_t &attributes,
+                                     size_t CTA_SIZE,
+                                     size_t dynamic_smem_bytes);
+
+
 
 namespace cuda_launch_config_detail
 {
@@ -176,12 +200,47 @@ size_t smem_allocation_unit(const device_properties_t &properties)
   {
     case 1:  return 512;
     case 2:  return 128;
-    case 3:  return 256;
-    default: return 256; // unknown GPU; have to guess
+    case 3:
+    case 5:
+    case 6:
+    case 7:  return 256;
+    default: return 128; // sm_80 & later, or an unknown GPU; have to guess
   }
 }
 
 
+// the shared memory the runtime reserves for itself from each block's allocation
+inline __host__ __device__
+size_t reserved_smem_per_block(const device_properties_t &properties)
+{
+  return properties.reservedSharedMemPerBlock;
+}
+
+
+// the multiprocessor's shared memory capacity
+// on sm_70+, this is only available once the carveout favors shared memory, which the launcher arranges
+inline __host__ __device__
+size_t smem_per_multiprocessor(const device_properties_t &properties)
+{
+  return properties.sharedMemPerMultiprocessor > 0 ? properties.sharedMemPerMultiprocessor : properties.sharedMemPerBlock;
+}
+
+
+// the largest allocation of a single block, once the kernel has opted in to more than sharedMemPerBlock
+inline __host__ __device__
+size_t max_smem_per_block(const device_properties_t &properties)
+{
+  return properties.sharedMemPerBlockOptin > 0 ? properties.sharedMemPerBlockOptin : properties.sharedMemPerBlock;
+}
+
+
+inline __host__ __device__
+size_t regs_per_multiprocessor(const device_properties_t &properties)
+{
+  return properties.regsPerMultiprocessor > 0 ? properties.regsPerMultiprocessor : properties.regsPerBlock;
+}
+
+
 // granularity of register allocation
 inline __host__ __device__
 int reg_allocation_unit(const device_properties_t &properties, const size_t regsPerThread)
@@ -230,10 +289,26 @@ size_t num_sides_per_multiprocessor(const device_properties_t &properties)
 }
 
 
+// the runtime reports this limit since CUDA 11, so the table only covers what came before
 inline __host__ __device__
 size_t max_blocks_per_multiprocessor(const device_properties_t &properties)
 {
-  return (properties.major <= 2) ? 8 : 16;
+  if(properties.maxBlocksPerMultiProcessor > 0)
+  {
+    return properties.maxBlocksPerMultiProcessor;
+  }
+
+  switch(properties.major)
+  {
+    case 1:
+    case 2:  return 8;
+    case 3:  return 16;
+    case 5:
+    case 6:  return 32;
+    case 7:  return (properties.minor >= 5) ? 16 : 32;
+    case 8:  return (properties.minor == 0) ? 32 : (properties.minor == 9) ? 24 : 16;
+    default: return 32; // unknown GPU; have to guess
+  }
 }
 
 
@@ -261,10 +336,20 @@ size_t max_active_blocks_per_multiprocessor(const device_properties_t    &proper
   //////////////////////////////////////////
   const size_t smemAllocationUnit     = smem_allocation_unit(properties);
   const size_t smemBytes  = attributes.sharedSizeBytes + dynamic_smem_bytes;
-  const size_t smemPerCTA = util::round_i(smemBytes, smemAllocationUnit);
+
+  // the runtime's reservation counts against each block's share of the multiprocessor, but not against its own limit
+  const size_t smemPerCTA = util::round_i(smemBytes + reserved_smem_per_block(properties), smemAllocationUnit);
 
   // Calc limit
-  const size_t ctaLimitSMem = smemPerCTA > 0 ? properties.sharedMemPerBlock / smemPerCTA : maxBlocksPerSM;
+  size_t ctaLimitSMem;
+  if(smemBytes > max_smem_per_block(properties))
+  {
+    ctaLimitSMem = 0;
+  }
+  else
+  {
+    ctaLimitSMem = smemPerCTA > 0 ? smem_per_multiprocessor(properties) / smemPerCTA : maxBlocksPerSM;
+  }
 
   //////////////////////////////////////////
   // Limits due to registers/SM
@@ -286,10 +371,19 @@ size_t max_active_blocks_per_multiprocessor(const device_properties_t    &proper
   {
     // GPUs of compute capability 2.x and higher allocate registers to warps
     // Number of regs per warp is regs per thread times times warp size, rounded up to allocation unit
+    // each side of the multiprocessor holds a whole number of warps' registers, and a block may not exceed regsPerBlock
     const size_t regsPerWarp = util::round_i(attributes.numRegs * properties.warpSize, regAllocationUnit);
     const size_t numSides = num_sides_per_multiprocessor(properties);
-    const size_t numRegsPerSide = properties.regsPerBlock / numSides;
-    ctaLimitRegs = regsPerWarp > 0 ? ((numRegsPerSide / regsPerWarp) * numSides) / numWarps : maxBlocksPerSM;
+    const size_t numRegsPerSide = regs_per_multiprocessor(properties) / numSides;
+
+    if(regsPerWarp * numWarps > size_t(properties.regsPerBlock))
+    {
+      ctaLimitRegs = 0;
+    }
+    else
+    {
+      ctaLimitRegs = regsPerWarp > 0 ? ((numRegsPerSide / regsPerWarp) * numSides) / numWarps : maxBlocksPerSM;
+    }
   }
 
   //////////////////////////////////////////
@@ -346,13 +440,18 @@ size_t proportional_smem_allocation(const device_properties_t   &properties,
                                     const function_attributes_t &attributes,
                                     size_t blocks_per_processor)
 {
-  size_t smem_per_processor    = properties.sharedMemPerBlock;
+  size_t smem_per_processor    = cuda_launch_config_detail::smem_per_multiprocessor(properties);
   size_t smem_allocation_unit  = cuda_launch_config_detail::smem_allocation_unit(properties);
 
   size_t total_smem_per_block  = cuda_launch_config_detail::util::round_z(smem_per_processor / blocks_per_processor, smem_allocation_unit);
+  size_t reserved_smem         = cuda_launch_config_detail::reserved_smem_per_block(properties);
   size_t static_smem_per_block = attributes.sharedSizeBytes;
+
+  // the runtime's reservation comes out of the block's share, and what remains can't exceed a single block's limit
+  total_smem_per_block = (total_smem_per_block > reserved_smem) ? total_smem_per_block - reserved_smem : 0;
+  total_smem_per_block = cuda_launch_config_detail::util::min_(total_smem_per_block, cuda_launch_config_detail::max_smem_per_block(properties));
   
-  return total_smem_per_block - static_smem_per_block;
+  return (total_smem_per_block > static_smem_per_block) ? total_smem_per_block - static_smem_per_block : 0;
 }
 
 
@@ -369,7 +468,7 @@ size_t max_blocksize_subject_to_smem_usage(const device_properties_t   &properti
   {
     size_t total_smem_usage = blocksize_to_dynamic_smem_usage(blocksize) + attributes.sharedSizeBytes;
 
-    if(total_smem_usage <= properties.sharedMemPerBlock)
+    if(total_smem_usage <= cuda_launch_config_detail::max_smem_per_block(properties))
     {
       return blocksize;
     }
@@ -379,6 +478,31 @@ size_t max_blocksize_subject_to_smem_usage(const device_properties_t   &properti
 }
 
 
+inline __host__ __device__
+int preferred_shared_memory_carveout(const device_properties_t   &properties,
+                                     const function_attributes_t &attributes,
+                                     size_t CTA_SIZE,
+                                     size_t dynamic_smem_bytes)
+{
+  const size_t smemBytes = attributes.sharedSizeBytes + dynamic_smem_bytes;
+  const size_t smemPerSM = cuda_launch_config_detail::smem_per_multiprocessor(properties);
+
+  // a kernel without shared memory leaves all of the storage to L1
+  if(smemBytes == 0 || smemPerSM == 0) return 0;
+
+  const size_t smemAllocationUnit = cuda_launch_config_detail::smem_allocation_unit(properties);
+  const size_t smemPerCTA = cuda_launch_config_detail::util::round_i(smemBytes + cuda_launch_config_detail::reserved_smem_per_block(properties), smemAllocationUnit);
+
+  size_t occupancy = cuda_launch_config_detail::max_active_blocks_per_multiprocessor(properties, attributes, CTA_SIZE, dynamic_smem_bytes);
+  occupancy = (occupancy > 0) ? occupancy : 1;
+
+  // the driver rounds the carveout up to the next configuration the multiprocessor supports
+  size_t percent = cuda_launch_config_detail::util::divide_ri(100 * occupancy * smemPerCTA, smemPerSM);
+
+  return static_cast<int>(cuda_launch_config_detail::util::min_<size_t>(percent, 100));
+}
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
@@ -22,8 +22,13 @@
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/cuda_launcher/triple_chevron_launcher.hpp>
 #include <bulk/detail/cuda_launcher/cuda_launch_config.hpp>
+#include <bulk/detail/cuda_launcher/launch_config_cache.hpp>
 #include <bulk/detail/synchronize.hpp>
+#include <bulk/detail/nvtx.hpp>
+#include <bulk/detail/launch_log.hpp>
+#include <bulk/detail/cuda_launcher/access_policy_window.hpp>
 #include <thrust/detail/minmax.h>
+#include <thrust/detail/integer_traits.h>
 #include <thrust/pair.h>
 
 
@@ -60,22 +65,211 @@ struct cuda_launcher_base
 
   __host__ __device__
   cuda_launcher_base()
-    : m_device_properties(bulk::detail::device_properties())
+    : m_device(bulk::detail::current_device()),
+      m_device_properties(bulk::detail::device_properties(m_device)),
+      m_precomputed(false),
+      m_has_launch_config(false),
+      m_cooperative(false),
+      m_cluster_size(1),
+      m_shaped(false),
+      m_resources()
+#if BULK_HEAP_STATISTICS
+      , m_heap_statistics(0)
+#endif
+#if __BULK_HAS_LAUNCH_NAMES__
+      , m_name(0)
+#endif
+#if BULK_LAUNCH_LOG
+      , m_launch_sequence(0)
+#endif
   {}
 
 
+  // takes the device & its properties from the caller rather than querying them,
+  // e.g. a nested launch from __device__ code which received them from the host
+  // sizes the caller names explicitly are then taken as-is, so that the kernel's attributes
+  // are only queried for a group size or heap size left to use_default
+  __host__ __device__
+  cuda_launcher_base(int device, const device_properties_t &props)
+    : m_device(device),
+      m_device_properties(props),
+      m_precomputed(true),
+      m_has_launch_config(false),
+      m_cooperative(false),
+      m_cluster_size(1),
+      m_shaped(false),
+      m_resources()
+#if BULK_HEAP_STATISTICS
+      , m_heap_statistics(0)
+#endif
+#if __BULK_HAS_LAUNCH_NAMES__
+      , m_name(0)
+#endif
+#if BULK_LAUNCH_LOG
+      , m_launch_sequence(0)
+#endif
+  {}
+
+
+#if BULK_HEAP_STATISTICS
+  // subsequent launches accumulate their heap usage into *stats
+  __host__ __device__
+  void set_heap_statistics(heap_statistics_t *stats)
+  {
+    m_heap_statistics = stats;
+  }
+#endif
+
+
+  // subsequent launches guarantee that all of their groups are resident at once, so that they may synchronize
+  // the caller must limit the number of groups to max_co_resident_groups()
+  __host__ __device__
+  void set_cooperative(bool cooperative)
+  {
+    m_cooperative = cooperative;
+  }
+
+
+  // subsequent launches group every cluster_size consecutive groups into a cluster
+  // the caller must launch a multiple of cluster_size groups
+  __host__ __device__
+  void set_cluster_size(size_type cluster_size)
+  {
+    m_cluster_size = cluster_size;
+  }
+
+
+  // subsequent launches of a grid map its groups & their agents onto grid_shape & group_shape
+  // rather than onto the x dimension alone
+  // the caller must request grid_shape.x * grid_shape.y * grid_shape.z groups of
+  // group_shape.x * group_shape.y * group_shape.z agents each
+  __host__ __device__
+  void set_shape(dim3 grid_shape, dim3 group_shape)
+  {
+    m_shaped      = true;
+    m_grid_shape  = grid_shape;
+    m_group_shape = group_shape;
+  }
+
+
+  // subsequent launches persist resources' access window in L2 and
+  // cap the number of groups they choose by resources' multiprocessor limits
+  // the stream priority is left to whoever acquires the stream
+  __host__ __device__
+  void set_resources(const launch_resources &resources)
+  {
+    m_resources = resources;
+  }
+
+
+#if __BULK_HAS_LAUNCH_NAMES__
+  // subsequent launches are tagged with name in the NVTX range they push & in the launch log
+  __host__ __device__
+  void set_name(const char *name)
+  {
+    m_name = name;
+  }
+#endif
+
+
   __host__ __device__
   void launch(size_type num_blocks, size_type block_size, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
   {
+    launch(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream, task);
+  } // end launch()
+
+
+  __host__ __device__
+  void launch(dim3 grid_dim, dim3 block_dim, size_type num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+  {
+    size_type num_blocks = grid_dim.x * grid_dim.y * grid_dim.z;
+
     if(num_blocks > 0)
     {
-      super_t::launch(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+#if BULK_HEAP_STATISTICS
+      task.set_heap_statistics(m_heap_statistics);
+#endif
+
+#if BULK_NVTX && !defined(__CUDA_ARCH__)
+      bulk::detail::scoped_nvtx_range range(m_name, num_blocks, block_dim.x * block_dim.y * block_dim.z, num_dynamic_smem_bytes);
+#endif
+
+#if BULK_LAUNCH_LOG && !defined(__CUDA_ARCH__)
+      m_launch_sequence = bulk::detail::the_launch_log().record(m_name, grid_dim, block_dim, num_dynamic_smem_bytes, stream);
+#endif
+
+#if !defined(__CUDA_ARCH__)
+      scoped_access_policy_window window(m_device, stream, m_resources);
+
+      prepare_shared_memory(block_dim.x * block_dim.y * block_dim.z, num_dynamic_smem_bytes);
+#endif
+
+      super_t::launch(grid_dim, block_dim, num_dynamic_smem_bytes, stream, task, m_cooperative, m_cluster_size);
 
       bulk::detail::synchronize_if_enabled("bulk_kernel_by_value");
     } // end if
   } // end launch()
 
 
+  // the launch log's number for the most recent launch, or 0 when there was none or nothing logs launches
+  __host__ __device__
+  unsigned long long launch_sequence() const
+  {
+#if BULK_LAUNCH_LOG
+    return m_launch_sequence;
+#else
+    return 0;
+#endif
+  }
+
+
+  // on sm_70+, a heap beyond the default per-group limit requires the kernel to opt in first,
+  // and the kernel's preferred carveout asks for just enough of the multiprocessor's storage as shared memory
+  // to keep as many groups resident as the model in cuda_launch_config.hpp expects, leaving the rest to L1
+  __host__ __device__
+  void prepare_shared_memory(size_type group_size, size_type heap_size)
+  {
+#ifndef __CUDA_ARCH__
+    const device_properties_t &props = device_properties();
+
+    if(props.major < 7) return;
+
+    const function_attributes_t &attr = launch_config().function_attributes;
+
+    if(attr.sharedSizeBytes + heap_size > props.sharedMemPerBlock && !cache().find_opt_in(m_device))
+    {
+      // opting in to the largest allocation at once means racing launches never undo one another
+      bulk::detail::set_max_dynamic_shared_memory_size(super_t::global_function_pointer(), max_smem_per_group(props) - attr.sharedSizeBytes);
+      cache().insert_opt_in(m_device);
+    } // end if
+
+    int carveout = bulk::detail::preferred_shared_memory_carveout(props, attr, group_size, heap_size);
+
+    if(!cache().find_carveout(m_device, carveout))
+    {
+      bulk::detail::set_preferred_shared_memory_carveout(super_t::global_function_pointer(), carveout);
+      cache().insert_carveout(m_device, carveout);
+    } // end if
+#endif
+  } // end prepare_shared_memory()
+
+
+  // the largest allocation of shared memory a group may make
+  // only the host may opt a kernel in to more than sharedMemPerBlock, and only sm_70+ allows it
+  __host__ __device__
+  static size_type max_smem_per_group(const device_properties_t &props)
+  {
+#ifndef __CUDA_ARCH__
+    if(props.major >= 7)
+    {
+      return bulk::detail::cuda_launch_config_detail::max_smem_per_block(props);
+    } // end if
+#endif
+
+    return props.sharedMemPerBlock;
+  } // end max_smem_per_group()
+
+
   __host__ __device__
   static size_type max_active_blocks_per_multiprocessor(const device_properties_t &props,
                                                         const function_attributes_t &attr,
@@ -105,7 +299,34 @@ struct cuda_launcher_base
   __host__ __device__
   size_type choose_heap_size(const device_properties_t &props, size_type group_size, size_type requested_size)
   {
-    function_attributes_t attr = bulk::detail::function_attributes(super_t::global_function_pointer());
+    if(m_precomputed && requested_size != use_default)
+    {
+      // leave room for the heap data structure, as choose_heap_size_uncached() does
+      return requested_size == 0 ? 0 : thrust::min<size_type>(requested_size + 48, max_smem_per_group(props));
+    } // end if
+
+#ifndef __CUDA_ARCH__
+    std::size_t cached_result = 0;
+    if(cache().find_heap_size(m_device, group_size, requested_size, cached_result))
+    {
+      return cached_result;
+    } // end if
+
+    size_type result = choose_heap_size_uncached(props, group_size, requested_size);
+
+    cache().insert_heap_size(m_device, group_size, requested_size, result);
+
+    return result;
+#else
+    return choose_heap_size_uncached(props, group_size, requested_size);
+#endif
+  } // end choose_heap_size()
+
+
+  __host__ __device__
+  size_type choose_heap_size_uncached(const device_properties_t &props, size_type group_size, size_type requested_size)
+  {
+    const function_attributes_t &attr = launch_config().function_attributes;
 
     // if the kernel's ptx version is < 200, we return 0 because there is no heap
     // if the user requested no heap, give him no heap
@@ -114,6 +335,13 @@ struct cuda_launcher_base
       return 0;
     } // end if
 
+    // heaps beyond the default per-group limit require an opt-in & take storage away from L1,
+    // so the heap only grows past that limit when the request does
+    size_type static_size   = attr.sharedSizeBytes;
+    size_type default_limit = props.sharedMemPerBlock > static_size ? props.sharedMemPerBlock - static_size : 0;
+    size_type max_limit     = max_smem_per_group(props) > static_size ? max_smem_per_group(props) - static_size : 0;
+    size_type limit         = (requested_size != use_default && requested_size + 48 > default_limit) ? max_limit : default_limit;
+
     // how much smem could we allocate without reducing occupancy?
     size_type result = 0, occupancy = 0;
     thrust::tie(result,occupancy) = dynamic_smem_occupancy_limit(props, attr, group_size, 0);
@@ -139,8 +367,18 @@ struct cuda_launcher_base
       } // end else
     } // end i
 
-    return result;
-  } // end choose_smem_size()
+    return thrust::min<size_type>(result, limit);
+  } // end choose_heap_size_uncached()
+
+
+  // the most groups of the given shape which may be resident on the device at once
+  __host__ __device__
+  size_type max_co_resident_groups(size_type group_size, size_type heap_size)
+  {
+    size_type occupancy = max_active_blocks_per_multiprocessor(device_properties(), launch_config().function_attributes, group_size, heap_size);
+
+    return occupancy * device_properties().multiProcessorCount;
+  } // end max_co_resident_groups()
 
 
   __host__ __device__
@@ -150,9 +388,7 @@ struct cuda_launcher_base
 
     if(result == use_default)
     {
-      bulk::detail::function_attributes_t attr = bulk::detail::function_attributes(super_t::global_function_pointer());
-
-      return bulk::detail::block_size_with_maximum_potential_occupancy(attr, device_properties());
+      return launch_config().default_group_size;
     } // end if
 
     return result;
@@ -178,7 +414,19 @@ struct cuda_launcher_base
       // would simply occupy the machine as well as possible
       size_type subscription = choose_subscription(group_size);
 
-      result = thrust::min<size_type>(subscription * device_properties().multiProcessorCount, max_physical_grid_size());
+      if(m_resources.max_groups_per_multiprocessor > 0)
+      {
+        subscription = thrust::min<size_type>(subscription, m_resources.max_groups_per_multiprocessor);
+      } // end if
+
+      size_type num_multiprocessors = device_properties().multiProcessorCount;
+
+      if(m_resources.max_multiprocessors > 0)
+      {
+        num_multiprocessors = thrust::min<size_type>(num_multiprocessors, m_resources.max_multiprocessors);
+      } // end if
+
+      result = thrust::min<size_type>(subscription * num_multiprocessors, max_physical_grid_size());
     } // end if
 
     return result;
@@ -187,12 +435,34 @@ struct cuda_launcher_base
 
   __host__ __device__
   size_type max_physical_grid_size()
+  {
+    // launches from __device__ code require sm_35, so the kernel's ptx version can't lower the device's limit
+    if(m_precomputed)
+    {
+      return device_properties().maxGridSize[0];
+    } // end if
+
+    return launch_config().max_physical_grid_size;
+  } // end max_physical_grid_size()
+
+
+  // the limit on the number of rows a sequence of blocks too long for a single row may be folded into
+  __host__ __device__
+  size_type max_physical_grid_height()
+  {
+    return device_properties().maxGridSize[1];
+  } // end max_physical_grid_height()
+
+
+  // the limit on the x dimension of a grid
+  __host__ __device__
+  static size_type max_physical_grid_size(const device_properties_t &props, const function_attributes_t &attr)
   {
     // get the limit of the actual device
-    int actual_limit = device_properties().maxGridSize[0];
+    int actual_limit = props.maxGridSize[0];
 
     // get the limit of the PTX version of the kernel
-    int ptx_version = bulk::detail::function_attributes(super_t::global_function_pointer()).ptxVersion;
+    int ptx_version = attr.ptxVersion;
 
     int ptx_limit = 0;
 
@@ -217,7 +487,72 @@ struct cuda_launcher_base
   }
 
 
+  // the launch configuration depends only on the kernel & the device,
+  // so on the host we look it up in a cache shared by all launches of this kernel
+  __host__ __device__
+  const launch_config_t &launch_config()
+  {
+    if(!m_has_launch_config)
+    {
+#ifndef __CUDA_ARCH__
+      if(!cache().find_config(m_device, m_launch_config))
+      {
+        m_launch_config = launch_config_uncached();
+        cache().insert_config(m_device, m_launch_config);
+      } // end if
+#else
+      m_launch_config = launch_config_uncached();
+#endif
+
+      m_has_launch_config = true;
+    } // end if
+
+    return m_launch_config;
+  } // end launch_config()
+
+
+  __host__ __device__
+  launch_config_t launch_config_uncached() const
+  {
+    launch_config_t result;
+
+    result.function_attributes    = bulk::detail::function_attributes(super_t::global_function_pointer());
+    result.default_group_size     = bulk::detail::block_size_with_maximum_potential_occupancy(result.function_attributes, device_properties());
+    result.max_physical_grid_size = max_physical_grid_size(device_properties(), result.function_attributes);
+
+    return result;
+  } // end launch_config_uncached()
+
+
+  inline static launch_config_cache &cache()
+  {
+    return launch_config_cache_for<cuda_launcher_base>();
+  } // end cache()
+
+
+  int                 m_device;
   device_properties_t m_device_properties;
+  bool                m_precomputed;
+  bool                m_has_launch_config;
+  launch_config_t     m_launch_config;
+  bool                m_cooperative;
+  size_type           m_cluster_size;
+  bool                m_shaped;
+  dim3                m_grid_shape;
+  dim3                m_group_shape;
+  launch_resources    m_resources;
+
+#if BULK_HEAP_STATISTICS
+  heap_statistics_t  *m_heap_statistics;
+#endif
+
+#if __BULK_HAS_LAUNCH_NAMES__
+  const char         *m_name;
+#endif
+
+#if BULK_LAUNCH_LOG
+  unsigned long long  m_launch_sequence;
+#endif
 }; // end cuda_launcher_base
 
 
@@ -246,6 +581,14 @@ struct cuda_launcher<
 
   typedef typename super_t::task_type task_type;
 
+  __host__ __device__
+  cuda_launcher() {}
+
+  __host__ __device__
+  cuda_launcher(int device, const device_properties_t &props)
+    : super_t(device, props)
+  {}
+
   // launch(...) requires CUDA launch capability
   __host__ __device__
   void launch(grid_type request, Closure c, cudaStream_t stream)
@@ -259,27 +602,35 @@ struct cuda_launcher<
     {
       size_type heap_size  = g.this_exec.heap_size();
 
-      size_type max_physical_grid_size = super_t::max_physical_grid_size();
+      if(super_t::m_shaped)
+      {
+        super_t::launch(super_t::m_grid_shape, super_t::m_group_shape, heap_size, stream, task_type(g, c, 0));
+        return;
+      } // end if
 
-      // launch multiple grids in order to accomodate potentially too large grid size requests
+      // a grid too long for the x dimension is folded into rows of max_grid_width blocks,
+      // which cuda_task reassembles into a linear block index
+      // clusters may not straddle rows, so rows hold whole clusters
+      size_type max_grid_width = super_t::max_physical_grid_size();
+      max_grid_width -= max_grid_width % super_t::m_cluster_size;
+
+      // only a grid too long to fold into a single launch goes out in several launches
       // XXX these will all go in sequential order in the same stream, even though they are logically
       //     parallel
-      if(block_size > 0)
-      {
-        size_type num_remaining_physical_blocks = num_blocks;
-        for(size_type block_offset = 0;
-            block_offset < num_blocks;
-            block_offset += max_physical_grid_size)
-        {
-          task_type task(g, c, block_offset);
+      size_type max_grid_height = thrust::min<size_type>(super_t::max_physical_grid_height(), thrust::detail::integer_traits<size_type>::const_max / max_grid_width);
+      size_type max_blocks_per_launch = max_grid_width * max_grid_height;
 
-          size_type num_physical_blocks = thrust::min<size_type>(num_remaining_physical_blocks, max_physical_grid_size);
+      for(size_type block_offset = 0, num_physical_blocks = 0;
+          block_offset < num_blocks;
+          block_offset += num_physical_blocks)
+      {
+        num_physical_blocks = thrust::min<size_type>(num_blocks - block_offset, max_blocks_per_launch);
 
-          super_t::launch(num_physical_blocks, block_size, heap_size, stream, task);
+        size_type grid_width  = thrust::min<size_type>(num_physical_blocks, max_grid_width);
+        size_type grid_height = (num_physical_blocks - 1) / grid_width + 1;
 
-          num_remaining_physical_blocks -= num_physical_blocks;
-        } // end for block_offset
-      } // end if
+        super_t::launch(dim3(grid_width, grid_height), dim3(block_size), heap_size, stream, task_type(g, c, block_offset));
+      } // end for block_offset
     } // end if
   } // end go()
 
@@ -290,9 +641,18 @@ struct cuda_launcher<
     size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, g.this_exec.heap_size());
     size_type num_blocks = g.size();
 
-    return make_grid<grid_type>(num_blocks, make_block<block_type>(block_size, heap_size));
+    return make_grid<grid_type>(num_blocks, make_block<block_type>(block_size, heap_size, thread_type(), invalid_index, g.this_exec.heap_policy()));
   } // end configure()
 
+  // returns the (num_groups, group_size, heap_size) launch(request, ...) would choose
+  __host__ __device__
+  thrust::tuple<size_type,size_type,size_type> configuration(grid_type request)
+  {
+    grid_type g = configure(request);
+
+    return thrust::make_tuple(g.size(), g.this_exec.size(), g.this_exec.heap_size());
+  } // end configuration()
+
   // chooses a number of groups and a group size
   __host__ __device__
   thrust::pair<size_type, size_type> choose_sizes(size_type requested_num_groups, size_type requested_group_size)
@@ -334,6 +694,14 @@ struct cuda_launcher<
 
   typedef concurrent_group<agent<grainsize>,blocksize> block_type;
 
+  __host__ __device__
+  cuda_launcher() {}
+
+  __host__ __device__
+  cuda_launcher(int device, const device_properties_t &props)
+    : super_t(device, props)
+  {}
+
   __host__ __device__
   void launch(block_type request, Closure c, cudaStream_t stream)
   {
@@ -354,8 +722,16 @@ struct cuda_launcher<
   {
     size_type block_size = super_t::choose_group_size(b.size());
     size_type heap_size  = super_t::choose_heap_size(device_properties(), block_size, b.heap_size());
-    return make_block<block_type>(block_size, heap_size);
+    return make_block<block_type>(block_size, heap_size, typename block_type::agent_type(), invalid_index, b.heap_policy());
   } // end configure()
+
+  __host__ __device__
+  thrust::tuple<size_type,size_type,size_type> configuration(block_type request)
+  {
+    block_type b = configure(request);
+
+    return thrust::make_tuple(size_type(1), b.size(), b.heap_size());
+  } // end configuration()
 }; // end cuda_launcher
 
 
@@ -375,6 +751,14 @@ struct cuda_launcher<
 
   typedef parallel_group<agent<grainsize>,groupsize> group_type;
 
+  __host__ __device__
+  cuda_launcher() {}
+
+  __host__ __device__
+  cuda_launcher(int device, const device_properties_t &props)
+    : super_t(device, props)
+  {}
+
   __host__ __device__
   void launch(group_type g, Closure c, cudaStream_t stream)
   {
@@ -405,6 +789,16 @@ struct cuda_launcher<
 
     return thrust::make_tuple(num_blocks, block_size);
   } // end configure()
+
+  // parallel groups have no heap
+  __host__ __device__
+  thrust::tuple<size_type,size_type,size_type> configuration(group_type g)
+  {
+    size_type num_blocks, block_size;
+    thrust::tie(num_blocks,block_size) = configure(g);
+
+    return thrust::make_tuple(num_blocks, block_size, size_type(0));
+  } // end configuration()
 }; // end cuda_launcher
 
 
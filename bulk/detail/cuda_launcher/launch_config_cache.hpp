@@ -0,0 +1,212 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launch_config.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// the decisions cuda_launcher makes which depend only on the kernel & the device
+struct launch_config_t
+{
+  function_attributes_t function_attributes;
+
+  // the block size with maximum potential occupancy given 0 bytes of dynamic smem
+  std::size_t           default_group_size;
+
+  // the limit on the number of blocks in a single launch
+  std::size_t           max_physical_grid_size;
+};
+
+
+// memoizes launch_config_t & the result of choose_heap_size() per device,
+// so that repeated launches of the same kernel avoid cudaFuncGetAttributes
+// and the occupancy calculation
+// it also remembers the shared memory attributes the launcher has set for the kernel,
+// so that they are only set again when they change
+class launch_config_cache
+{
+  public:
+    // only cache the first few devices
+    static const int max_num_devices = 16;
+
+    // heap size decisions are hashed into a small direct-mapped table
+    static const int num_heap_size_slots = 8;
+
+    inline launch_config_cache()
+    {
+      for(int i = 0; i < max_num_devices; ++i)
+      {
+        m_config_exists[i] = false;
+        m_opted_in[i] = false;
+        m_carveouts[i] = -1;
+
+        for(int j = 0; j < num_heap_size_slots; ++j)
+        {
+          m_heap_sizes[i][j].valid = false;
+        } // end for j
+      } // end for i
+    } // end launch_config_cache()
+
+    inline bool find_config(int device_id, launch_config_t &result)
+    {
+      if(!is_cached_device(device_id)) return false;
+
+      scoped_spin_lock guard(m_lock);
+
+      if(m_config_exists[device_id])
+      {
+        result = m_configs[device_id];
+        return true;
+      } // end if
+
+      return false;
+    } // end find_config()
+
+    inline void insert_config(int device_id, const launch_config_t &config)
+    {
+      if(!is_cached_device(device_id)) return;
+
+      scoped_spin_lock guard(m_lock);
+
+      m_configs[device_id] = config;
+      m_config_exists[device_id] = true;
+    } // end insert_config()
+
+    inline bool find_heap_size(int device_id, std::size_t group_size, std::size_t requested_size, std::size_t &result)
+    {
+      if(!is_cached_device(device_id)) return false;
+
+      scoped_spin_lock guard(m_lock);
+
+      const heap_size_entry &entry = m_heap_sizes[device_id][slot(group_size, requested_size)];
+
+      if(entry.valid && entry.group_size == group_size && entry.requested_size == requested_size)
+      {
+        result = entry.heap_size;
+        return true;
+      } // end if
+
+      return false;
+    } // end find_heap_size()
+
+    inline void insert_heap_size(int device_id, std::size_t group_size, std::size_t requested_size, std::size_t heap_size)
+    {
+      if(!is_cached_device(device_id)) return;
+
+      scoped_spin_lock guard(m_lock);
+
+      heap_size_entry &entry = m_heap_sizes[device_id][slot(group_size, requested_size)];
+
+      entry.valid          = true;
+      entry.group_size     = group_size;
+      entry.requested_size = requested_size;
+      entry.heap_size      = heap_size;
+    } // end insert_heap_size()
+
+    // true once the kernel has opted in to its device's largest dynamic shared memory allocation
+    inline bool find_opt_in(int device_id)
+    {
+      if(!is_cached_device(device_id)) return false;
+
+      scoped_spin_lock guard(m_lock);
+
+      return m_opted_in[device_id];
+    } // end find_opt_in()
+
+    inline void insert_opt_in(int device_id)
+    {
+      if(!is_cached_device(device_id)) return;
+
+      scoped_spin_lock guard(m_lock);
+
+      m_opted_in[device_id] = true;
+    } // end insert_opt_in()
+
+    // true if carveout is the preferred carveout last set for the kernel on the device
+    inline bool find_carveout(int device_id, int carveout)
+    {
+      if(!is_cached_device(device_id)) return false;
+
+      scoped_spin_lock guard(m_lock);
+
+      return m_carveouts[device_id] == carveout;
+    } // end find_carveout()
+
+    inline void insert_carveout(int device_id, int carveout)
+    {
+      if(!is_cached_device(device_id)) return;
+
+      scoped_spin_lock guard(m_lock);
+
+      m_carveouts[device_id] = carveout;
+    } // end insert_carveout()
+
+  private:
+    struct heap_size_entry
+    {
+      bool        valid;
+      std::size_t group_size;
+      std::size_t requested_size;
+      std::size_t heap_size;
+    };
+
+    inline static bool is_cached_device(int device_id)
+    {
+      return 0 <= device_id && device_id < max_num_devices;
+    } // end is_cached_device()
+
+    inline static int slot(std::size_t group_size, std::size_t requested_size)
+    {
+      return static_cast<int>(((group_size / 32) ^ (requested_size / 64)) % num_heap_size_slots);
+    } // end slot()
+
+    spin_lock       m_lock;
+    bool            m_config_exists[max_num_devices];
+    launch_config_t m_configs[max_num_devices];
+    heap_size_entry m_heap_sizes[max_num_devices][num_heap_size_slots];
+    bool            m_opted_in[max_num_devices];
+    int             m_carveouts[max_num_devices];
+
+    // non-copyable
+    launch_config_cache(const launch_config_cache &);
+    launch_config_cache &operator=(const launch_config_cache &);
+}; // end launch_config_cache
+
+
+// each distinct Kernel gets its own cache
+template<typename Kernel>
+inline launch_config_cache &launch_config_cache_for()
+{
+  static launch_config_cache cache;
+  return cache;
+} // end launch_config_cache_for()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -24,6 +24,14 @@
 #include <cstring>
 
 
+// stream-ordered allocation first appeared in CUDA 11.2
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 11020)
+#  define __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ 1
+#else
+#  define __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ 0
+#endif
+
+
 BULK_NAMESPACE_PREFIX
 namespace bulk
 {
@@ -32,6 +40,9 @@ namespace detail
 
 
 // this thing has ownership semantics like unique_ptr, so copy and assign are more like moves
+// when stream_ordered is true, the parameter was allocated in stream with cudaMallocAsync
+// and is freed in stream, so that its lifetime ends after the launches which use it
+// without synchronizing the device
 template<typename T>
 class parameter_ptr
 {
@@ -39,16 +50,19 @@ class parameter_ptr
     typedef T element_type;
 
     __host__ __device__
-    explicit parameter_ptr(element_type *ptr)
-      : m_ptr(ptr)
+    explicit parameter_ptr(element_type *ptr, cudaStream_t stream = 0, bool stream_ordered = false)
+      : m_ptr(ptr), m_stream(stream), m_stream_ordered(stream_ordered)
     {}
 
     // XXX copy emulates a move
     __host__ __device__
     parameter_ptr(const parameter_ptr& other_)
+      : m_ptr(0), m_stream(0), m_stream_ordered(false)
     {
       parameter_ptr& other = const_cast<parameter_ptr&>(other_);
       thrust::swap(m_ptr, other.m_ptr);
+      thrust::swap(m_stream, other.m_stream);
+      thrust::swap(m_stream_ordered, other.m_stream_ordered);
     }
 
     __host__ __device__
@@ -57,6 +71,13 @@ class parameter_ptr
 #if __BULK_HAS_CUDART__
       if(m_ptr)
       {
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ && !defined(__CUDA_ARCH__)
+        if(m_stream_ordered)
+        {
+          bulk::detail::terminate_on_error(cudaFreeAsync(m_ptr, m_stream), "in parameter_ptr dtor");
+          return;
+        }
+#endif
         bulk::detail::terminate_on_error(cudaFree(m_ptr), "in parameter_ptr dtor");
       }
 #else
@@ -70,6 +91,8 @@ class parameter_ptr
     {
       parameter_ptr& other = const_cast<parameter_ptr&>(other_);
       thrust::swap(m_ptr, other.m_ptr);
+      thrust::swap(m_stream, other.m_stream);
+      thrust::swap(m_stream_ordered, other.m_stream_ordered);
       return *this;
     }
 
@@ -81,6 +104,8 @@ class parameter_ptr
 
   private:
     T *m_ptr;
+    cudaStream_t m_stream;
+    bool m_stream_ordered;
 };
 
 
@@ -109,6 +134,29 @@ parameter_ptr<T> make_parameter(const T& x)
 }
 
 
+// like make_parameter(x), but the allocation and upload are ordered in stream,
+// so neither the host nor the device waits on them
+template<typename T>
+__host__ __device__
+parameter_ptr<T> make_parameter(const T& x, cudaStream_t stream)
+{
+#if __BULK_HAS_STREAM_ORDERED_ALLOCATOR__ && !defined(__CUDA_ARCH__)
+  T* raw_ptr = 0;
+
+  bulk::detail::throw_on_error(cudaMallocAsync(reinterpret_cast<void**>(&raw_ptr), sizeof(T), stream), "make_parameter(): after cudaMallocAsync");
+
+  // x is pageable, so cudaMemcpyAsync stages it before returning and x need not outlive this call
+  bulk::detail::throw_on_error(cudaMemcpyAsync(raw_ptr, &x, sizeof(T), cudaMemcpyHostToDevice, stream),
+                               "make_parameter(): after cudaMemcpyAsync");
+
+  return parameter_ptr<T>(raw_ptr, stream, true);
+#else
+  (void) stream; // Suppress unused parameter warnings
+  return make_parameter(x);
+#endif
+}
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
@@ -25,6 +25,14 @@
 #include <cstddef>
 
 
+// cudaFuncSetAttribute first appeared in CUDA 9
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+#  define __BULK_HAS_FUNC_SET_ATTRIBUTE__ 1
+#else
+#  define __BULK_HAS_FUNC_SET_ATTRIBUTE__ 0
+#endif
+
+
 // runtime introspection isn't possible without CUDART
 #if __BULK_HAS_CUDART__
 
@@ -60,6 +68,18 @@ template <typename KernelFunction>
 __host__ __device__
 inline function_attributes_t function_attributes(KernelFunction kernel);
 
+/*! Allows launches of a __global__ function to allocate up to num_bytes of dynamic __shared__ memory,
+ *  which may exceed the default limit of sharedMemPerBlock on sm_70+
+ */
+template <typename KernelFunction>
+inline void set_max_dynamic_shared_memory_size(KernelFunction kernel, int num_bytes);
+
+/*! Sets the percentage of the multiprocessor's unified L1 & __shared__ memory storage
+ *  a __global__ function prefers as __shared__ memory
+ */
+template <typename KernelFunction>
+inline void set_preferred_shared_memory_carveout(KernelFunction kernel, int percent);
+
 /*! Returns the compute capability of a device in integer format.
  *  For example, returns 10 for sm_10 and 21 for sm_21
  *  \return The compute capability as an integer
@@ -17,6 +17,7 @@
 #include <bulk/detail/config.hpp>
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
 #include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/host_atomic.hpp>
 #include <thrust/system/cuda/detail/guarded_cuda_runtime_api.h>
 #include <thrust/detail/util/blocking.h>
 #include <thrust/detail/minmax.h>
@@ -34,15 +35,23 @@ namespace detail
 __host__ __device__
 inline device_properties_t device_properties_uncached(int device_id)
 {
-  device_properties_t prop = {0,{0,0,0},0,0,0,0,0,0,0};
+  device_properties_t prop = {0,0,0,0,{0,0,0},{0,0,0},0,0,0,0,0,0,0,0,0,0,0};
 
   cudaError_t error = cudaErrorNoDevice;
 
 #if __BULK_HAS_CUDART__
-  error = cudaDeviceGetAttribute(&prop.major,           cudaDevAttrComputeCapabilityMajor,      device_id);
+  // the runtime only reports support for cooperative launch since CUDA 9
+#if CUDART_VERSION >= 9000
+  error = cudaDeviceGetAttribute(&prop.cooperativeLaunch,           cudaDevAttrCooperativeLaunch,           device_id);
+#endif
+  error = cudaDeviceGetAttribute(&prop.l2CacheSize,                 cudaDevAttrL2CacheSize,                 device_id);
+  error = cudaDeviceGetAttribute(&prop.major,                       cudaDevAttrComputeCapabilityMajor,      device_id);
   error = cudaDeviceGetAttribute(&prop.maxGridSize[0],              cudaDevAttrMaxGridDimX,                 device_id);
   error = cudaDeviceGetAttribute(&prop.maxGridSize[1],              cudaDevAttrMaxGridDimY,                 device_id);
   error = cudaDeviceGetAttribute(&prop.maxGridSize[2],              cudaDevAttrMaxGridDimZ,                 device_id);
+  error = cudaDeviceGetAttribute(&prop.maxThreadsDim[0],            cudaDevAttrMaxBlockDimX,                device_id);
+  error = cudaDeviceGetAttribute(&prop.maxThreadsDim[1],            cudaDevAttrMaxBlockDimY,                device_id);
+  error = cudaDeviceGetAttribute(&prop.maxThreadsDim[2],            cudaDevAttrMaxBlockDimZ,                device_id);
   error = cudaDeviceGetAttribute(&prop.maxThreadsPerBlock,          cudaDevAttrMaxThreadsPerBlock,          device_id);
   error = cudaDeviceGetAttribute(&prop.maxThreadsPerMultiProcessor, cudaDevAttrMaxThreadsPerMultiProcessor, device_id);
   error = cudaDeviceGetAttribute(&prop.minor,                       cudaDevAttrComputeCapabilityMinor,      device_id);
@@ -51,7 +60,36 @@ inline device_properties_t device_properties_uncached(int device_id)
   int temp;
   error = cudaDeviceGetAttribute(&temp,                             cudaDevAttrMaxSharedMemoryPerBlock,     device_id);
   prop.sharedMemPerBlock = temp;
+#if CUDART_VERSION >= 6000
+  error = cudaDeviceGetAttribute(&prop.regsPerMultiprocessor,       cudaDevAttrMaxRegistersPerMultiprocessor, device_id);
+  error = cudaDeviceGetAttribute(&temp,                             cudaDevAttrMaxSharedMemoryPerMultiprocessor, device_id);
+  prop.sharedMemPerMultiprocessor = temp;
+#else
+  prop.regsPerMultiprocessor = prop.regsPerBlock;
+  prop.sharedMemPerMultiprocessor = prop.sharedMemPerBlock;
+#endif
+
+  // blocks may only opt in to more shared memory than sharedMemPerBlock since CUDA 9
+#if CUDART_VERSION >= 9000
+  error = cudaDeviceGetAttribute(&temp,                             cudaDevAttrMaxSharedMemoryPerBlockOptin, device_id);
+  prop.sharedMemPerBlockOptin = temp;
+#else
+  prop.sharedMemPerBlockOptin = prop.sharedMemPerBlock;
+#endif
+
+  // the runtime only reports its per-block reservation since CUDA 11
+#if CUDART_VERSION >= 11000
+  error = cudaDeviceGetAttribute(&temp,                             cudaDevAttrReservedSharedMemoryPerBlock, device_id);
+  prop.reservedSharedMemPerBlock = temp;
+#endif
   error = cudaDeviceGetAttribute(&prop.warpSize,                    cudaDevAttrWarpSize,                    device_id);
+
+  // the runtime only reports this limit since CUDA 11, so fall back to the table in cuda_launch_config.hpp
+#if CUDART_VERSION >= 11000
+  error = cudaDeviceGetAttribute(&prop.maxBlocksPerMultiProcessor,  cudaDevAttrMaxBlocksPerMultiprocessor,  device_id);
+#else
+  prop.maxBlocksPerMultiProcessor = static_cast<int>(cuda_launch_config_detail::max_blocks_per_multiprocessor(prop));
+#endif
 #else
   (void) device_id; // Suppress unused parameter warnings
 #endif
@@ -62,32 +100,65 @@ inline device_properties_t device_properties_uncached(int device_id)
 }
 
 
-inline device_properties_t device_properties_cached(int device_id)
+// the registry is zero-initialized POD, so it is ready before any thread can touch it
+struct device_properties_registry
 {
-  // cache the result of get_device_properties, because it is slow
-  // only cache the first few devices
-  static const int max_num_devices                              = 16;
+  // enough for any node we're likely to see
+  static const int max_num_devices = 64;
+
+  // the states of each entry
+  static const int uninitialized = 0;
+  static const int initializing  = 1;
+  static const int ready         = 2;
 
-  static bool properties_exist[max_num_devices]                 = {0};
-  static device_properties_t device_properties[max_num_devices] = {};
+  host_atomic_int     state[max_num_devices];
+  device_properties_t properties[max_num_devices];
+};
 
-  if(device_id >= max_num_devices)
+
+inline device_properties_registry &the_device_properties_registry()
+{
+  static device_properties_registry registry;
+  return registry;
+}
+
+
+// once an entry is ready, lookups cost a single load. Only one thread ever
+// queries a given device; other threads asking for it at the same time wait
+inline device_properties_t device_properties_cached(int device_id)
+{
+  if(device_id < 0 || device_id >= device_properties_registry::max_num_devices)
   {
     return device_properties_uncached(device_id);
   }
 
-  if(!properties_exist[device_id])
-  {
-    device_properties[device_id] = device_properties_uncached(device_id);
+  device_properties_registry &registry = the_device_properties_registry();
 
-    // disallow the compiler to move the write to properties_exist[device_id]
-    // before the initialization of device_properties[device_id]
-    __thrust_compiler_fence();
-    
-    properties_exist[device_id] = true;
-  }
+  host_atomic_int *state = &registry.state[device_id];
 
-  return device_properties[device_id];
+  int current_state = device_properties_registry::uninitialized;
+
+  while((current_state = host_atomic_load(state)) != device_properties_registry::ready)
+  {
+    if(current_state == device_properties_registry::uninitialized &&
+       host_atomic_compare_and_swap(state, device_properties_registry::uninitialized, device_properties_registry::initializing))
+    {
+      try
+      {
+        registry.properties[device_id] = device_properties_uncached(device_id);
+      }
+      catch(...)
+      {
+        // let a later caller try again
+        host_atomic_store(state, device_properties_registry::uninitialized);
+        throw;
+      }
+
+      host_atomic_store(state, device_properties_registry::ready);
+    } // end if
+  } // end while
+
+  return registry.properties[device_id];
 }
 
 
@@ -156,6 +227,30 @@ inline function_attributes_t function_attributes(KernelFunction kernel)
 #endif // __CUDACC__
 }
 
+
+template <typename KernelFunction>
+inline void set_max_dynamic_shared_memory_size(KernelFunction kernel, int num_bytes)
+{
+#if __BULK_HAS_FUNC_SET_ATTRIBUTE__
+  bulk::detail::throw_on_error(cudaFuncSetAttribute(reinterpret_cast<const void*>(kernel), cudaFuncAttributeMaxDynamicSharedMemorySize, num_bytes),
+                               "set_max_dynamic_shared_memory_size(): after cudaFuncSetAttribute");
+#else
+  (void) kernel; (void) num_bytes;
+#endif
+}
+
+
+template <typename KernelFunction>
+inline void set_preferred_shared_memory_carveout(KernelFunction kernel, int percent)
+{
+#if __BULK_HAS_FUNC_SET_ATTRIBUTE__
+  bulk::detail::throw_on_error(cudaFuncSetAttribute(reinterpret_cast<const void*>(kernel), cudaFuncAttributePreferredSharedMemoryCarveout, percent),
+                               "set_preferred_shared_memory_carveout(): after cudaFuncSetAttribute");
+#else
+  (void) kernel; (void) percent;
+#endif
+}
+
 __host__ __device__
 inline size_t compute_capability(const device_properties_t &properties)
 {
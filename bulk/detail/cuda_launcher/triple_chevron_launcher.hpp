@@ -20,6 +20,23 @@
 #include <bulk/detail/alignment.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/cuda_launcher/parameter_ptr.hpp>
+#include <cstring>
+
+
+// cudaLaunchCooperativeKernel first appeared in CUDA 9
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+#  define __BULK_HAS_COOPERATIVE_LAUNCH__ 1
+#else
+#  define __BULK_HAS_COOPERATIVE_LAUNCH__ 0
+#endif
+
+
+// cudaLaunchKernelExC & thread block clusters first appeared in CUDA 11.8
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 11080)
+#  define __BULK_HAS_CLUSTER_LAUNCH__ 1
+#else
+#  define __BULK_HAS_CLUSTER_LAUNCH__ 0
+#endif
 
 // It's not possible to launch a CUDA kernel unless __BULK_HAS_CUDART__
 // is 1, so we'd like to just hide all this code when that macro is 0.
@@ -38,6 +55,72 @@ namespace detail
 {
 
 
+namespace triple_chevron_launcher_detail
+{
+
+
+inline void launch_cooperative_kernel(void *kernel, dim3 grid_dim, dim3 block_dim, void **args, size_t num_dynamic_smem_bytes, cudaStream_t stream)
+{
+#if __BULK_HAS_COOPERATIVE_LAUNCH__
+  bulk::detail::throw_on_error(cudaLaunchCooperativeKernel(kernel, grid_dim, block_dim, args, num_dynamic_smem_bytes, stream),
+                               "after cudaLaunchCooperativeKernel in triple_chevron_launcher::launch()");
+#else
+  (void) kernel; (void) grid_dim; (void) block_dim; (void) args; (void) num_dynamic_smem_bytes; (void) stream;
+  bulk::detail::throw_on_error(cudaErrorNotSupported, "triple_chevron_launcher::launch(): cooperative launch requires CUDA 9");
+#endif
+} // end launch_cooperative_kernel()
+
+
+// launches kernel in clusters of cluster_size consecutive blocks, which may also be cooperative
+inline void launch_cluster_kernel(void *kernel, dim3 grid_dim, dim3 block_dim, void **args, size_t num_dynamic_smem_bytes, cudaStream_t stream, bool cooperative, unsigned int cluster_size)
+{
+#if __BULK_HAS_CLUSTER_LAUNCH__
+  cudaLaunchAttribute attributes[2];
+  std::memset(attributes, 0, sizeof(attributes));
+
+  attributes[0].id               = cudaLaunchAttributeClusterDimension;
+  attributes[0].val.clusterDim.x = cluster_size;
+  attributes[0].val.clusterDim.y = 1;
+  attributes[0].val.clusterDim.z = 1;
+
+  attributes[1].id               = cudaLaunchAttributeCooperative;
+  attributes[1].val.cooperative  = 1;
+
+  cudaLaunchConfig_t config;
+  std::memset(&config, 0, sizeof(config));
+  config.gridDim          = grid_dim;
+  config.blockDim         = block_dim;
+  config.dynamicSmemBytes = num_dynamic_smem_bytes;
+  config.stream           = stream;
+  config.attrs            = attributes;
+  config.numAttrs         = cooperative ? 2 : 1;
+
+  bulk::detail::throw_on_error(cudaLaunchKernelExC(&config, kernel, args),
+                               "after cudaLaunchKernelExC in triple_chevron_launcher::launch()");
+#else
+  (void) kernel; (void) grid_dim; (void) block_dim; (void) args; (void) num_dynamic_smem_bytes; (void) stream; (void) cooperative; (void) cluster_size;
+  bulk::detail::throw_on_error(cudaErrorNotSupported, "triple_chevron_launcher::launch(): cluster launch requires CUDA 11.8");
+#endif
+} // end launch_cluster_kernel()
+
+
+// launches kernel with whichever of the runtime's launch functions supports the requested attributes
+inline void launch_kernel_with_attributes(void *kernel, dim3 grid_dim, dim3 block_dim, void **args, size_t num_dynamic_smem_bytes, cudaStream_t stream, bool cooperative, unsigned int cluster_size)
+{
+  if(cluster_size > 1)
+  {
+    launch_cluster_kernel(kernel, grid_dim, block_dim, args, num_dynamic_smem_bytes, stream, cooperative, cluster_size);
+  } // end if
+  else
+  {
+    launch_cooperative_kernel(kernel, grid_dim, block_dim, args, num_dynamic_smem_bytes, stream);
+  } // end else
+} // end launch_kernel_with_attributes()
+
+
+} // end triple_chevron_launcher_detail
+
+
 #ifdef __CUDACC__
 // if there are multiple versions of Bulk floating around, this may be #defined already
 #  ifndef __bulk_launch_bounds__
@@ -114,39 +197,54 @@ class triple_chevron_launcher : protected triple_chevron_launcher_base<block_siz
   public:
     typedef Function task_type;
 
+    // grid_dim & block_dim may be up to 3-dimensional
+    // when cooperative is true, every block of the launch is guaranteed to be resident at once
+    // when cluster_size is greater than 1, every cluster_size consecutive blocks form a cluster
     inline __host__ __device__
-    void launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    void launch(dim3 grid_dim, dim3 block_dim, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, bool cooperative = false, unsigned int cluster_size = 1)
     {
       struct workaround
       {
         __host__ __device__
-        static void supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+        static void supported_path(dim3 grid_dim, dim3 block_dim, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, bool cooperative, unsigned int cluster_size)
         {
 #if __BULK_HAS_CUDART__
 #  ifndef __CUDA_ARCH__
-          cudaConfigureCall(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
+          if(cooperative || cluster_size > 1)
+          {
+            void *args[] = {&task};
+            bulk::detail::triple_chevron_launcher_detail::launch_kernel_with_attributes(reinterpret_cast<void*>(super_t::global_function_pointer()), grid_dim, block_dim, args, num_dynamic_smem_bytes, stream, cooperative, cluster_size);
+            return;
+          }
+
+          cudaConfigureCall(grid_dim, block_dim, num_dynamic_smem_bytes, stream);
           cudaSetupArgument(task, 0);
           bulk::detail::throw_on_error(cudaLaunch(super_t::global_function_pointer()), "after cudaLaunch in triple_chevron_launcher::launch()");
 #  else
+          if(cooperative || cluster_size > 1)
+          {
+            bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): cooperative & cluster launch are unsupported in __device__ code.");
+          }
+
           void *param_buffer = cudaGetParameterBuffer(alignment_of<task_type>::value, sizeof(task_type));
           std::memcpy(param_buffer, &task, sizeof(task_type));
-          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream),
+          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, grid_dim, block_dim, num_dynamic_smem_bytes, stream),
                                        "after cudaLaunchDevice in triple_chevron_launcher::launch()");
 #  endif // __CUDA_ARCH__
 #endif // __BULK_HAS_CUDART__
         }
 
         __host__ __device__
-        static void unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
+        static void unsupported_path(dim3, dim3, size_t, cudaStream_t, task_type, bool, unsigned int)
         {
           bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): CUDA kernel launch requires CUDART.");
         }
       };
 
 #if __BULK_HAS_CUDART__
-      workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      workaround::supported_path(grid_dim, block_dim, num_dynamic_smem_bytes, stream, task, cooperative, cluster_size);
 #else
-      workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      workaround::unsupported_path(grid_dim, block_dim, num_dynamic_smem_bytes, stream, task, cooperative, cluster_size);
 #endif
     } // end launch()
 };
@@ -165,42 +263,59 @@ class triple_chevron_launcher<block_size_,Function,false> : protected triple_che
   public:
     typedef Function task_type;
 
+    // grid_dim & block_dim may be up to 3-dimensional
+    // when cooperative is true, every block of the launch is guaranteed to be resident at once
+    // when cluster_size is greater than 1, every cluster_size consecutive blocks form a cluster
     inline __host__ __device__
-    void launch(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+    void launch(dim3 grid_dim, dim3 block_dim, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, bool cooperative = false, unsigned int cluster_size = 1)
     {
       struct workaround
       {
         __host__ __device__
-        static void supported_path(unsigned int num_blocks, unsigned int block_size, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task)
+        static void supported_path(dim3 grid_dim, dim3 block_dim, size_t num_dynamic_smem_bytes, cudaStream_t stream, task_type task, bool cooperative, unsigned int cluster_size)
         {
-          bulk::detail::parameter_ptr<task_type> parm = bulk::detail::make_parameter<task_type>(task);
+          // the parameter is freed in stream after the launch, so this doesn't synchronize the device
+          bulk::detail::parameter_ptr<task_type> parm = bulk::detail::make_parameter<task_type>(task, stream);
 
 #if __BULK_HAS_CUDART__
 #  ifndef __CUDA_ARCH__
-          cudaConfigureCall(dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream);
+          if(cooperative || cluster_size > 1)
+          {
+            const task_type *task_ptr = parm.get();
+            void *args[] = {&task_ptr};
+            bulk::detail::triple_chevron_launcher_detail::launch_kernel_with_attributes(reinterpret_cast<void*>(super_t::global_function_pointer()), grid_dim, block_dim, args, num_dynamic_smem_bytes, stream, cooperative, cluster_size);
+            return;
+          }
+
+          cudaConfigureCall(grid_dim, block_dim, num_dynamic_smem_bytes, stream);
           cudaSetupArgument(static_cast<const task_type*>(parm.get()), 0);
           bulk::detail::throw_on_error(cudaLaunch(super_t::global_function_pointer()), "after cudaLaunch in triple_chevron_launcher::launch()");
 #  else
+          if(cooperative || cluster_size > 1)
+          {
+            bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): cooperative & cluster launch are unsupported in __device__ code.");
+          }
+
           void *param_buffer = cudaGetParameterBuffer(alignment_of<task_type>::value, sizeof(task_type));
           task_type *task_ptr = parm.get();
           std::memcpy(param_buffer, &task_ptr, sizeof(task_type*));
-          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, dim3(num_blocks), dim3(block_size), num_dynamic_smem_bytes, stream),
+          bulk::detail::throw_on_error(cudaLaunchDevice(reinterpret_cast<void*>(super_t::global_function_pointer()), param_buffer, grid_dim, block_dim, num_dynamic_smem_bytes, stream),
                                        "after cudaLaunchDevice in triple_chevron_launcher::launch()");
 #  endif // __CUDA_ARCH__
 #endif // __BULK_HAS_CUDART__
         }
 
         __host__ __device__
-        static void unsupported_path(unsigned int, unsigned int, size_t, cudaStream_t, task_type)
+        static void unsupported_path(dim3, dim3, size_t, cudaStream_t, task_type, bool, unsigned int)
         {
           bulk::detail::terminate_with_message("triple_chevron_launcher::launch(): CUDA kernel launch requires CUDART.");
         }
       };
 
 #if __BULK_HAS_CUDART__
-      workaround::supported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      workaround::supported_path(grid_dim, block_dim, num_dynamic_smem_bytes, stream, task, cooperative, cluster_size);
 #else
-      workaround::unsupported_path(num_blocks, block_size, num_dynamic_smem_bytes, stream, task);
+      workaround::unsupported_path(grid_dim, block_dim, num_dynamic_smem_bytes, stream, task, cooperative, cluster_size);
 #endif
     } // end launch()
 };
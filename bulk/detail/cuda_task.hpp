@@ -32,6 +32,32 @@ namespace detail
 {
 
 
+// guard use of CUDA built-ins from foreign compilers
+#ifdef __CUDA_ARCH__
+// the linear index of this block within a grid of up to 3 dimensions, x varying fastest
+__device__ __forceinline__
+unsigned int linear_block_index()
+{
+  return blockIdx.x + gridDim.x * (blockIdx.y + gridDim.y * blockIdx.z);
+}
+
+
+// the linear index of this thread within a block of up to 3 dimensions, x varying fastest
+__device__ __forceinline__
+unsigned int linear_thread_index()
+{
+  return threadIdx.x + blockDim.x * (threadIdx.y + blockDim.y * threadIdx.z);
+}
+
+
+__device__ __forceinline__
+unsigned int linear_block_size()
+{
+  return blockDim.x * blockDim.y * blockDim.z;
+}
+#endif
+
+
 template<typename ExecutionGroup, typename Closure>
 class task_base
 {
@@ -42,8 +68,20 @@ class task_base
     __host__ __device__
     task_base(group_type g, closure_type c)
       : c(c), g(g)
+#if BULK_HEAP_STATISTICS
+        , heap_statistics(0)
+#endif
     {}
 
+#if BULK_HEAP_STATISTICS
+    // each group accumulates its heap usage into *stats before exiting
+    __host__ __device__
+    void set_heap_statistics(heap_statistics_t *stats)
+    {
+      heap_statistics = stats;
+    }
+#endif
+
   protected:
     __host__ __device__
     static void substitute_placeholders_and_execute(group_type &g, closure_type &c)
@@ -61,6 +99,10 @@ class task_base
     closure_type c;
     group_type g;
 
+#if BULK_HEAP_STATISTICS
+    heap_statistics_t *heap_statistics;
+#endif
+
   private:
     template<typename T>
     struct substitutor_result
@@ -71,7 +113,7 @@ class task_base
         >
     {};
 
-    typedef typename bulk::detail::tuple_meta_transform<
+    typedef typename bulk::detail::closure_arguments_meta_transform<
       typename closure_type::arguments_type,
       substitutor_result
     >::type substituted_arguments_type;
@@ -80,13 +122,13 @@ class task_base
     {
       group_type &g;
 
-      __device__
+      __host__ __device__
       substitutor(group_type &g)
         : g(g)
       {}
 
       template<unsigned int depth>
-      __device__
+      __host__ __device__
       typename bulk::detail::cursor_result<cursor<depth>,group_type>::type
       operator()(cursor<depth> c) const
       {
@@ -94,7 +136,7 @@ class task_base
       }
 
       template<typename T>
-      __device__
+      __host__ __device__
       T &operator()(T &x) const
       {
         return x;
@@ -104,7 +146,7 @@ class task_base
     __host__ __device__
     static substituted_arguments_type substitute_placeholders(group_type &g, typename closure_type::arguments_type args)
     {
-      return bulk::detail::tuple_host_device_transform<substitutor_result>(args, substitutor(g));
+      return bulk::detail::closure_arguments_transform<substitutor_result>(args, substitutor(g));
     }
 };
 
@@ -161,9 +203,10 @@ struct block_maker
   static Block make(typename Block::size_type     size,
                     typename Block::size_type     heap_size,
                     typename Block::agent_type    thread,
-                    typename Block::size_type     index)
+                    typename Block::size_type     index,
+                    heap_policy                   policy)
   {
-    return Block(heap_size, thread, index);
+    return Block(heap_size, thread, index, policy);
   }
 };
 
@@ -174,9 +217,10 @@ struct block_maker<concurrent_group<Thread,dynamic_group_size> >
   static concurrent_group<Thread,dynamic_group_size> make(typename concurrent_group<Thread,dynamic_group_size>::size_type size,
                                                           typename concurrent_group<Thread,dynamic_group_size>::size_type heap_size,
                                                           Thread thread,
-                                                          typename concurrent_group<Thread,dynamic_group_size>::size_type index)
+                                                          typename concurrent_group<Thread,dynamic_group_size>::size_type index,
+                                                          heap_policy policy)
   {
-    return concurrent_group<Thread,dynamic_group_size>(size, heap_size, thread, index);
+    return concurrent_group<Thread,dynamic_group_size>(size, heap_size, thread, index, policy);
   }
 };
 
@@ -191,9 +235,9 @@ Grid make_grid(typename Grid::size_type size, typename Grid::agent_type block, t
 
 template<typename Block>
 __host__ __device__
-Block make_block(typename Block::size_type size, typename Block::size_type heap_size, typename Block::agent_type thread = typename Block::agent_type(), typename Block::size_type index = invalid_index)
+Block make_block(typename Block::size_type size, typename Block::size_type heap_size, typename Block::agent_type thread = typename Block::agent_type(), typename Block::size_type index = invalid_index, heap_policy policy = first_fit_heap)
 {
-  return block_maker<Block>::make(size, heap_size, thread, index);
+  return block_maker<Block>::make(size, heap_size, thread, index, policy);
 }
 
 
@@ -236,15 +280,21 @@ class cuda_task<
     {
       // guard use of CUDA built-ins from foreign compilers
 #ifdef __CUDA_ARCH__
+      size_type block_index = block_offset + linear_block_index();
+
+      // a grid folded into rows may end with a partial row, whose excess blocks have nothing to do
+      if(block_index >= super_t::g.size()) return;
+
       // instantiate a view of this grid
       grid_type this_grid =
         make_grid<grid_type>(
           super_t::g.size(),
           make_block<block_type>(
-            blockDim.x,
+            linear_block_size(),
             super_t::g.this_exec.heap_size(),
-            thread_type(threadIdx.x),
-            block_offset + blockIdx.x
+            thread_type(linear_thread_index()),
+            block_index,
+            super_t::g.this_exec.heap_policy()
           ),
           0
       );
@@ -253,12 +303,20 @@ class cuda_task<
       // initialize shared storage
       if(this_grid.this_exec.this_exec.index() == 0)
       {
-        bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size());
+        bulk::detail::init_on_chip_malloc(this_grid.this_exec.heap_size(), this_grid.this_exec.heap_policy());
       }
       this_grid.this_exec.wait();
 #endif
 
       substitute_placeholders_and_execute(this_grid, super_t::c);
+
+#if BULK_HEAP_STATISTICS && (__CUDA_ARCH__ >= 200)
+      this_grid.this_exec.wait();
+      if(this_grid.this_exec.this_exec.index() == 0)
+      {
+        bulk::detail::flush_on_chip_malloc_statistics(super_t::heap_statistics);
+      }
+#endif
 #endif
     } // end operator()
 }; // end cuda_task
@@ -297,22 +355,31 @@ class cuda_task<
       // instantiate a view of this block
       block_type this_block =
         make_block<block_type>(
-          blockDim.x,
+          linear_block_size(),
           super_t::g.heap_size(),
-          thread_type(threadIdx.x),
-          0
+          thread_type(linear_thread_index()),
+          0,
+          super_t::g.heap_policy()
         );
 
 #if __CUDA_ARCH__ >= 200
       // initialize shared storage
       if(this_block.this_exec.index() == 0)
       {
-        bulk::detail::init_on_chip_malloc(this_block.heap_size());
+        bulk::detail::init_on_chip_malloc(this_block.heap_size(), this_block.heap_policy());
       }
       this_block.wait();
 #endif
 
       substitute_placeholders_and_execute(this_block, super_t::c);
+
+#if BULK_HEAP_STATISTICS && (__CUDA_ARCH__ >= 200)
+      this_block.wait();
+      if(this_block.this_exec.index() == 0)
+      {
+        bulk::detail::flush_on_chip_malloc_statistics(super_t::heap_statistics);
+      }
+#endif
 #endif
     } // end operator()
 }; // end cuda_task
@@ -340,11 +407,12 @@ class cuda_task<parallel_group<agent<grainsize>,groupsize>,Closure>
     {
       // guard use of CUDA built-ins from foreign compilers
 #ifdef __CUDA_ARCH__
-      typedef int size_type;
+      // the stride is taken in 64 bits so that it can't overflow past the end of a group of nearly INT_MAX agents
+      typedef typename group_type::global_size_type global_size_type;
 
-      const size_type grid_size = gridDim.x * blockDim.x;
+      const global_size_type grid_size = gridDim.x * blockDim.x;
 
-      for(size_type tid = blockDim.x * blockIdx.x + threadIdx.x;
+      for(global_size_type tid = blockDim.x * blockIdx.x + threadIdx.x;
           tid < super_t::g.size();
           tid += grid_size)
       {
@@ -0,0 +1,151 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/uninitialized.hpp>
+#include <cstring>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// the status of a tile of a single-pass scan, published to the tiles after it
+template<typename T>
+struct tile_status
+{
+  // tile_status is zeroed before the scan, so 0 means nothing has been published yet
+  static const int not_ready          = 0;
+  static const int aggregate_ready    = 1;
+  static const int prefix_ready       = 2;
+
+  // values are held in whole words so that a T narrower than an int
+  // never shares a word with its neighbor
+  static const int num_words = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+
+  int flag;
+
+  // the reduction of this tile alone
+  int aggregate[num_words];
+
+  // the reduction of init and every tile up to & including this one
+  int inclusive_prefix[num_words];
+};
+
+
+// read & write T one word at a time through volatile so that other tiles'
+// updates aren't hidden in a cache
+template<typename T>
+__device__ void store_volatile(int *words, const T &x)
+{
+  const int num_words = tile_status<T>::num_words;
+
+  int temp[num_words];
+  std::memset(temp, 0, sizeof(temp));
+  std::memcpy(temp, &x, sizeof(T));
+
+  volatile int *dst = words;
+  for(int i = 0; i < num_words; ++i)
+  {
+    dst[i] = temp[i];
+  }
+} // end store_volatile()
+
+
+template<typename T>
+__device__ T load_volatile(const int *words)
+{
+  const int num_words = tile_status<T>::num_words;
+
+  int temp[num_words];
+
+  const volatile int *src = words;
+  for(int i = 0; i < num_words; ++i)
+  {
+    temp[i] = src[i];
+  }
+
+  bulk::uninitialized<T> result;
+  std::memcpy(&result.get(), temp, sizeof(T));
+  return result.get();
+} // end load_volatile()
+
+
+template<typename T>
+__device__ void publish(tile_status<T> *status, int flag, const T &x)
+{
+  if(flag == tile_status<T>::aggregate_ready)
+  {
+    store_volatile(status->aggregate, x);
+  }
+  else
+  {
+    store_volatile(status->inclusive_prefix, x);
+  }
+
+  // make the value visible before the flag
+  __threadfence();
+
+  *reinterpret_cast<volatile int*>(&status->flag) = flag;
+} // end publish()
+
+
+// computes the reduction of init and all the tiles before tile by looking back through their published statuses
+// binary_op need not be commutative
+// XXX this look-back is performed by a single agent; a warp-wide look-back would consume 32 predecessors per step
+template<typename T, typename BinaryFunction>
+__device__ T look_back(tile_status<T> *status, unsigned int tile, BinaryFunction binary_op)
+{
+  T exclusive_prefix;
+  bool exclusive_prefix_defined = false;
+
+  for(int predecessor = tile - 1; ; --predecessor)
+  {
+    // wait for the predecessor to publish something
+    int flag = tile_status<T>::not_ready;
+    while((flag = *reinterpret_cast<volatile int*>(&status[predecessor].flag)) == tile_status<T>::not_ready)
+    {
+      ;
+    }
+
+    // don't read the value before the flag
+    __threadfence();
+
+    if(flag == tile_status<T>::prefix_ready)
+    {
+      T prefix = load_volatile<T>(status[predecessor].inclusive_prefix);
+      exclusive_prefix = exclusive_prefix_defined ? binary_op(prefix, exclusive_prefix) : prefix;
+      break;
+    }
+
+    T aggregate = load_volatile<T>(status[predecessor].aggregate);
+    exclusive_prefix = exclusive_prefix_defined ? binary_op(aggregate, exclusive_prefix) : aggregate;
+    exclusive_prefix_defined = true;
+  }
+
+  return exclusive_prefix;
+} // end look_back()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/detail/shuffle.hpp>
 #include <thrust/iterator/transform_iterator.h>
 #include <thrust/iterator/zip_iterator.h>
 #include <thrust/iterator/counting_iterator.h>
@@ -123,6 +125,73 @@ template<typename RandomAccessIterator,
 
 
 
+// stores the head flags of [first, first + n) given init as the element before first to
+// [result, result + n), in the same arrangement as a group's copy_n: agent tid handles elements tid, tid + groupsize, ...
+// unlike reading through head_flags_with_init, which loads each element twice, each element is loaded once
+// and its successor's agent receives it from a warp shuffle. Only the first lane of each warp reloads its predecessor
+// n must not exceed groupsize * grainsize
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename T, typename BinaryPredicate, typename RandomAccessIterator2>
+__device__
+void head_flags_tile_n(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                       RandomAccessIterator1 first, Size n,
+                       const T &init,
+                       BinaryPredicate pred,
+                       RandomAccessIterator2 result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type flag_type;
+
+  const Size tid = g.this_exec.index();
+
+#if __CUDA_ARCH__ >= 300
+  // every lane of a warp must reach each shuffle
+  if(groupsize % 32 == 0)
+  {
+    const Size lane = tid % 32;
+
+    for(Size warp_tile = 0; warp_tile < n; warp_tile += groupsize)
+    {
+      Size i = warp_tile + tid;
+
+      // lanes beyond the end reload the last element rather than diverge from the shuffle
+      value_type x = first[i < n ? i : n - 1];
+      value_type predecessor = bulk::detail::shuffle_up(x, 1);
+
+      if(i < n)
+      {
+        if(i == 0)
+        {
+          result[i] = static_cast<flag_type>(!pred(init, x));
+        }
+        else
+        {
+          if(lane == 0)
+          {
+            predecessor = first[i - 1];
+          } // end if
+
+          result[i] = static_cast<flag_type>(!pred(predecessor, x));
+        } // end else
+      } // end if
+    } // end for warp_tile
+
+    g.wait();
+
+    return;
+  } // end if
+#endif
+
+  head_flags_with_init<RandomAccessIterator1,BinaryPredicate,flag_type,Size> flags(first, first + n, init, pred);
+
+  for(Size i = tid; i < n; i += groupsize)
+  {
+    result[i] = flags[i];
+  } // end for i
+
+  g.wait();
+} // end head_flags_tile_n()
+
+
 template<typename RandomAccessIterator,
          typename BinaryPredicate = thrust::equal_to<typename thrust::iterator_value<RandomAccessIterator>::type>,
          typename ValueType = bool,
@@ -0,0 +1,84 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// host-only atomic operations on ints with sequentially-consistent ordering
+// XXX we can't count on <atomic> being available, so use the compiler's intrinsics instead
+
+
+#if defined(_MSC_VER)
+typedef volatile long host_atomic_int;
+#else
+typedef volatile int  host_atomic_int;
+#endif
+
+
+// returns true if *x was expected and has been replaced with desired
+inline bool host_atomic_compare_and_swap(host_atomic_int *x, int expected, int desired)
+{
+#if defined(_MSC_VER)
+  return _InterlockedCompareExchange(x, desired, expected) == expected;
+#else
+  return __sync_bool_compare_and_swap(x, expected, desired);
+#endif
+} // end host_atomic_compare_and_swap()
+
+
+inline int host_atomic_load(const host_atomic_int *x)
+{
+  int result = *x;
+
+#if defined(_MSC_VER)
+  _ReadWriteBarrier();
+#else
+  __sync_synchronize();
+#endif
+
+  return result;
+} // end host_atomic_load()
+
+
+inline void host_atomic_store(host_atomic_int *x, int value)
+{
+#if defined(_MSC_VER)
+  _InterlockedExchange(x, value);
+#else
+  __sync_synchronize();
+  *x = value;
+  __sync_synchronize();
+#endif
+} // end host_atomic_store()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
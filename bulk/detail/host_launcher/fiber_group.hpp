@@ -0,0 +1,232 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/host_launcher/thread_pool.hpp>
+#include <cstdlib>
+
+// XXX ucontext is POSIX-only; elsewhere, only groups whose agents never wait may run on the host
+#if __BULK_HAS_HOST_THREADS__
+#  if defined(__APPLE__) && !defined(_XOPEN_SOURCE)
+#    define _XOPEN_SOURCE 600
+#  endif
+#  include <ucontext.h>
+#  define __BULK_HAS_HOST_FIBERS__ 1
+#else
+#  define __BULK_HAS_HOST_FIBERS__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// runs the agents of a concurrent group as fibers on the calling thread
+// an agent which waits is suspended until each of the others has waited or exited, as with __syncthreads(),
+// so a group's agents run round-robin from one barrier to the next
+class host_fiber_group
+{
+  public:
+    // each agent's stack
+    static const std::size_t stack_size = 64 * 1024;
+
+    inline host_fiber_group()
+      : m_capacity(0), m_fibers(0), m_stacks(0)
+    {}
+
+    inline ~host_fiber_group()
+    {
+#if __BULK_HAS_HOST_FIBERS__
+      delete [] m_fibers;
+#endif
+      std::free(m_stacks);
+    } // end ~host_fiber_group()
+
+    // calls entry(context, i) as agent i, for each agent of a group of the given size
+    inline void run(void (*entry)(void *context, int agent), void *context, int size)
+    {
+      host_fiber_group *&current = this_thread_group();
+      host_fiber_group *previous = current;
+
+      // a group of one never waits on another, so it needs no fiber
+      if(size == 1)
+      {
+        current = 0;
+        entry(context, 0);
+        current = previous;
+        return;
+      } // end if
+
+#if __BULK_HAS_HOST_FIBERS__
+      reserve(size);
+
+      m_entry     = entry;
+      m_context   = context;
+      m_num_live  = size;
+
+      for(int i = 0; i < size; ++i)
+      {
+        fiber &f = m_fibers[i];
+
+        getcontext(&f.context);
+        f.context.uc_stack.ss_sp   = m_stacks + i * stack_size;
+        f.context.uc_stack.ss_size = stack_size;
+        f.context.uc_link          = &m_scheduler;
+        makecontext(&f.context, &trampoline, 0);
+
+        f.done = false;
+      } // end for i
+
+      current = this;
+
+      while(m_num_live > 0)
+      {
+        for(m_current = 0; m_current < size; ++m_current)
+        {
+          if(!m_fibers[m_current].done)
+          {
+            swapcontext(&m_scheduler, &m_fibers[m_current].context);
+          } // end if
+        } // end for
+      } // end while
+
+      current = previous;
+#else
+      (void) context;
+      bulk::detail::terminate_with_message("bulk::detail::host_fiber_group::run(): concurrent groups of more than one agent require ucontext on the host");
+#endif
+    } // end run()
+
+    // suspends the calling agent until the others have waited or exited
+    // outside of a fiber, there's nothing to wait on
+    inline static void wait()
+    {
+#if __BULK_HAS_HOST_FIBERS__
+      host_fiber_group *self = this_thread_group();
+
+      if(self)
+      {
+        swapcontext(&self->m_fibers[self->m_current].context, &self->m_scheduler);
+      } // end if
+#endif
+    } // end wait()
+
+    // the group whose agent is running on this thread, if any
+    inline static host_fiber_group *&this_thread_group()
+    {
+      static __bulk_thread_local__ host_fiber_group *result = 0;
+      return result;
+    } // end this_thread_group()
+
+  private:
+#if __BULK_HAS_HOST_FIBERS__
+    struct fiber
+    {
+      ucontext_t context;
+      bool       done;
+    };
+
+    inline static void trampoline()
+    {
+      host_fiber_group *self = this_thread_group();
+
+      int i = self->m_current;
+
+      self->m_entry(self->m_context, i);
+
+      self->m_fibers[i].done = true;
+      --self->m_num_live;
+
+      // returning resumes m_scheduler through uc_link
+    } // end trampoline()
+
+    inline void reserve(int size)
+    {
+      if(size <= m_capacity) return;
+
+      delete [] m_fibers;
+      std::free(m_stacks);
+
+      m_fibers = new fiber[size];
+      m_stacks = reinterpret_cast<char*>(std::malloc(size * stack_size));
+
+      if(m_stacks == 0)
+      {
+        bulk::detail::terminate_with_message("bulk::detail::host_fiber_group::reserve(): could not allocate the agents' stacks");
+      } // end if
+
+      m_capacity = size;
+    } // end reserve()
+
+    ucontext_t m_scheduler;
+    void     (*m_entry)(void *, int);
+    void      *m_context;
+    int        m_num_live;
+    int        m_current;
+#else
+    struct fiber {};
+#endif
+
+    int        m_capacity;
+    fiber     *m_fibers;
+    char      *m_stacks;
+
+    // non-copyable
+    host_fiber_group(const host_fiber_group &);
+    host_fiber_group &operator=(const host_fiber_group &);
+}; // end host_fiber_group
+
+
+// runs a concurrent group of size agents on the calling thread
+// each thread keeps its fibers & their stacks from one group to the next
+inline void run_host_fiber_group(void (*entry)(void *context, int agent), void *context, int size)
+{
+  // XXX this leaks when its thread exits
+  static __bulk_thread_local__ host_fiber_group *cached = 0;
+
+  // the number of groups running on this thread
+  static __bulk_thread_local__ int depth = 0;
+
+  ++depth;
+
+  if(depth > 1)
+  {
+    // a group launched from within another group's agent needs fibers of its own
+    host_fiber_group nested;
+    nested.run(entry, context, size);
+  } // end if
+  else
+  {
+    if(!cached) cached = new host_fiber_group;
+
+    cached->run(entry, context, size);
+  } // end else
+
+  --depth;
+} // end run_host_fiber_group()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
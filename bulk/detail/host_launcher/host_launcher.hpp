@@ -0,0 +1,257 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/cuda_task.hpp>
+#include <bulk/detail/host_launcher/thread_pool.hpp>
+#include <bulk/detail/host_launcher/fiber_group.hpp>
+#include <bulk/execution_policy.hpp>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// exposes task_base's substitution of placeholders to the host launchers
+template<typename ExecutionGroup, typename Closure>
+struct host_task
+  : task_base<ExecutionGroup,Closure>
+{
+  typedef task_base<ExecutionGroup,Closure> super_t;
+
+  // each agent receives its own copy of c, as each CUDA thread does
+  inline static void execute(ExecutionGroup &g, Closure c)
+  {
+    super_t::substitute_placeholders_and_execute(g, c);
+  } // end execute()
+}; // end host_task
+
+
+// the number of agents in a concurrent group launched on the host when the caller doesn't say
+// each of a group's agents is a fiber, so a barrier costs a context switch per agent
+static const int default_host_group_size = 32;
+
+
+template<typename ExecutionGroup, typename Closure> struct host_launcher;
+
+
+// a grid's groups are dealt out to the host's threads, and each group's agents run as fibers on one of them
+// XXX there is no on-chip heap on the host, so the groups receive none
+template<std::size_t gridsize, std::size_t blocksize, std::size_t grainsize, typename Closure>
+struct host_launcher<
+  parallel_group<
+    concurrent_group<
+      agent<grainsize>,
+      blocksize
+    >,
+    gridsize
+  >,
+  Closure
+>
+{
+  typedef typename cuda_grid<gridsize,blocksize,grainsize>::type grid_type;
+  typedef typename grid_type::agent_type                         block_type;
+  typedef typename block_type::agent_type                        thread_type;
+  typedef typename grid_type::size_type                          size_type;
+
+  struct grid_context
+  {
+    const grid_type *g;
+    const Closure   *c;
+  };
+
+  struct block_context
+  {
+    const grid_context *grid;
+    size_type           block_index;
+  };
+
+  inline void launch(grid_type request, Closure c)
+  {
+    grid_type g = configure(request);
+
+    if(g.size() > 0 && g.this_exec.size() > 0)
+    {
+      grid_context context = {&g, &c};
+      host_job job = {&execute_block, &context};
+
+      the_host_thread_pool().execute(job, g.size());
+    } // end if
+  } // end launch()
+
+  inline grid_type configure(grid_type g)
+  {
+    size_type block_size = (g.this_exec.size() == use_default) ? default_host_group_size : g.this_exec.size();
+    size_type num_blocks = (g.size() == use_default) ? the_host_thread_pool().num_threads() : g.size();
+
+    return make_grid<grid_type>(num_blocks, make_block<block_type>(block_size, 0, thread_type(), invalid_index, g.this_exec.heap_policy()));
+  } // end configure()
+
+  inline static void execute_block(void *context_, std::size_t block_index)
+  {
+    const grid_context *context = reinterpret_cast<const grid_context*>(context_);
+
+    block_context block = {context, static_cast<size_type>(block_index)};
+
+    run_host_fiber_group(&execute_thread, &block, context->g->this_exec.size());
+  } // end execute_block()
+
+  inline static void execute_thread(void *context_, int thread_index)
+  {
+    const block_context *context = reinterpret_cast<const block_context*>(context_);
+    const grid_type &g = *context->grid->g;
+
+    // instantiate a view of this grid
+    grid_type this_grid =
+      make_grid<grid_type>(
+        g.size(),
+        make_block<block_type>(
+          g.this_exec.size(),
+          g.this_exec.heap_size(),
+          thread_type(thread_index),
+          context->block_index,
+          g.this_exec.heap_policy()
+        ),
+        0
+    );
+
+    host_task<grid_type,Closure>::execute(this_grid, *context->grid->c);
+  } // end execute_thread()
+}; // end host_launcher
+
+
+// a single group's agents run as fibers on the calling thread
+template<std::size_t blocksize, std::size_t grainsize, typename Closure>
+struct host_launcher<
+  concurrent_group<
+    agent<grainsize>,
+    blocksize
+  >,
+  Closure
+>
+{
+  typedef concurrent_group<agent<grainsize>,blocksize> block_type;
+  typedef typename block_type::agent_type              thread_type;
+  typedef typename block_type::size_type               size_type;
+
+  struct block_context
+  {
+    const block_type *b;
+    const Closure    *c;
+  };
+
+  inline void launch(block_type request, Closure c)
+  {
+    block_type b = configure(request);
+
+    if(b.size() > 0)
+    {
+      block_context context = {&b, &c};
+
+      run_host_fiber_group(&execute_thread, &context, b.size());
+    } // end if
+  } // end launch()
+
+  inline block_type configure(block_type b)
+  {
+    size_type block_size = (b.size() == use_default) ? default_host_group_size : b.size();
+
+    return make_block<block_type>(block_size, 0, thread_type(), invalid_index, b.heap_policy());
+  } // end configure()
+
+  inline static void execute_thread(void *context_, int thread_index)
+  {
+    const block_context *context = reinterpret_cast<const block_context*>(context_);
+    const block_type &b = *context->b;
+
+    // instantiate a view of this block
+    block_type this_block = make_block<block_type>(b.size(), b.heap_size(), thread_type(thread_index), 0, b.heap_policy());
+
+    host_task<block_type,Closure>::execute(this_block, *context->c);
+  } // end execute_thread()
+}; // end host_launcher
+
+
+// a parallel group's agents are dealt out to the host's threads in contiguous chunks
+template<std::size_t groupsize, std::size_t grainsize, typename Closure>
+struct host_launcher<
+  parallel_group<
+    agent<grainsize>,
+    groupsize
+  >,
+  Closure
+>
+{
+  typedef parallel_group<agent<grainsize>,groupsize> group_type;
+  typedef typename group_type::size_type             size_type;
+
+  // enough chunks per thread for stealing to even out the load
+  static const int chunks_per_thread = 16;
+
+  struct group_context
+  {
+    const Closure *c;
+    size_type      size;
+    std::size_t    num_chunks;
+  };
+
+  inline void launch(group_type g, Closure c)
+  {
+    if(g.size() > 0)
+    {
+      std::size_t num_chunks = thrust::min<std::size_t>(g.size(), chunks_per_thread * the_host_thread_pool().num_threads());
+
+      group_context context = {&c, g.size(), num_chunks};
+      host_job job = {&execute_chunk, &context};
+
+      the_host_thread_pool().execute(job, num_chunks);
+    } // end if
+  } // end launch()
+
+  inline static void execute_chunk(void *context_, std::size_t chunk)
+  {
+    const group_context *context = reinterpret_cast<const group_context*>(context_);
+
+    size_type first = static_cast<size_type>(context->size * chunk / context->num_chunks);
+    size_type last  = static_cast<size_type>(context->size * (chunk + 1) / context->num_chunks);
+
+    for(size_type i = first; i < last; ++i)
+    {
+      // instantiate a view of the exec group
+      group_type this_group(
+        1,
+        agent<grainsize>(i),
+        0
+      );
+
+      host_task<group_type,Closure>::execute(this_group, *context->c);
+    } // end for i
+  } // end execute_chunk()
+}; // end host_launcher
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,325 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <cstddef>
+
+// the host backend runs on POSIX threads
+// elsewhere, a job's tasks execute in order on the thread which submits it
+#if defined(__unix__) || defined(__APPLE__)
+#  define __BULK_HAS_HOST_THREADS__ 1
+#  include <pthread.h>
+#  include <unistd.h>
+#else
+#  define __BULK_HAS_HOST_THREADS__ 0
+#endif
+
+#if defined(_MSC_VER)
+#  define __bulk_thread_local__ __declspec(thread)
+#else
+#  define __bulk_thread_local__ __thread
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a job for the host's threads: tasks 0, 1, ... each executed by a call to execute(context, task)
+// XXX tasks must not throw
+struct host_job
+{
+  void (*execute)(void *context, std::size_t task);
+  void *context;
+};
+
+
+// a fixed set of worker threads which execute each job's tasks along with the thread which submits it
+// each participant owns a contiguous range of the tasks and executes it front to back;
+// a participant whose range runs dry steals the back half of another's, so uneven tasks still balance
+// XXX jobs execute one at a time, and a job submitted from within a task executes inline on its thread
+class host_thread_pool
+{
+  public:
+    static const int max_num_threads = 64;
+
+    inline host_thread_pool()
+      : m_num_threads(1)
+#if __BULK_HAS_HOST_THREADS__
+        , m_generation(0),
+        m_num_busy(0),
+        m_exit(false)
+#endif
+    {
+#if __BULK_HAS_HOST_THREADS__
+      long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+      m_num_threads = (n < 1) ? 1 : (n > max_num_threads) ? max_num_threads : static_cast<int>(n);
+
+      pthread_mutex_init(&m_mutex, 0);
+      pthread_cond_init(&m_wake, 0);
+      pthread_cond_init(&m_done, 0);
+      pthread_mutex_init(&m_submit, 0);
+
+      // the submitting thread is participant 0
+      for(int i = 1; i < m_num_threads; ++i)
+      {
+        m_worker_args[i].pool = this;
+        m_worker_args[i].participant = i;
+
+        if(pthread_create(&m_workers[i], 0, worker_main, &m_worker_args[i]) != 0)
+        {
+          // make do with the threads we have
+          m_num_threads = i;
+          break;
+        } // end if
+      } // end for i
+#endif
+    } // end host_thread_pool()
+
+    inline ~host_thread_pool()
+    {
+#if __BULK_HAS_HOST_THREADS__
+      pthread_mutex_lock(&m_mutex);
+      m_exit = true;
+      pthread_cond_broadcast(&m_wake);
+      pthread_mutex_unlock(&m_mutex);
+
+      for(int i = 1; i < m_num_threads; ++i)
+      {
+        pthread_join(m_workers[i], 0);
+      } // end for i
+
+      pthread_mutex_destroy(&m_submit);
+      pthread_cond_destroy(&m_done);
+      pthread_cond_destroy(&m_wake);
+      pthread_mutex_destroy(&m_mutex);
+#endif
+    } // end ~host_thread_pool()
+
+    // the number of threads which execute a job, including the one which submits it
+    inline int num_threads() const
+    {
+      return m_num_threads;
+    } // end num_threads()
+
+    // executes tasks [0, num_tasks) of job and returns once all have completed
+    inline void execute(host_job job, std::size_t num_tasks)
+    {
+      if(num_tasks == 0) return;
+
+#if __BULK_HAS_HOST_THREADS__
+      if(m_num_threads > 1 && num_tasks > 1 && !is_worker())
+      {
+        pthread_mutex_lock(&m_submit);
+
+        m_job = job;
+
+        // deal the tasks out evenly
+        for(int i = 0; i < m_num_threads; ++i)
+        {
+          m_ranges[i].begin = num_tasks * i / m_num_threads;
+          m_ranges[i].end   = num_tasks * (i + 1) / m_num_threads;
+        } // end for i
+
+        pthread_mutex_lock(&m_mutex);
+        ++m_generation;
+        m_num_busy = m_num_threads - 1;
+        pthread_cond_broadcast(&m_wake);
+        pthread_mutex_unlock(&m_mutex);
+
+        is_worker() = true;
+        participate(0);
+        is_worker() = false;
+
+        pthread_mutex_lock(&m_mutex);
+        while(m_num_busy > 0)
+        {
+          pthread_cond_wait(&m_done, &m_mutex);
+        } // end while
+        pthread_mutex_unlock(&m_mutex);
+
+        pthread_mutex_unlock(&m_submit);
+
+        return;
+      } // end if
+#endif
+
+      for(std::size_t i = 0; i < num_tasks; ++i)
+      {
+        job.execute(job.context, i);
+      } // end for i
+    } // end execute()
+
+  private:
+#if __BULK_HAS_HOST_THREADS__
+    struct range
+    {
+      spin_lock   lock;
+      std::size_t begin;
+      std::size_t end;
+    };
+
+    struct worker_arg
+    {
+      host_thread_pool *pool;
+      int               participant;
+    };
+
+    // true on a thread which is executing a job's tasks
+    inline static bool &is_worker()
+    {
+      static __bulk_thread_local__ bool result = false;
+      return result;
+    } // end is_worker()
+
+    inline bool pop(int participant, std::size_t &task)
+    {
+      range &r = m_ranges[participant];
+      scoped_spin_lock guard(r.lock);
+
+      if(r.begin == r.end) return false;
+
+      task = r.begin++;
+      return true;
+    } // end pop()
+
+    // moves the back half of another participant's range into participant's own
+    inline bool steal(int participant)
+    {
+      for(int i = 1; i < m_num_threads; ++i)
+      {
+        range &victim = m_ranges[(participant + i) % m_num_threads];
+
+        std::size_t begin = 0, end = 0;
+
+        {
+          scoped_spin_lock guard(victim.lock);
+
+          std::size_t n = victim.end - victim.begin;
+
+          if(n == 0) continue;
+
+          begin = victim.end - (n + 1) / 2;
+          end   = victim.end;
+
+          victim.end = begin;
+        }
+
+        range &r = m_ranges[participant];
+        scoped_spin_lock guard(r.lock);
+
+        r.begin = begin;
+        r.end   = end;
+
+        return true;
+      } // end for i
+
+      return false;
+    } // end steal()
+
+    inline void participate(int participant)
+    {
+      std::size_t task = 0;
+
+      while(pop(participant, task) || (steal(participant) && pop(participant, task)))
+      {
+        m_job.execute(m_job.context, task);
+      } // end while
+    } // end participate()
+
+    inline static void *worker_main(void *arg_)
+    {
+      worker_arg *arg = reinterpret_cast<worker_arg*>(arg_);
+      host_thread_pool *self = arg->pool;
+
+      is_worker() = true;
+
+      unsigned int generation = 0;
+
+      while(true)
+      {
+        pthread_mutex_lock(&self->m_mutex);
+        while(self->m_generation == generation && !self->m_exit)
+        {
+          pthread_cond_wait(&self->m_wake, &self->m_mutex);
+        } // end while
+
+        if(self->m_exit)
+        {
+          pthread_mutex_unlock(&self->m_mutex);
+          return 0;
+        } // end if
+
+        generation = self->m_generation;
+        pthread_mutex_unlock(&self->m_mutex);
+
+        self->participate(arg->participant);
+
+        pthread_mutex_lock(&self->m_mutex);
+        if(--self->m_num_busy == 0)
+        {
+          pthread_cond_signal(&self->m_done);
+        } // end if
+        pthread_mutex_unlock(&self->m_mutex);
+      } // end while
+    } // end worker_main()
+#endif
+
+    int m_num_threads;
+
+#if __BULK_HAS_HOST_THREADS__
+    host_job        m_job;
+    range           m_ranges[max_num_threads];
+    pthread_t       m_workers[max_num_threads];
+    worker_arg      m_worker_args[max_num_threads];
+
+    // guards m_generation, m_num_busy & m_exit
+    pthread_mutex_t m_mutex;
+    pthread_cond_t  m_wake;
+    pthread_cond_t  m_done;
+    unsigned int    m_generation;
+    int             m_num_busy;
+    bool            m_exit;
+
+    // serializes jobs submitted by different threads
+    pthread_mutex_t m_submit;
+#endif
+
+    // non-copyable
+    host_thread_pool(const host_thread_pool &);
+    host_thread_pool &operator=(const host_thread_pool &);
+}; // end host_thread_pool
+
+
+inline host_thread_pool &the_host_thread_pool()
+{
+  static host_thread_pool pool;
+  return pool;
+} // end the_host_thread_pool()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
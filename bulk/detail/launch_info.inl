@@ -0,0 +1,186 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/launch_info.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <thrust/tuple.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// resources' caps bound the number of groups the launcher chooses, as they would for the launch itself
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Closure, const launch_resources &resources = launch_resources())
+{
+  typedef bulk::detail::cuda_launcher<ExecutionGroup, Closure> launcher_type;
+  typedef typename launcher_type::size_type                    size_type;
+
+  launcher_type launcher;
+
+  launcher.set_resources(resources);
+
+  size_type num_groups = 0, group_size = 0, heap_size = 0;
+  thrust::tie(num_groups, group_size, heap_size) = launcher.configuration(g);
+
+  const device_properties_t   &props = launcher.device_properties();
+  const function_attributes_t &attr  = launcher.launch_config().function_attributes;
+
+  launch_info_t result;
+
+  result.num_groups = num_groups;
+  result.group_size = group_size;
+  result.heap_size  = heap_size;
+
+  result.max_active_groups_per_multiprocessor =
+    group_size > 0 ? launcher_type::max_active_blocks_per_multiprocessor(props, attr, group_size, heap_size) : 0;
+
+  result.occupancy =
+    props.maxThreadsPerMultiProcessor > 0 ?
+    float(result.max_active_groups_per_multiprocessor * group_size) / props.maxThreadsPerMultiProcessor :
+    0.f;
+
+  result.num_registers_per_thread = attr.numRegs;
+  result.local_bytes_per_thread   = attr.localSizeBytes;
+  result.static_smem_bytes        = attr.sharedSizeBytes;
+  result.max_group_size           = attr.maxThreadsPerBlock;
+  result.ptx_version              = attr.ptxVersion;
+
+  return result;
+} // end launch_info()
+
+
+// the configuration depends on a launch's resources, but not on its stream or dependencies
+template<typename ExecutionGroup, typename Closure>
+__host__ __device__
+launch_info_t launch_info(async_launch<ExecutionGroup> launch, Closure c)
+{
+  return bulk::detail::launch_info(launch.exec(), c, launch.resources());
+} // end launch_info()
+
+
+} // end detail
+
+
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Args&&... args)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f, bulk::detail::forward<Args>(args)...));
+}
+#else
+template<typename ExecutionGroup, typename Function>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9));
+}
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10)
+{
+  return bulk::detail::launch_info(g, detail::make_closure(f,arg1,arg2,arg3,arg4,arg5,arg6,arg7,arg8,arg9,arg10));
+}
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,182 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/nvtx.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <string>
+#include <cstdio>
+#include <cstddef>
+
+// #define BULK_LAUNCH_LOG 1 before #including Bulk to record each launch from the host in a ring buffer
+// and to report which launches may have raised an error when it surfaces at a future's wait,
+// rather than synchronizing after each launch as __THRUST_SYNCHRONOUS does
+#ifndef BULK_LAUNCH_LOG
+#  define BULK_LAUNCH_LOG 0
+#endif
+
+// launches only carry their names when something consumes them
+#define __BULK_HAS_LAUNCH_NAMES__ (BULK_NVTX || BULK_LAUNCH_LOG)
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+#if BULK_LAUNCH_LOG
+struct launch_record
+{
+  unsigned long long sequence;
+  const char        *name;
+  dim3               grid_dim;
+  dim3               block_dim;
+  std::size_t        heap_size;
+  cudaStream_t       stream;
+};
+
+
+// the most recent launches, numbered in the order they were issued
+// a launch retires when a wait on it or on a later launch succeeds
+// XXX launches in other streams may still be running at that point,
+//     so an error is only attributed to the launches in flight, not to a single one
+class launch_log
+{
+  public:
+    static const int capacity = 32;
+
+    inline launch_log()
+      : m_next_sequence(1), m_retired(0)
+    {}
+
+    // returns the new launch's sequence number
+    inline unsigned long long record(const char *name, dim3 grid_dim, dim3 block_dim, std::size_t heap_size, cudaStream_t stream)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      launch_record &r = m_records[m_next_sequence % capacity];
+
+      r.sequence  = m_next_sequence;
+      r.name      = name;
+      r.grid_dim  = grid_dim;
+      r.block_dim = block_dim;
+      r.heap_size = heap_size;
+      r.stream    = stream;
+
+      return m_next_sequence++;
+    } // end record()
+
+    inline void retire(unsigned long long sequence)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      if(sequence > m_retired) m_retired = sequence;
+    } // end retire()
+
+    // message followed by each unretired launch still in the log, marking the one numbered sequence
+    inline std::string describe(const char *message, unsigned long long sequence)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      std::string result = message;
+      result += "; bulk launches in flight:";
+
+      unsigned long long first = m_retired + 1;
+
+      if(m_next_sequence - first > static_cast<unsigned long long>(capacity))
+      {
+        char buffer[64];
+        std::sprintf(buffer, " (%llu earlier launches not shown)", m_next_sequence - capacity - first);
+        result += buffer;
+
+        first = m_next_sequence - capacity;
+      } // end if
+
+      if(first == m_next_sequence)
+      {
+        result += " none";
+      } // end if
+
+      for(unsigned long long i = first; i < m_next_sequence; ++i)
+      {
+        const launch_record &r = m_records[i % capacity];
+
+        char buffer[256];
+        std::sprintf(buffer, "\n  #%llu %.64s grid=(%u,%u,%u) block=(%u,%u,%u) heap=%lu stream=%p%s",
+                     r.sequence,
+                     r.name ? r.name : "(unnamed)",
+                     r.grid_dim.x, r.grid_dim.y, r.grid_dim.z,
+                     r.block_dim.x, r.block_dim.y, r.block_dim.z,
+                     static_cast<unsigned long>(r.heap_size),
+                     static_cast<void*>(r.stream),
+                     r.sequence == sequence ? " <- waited on" : "");
+        result += buffer;
+      } // end for i
+
+      return result;
+    } // end describe()
+
+  private:
+    spin_lock          m_lock;
+    unsigned long long m_next_sequence;
+    unsigned long long m_retired;
+    launch_record      m_records[capacity];
+
+    // non-copyable
+    launch_log(const launch_log &);
+    launch_log &operator=(const launch_log &);
+}; // end launch_log
+
+
+inline launch_log &the_launch_log()
+{
+  static launch_log log;
+  return log;
+} // end the_launch_log()
+
+
+// e is the result of waiting on the launch numbered sequence
+// throws any error e or an earlier launch left behind, describing the launches which may have raised it
+// otherwise retires the launches through sequence
+inline void throw_on_launch_error(cudaError_t e, unsigned long long sequence, const char *message)
+{
+  // errors nothing has reported yet, e.g. from a launch no future tracks
+  if(e == cudaSuccess) e = cudaPeekAtLastError();
+
+  if(e == cudaSuccess)
+  {
+    the_launch_log().retire(sequence);
+    return;
+  } // end if
+
+  std::string description = the_launch_log().describe(message, sequence);
+
+  bulk::detail::throw_on_error(e, description.c_str());
+} // end throw_on_launch_error()
+#endif // BULK_LAUNCH_LOG
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,103 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <cstddef>
+
+// #define BULK_NVTX 1 before #including Bulk to wrap each launch in an NVTX range
+// tagged with the launch's name (see bulk::named) and its grid/block/heap configuration.
+// NVTX is header-only since CUDA 10; older toolkits must link against -lnvToolsExt
+#ifndef BULK_NVTX
+#  define BULK_NVTX 0
+#endif
+
+#if BULK_NVTX
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 10000)
+#    include <nvtx3/nvToolsExt.h>
+#  else
+#    include <nvToolsExt.h>
+#  endif
+#  include <cstdio>
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+#if BULK_NVTX
+// pushes an NVTX range for the lifetime of the object
+class scoped_nvtx_range
+{
+  public:
+    inline scoped_nvtx_range(const char *name, std::size_t num_groups, std::size_t group_size, std::size_t heap_size)
+    {
+      if(name == 0) name = "bulk::async";
+
+      char message[128];
+      std::sprintf(message, "%.64s grid=%lu block=%lu heap=%lu",
+                   name,
+                   static_cast<unsigned long>(num_groups),
+                   static_cast<unsigned long>(group_size),
+                   static_cast<unsigned long>(heap_size));
+
+      nvtxEventAttributes_t attributes = {0};
+      attributes.version       = NVTX_VERSION;
+      attributes.size          = NVTX_EVENT_ATTRIB_STRUCT_SIZE;
+      attributes.colorType     = NVTX_COLOR_ARGB;
+      attributes.color         = color(name);
+      attributes.messageType   = NVTX_MESSAGE_TYPE_ASCII;
+      attributes.message.ascii = message;
+
+      nvtxRangePushEx(&attributes);
+    } // end scoped_nvtx_range()
+
+    inline ~scoped_nvtx_range()
+    {
+      nvtxRangePop();
+    } // end ~scoped_nvtx_range()
+
+  private:
+    // launches with the same name share a color
+    inline static unsigned int color(const char *name)
+    {
+      unsigned int hash = 2166136261u;
+
+      for(; *name; ++name)
+      {
+        hash = (hash ^ static_cast<unsigned char>(*name)) * 16777619u;
+      } // end for
+
+      return 0xff000000u | (hash & 0x00ffffffu);
+    } // end color()
+
+    // non-copyable
+    scoped_nvtx_range(const scoped_nvtx_range &);
+    scoped_nvtx_range &operator=(const scoped_nvtx_range &);
+}; // end scoped_nvtx_range
+#endif
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
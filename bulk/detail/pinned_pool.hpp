@@ -0,0 +1,106 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// small pinned host buffers receive the results of bulk::future<T>,
+// and cudaMallocHost is far too expensive to call once per future,
+// so they are borrowed from a free list of fixed-size blocks instead
+// XXX like stream_pool, the pooled blocks are deliberately leaked at exit
+class pinned_pool
+{
+  public:
+    // requests larger than a block bypass the pool
+    static const std::size_t block_size = 256;
+
+    static const std::size_t max_pooled_blocks = 64;
+
+    inline void *allocate(std::size_t num_bytes)
+    {
+      if(num_bytes <= block_size)
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(!m_blocks.empty())
+        {
+          void *result = m_blocks.back();
+          m_blocks.pop_back();
+          return result;
+        } // end if
+      } // end if
+
+      void *result = 0;
+#if __BULK_HAS_CUDART__
+      // portable so that the block may receive copies from any device
+      bulk::detail::throw_on_error(cudaHostAlloc(&result, num_bytes <= block_size ? block_size : num_bytes, cudaHostAllocPortable),
+                                   "cudaHostAlloc in pinned_pool::allocate");
+#endif
+      return result;
+    } // end allocate()
+
+    inline cudaError_t deallocate(void *ptr, std::size_t num_bytes)
+    {
+      if(num_bytes <= block_size)
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(m_blocks.size() < max_pooled_blocks)
+        {
+          m_blocks.push_back(ptr);
+          return cudaSuccess;
+        } // end if
+      } // end if
+
+#if __BULK_HAS_CUDART__
+      return cudaFreeHost(ptr);
+#else
+      return cudaSuccess;
+#endif
+    } // end deallocate()
+
+  private:
+    spin_lock          m_lock;
+    std::vector<void*> m_blocks;
+}; // end pinned_pool
+
+
+inline pinned_pool &global_pinned_pool()
+{
+  static pinned_pool pool;
+  return pool;
+} // end global_pinned_pool()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -17,6 +17,19 @@
 #pragma once
 
 #include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <cstddef>
+
+
+// the runtime hands out driver entry points since CUDA 11.3, so that we may ask
+// the driver for an allocation's extent without linking against -lcuda
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 11030)
+#  define __BULK_HAS_DRIVER_ENTRY_POINTS__ 1
+#  include <cuda.h>
+#else
+#  define __BULK_HAS_DRIVER_ENTRY_POINTS__ 0
+#endif
+
 
 BULK_NAMESPACE_PREFIX
 namespace bulk
@@ -69,6 +82,64 @@ inline __device__ bool is_global(const void *ptr)
 } // end is_global()
 
 
+#if __BULK_HAS_DRIVER_ENTRY_POINTS__
+typedef CUresult (CUDAAPI *pointer_get_attributes_t)(unsigned int, CUpointer_attribute *, void **, CUdeviceptr);
+
+
+inline __host__ pointer_get_attributes_t pointer_get_attributes_entry_point()
+{
+  void *result = 0;
+
+  if(cudaGetDriverEntryPoint("cuPointerGetAttributes", &result, cudaEnableDefault) != cudaSuccess)
+  {
+    // clear the error, the driver is just too old
+    cudaGetLastError();
+    result = 0;
+  } // end if
+
+  return reinterpret_cast<pointer_get_attributes_t>(result);
+} // end pointer_get_attributes_entry_point()
+#endif
+
+
+// finds [base, base + size), the managed allocation containing ptr
+// returns false when ptr isn't managed (e.g. device memory, or mapped host memory, which never migrates)
+// or when the toolkit or driver can't tell
+// XXX unlike cudaPointerGetAttributes, the driver doesn't disturb the runtime's last error for unregistered host pointers
+inline __host__ bool find_managed_allocation(const void *ptr, const void *&base, std::size_t &size)
+{
+  base = 0;
+  size = 0;
+
+#if __BULK_HAS_DRIVER_ENTRY_POINTS__
+  static pointer_get_attributes_t get_attributes = pointer_get_attributes_entry_point();
+
+  if(ptr == 0 || get_attributes == 0) return false;
+
+  unsigned int is_managed = 0;
+  CUdeviceptr range_start = 0;
+  std::size_t range_size  = 0;
+
+  CUpointer_attribute attributes[3] = {CU_POINTER_ATTRIBUTE_IS_MANAGED, CU_POINTER_ATTRIBUTE_RANGE_START_ADDR, CU_POINTER_ATTRIBUTE_RANGE_SIZE};
+  void *data[3] = {&is_managed, &range_start, &range_size};
+
+  if(get_attributes(3, attributes, data, reinterpret_cast<CUdeviceptr>(ptr)) != CUDA_SUCCESS || !is_managed)
+  {
+    return false;
+  } // end if
+
+  base = reinterpret_cast<const void*>(range_start);
+  size = range_size;
+
+  return size > 0;
+#else
+  (void) ptr;
+
+  return false;
+#endif
+} // end find_managed_allocation()
+
+
 } // end detail
 } // end bulk
 BULK_NAMESPACE_SUFFIX
@@ -0,0 +1,114 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// carves aligned arrays out of a caller-provided scratch space
+// given a null scratch space, it only measures how large the scratch space must be
+class scratch_partition
+{
+  public:
+    // each array begins on a boundary suitable for any type
+    static const std::size_t alignment = 256;
+
+    inline explicit scratch_partition(void *scratch)
+      : m_scratch(static_cast<char*>(scratch)),
+        m_size(0)
+    {}
+
+    // returns null when measuring
+    template<typename T>
+    inline T *allocate(std::size_t n)
+    {
+      char *result = m_scratch ? m_scratch + m_size : 0;
+
+      m_size += (n * sizeof(T) + alignment - 1) / alignment * alignment;
+
+      return reinterpret_cast<T*>(result);
+    } // end allocate()
+
+    // the result is never 0, so a null scratch space always means a query
+    inline std::size_t size() const
+    {
+      return m_size > 0 ? m_size : 1;
+    } // end size()
+
+  private:
+    char        *m_scratch;
+    std::size_t  m_size;
+}; // end scratch_partition
+
+
+// returns true if the algorithm should go ahead with the scratch space it was given
+// when scratch is null, records the required size in scratch_bytes and returns false instead
+inline bool check_scratch(void *scratch, std::size_t &scratch_bytes, const scratch_partition &partition, const char *message)
+{
+  if(scratch == 0)
+  {
+    scratch_bytes = partition.size();
+    return false;
+  } // end if
+
+  if(scratch_bytes < partition.size())
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, message);
+  } // end if
+
+  return true;
+} // end check_scratch()
+
+
+// the scratch space the algorithms allocate for themselves when the caller provides none
+// it's drawn from the caching allocator, so releasing it doesn't synchronize the device
+class temporary_scratch
+{
+  public:
+    inline explicit temporary_scratch(std::size_t num_bytes, cudaStream_t stream = 0)
+      : m_storage(num_bytes, stream)
+    {}
+
+    inline void *data()
+    {
+      return m_storage.data();
+    } // end data()
+
+  private:
+    bulk::detail::cached_array<char> m_storage;
+
+    // non-copyable
+    temporary_scratch(const temporary_scratch &);
+    temporary_scratch &operator=(const temporary_scratch &);
+}; // end temporary_scratch
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
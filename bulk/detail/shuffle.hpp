@@ -0,0 +1,141 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/uninitialized.hpp>
+#include <cstring>
+
+
+// the *_sync flavors of the shuffle intrinsics first appeared in CUDA 9
+#if defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+#  define __BULK_HAS_SYNC_SHUFFLE__ 1
+#else
+#  define __BULK_HAS_SYNC_SHUFFLE__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace shuffle_detail
+{
+
+
+enum shuffle_kind
+{
+  shuffle_idx,
+  shuffle_up,
+  shuffle_down,
+  shuffle_xor
+};
+
+
+template<int kind>
+__device__ __forceinline__
+int shuffle_word(int word, int operand)
+{
+#if __CUDA_ARCH__ >= 300
+#  if __BULK_HAS_SYNC_SHUFFLE__
+  const unsigned int all_lanes = 0xffffffff;
+
+  return (kind == shuffle_idx)  ? __shfl_sync(all_lanes, word, operand) :
+         (kind == shuffle_up)   ? __shfl_up_sync(all_lanes, word, operand) :
+         (kind == shuffle_down) ? __shfl_down_sync(all_lanes, word, operand) :
+                                  __shfl_xor_sync(all_lanes, word, operand);
+#  else
+  return (kind == shuffle_idx)  ? __shfl(word, operand) :
+         (kind == shuffle_up)   ? __shfl_up(word, operand) :
+         (kind == shuffle_down) ? __shfl_down(word, operand) :
+                                  __shfl_xor(word, operand);
+#  endif
+#else
+  bulk::detail::terminate_with_message("warp shuffle requires sm_30 or better");
+  return word;
+#endif
+} // end shuffle_word()
+
+
+// shuffles an arbitrary T one 32b word at a time
+template<int kind, typename T>
+__device__ __forceinline__
+T shuffle(const T &x, int operand)
+{
+  const int num_words = (sizeof(T) + sizeof(int) - 1) / sizeof(int);
+
+  int words[num_words];
+  std::memcpy(words, &x, sizeof(T));
+
+  for(int i = 0; i < num_words; ++i)
+  {
+    words[i] = shuffle_word<kind>(words[i], operand);
+  } // end for i
+
+  bulk::uninitialized<T> result;
+  std::memcpy(&result.get(), words, sizeof(T));
+
+  return result.get();
+} // end shuffle()
+
+
+} // end shuffle_detail
+
+
+// returns x from lane src_lane
+template<typename T>
+__device__ __forceinline__
+T shuffle(const T &x, int src_lane)
+{
+  return shuffle_detail::shuffle<shuffle_detail::shuffle_idx>(x, src_lane);
+} // end shuffle()
+
+
+// returns x from lane (lane - delta); lanes below delta receive their own x
+template<typename T>
+__device__ __forceinline__
+T shuffle_up(const T &x, int delta)
+{
+  return shuffle_detail::shuffle<shuffle_detail::shuffle_up>(x, delta);
+} // end shuffle_up()
+
+
+// returns x from lane (lane + delta); lanes at or above (32 - delta) receive their own x
+template<typename T>
+__device__ __forceinline__
+T shuffle_down(const T &x, int delta)
+{
+  return shuffle_detail::shuffle<shuffle_detail::shuffle_down>(x, delta);
+} // end shuffle_down()
+
+
+// returns x from lane (lane ^ mask)
+template<typename T>
+__device__ __forceinline__
+T shuffle_xor(const T &x, int mask)
+{
+  return shuffle_detail::shuffle<shuffle_detail::shuffle_xor>(x, mask);
+} // end shuffle_xor()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,102 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// a minimal host-only lock for guarding the runtime's small caches
+// XXX we can't count on <mutex> being available, so spin on an atomic exchange instead
+class spin_lock
+{
+  public:
+    inline spin_lock()
+      : m_flag(0)
+    {}
+
+    inline void lock()
+    {
+#if defined(_MSC_VER)
+      while(_InterlockedExchange(&m_flag, 1))
+#else
+      while(__sync_lock_test_and_set(&m_flag, 1))
+#endif
+      {
+        ;
+      } // end while
+    } // end lock()
+
+    inline void unlock()
+    {
+#if defined(_MSC_VER)
+      _InterlockedExchange(&m_flag, 0);
+#else
+      __sync_lock_release(&m_flag);
+#endif
+    } // end unlock()
+
+  private:
+#if defined(_MSC_VER)
+    volatile long m_flag;
+#else
+    volatile int m_flag;
+#endif
+
+    // non-copyable
+    spin_lock(const spin_lock &);
+    spin_lock &operator=(const spin_lock &);
+}; // end spin_lock
+
+
+class scoped_spin_lock
+{
+  public:
+    inline explicit scoped_spin_lock(spin_lock &l)
+      : m_lock(l)
+    {
+      m_lock.lock();
+    } // end scoped_spin_lock()
+
+    inline ~scoped_spin_lock()
+    {
+      m_lock.unlock();
+    } // end ~scoped_spin_lock()
+
+  private:
+    spin_lock &m_lock;
+
+    // non-copyable
+    scoped_spin_lock(const scoped_spin_lock &);
+    scoped_spin_lock &operator=(const scoped_spin_lock &);
+}; // end scoped_spin_lock
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
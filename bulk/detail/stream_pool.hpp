@@ -0,0 +1,291 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <vector>
+#include <utility>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// streams & events are expensive to create and destroy relative to the cost of a small launch,
+// so bulk::async & bulk::future borrow them from a per-device free list instead
+// XXX the pooled resources are deliberately leaked at exit, because the CUDA runtime
+//     may already have been torn down by the time static destructors run
+class stream_pool
+{
+  public:
+    // the events we hand out never record timing information
+    static const int event_create_flags = cudaEventDisableTiming;
+
+    // don't let a burst of launches leave an unbounded number of idle resources behind
+    static const size_t max_pooled_resources = 64;
+
+    // streams of priority other than the default are pooled apart, since few launches ask for them
+    inline cudaStream_t acquire_stream(int priority = 0)
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(priority == 0 && !m_streams.empty())
+        {
+          cudaStream_t result = m_streams.back();
+          m_streams.pop_back();
+          return result;
+        } // end if
+
+        for(size_t i = 0; priority != 0 && i < m_prioritized_streams.size(); ++i)
+        {
+          if(m_prioritized_streams[i].first == priority)
+          {
+            cudaStream_t result = m_prioritized_streams[i].second;
+            m_prioritized_streams[i] = m_prioritized_streams.back();
+            m_prioritized_streams.pop_back();
+            return result;
+          } // end if
+        } // end for i
+      }
+
+      cudaStream_t result = 0;
+#if __BULK_HAS_CUDART__
+      if(priority == 0)
+      {
+        bulk::detail::throw_on_error(cudaStreamCreate(&result), "cudaStreamCreate in stream_pool::acquire_stream");
+      }
+      else
+      {
+        bulk::detail::throw_on_error(cudaStreamCreateWithPriority(&result, cudaStreamDefault, priority), "cudaStreamCreateWithPriority in stream_pool::acquire_stream");
+      } // end else
+#endif
+      return result;
+    } // end acquire_stream()
+
+    inline cudaError_t release_stream(cudaStream_t s)
+    {
+      int priority = 0;
+#if __BULK_HAS_CUDART__
+      cudaError_t error = cudaStreamGetPriority(s, &priority);
+      if(error) return error;
+#endif
+
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(priority == 0 && m_streams.size() < max_pooled_resources)
+        {
+          m_streams.push_back(s);
+          return cudaSuccess;
+        } // end if
+
+        if(priority != 0 && m_prioritized_streams.size() < max_pooled_resources)
+        {
+          m_prioritized_streams.push_back(std::make_pair(priority, s));
+          return cudaSuccess;
+        } // end if
+      }
+
+#if __BULK_HAS_CUDART__
+      return cudaStreamDestroy(s);
+#else
+      return cudaSuccess;
+#endif
+    } // end release_stream()
+
+    inline cudaEvent_t acquire_event()
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(!m_events.empty())
+        {
+          cudaEvent_t result = m_events.back();
+          m_events.pop_back();
+          return result;
+        } // end if
+      }
+
+      cudaEvent_t result = 0;
+#if __BULK_HAS_CUDART__
+      bulk::detail::throw_on_error(cudaEventCreateWithFlags(&result, event_create_flags), "cudaEventCreateWithFlags in stream_pool::acquire_event");
+#endif
+      return result;
+    } // end acquire_event()
+
+    inline cudaError_t release_event(cudaEvent_t e)
+    {
+      {
+        scoped_spin_lock guard(m_lock);
+
+        if(m_events.size() < max_pooled_resources)
+        {
+          m_events.push_back(e);
+          return cudaSuccess;
+        } // end if
+      }
+
+#if __BULK_HAS_CUDART__
+      return cudaEventDestroy(e);
+#else
+      return cudaSuccess;
+#endif
+    } // end release_event()
+
+  private:
+    spin_lock                 m_lock;
+    std::vector<cudaStream_t> m_streams;
+    std::vector<std::pair<int,cudaStream_t> > m_prioritized_streams;
+    std::vector<cudaEvent_t>  m_events;
+}; // end stream_pool
+
+
+// returns 0 for devices beyond the first few, which bypass the pool
+inline stream_pool *stream_pool_for_device(int device_id)
+{
+  // only pool resources for the first few devices
+  static const int max_num_devices = 16;
+
+  static stream_pool pools[max_num_devices];
+
+  return (0 <= device_id && device_id < max_num_devices) ? &pools[device_id] : 0;
+} // end stream_pool_for_device()
+
+
+// device_id must name the current device
+// priority is as for cudaStreamCreateWithPriority
+__host__ __device__
+inline cudaStream_t acquire_stream(int device_id, int priority = 0)
+{
+  cudaStream_t result = 0;
+
+  // XXX cudaStreamCreate is __host__-only
+#if (__BULK_HAS_CUDART__ && !defined(__CUDA_ARCH__))
+  stream_pool *pool = stream_pool_for_device(device_id);
+
+  if(pool)
+  {
+    result = pool->acquire_stream(priority);
+  }
+  else if(priority == 0)
+  {
+    bulk::detail::throw_on_error(cudaStreamCreate(&result), "cudaStreamCreate in acquire_stream");
+  }
+  else
+  {
+    bulk::detail::throw_on_error(cudaStreamCreateWithPriority(&result, cudaStreamDefault, priority), "cudaStreamCreateWithPriority in acquire_stream");
+  } // end else
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  (void) priority;
+  bulk::detail::terminate_with_message("bulk::async(): cudaStreamCreate() is unsupported in __device__ code.");
+#endif
+
+  return result;
+} // end acquire_stream()
+
+
+// device_id must name the device on which s was acquired
+__host__ __device__
+inline cudaError_t release_stream(int device_id, cudaStream_t s)
+{
+  cudaError_t result = cudaSuccess;
+
+#if __BULK_HAS_CUDART__
+#ifndef __CUDA_ARCH__
+  stream_pool *pool = stream_pool_for_device(device_id);
+
+  result = pool ? pool->release_stream(s) : cudaStreamDestroy(s);
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  result = cudaStreamDestroy(s);
+#endif // __CUDA_ARCH__
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  (void) s;
+#endif // __BULK_HAS_CUDART__
+
+  return result;
+} // end release_stream()
+
+
+// device_id must name the current device
+__host__ __device__
+inline cudaEvent_t acquire_event(int device_id)
+{
+  cudaEvent_t result = 0;
+
+#if __BULK_HAS_CUDART__
+#ifndef __CUDA_ARCH__
+  stream_pool *pool = stream_pool_for_device(device_id);
+
+  if(pool)
+  {
+    result = pool->acquire_event();
+  }
+  else
+  {
+    bulk::detail::throw_on_error(cudaEventCreateWithFlags(&result, stream_pool::event_create_flags), "cudaEventCreateWithFlags in acquire_event");
+  } // end else
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  bulk::detail::throw_on_error(cudaEventCreateWithFlags(&result, stream_pool::event_create_flags), "cudaEventCreateWithFlags in acquire_event");
+#endif // __CUDA_ARCH__
+#else
+  (void) device_id; // Suppress unused parameter warnings
+#endif // __BULK_HAS_CUDART__
+
+  return result;
+} // end acquire_event()
+
+
+// device_id must name the device on which e was acquired
+__host__ __device__
+inline cudaError_t release_event(int device_id, cudaEvent_t e)
+{
+  cudaError_t result = cudaSuccess;
+
+#if __BULK_HAS_CUDART__
+#ifndef __CUDA_ARCH__
+  stream_pool *pool = stream_pool_for_device(device_id);
+
+  result = pool ? pool->release_event(e) : cudaEventDestroy(e);
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  result = cudaEventDestroy(e);
+#endif // __CUDA_ARCH__
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  (void) e;
+#endif // __BULK_HAS_CUDART__
+
+  return result;
+} // end release_event()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -22,6 +22,15 @@
 #include <bulk/detail/terminate.hpp>
 #include <bulk/detail/guarded_cuda_runtime_api.hpp>
 
+
+// #define BULK_DEVICE_SYNCHRONOUS 1 before #including Bulk to make each launch from __device__ code
+// wait for its child grid to complete before returning
+// XXX cudaDeviceSynchronize() is unavailable in __device__ code since CUDA 12.0
+#ifndef BULK_DEVICE_SYNCHRONOUS
+#  define BULK_DEVICE_SYNCHRONOUS 0
+#endif
+
+
 BULK_NAMESPACE_PREFIX
 namespace bulk
 {
@@ -45,8 +54,9 @@ inline __host__ __device__
 void synchronize_if_enabled(const char* message = "")
 {
 // XXX we rely on __THRUST_SYNCHRONOUS here
-//     note we always have to synchronize in __device__ code
-#if __THRUST_SYNCHRONOUS || defined(__CUDA_ARCH__)
+//     __device__ code synchronizes only when asked to, because a parent grid which waits on each of
+//     its children serializes a recursive algorithm and counts against the nesting depth
+#if __THRUST_SYNCHRONOUS || (defined(__CUDA_ARCH__) && BULK_DEVICE_SYNCHRONOUS)
   synchronize(message);
 #else
   // WAR "unused parameter" warning
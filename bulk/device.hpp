@@ -0,0 +1,51 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+
+// the device-wide algorithms each launch one or more kernels over an entire range.
+//
+// Each algorithm which requires temporary storage accepts a caller-provided scratch space
+// as its first two parameters and an optional stream as its last parameter:
+//
+//   std::size_t scratch_bytes = 0;
+//   bulk::device::inclusive_scan(0, scratch_bytes, first, last, result, init, op, stream);
+//
+//   void *scratch = ...; // at least scratch_bytes on the device
+//   bulk::device::inclusive_scan(scratch, scratch_bytes, first, last, result, init, op, stream);
+//
+// Given a null scratch space, they only report how many bytes they require. The same scratch
+// space may be reused across invocations, provided the invocations do not overlap. The
+// overloads without a scratch space draw one from a per-device caching allocator, so
+// they neither call cudaMalloc nor synchronize the device in the steady state.
+
+#include <bulk/device/decomposition.hpp>
+#include <bulk/device/reduce_intervals.hpp>
+#include <bulk/device/reduce.hpp>
+#include <bulk/device/scan.hpp>
+#include <bulk/device/merge.hpp>
+#include <bulk/device/multiway_merge.hpp>
+#include <bulk/device/sort.hpp>
+#include <bulk/device/segmented_sort.hpp>
+#include <bulk/device/load_balance.hpp>
+#include <bulk/device/reduce_by_key.hpp>
+#include <bulk/device/select.hpp>
+#include <bulk/device/set_operations.hpp>
+#include <bulk/device/histogram.hpp>
+#include <bulk/device/streaming.hpp>
+
@@ -0,0 +1,392 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <thrust/pair.h>
+#include <thrust/detail/minmax.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace device
+{
+
+
+template<typename Size>
+class trivial_decomposition
+{
+  public:
+    typedef Size size_type;
+
+    typedef thrust::pair<size_type,size_type> range;
+
+    __host__ __device__
+    trivial_decomposition()
+      : m_n(0)
+    {}
+
+    __host__ __device__
+    trivial_decomposition(size_type n)
+      : m_n(n)
+    {}
+
+    __host__ __device__
+    range operator[](size_type) const
+    {
+      return range(0, n());
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return 1;
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_n;
+    }
+
+  private:
+    Size m_n;
+};
+
+
+template<typename Size>
+__host__ __device__
+trivial_decomposition<Size> make_trivial_decomposition(Size n)
+{
+  return trivial_decomposition<Size>(n);
+}
+
+
+template<typename Size>
+class blocked_decomposition
+{
+  public:
+    typedef Size size_type;
+
+    typedef thrust::pair<size_type,size_type> range;
+
+    __host__ __device__
+    blocked_decomposition()
+      : m_n(0),
+        m_block_size(0),
+        m_num_partitions(0)
+    {}
+
+    __host__ __device__
+    blocked_decomposition(size_type n, Size block_size)
+      : m_n(n),
+        m_block_size(block_size),
+        m_num_partitions((n + block_size - 1) / block_size)
+    {}
+
+    __host__ __device__
+    range operator[](size_type i) const
+    {
+      size_type first = i * m_block_size;
+      size_type last  = thrust::min(m_n, first + m_block_size);
+
+      return range(first, last);
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_num_partitions;
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_n;
+    }
+
+  private:
+    Size m_n;
+    Size m_block_size;
+    Size m_num_partitions;
+};
+
+
+template<typename Size>
+__host__ __device__
+blocked_decomposition<Size> make_blocked_decomposition(Size n, Size block_size)
+{
+  return blocked_decomposition<Size>(n,block_size);
+}
+
+
+template<typename Size>
+class uniform_decomposition
+  : public blocked_decomposition<Size>
+{
+  private:
+    typedef blocked_decomposition<Size> super_t;
+
+  public:
+    __host__ __device__
+    uniform_decomposition()
+      : super_t()
+    {}
+
+    __host__ __device__
+    uniform_decomposition(Size n, Size num_partitions)
+      : super_t(n, n / num_partitions)
+    {}
+};
+
+
+template<typename Size>
+__host__ __device__
+uniform_decomposition<Size> make_uniform_decomposition(Size n, Size num_partitions)
+{
+  return uniform_decomposition<Size>(n,num_partitions);
+}
+
+
+template<typename Size>
+class aligned_decomposition
+{
+  public:
+    typedef Size size_type;
+
+    typedef thrust::pair<size_type,size_type> range;
+
+    __host__ __device__
+    aligned_decomposition()
+      : m_n(0),
+        m_num_partitions(0),
+        m_tile_size(0)
+    {}
+
+    __host__ __device__
+    aligned_decomposition(Size n, Size num_partitions, Size aligned_size)
+      : m_n(n),
+        m_num_partitions(num_partitions),
+        m_tile_size(aligned_size)
+    {
+      size_type num_tiles = (n + m_tile_size - 1) / m_tile_size;
+
+      m_num_tiles_per_partition = num_tiles / size();
+      m_last_partial_tile_size  =  num_tiles % size();
+    }
+
+    __host__ __device__
+    range operator[](Size i) const
+    {
+      range result = range_in_tiles(i);
+      result.first *= m_tile_size;
+      result.second = thrust::min<size_type>(m_n, result.second * m_tile_size);
+      return result;
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_num_partitions;
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_n;
+    }
+
+  private:
+    __host__ __device__
+    range range_in_tiles(size_type i) const
+    {
+      range result;
+
+      result.first = m_num_tiles_per_partition * i;
+      result.first += thrust::min<size_type>(i, m_last_partial_tile_size);
+
+      result.second = result.first + m_num_tiles_per_partition + (i < m_last_partial_tile_size);
+
+      return result;
+    }
+
+    size_type m_n;
+    size_type m_num_partitions;
+    size_type m_num_tiles_per_partition;
+    size_type m_tile_size;
+    size_type m_last_partial_tile_size;
+};
+
+
+template<typename Size>
+__host__ __device__
+aligned_decomposition<Size> make_aligned_decomposition(Size n, Size num_partitions, Size aligned_size)
+{
+  return aligned_decomposition<Size>(n,num_partitions,aligned_size);
+}
+
+
+
+// dynamic_decomposition hands out the partitions of another decomposition to groups on demand:
+// a fixed number of groups repeatedly claim the next unprocessed partition from a global counter,
+// so a group which draws a slow partition doesn't hold up the partitions behind it
+// the counter must be zero when the launch begins
+template<typename Decomposition>
+class dynamic_decomposition
+{
+  public:
+    typedef typename Decomposition::size_type size_type;
+
+    typedef typename Decomposition::range range;
+
+    __host__ __device__
+    dynamic_decomposition()
+      : m_decomp(),
+        m_num_groups(0),
+        m_counter(0)
+    {}
+
+    __host__ __device__
+    dynamic_decomposition(Decomposition decomp, size_type num_groups, unsigned int *counter)
+      : m_decomp(decomp),
+        m_num_groups(thrust::min<size_type>(num_groups, decomp.size())),
+        m_counter(counter)
+    {}
+
+    __host__ __device__
+    range operator[](size_type i) const
+    {
+      return m_decomp[i];
+    }
+
+    __host__ __device__
+    size_type size() const
+    {
+      return m_decomp.size();
+    }
+
+    // XXX think of a better name for this
+    __host__ __device__
+    size_type n() const
+    {
+      return m_decomp.n();
+    }
+
+    // the number of groups to launch
+    __host__ __device__
+    size_type num_groups() const
+    {
+      return m_num_groups;
+    }
+
+    // returns the index of the next partition for g to process, which is not less than size() when none remain
+    template<typename ConcurrentGroup>
+    __device__
+    size_type claim(ConcurrentGroup &g) const
+    {
+      __shared__ unsigned int s_partition;
+
+      // the group must be finished with its previous partition before we overwrite s_partition
+      g.wait();
+
+      if(g.this_exec.index() == 0)
+      {
+        s_partition = atomicAdd(m_counter, 1);
+      }
+
+      g.wait();
+
+      return s_partition;
+    }
+
+  private:
+    Decomposition m_decomp;
+    size_type     m_num_groups;
+    unsigned int *m_counter;
+};
+
+
+template<typename Decomposition, typename Size>
+__host__ __device__
+dynamic_decomposition<Decomposition> make_dynamic_decomposition(Decomposition decomp, Size num_groups, unsigned int *counter)
+{
+  return dynamic_decomposition<Decomposition>(decomp, num_groups, counter);
+}
+
+
+// kernels visit their partitions with
+//
+//   for(size_type i = first_partition(g, decomp); i < decomp.size(); i = next_partition(g, decomp, i))
+//
+// static decompositions assign partition g.index() to group g
+template<typename ConcurrentGroup, typename Decomposition>
+__device__
+typename Decomposition::size_type first_partition(ConcurrentGroup &g, const Decomposition &)
+{
+  return g.index();
+}
+
+
+template<typename ConcurrentGroup, typename Decomposition>
+__device__
+typename Decomposition::size_type next_partition(ConcurrentGroup &, const Decomposition &decomp, typename Decomposition::size_type)
+{
+  return decomp.size();
+}
+
+
+template<typename ConcurrentGroup, typename Decomposition>
+__device__
+typename Decomposition::size_type first_partition(ConcurrentGroup &g, const dynamic_decomposition<Decomposition> &decomp)
+{
+  return decomp.claim(g);
+}
+
+
+template<typename ConcurrentGroup, typename Decomposition>
+__device__
+typename Decomposition::size_type next_partition(ConcurrentGroup &g, const dynamic_decomposition<Decomposition> &decomp, typename Decomposition::size_type)
+{
+  return decomp.claim(g);
+}
+
+
+// the number of groups to launch for decomp
+template<typename Decomposition>
+__host__ __device__
+typename Decomposition::size_type num_groups_to_launch(const Decomposition &decomp)
+{
+  return decomp.size();
+}
+
+
+template<typename Decomposition>
+__host__ __device__
+typename Decomposition::size_type num_groups_to_launch(const dynamic_decomposition<Decomposition> &decomp)
+{
+  return decomp.num_groups();
+}
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,145 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/launch_info.hpp>
+#include <bulk/algorithm/histogram.hpp>
+#include <bulk/device/decomposition.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_histogram_detail
+{
+
+
+struct histogram_partitions
+{
+  template<typename ConcurrentGroup, typename RandomAccessIterator, typename Decomposition, typename BinFunction, typename Counter>
+  __device__
+  void operator()(ConcurrentGroup &this_group, RandomAccessIterator first, Decomposition decomp, int num_bins, BinFunction bin, Counter *result)
+  {
+    typename Decomposition::range rng = decomp[this_group.index()];
+
+    bulk::histogram(this_group, first + rng.first, first + rng.second, num_bins, bin, result);
+  }
+};
+
+
+} // end device_histogram_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// counts the number of elements of [first, last) which bin maps to each of [0, num_bins) into result,
+// which must point to num_bins Counters on the device. Samples which bin maps outside of [0, num_bins) are ignored.
+// Each group privatizes the bins on chip where they fit and merges them into result with atomics,
+// so the number of groups launched is limited to amortize the merges
+template<typename RandomAccessIterator, typename BinFunction, typename Counter>
+void histogram(RandomAccessIterator first, RandomAccessIterator last,
+               int num_bins,
+               BinFunction bin,
+               Counter *result,
+               cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator>::type size_type;
+
+  if(num_bins <= 0) return;
+
+  bulk::detail::throw_on_error(cudaMemsetAsync(result, 0, num_bins * sizeof(Counter), stream),
+                               "cudaMemsetAsync in bulk::device::histogram");
+
+  size_type n = last - first;
+
+  if(n == 0) return;
+
+  // XXX these sizes aren't tuned
+  const int groupsize = 256;
+  const int grainsize = 8;
+  const size_type tile_size = groupsize * grainsize;
+  const size_type subscription = 4;
+
+  typedef bulk::concurrent_group<bulk::agent<grainsize>,groupsize> group_type;
+
+  size_type num_tiles = (n + tile_size - 1) / tile_size;
+  size_type num_groups = thrust::min<size_type>(subscription * group_type::hardware_concurrency(), num_tiles);
+
+  bulk::device::aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
+
+  // ask for enough heap for a copy of the bins per warp, or at least one copy for the group.
+  // Beyond that, the bins are too many to privatize and the groups count straight into global memory
+  // the launcher opts the kernel in to more than sharedMemPerBlock where the device allows it,
+  // but the heap's 48-byte header & the kernel's static shared memory come out of the same budget
+  const bulk::detail::device_properties_t props = bulk::detail::device_properties();
+  const std::size_t max_smem_size = (props.major >= 7) ? bulk::detail::cuda_launch_config_detail::max_smem_per_block(props) : props.sharedMemPerBlock;
+  const std::size_t heap_header_size = 48;
+  const std::size_t static_smem_size =
+    bulk::launch_info(bulk::grid<groupsize,grainsize>(decomp.size(), 0),
+                      bulk::detail::device_histogram_detail::histogram_partitions(),
+                      bulk::root.this_exec,
+                      first, decomp, num_bins, bin, result).static_smem_bytes;
+  const std::size_t max_heap_size = (max_smem_size > heap_header_size + static_smem_size) ? max_smem_size - heap_header_size - static_smem_size : 0;
+  const std::size_t num_warps = groupsize / 32;
+  std::size_t bins_size = num_bins * sizeof(Counter);
+
+  std::size_t heap_size = 0;
+  if(num_warps * bins_size <= max_heap_size)
+  {
+    heap_size = num_warps * bins_size;
+  } // end if
+  else if(bins_size <= max_heap_size)
+  {
+    heap_size = bins_size;
+  } // end else if
+
+  bulk::async(bulk::named("bulk::device::histogram", bulk::grid<groupsize,grainsize>(decomp.size(), heap_size, stream)),
+              bulk::detail::device_histogram_detail::histogram_partitions(),
+              bulk::root.this_exec,
+              first, decomp, num_bins, bin, result);
+} // end histogram()
+
+
+// counts the number of elements of [first, last) which fall into each of num_bins equal-width bins spanning [lower, upper)
+template<typename RandomAccessIterator, typename T, typename Counter>
+void histogram_even(RandomAccessIterator first, RandomAccessIterator last,
+                    int num_bins,
+                    T lower, T upper,
+                    Counter *result,
+                    cudaStream_t stream = 0)
+{
+  bulk::device::histogram(first, last, num_bins, bulk::even_bins<T>(lower, upper, num_bins), result, stream);
+} // end histogram_even()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,155 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/load_balance.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/tabulate.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_load_balance_detail
+{
+
+
+template<typename RandomAccessIterator, typename Size>
+struct locate_load_balance_path
+{
+  RandomAccessIterator offsets_first;
+  Size num_segments;
+  Size num_items;
+  Size tile_size;
+
+  locate_load_balance_path(RandomAccessIterator offsets_first, Size num_segments, Size num_items, Size tile_size)
+    : offsets_first(offsets_first),
+      num_segments(num_segments),
+      num_items(num_items),
+      tile_size(tile_size)
+  {}
+
+  template<typename Index>
+  __host__ __device__
+  Size operator()(Index i)
+  {
+    Size diag = thrust::min<Size>(tile_size * i, num_items + num_segments);
+    return bulk::detail::load_balance_detail::load_balance_path(offsets_first, num_segments, num_items, diag);
+  }
+};
+
+
+struct load_balance_tiles
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename Size, typename Function>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator offsets_first,
+                  Size num_segments,
+                  Size num_items,
+                  const Size *merge_paths,
+                  Function f)
+  {
+    const Size tile_size = groupsize * grainsize;
+
+    Size diag_first = tile_size * g.index();
+    Size diag_last  = thrust::min<Size>(num_items + num_segments, diag_first + tile_size);
+
+    Size *stage = static_cast<Size*>(bulk::malloc(g, tile_size * sizeof(Size)));
+
+    bulk::detail::load_balance_detail::load_balance_tile(g, offsets_first,
+                                                         diag_first, diag_last,
+                                                         merge_paths[g.index()], merge_paths[g.index() + 1],
+                                                         stage,
+                                                         f);
+
+    bulk::free(g, stage);
+  }
+};
+
+
+} // end device_load_balance_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// for each of the num_items items distributed among num_segments segments, invokes
+// f(item, segment, rank), where rank is item's position within segment.
+// offsets_first[i] is the first item of segment i, and offsets_first[0] must be 0.
+// Each group receives an equal share of items & segment boundaries, so a few enormous
+// segments cost no more than many small ones
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator, typename Size, typename Function>
+void load_balanced_for_each(void *scratch, std::size_t &scratch_bytes,
+                            RandomAccessIterator offsets_first,
+                            Size num_segments,
+                            Size num_items,
+                            Function f,
+                            cudaStream_t stream = 0)
+{
+  // XXX these sizes aren't tuned
+  const int groupsize = 128;
+  const int grainsize = 7;
+
+  const Size tile_size = groupsize * grainsize;
+  Size num_tiles = (num_items + num_segments + tile_size - 1) / tile_size;
+
+  bulk::detail::scratch_partition partition(scratch);
+  Size *merge_paths = partition.allocate<Size>(num_tiles + 1);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::load_balanced_for_each") || num_items == 0) return;
+
+  thrust::tabulate(thrust::cuda::par.on(stream),
+                   merge_paths, merge_paths + num_tiles + 1,
+                   bulk::detail::device_load_balance_detail::locate_load_balance_path<RandomAccessIterator,Size>(offsets_first, num_segments, num_items, tile_size));
+
+  bulk::async(bulk::named("bulk::device::load_balanced_for_each", bulk::grid<groupsize,grainsize>(num_tiles, tile_size * sizeof(Size), stream)),
+              bulk::detail::device_load_balance_detail::load_balance_tiles(),
+              bulk::root.this_exec, offsets_first, num_segments, num_items, merge_paths, f);
+} // end load_balanced_for_each()
+
+
+template<typename RandomAccessIterator, typename Size, typename Function>
+void load_balanced_for_each(RandomAccessIterator offsets_first,
+                            Size num_segments,
+                            Size num_items,
+                            Function f)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::load_balanced_for_each(0, scratch_bytes, offsets_first, num_segments, num_items, f);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::load_balanced_for_each(scratch.data(), scratch_bytes, offsets_first, num_segments, num_items, f);
+} // end load_balanced_for_each()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,206 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/tabulate.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_merge_detail
+{
+
+
+// each group merges the tile of the output between two consecutive merge paths
+// the tile's offsets require Size's width, but its sizes fit in an int
+struct merge_tiles
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename RandomAccessIterator3, typename RandomAccessIterator4, typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 first1, Size n1,
+                  RandomAccessIterator2 first2, Size n2,
+                  RandomAccessIterator3 merge_paths_first,
+                  RandomAccessIterator4 result,
+                  Compare comp)
+  {
+    typedef int size_type;
+
+    size_type elements_per_group = g.size() * g.this_exec.grainsize();
+
+    // determine the ranges to merge
+    Size mp0  = merge_paths_first[g.index()];
+    Size mp1  = merge_paths_first[g.index()+1];
+    Size diag = static_cast<Size>(elements_per_group) * g.index();
+
+    size_type local_size1 = mp1 - mp0;
+    size_type local_size2 = thrust::min<Size>(n1 + n2, diag + elements_per_group) - mp1 - diag + mp0;
+
+    first1 += mp0;
+    first2 += diag - mp0;
+    result += diag;
+
+    typedef typename thrust::iterator_value<RandomAccessIterator4>::type value_type;
+
+#if __CUDA_ARCH__ >= 200
+    // merge through a stage
+    value_type *stage = reinterpret_cast<value_type*>(bulk::malloc(g, bulk::exchange_buffer_size<groupsize * grainsize>::value * sizeof(value_type)));
+
+    if(bulk::is_on_chip(stage))
+    {
+      bulk::detail::merge_detail::bounded_merge_with_buffer(g,
+                                                            first1, first1 + local_size1,
+                                                            first2, first2 + local_size2,
+                                                            bulk::on_chip_cast(stage),
+                                                            result,
+                                                            comp);
+    } // end if
+    else
+    {
+      bulk::detail::merge_detail::bounded_merge_with_buffer(g,
+                                                            first1, first1 + local_size1,
+                                                            first2, first2 + local_size2,
+                                                            stage,
+                                                            result,
+                                                            comp);
+    } // end else
+
+    bulk::free(g, stage);
+#else
+    __shared__ bulk::uninitialized_array<value_type, bulk::exchange_buffer_size<groupsize * grainsize>::value> stage;
+    bulk::detail::merge_detail::bounded_merge_with_buffer(g, first1, first1 + local_size1, first2, first2 + local_size2, stage.data(), result, comp);
+#endif
+  } // end operator()
+}; // end merge_tiles
+
+
+template<typename Size, typename RandomAccessIterator1,typename RandomAccessIterator2, typename Compare>
+struct locate_merge_path
+{
+  Size partition_size;
+  RandomAccessIterator1 first1, last1;
+  RandomAccessIterator2 first2, last2;
+  Compare comp;
+
+  locate_merge_path(Size partition_size, RandomAccessIterator1 first1, RandomAccessIterator1 last1, RandomAccessIterator2 first2, RandomAccessIterator2 last2, Compare comp)
+    : partition_size(partition_size),
+      first1(first1), last1(last1),
+      first2(first2), last2(last2),
+      comp(comp)
+  {}
+
+  template<typename Index>
+  __device__
+  Size operator()(Index i)
+  {
+    Size n1 = last1 - first1;
+    Size n2 = last2 - first2;
+    Size diag = thrust::min<Size>(partition_size * i, n1 + n2);
+    return bulk::merge_path(first1, n1, first2, n2, diag, comp);
+  }
+};
+
+
+} // end device_merge_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// merges the sorted ranges [first1, last1) & [first2, last2) into result
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 merge(void *scratch, std::size_t &scratch_bytes,
+                            RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                            RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                            RandomAccessIterator3 result,
+                            Compare comp,
+                            cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type difference_type;
+  typedef int size_type;
+
+  // 90/86/97
+  const size_type groupsize = (sizeof(value_type) == sizeof(int)) ? 256 : 256 + 32;
+  const size_type grainsize = (sizeof(value_type) == sizeof(int)) ? 9   : 5;
+
+  const size_type tile_size = groupsize * grainsize;
+
+  difference_type n = (last1 - first1) + (last2 - first2);
+  size_type num_groups = (n + tile_size - 1) / tile_size;
+
+  // merge paths are positions in the input, so they may exceed an int
+  bulk::detail::scratch_partition partition(scratch);
+  difference_type *merge_paths = partition.allocate<difference_type>(num_groups + 1);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::merge") || n == 0) return result;
+
+  thrust::tabulate(thrust::cuda::par.on(stream),
+                   merge_paths, merge_paths + num_groups + 1,
+                   bulk::detail::device_merge_detail::locate_merge_path<difference_type,RandomAccessIterator1,RandomAccessIterator2,Compare>(tile_size,first1,last1,first2,last2,comp));
+
+  // merge partitions
+  // the stage is padded for bank-conflict-free exchange
+  size_type heap_size = bulk::exchange_buffer_size<tile_size>::value * sizeof(value_type);
+  bulk::async(bulk::named("bulk::device::merge", bulk::grid<groupsize,grainsize>(num_groups, heap_size, stream)),
+              bulk::detail::device_merge_detail::merge_tiles(),
+              bulk::root.this_exec, first1, last1 - first1, first2, last2 - first2, merge_paths, result, comp);
+
+  return result + n;
+} // end merge()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 merge(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                            RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                            RandomAccessIterator3 result,
+                            Compare comp)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::merge(0, scratch_bytes, first1, last1, first2, last2, result, comp);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  return bulk::device::merge(scratch.data(), scratch_bytes, first1, last1, first2, last2, result, comp);
+} // end merge()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
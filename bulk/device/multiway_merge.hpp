@@ -0,0 +1,384 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/multiway_merge.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/function.h>
+#include <thrust/tabulate.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_multiway_merge_detail
+{
+
+
+// each merge of a merge sort's pass combines num_runs consecutive runs of run_size elements
+template<typename Size>
+struct uniform_runs
+{
+  Size n;
+  Size run_size;
+  int  num_runs;
+
+  __host__ __device__
+  uniform_runs(Size n, Size run_size, int num_runs)
+    : n(n), run_size(run_size), num_runs(num_runs)
+  {}
+
+  // returns the merge producing the i'th element of the output
+  __host__ __device__
+  Size merge_of(Size i) const
+  {
+    return i / run_size / num_runs;
+  }
+
+  __host__ __device__
+  Size run_begin(Size merge, int run) const
+  {
+    Size total_num_runs = (n + run_size - 1) / run_size;
+    Size global_run = merge * num_runs + run;
+
+    // avoid overflowing Size past the last run
+    return global_run < total_num_runs ? global_run * run_size : n;
+  }
+};
+
+
+// a single merge of the num_runs runs delimited by offsets
+template<typename RandomAccessIterator, typename Size>
+struct given_runs
+{
+  RandomAccessIterator offsets;
+  int                  num_runs;
+
+  __host__ __device__
+  given_runs(RandomAccessIterator offsets, int num_runs)
+    : offsets(offsets), num_runs(num_runs)
+  {}
+
+  __host__ __device__
+  Size merge_of(Size) const
+  {
+    return 0;
+  }
+
+  __host__ __device__
+  Size run_begin(Size, int run) const
+  {
+    return offsets[run];
+  }
+};
+
+
+// presents the runs of one merge as the run_offsets multiway_merge_path expects
+template<typename Runs, typename Size>
+struct run_offsets_of
+{
+  Runs runs;
+  Size merge;
+
+  __host__ __device__
+  run_offsets_of(Runs runs, Size merge)
+    : runs(runs), merge(merge)
+  {}
+
+  __host__ __device__
+  Size operator[](int run) const
+  {
+    return runs.run_begin(merge, run);
+  }
+};
+
+
+// for tile t & run r, finds the number of elements of r which precede t's output in its merge
+template<typename Iterator, typename Size, typename Runs, typename Compare>
+struct locate_multiway_merge_path
+{
+  Iterator keys_first;
+  Size tile_size;
+  Runs runs;
+  thrust::detail::wrapped_function<Compare,bool> comp;
+
+  locate_multiway_merge_path(Iterator keys_first, Size tile_size, Runs runs, Compare comp)
+    : keys_first(keys_first),
+      tile_size(tile_size),
+      runs(runs),
+      comp(comp)
+  {}
+
+  template<typename Index>
+  __host__ __device__
+  Index operator()(Index path_idx)
+  {
+    Size tile = path_idx / runs.num_runs;
+    int  run  = path_idx % runs.num_runs;
+
+    Size merge = runs.merge_of(tile * tile_size);
+
+    // note that diag is computed as an offset from the beginning of the merge
+    Size diag = tile * tile_size - runs.run_begin(merge, 0);
+
+    return bulk::multiway_merge_path(keys_first, run_offsets_of<Runs,Size>(runs, merge), runs.num_runs, run, diag, comp);
+  }
+};
+
+
+// each group gathers the slice of every run its tile of the output requires on chip,
+// and then merges the slices in place
+// positions in the input require Size's width, but positions within the tile fit in an int
+struct merge_tiles_by_key
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename RandomAccessIterator2,
+           typename Size,
+           typename Runs,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 keys_first,
+                  RandomAccessIterator2 values_first,
+                  Size n,
+                  Runs runs,
+                  const Size *paths,
+                  RandomAccessIterator3 keys_result,
+                  RandomAccessIterator4 values_result,
+                  Compare comp)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+    const int tile_size = groupsize * grainsize;
+    const int num_runs = runs.num_runs;
+
+    Size num_tiles  = (n + tile_size - 1) / tile_size;
+    Size tile       = g.index();
+    Size tile_begin = tile * tile_size;
+    Size merge      = runs.merge_of(tile_begin);
+
+    // the last tile of each merge doesn't have a successor in the same coordinate system
+    bool last_tile_in_merge = (tile + 1 == num_tiles) || (runs.merge_of(tile_begin + tile_size) != merge);
+
+    key_type   *stage_keys    = 0;
+    value_type *stage_values  = 0;
+    Size       *slice_firsts  = 0;
+    int        *slice_offsets = 0;
+    bulk::malloc_all(g, stage_keys, tile_size, stage_values, tile_size, slice_firsts, num_runs, slice_offsets, num_runs + 1);
+
+    for(int run = g.this_exec.index(); run < num_runs; run += g.size())
+    {
+      Size run_begin = runs.run_begin(merge, run);
+
+      Size slice_first = run_begin + paths[tile * num_runs + run];
+      Size slice_last  = last_tile_in_merge ? runs.run_begin(merge, run + 1) : run_begin + paths[(tile + 1) * num_runs + run];
+
+      slice_firsts[run] = slice_first;
+      slice_offsets[run + 1] = slice_last - slice_first;
+    } // end for run
+    g.wait();
+
+    if(g.this_exec.index() == 0)
+    {
+      slice_offsets[0] = 0;
+
+      for(int run = 0; run < num_runs; ++run)
+      {
+        slice_offsets[run + 1] += slice_offsets[run];
+      } // end for run
+    } // end if
+    g.wait();
+
+    int num_elements = slice_offsets[num_runs];
+
+    // concatenate the slices on chip
+    for(int i = g.this_exec.index(); i < num_elements; i += g.size())
+    {
+      int run = bulk::detail::multiway_merge_detail::find_run(slice_offsets, num_runs, i);
+
+      Size j = slice_firsts[run] + (i - slice_offsets[run]);
+
+      stage_keys[i]   = keys_first[j];
+      stage_values[i] = values_first[j];
+    } // end for i
+    g.wait();
+
+    bulk::multiway_merge_by_key(bulk::bound<groupsize * grainsize>(g),
+                                stage_keys, slice_offsets, num_runs,
+                                stage_values,
+                                stage_keys, stage_values,
+                                comp);
+
+    bulk::copy_n(g, stage_keys,   num_elements, keys_result   + tile_begin);
+    bulk::copy_n(g, stage_values, num_elements, values_result + tile_begin);
+
+    bulk::free_all(g, stage_keys, stage_values, slice_firsts, slice_offsets);
+  }
+};
+
+
+const int merge_groupsize = 128;
+const int merge_grainsize = 7;
+
+
+// returns the number of paths a pass over n elements requires
+template<typename Size>
+Size num_paths(Size n, int num_runs)
+{
+  const Size tile_size = merge_groupsize * merge_grainsize;
+
+  return num_runs * ((n + tile_size - 1) / tile_size);
+}
+
+
+// performs every merge of runs over [keys_first, keys_first + n) in a single pass
+// paths must hold num_paths(n, runs.num_runs) elements
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Size,
+         typename Runs,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename Compare>
+void merge_runs_by_key(const char *name,
+                       cudaStream_t stream,
+                       RandomAccessIterator1 keys_first,
+                       RandomAccessIterator2 values_first,
+                       Size n,
+                       Runs runs,
+                       Size *paths,
+                       RandomAccessIterator3 keys_result,
+                       RandomAccessIterator4 values_result,
+                       Compare comp)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  const Size tile_size = merge_groupsize * merge_grainsize;
+  Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  locate_multiway_merge_path<RandomAccessIterator1,Size,Runs,Compare> f(keys_first, tile_size, runs, comp);
+  thrust::tabulate(thrust::cuda::par.on(stream), paths, paths + num_paths(n, runs.num_runs), f);
+
+  // the stage, the slices' bookkeeping, and some room for the heap's own
+  Size heap_size = tile_size * (sizeof(key_type) + sizeof(value_type)) + runs.num_runs * sizeof(Size) + (runs.num_runs + 1) * sizeof(int) + 4 * 64;
+
+  bulk::async(bulk::named(name, bulk::grid<merge_groupsize,merge_grainsize>(num_tiles, heap_size, stream)),
+              merge_tiles_by_key(),
+              bulk::root.this_exec,
+              keys_first, values_first, n,
+              runs,
+              paths,
+              keys_result, values_result,
+              comp);
+}
+
+
+} // end device_multiway_merge_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// stably merges the num_runs consecutive sorted runs of [keys_first, keys_last) in a single pass over the input,
+// permuting values_first alike. Run q is [keys_first + run_offsets_first[q], keys_first + run_offsets_first[q + 1]),
+// where run_offsets_first[0] is 0 & run_offsets_first[num_runs] is keys_last - keys_first.
+// Equivalent keys of earlier runs precede those of later runs.
+// The results must not overlap the inputs
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+// XXX partitioning the runs costs O(num_runs^2) per tile, so this suits at most a few dozen runs
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename Compare>
+void multiway_merge_by_key(void *scratch, std::size_t &scratch_bytes,
+                           RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                           RandomAccessIterator2 run_offsets_first,
+                           int num_runs,
+                           RandomAccessIterator3 values_first,
+                           RandomAccessIterator4 keys_result,
+                           RandomAccessIterator5 values_result,
+                           Compare comp,
+                           cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  namespace ns = bulk::detail::device_multiway_merge_detail;
+
+  size_type n = keys_last - keys_first;
+
+  bulk::detail::scratch_partition partition(scratch);
+  size_type *paths = partition.allocate<size_type>(num_runs > 0 ? ns::num_paths(n, num_runs) : 0);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::multiway_merge_by_key") || n <= 0) return;
+
+  ns::merge_runs_by_key("bulk::device::multiway_merge_by_key",
+                        stream,
+                        keys_first, values_first, n,
+                        ns::given_runs<RandomAccessIterator2,size_type>(run_offsets_first, num_runs),
+                        paths,
+                        keys_result, values_result,
+                        comp);
+} // end multiway_merge_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename Compare>
+void multiway_merge_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                           RandomAccessIterator2 run_offsets_first,
+                           int num_runs,
+                           RandomAccessIterator3 values_first,
+                           RandomAccessIterator4 keys_result,
+                           RandomAccessIterator5 values_result,
+                           Compare comp)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::multiway_merge_by_key(0, scratch_bytes, keys_first, keys_last, run_offsets_first, num_runs, values_first, keys_result, values_result, comp);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::multiway_merge_by_key(scratch.data(), scratch_bytes, keys_first, keys_last, run_offsets_first, num_runs, values_first, keys_result, values_result, comp);
+} // end multiway_merge_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
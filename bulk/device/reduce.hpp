@@ -0,0 +1,210 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/future.hpp>
+#include <bulk/algorithm/reduce.hpp>
+#include <bulk/device/decomposition.hpp>
+#include <bulk/device/reduce_intervals.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_reduce_detail
+{
+
+
+// the shape of the launch which reduces the input to partial sums
+const int partials_groupsize = 128;
+const int partials_grainsize = 7;
+
+
+// the number of partial sums reduce produces for n elements
+template<typename Size>
+Size num_partials(Size n)
+{
+  typedef bulk::concurrent_group<bulk::agent<partials_grainsize>,partials_groupsize> group_type;
+
+  const Size tile_size = partials_groupsize * partials_grainsize;
+  const Size subscription = 10;
+
+  Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  return thrust::min<Size>(subscription * group_type::hardware_concurrency(), num_tiles);
+} // end num_partials()
+
+
+struct reduce_partials
+{
+  template<typename ConcurrentGroup, typename T, typename Size, typename BinaryFunction, typename Result>
+  __device__
+  void operator()(ConcurrentGroup &g, const T *partials, Size n, T init, BinaryFunction binary_op, Result *result)
+  {
+    T sum = bulk::reduce(g, partials, partials + n, init, binary_op);
+
+    if(g.this_exec.index() == 0)
+    {
+      *result = sum;
+    } // end if
+  }
+};
+
+
+// reduces partials[0,n) with init into *result with a single group
+// the sum converts to *result's type only once it is complete
+template<typename T, typename Size, typename BinaryFunction, typename Result>
+bulk::future<void> reduce_partials_with_one_group(const char *name, const T *partials, Size n, T init, BinaryFunction binary_op, Result *result, cudaStream_t stream)
+{
+  typedef bulk::concurrent_group<bulk::agent<1>,256> group_type;
+
+  return bulk::async(bulk::named(name, bulk::async_launch<group_type>(bulk::con<256,1>(256 * sizeof(T)), stream)),
+                     reduce_partials(), bulk::root,
+                     partials, n, init, binary_op, result);
+} // end reduce_partials_with_one_group()
+
+
+// reduces each of decomp's partitions of first into partials with reduce_intervals_kernel
+template<typename RandomAccessIterator, typename Size, typename T, typename BinaryFunction>
+void reduce_to_partials(const char *name, RandomAccessIterator first, bulk::device::aligned_decomposition<Size> decomp, T *partials, BinaryFunction binary_op, cudaStream_t stream)
+{
+  const int groupsize = partials_groupsize;
+  const int grainsize = partials_grainsize;
+
+  bulk::async(bulk::named(name, bulk::grid<groupsize,grainsize>(decomp.size(), groupsize * sizeof(T), stream)),
+              bulk::detail::device_reduce_intervals_detail::reduce_intervals_kernel(),
+              bulk::root.this_exec,
+              first,
+              decomp,
+              partials,
+              binary_op);
+} // end reduce_to_partials()
+
+
+template<typename RandomAccessIterator, typename Size, typename Result, typename T, typename BinaryFunction>
+bulk::future<void> reduce_n(void *scratch, std::size_t &scratch_bytes,
+                            const char *name,
+                            RandomAccessIterator first, Size n,
+                            Result *result,
+                            T init,
+                            BinaryFunction binary_op,
+                            cudaStream_t stream)
+{
+  Size num_groups = num_partials(n);
+
+  const Size tile_size = partials_groupsize * partials_grainsize;
+
+  bulk::detail::scratch_partition partition(scratch);
+  T *partials = partition.allocate<T>(num_groups);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, name)) return bulk::future<void>();
+
+  // an empty input reduces no partials, leaving init
+  if(n == 0) return reduce_partials_with_one_group(name, partials, Size(0), init, binary_op, result, stream);
+
+  bulk::device::aligned_decomposition<Size> decomp(n, num_groups, tile_size);
+
+  reduce_to_partials(name, first, decomp, partials, binary_op, stream);
+
+  return reduce_partials_with_one_group(name, partials, decomp.size(), init, binary_op, result, stream);
+} // end reduce_n()
+
+
+} // end device_reduce_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// *result = init + first[0] + ... + first[n-1]
+// result points to device memory; the result is a future which becomes ready once *result is written
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+// the sum accumulates in init's type, which may differ from *result's:
+// e.g. reduce floats with a double init, or with a bulk::compensated<float> init & bulk::compensated_plus<float>,
+// into a float *result
+template<typename RandomAccessIterator, typename Result, typename T, typename BinaryFunction>
+bulk::future<void> reduce(void *scratch, std::size_t &scratch_bytes,
+                          RandomAccessIterator first, RandomAccessIterator last,
+                          Result *result,
+                          T init,
+                          BinaryFunction binary_op,
+                          cudaStream_t stream = 0)
+{
+  return bulk::detail::device_reduce_detail::reduce_n(scratch, scratch_bytes, "bulk::device::reduce", first, last - first, result, init, binary_op, stream);
+} // end reduce()
+
+
+template<typename RandomAccessIterator, typename T, typename BinaryFunction>
+T reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryFunction binary_op)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::reduce(0, scratch_bytes, first, last, (T*)0, init, binary_op);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::detail::cached_array<T> result(1);
+
+  bulk::future<void> done = bulk::device::reduce(scratch.data(), scratch_bytes, first, last, result.data(), init, binary_op);
+
+  return bulk::async_get(done, result.data()).get();
+} // end reduce()
+
+
+// *result = init + unary_op(first[0]) + ... + unary_op(first[n-1])
+// unary_op applies as each element is loaded, so no transformed intermediate is stored
+template<typename RandomAccessIterator, typename Result, typename UnaryFunction, typename T, typename BinaryFunction>
+bulk::future<void> transform_reduce(void *scratch, std::size_t &scratch_bytes,
+                                    RandomAccessIterator first, RandomAccessIterator last,
+                                    Result *result,
+                                    UnaryFunction unary_op,
+                                    T init,
+                                    BinaryFunction binary_op,
+                                    cudaStream_t stream = 0)
+{
+  return bulk::device::reduce(scratch, scratch_bytes,
+                              thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op),
+                              result, init, binary_op,
+                              stream);
+} // end transform_reduce()
+
+
+template<typename RandomAccessIterator, typename UnaryFunction, typename T, typename BinaryFunction>
+T transform_reduce(RandomAccessIterator first, RandomAccessIterator last,
+                   UnaryFunction unary_op,
+                   T init,
+                   BinaryFunction binary_op)
+{
+  return bulk::device::reduce(thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op), init, binary_op);
+} // end transform_reduce()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
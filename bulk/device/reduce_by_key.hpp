@@ -0,0 +1,504 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/future.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/reduce_by_key.hpp>
+#include <bulk/detail/decoupled_look_back.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <thrust/iterator/counting_iterator.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+#include <thrust/tuple.h>
+#include <thrust/pair.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_reduce_by_key_detail
+{
+
+
+// the state of the segmented reduction at the end of some prefix of the input
+template<typename Size, typename Key, typename Value>
+struct segment_prefix
+{
+  // the number of segments begun in the prefix
+  Size  num_segments;
+
+  // the prefix's last key
+  Key   key;
+
+  // the reduction of the prefix's last segment so far
+  Value value;
+
+  __host__ __device__
+  segment_prefix() {}
+
+  __host__ __device__
+  segment_prefix(Size num_segments, const Key &key, const Value &value)
+    : num_segments(num_segments), key(key), value(value)
+  {}
+};
+
+
+// combines a prefix with the prefix which follows it
+// this is associative but not commutative
+template<typename Prefix, typename BinaryFunction>
+struct combine_segment_prefixes
+{
+  typedef Prefix result_type;
+  typedef Prefix first_argument_type;
+  typedef Prefix second_argument_type;
+
+  BinaryFunction binary_op;
+
+  __host__ __device__
+  combine_segment_prefixes(BinaryFunction binary_op)
+    : binary_op(binary_op)
+  {}
+
+  __host__ __device__
+  Prefix operator()(const Prefix &a, const Prefix &b)
+  {
+    // if b begins no segment, it continues a's last segment
+    return Prefix(a.num_segments + b.num_segments,
+                  b.key,
+                  b.num_segments ? b.value : binary_op(a.value, b.value));
+  }
+};
+
+
+// maps the index of an element of a tile to the one-element prefix containing it
+template<typename Prefix, typename Key, typename Value, typename BinaryPredicate>
+struct make_segment_prefix
+{
+  typedef Prefix result_type;
+
+  const Key   *keys;
+  const Value *values;
+
+  // the key just before the tile, if there is one
+  Key          predecessor_key;
+  bool         has_predecessor;
+
+  mutable BinaryPredicate pred;
+
+  __host__ __device__
+  make_segment_prefix(const Key *keys, const Value *values, const Key &predecessor_key, bool has_predecessor, BinaryPredicate pred)
+    : keys(keys), values(values), predecessor_key(predecessor_key), has_predecessor(has_predecessor), pred(pred)
+  {}
+
+  template<typename Size>
+  __host__ __device__
+  Prefix operator()(Size i) const
+  {
+    // each element not equivalent to its predecessor begins a segment
+    bool is_head = (i == 0) ?
+      (!has_predecessor || !pred(predecessor_key, keys[0])) :
+      !pred(keys[i-1], keys[i]);
+
+    return Prefix(is_head ? 1 : 0, keys[i], values[i]);
+  }
+};
+
+
+// when reduce_by_key processes its input in chunks, the segment at the end of one chunk may continue into the next
+template<typename Size, typename Prefix>
+struct chunk_state
+{
+  // receives the number of segments output
+  Size         *result_size;
+
+  // when not null, the segment the previous chunk left unfinished
+  const Prefix *carry_in;
+
+  // when not null, receives the last segment rather than outputting it
+  Prefix       *carry_out;
+
+  __host__ __device__
+  chunk_state(Size *result_size, const Prefix *carry_in, Prefix *carry_out)
+    : result_size(result_size), carry_in(carry_in), carry_out(carry_out)
+  {}
+};
+
+
+// reduces each segment of equivalent keys in a single pass using decoupled look-back:
+// each group stages its tile on chip and publishes the tile's segment count & trailing partial reduction.
+// After looking back through its predecessors' statuses, a group knows where its output begins and
+// which carry flows into its tile, so block-level reduce_by_key can finish the tile without a fixup pass
+struct reduce_tiles_by_key
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename Prefix,
+           typename BinaryPredicate,
+           typename BinaryFunction>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &this_group,
+                  RandomAccessIterator1 keys_first,
+                  Size n,
+                  RandomAccessIterator2 values_first,
+                  RandomAccessIterator3 keys_result,
+                  RandomAccessIterator4 values_result,
+                  bulk::detail::tile_status<Prefix> *status,
+                  unsigned int *tile_counter,
+                  chunk_state<Size,Prefix> chunk,
+                  thrust::tuple<BinaryPredicate,BinaryFunction> pred_and_binary_op)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator4>::type value_type;
+
+    BinaryPredicate pred = thrust::get<0>(pred_and_binary_op);
+    combine_segment_prefixes<Prefix,BinaryFunction> combine(thrust::get<1>(pred_and_binary_op));
+
+    // offsets into the input require Size's width, but positions within the tile fit in an int
+    const int tile_size = groupsize * grainsize;
+
+    // claim tiles in the order groups begin executing rather than by this_group.index(),
+    // which guarantees that every tile we wait on belongs to a group which is already running
+    __shared__ unsigned int s_tile;
+    __shared__ bulk::uninitialized<Prefix> s_prefix;
+
+    if(this_group.this_exec.index() == 0)
+    {
+      s_tile = atomicAdd(tile_counter, 1);
+    }
+    this_group.wait();
+
+    unsigned int tile = s_tile;
+
+    Size tile_begin = static_cast<Size>(tile) * tile_size;
+    Size tile_end   = thrust::min<Size>(n, tile_begin + tile_size);
+    int num_elements = tile_end - tile_begin;
+
+    // stage the tile on chip so we only read it from memory once
+    key_type   *stage_keys = 0;
+    value_type *stage_values = 0;
+    bulk::malloc_all(this_group, stage_keys, tile_size, stage_values, tile_size);
+
+    bulk::copy_n(this_group, keys_first + tile_begin, num_elements, stage_keys);
+    bulk::copy_n(this_group, values_first + tile_begin, num_elements, stage_values);
+    this_group.wait();
+
+    // the first tile of a chunk continues the segment carried in, if there is one
+    bool has_predecessor = tile > 0 || chunk.carry_in;
+    key_type predecessor_key = tile > 0 ? keys_first[tile_begin - 1] : chunk.carry_in ? chunk.carry_in->key : stage_keys[0];
+
+    thrust::transform_iterator<
+      make_segment_prefix<Prefix,key_type,value_type,BinaryPredicate>,
+      thrust::counting_iterator<int>
+    > prefixes(thrust::counting_iterator<int>(0),
+               make_segment_prefix<Prefix,key_type,value_type,BinaryPredicate>(stage_keys, stage_values, predecessor_key, has_predecessor, pred));
+
+    Prefix aggregate = bulk::accumulate(this_group, prefixes + 1, prefixes + num_elements, prefixes[0], combine);
+
+    if(this_group.this_exec.index() == 0)
+    {
+      if(tile == 0 && chunk.carry_in)
+      {
+        // the carried segment is output first
+        Prefix exclusive_prefix(1, chunk.carry_in->key, chunk.carry_in->value);
+
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Prefix>::prefix_ready, combine(exclusive_prefix, aggregate));
+
+        s_prefix = exclusive_prefix;
+      }
+      else if(tile == 0)
+      {
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Prefix>::prefix_ready, aggregate);
+
+        // the first element is the carry into the rest of the tile
+        s_prefix = Prefix(1, stage_keys[0], stage_values[0]);
+      }
+      else
+      {
+        // let our successors make progress while we look back
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Prefix>::aggregate_ready, aggregate);
+
+        Prefix exclusive_prefix = bulk::detail::look_back(status, tile, combine);
+
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Prefix>::prefix_ready, combine(exclusive_prefix, aggregate));
+
+        s_prefix = exclusive_prefix;
+      }
+    }
+    this_group.wait();
+
+    Prefix carry = s_prefix;
+
+    // the carry's segment is output first, unless it continues past the end of the tile
+    Size output_first = carry.num_segments - 1;
+    int  input_first  = (tile == 0 && !chunk.carry_in) ? 1 : 0;
+
+    RandomAccessIterator3 keys_last;
+    RandomAccessIterator4 values_last;
+    key_type   last_key;
+    value_type last_value;
+
+    thrust::tie(keys_last, values_last, last_key, last_value) =
+      bulk::reduce_by_key(this_group,
+                          stage_keys + input_first,
+                          stage_keys + num_elements,
+                          stage_values + input_first,
+                          keys_result + output_first,
+                          values_result + output_first,
+                          carry.key,
+                          carry.value,
+                          pred,
+                          combine.binary_op);
+
+    // the last tile also outputs the last segment, unless the next chunk continues it
+    if(tile_end == n && this_group.this_exec.index() == 0)
+    {
+      if(chunk.carry_out)
+      {
+        *chunk.carry_out = Prefix(1, last_key, last_value);
+
+        *chunk.result_size = keys_last - keys_result;
+      }
+      else
+      {
+        *keys_last   = last_key;
+        *values_last = last_value;
+
+        *chunk.result_size = (keys_last - keys_result) + 1;
+      }
+    }
+
+    bulk::free_all(this_group, stage_keys, stage_values);
+  }
+};
+
+
+// the prefix type reduce_tiles_by_key publishes for the given keys & values results
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+struct segment_prefix_for
+{
+  // XXX the value should be the result of BinaryFunction
+  typedef segment_prefix<
+    typename thrust::iterator_difference<RandomAccessIterator1>::type,
+    typename thrust::iterator_value<RandomAccessIterator1>::type,
+    typename thrust::iterator_value<RandomAccessIterator2>::type
+  > type;
+};
+
+
+// launches reduce_tiles_by_key over one chunk of n elements, writing the number of segments output to *chunk.result_size
+// the scratch space required depends only on n
+template<typename RandomAccessIterator1,
+         typename Size,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename Prefix,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+bulk::future<void> reduce_by_key_n(void *scratch, std::size_t &scratch_bytes,
+                                   RandomAccessIterator1 keys_first, Size n,
+                                   RandomAccessIterator2 values_first,
+                                   RandomAccessIterator3 keys_result,
+                                   RandomAccessIterator4 values_result,
+                                   chunk_state<Size,Prefix> chunk,
+                                   BinaryPredicate pred,
+                                   BinaryFunction binary_op,
+                                   cudaStream_t stream)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator4>::type intermediate_type;
+
+  // XXX these sizes aren't tuned
+  const int groupsize = 128;
+  const int grainsize = (sizeof(key_type) + sizeof(intermediate_type) <= 2 * sizeof(int)) ? 5 : 3;
+
+  typedef bulk::concurrent_group<bulk::agent<grainsize>,groupsize> group_type;
+
+  const Size tile_size = groupsize * grainsize;
+  Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  bulk::detail::scratch_partition partition(scratch);
+  bulk::detail::tile_status<Prefix> *status = partition.allocate<bulk::detail::tile_status<Prefix> >(num_tiles);
+  unsigned int *tile_counter                = partition.allocate<unsigned int>(1);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::reduce_by_key") || n == 0)
+  {
+    return bulk::future<void>();
+  } // end if
+
+  // every tile begins not_ready, and tiles are claimed starting from 0
+  bulk::detail::throw_on_error(cudaMemsetAsync(status, 0, num_tiles * sizeof(bulk::detail::tile_status<Prefix>), stream),
+                               "cudaMemsetAsync in bulk::device::reduce_by_key");
+  bulk::detail::throw_on_error(cudaMemsetAsync(tile_counter, 0, sizeof(unsigned int), stream),
+                               "cudaMemsetAsync in bulk::device::reduce_by_key");
+
+  // the stage lives on the heap alongside reduce_by_key's buffers
+  // accumulate's buffer is sized statically, so it doesn't come from the heap
+  Size stage_size         = tile_size * (sizeof(key_type) + sizeof(intermediate_type));
+  Size reduce_by_key_size = tile_size * (sizeof(typename group_type::size_type) + sizeof(intermediate_type));
+  Size heap_size          = stage_size + reduce_by_key_size;
+
+  return bulk::async(bulk::named("bulk::device::reduce_by_key", bulk::grid<groupsize,grainsize>(num_tiles, heap_size, stream)),
+                     reduce_tiles_by_key(),
+                     bulk::root.this_exec,
+                     keys_first, n, values_first,
+                     keys_result, values_result,
+                     status,
+                     tile_counter,
+                     chunk,
+                     thrust::make_tuple(pred, binary_op));
+} // end reduce_by_key_n()
+
+
+} // end device_reduce_by_key_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// for each run of consecutive keys equivalent under pred, outputs the run's last key and the
+// reduction of its values with binary_op. Returns the ends of the two output ranges
+// the entire input is read once in a single launch, and no intermediate results touch memory
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+// XXX this waits for the number of runs to arrive on the host
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(void *scratch, std::size_t &scratch_bytes,
+                RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred,
+                BinaryFunction binary_op,
+                cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  namespace ns = bulk::detail::device_reduce_by_key_detail;
+
+  typedef typename ns::segment_prefix_for<RandomAccessIterator1,RandomAccessIterator4>::type prefix_type;
+
+  size_type n = keys_last - keys_first;
+
+  bulk::detail::scratch_partition partition(scratch);
+  size_type *result_size = partition.allocate<size_type>(1);
+
+  std::size_t chunk_scratch_bytes = 0;
+  ns::reduce_by_key_n(0, chunk_scratch_bytes, keys_first, n, values_first, keys_result, values_result,
+                      ns::chunk_state<size_type,prefix_type>(0, 0, 0), pred, binary_op, stream);
+  char *chunk_scratch = partition.allocate<char>(chunk_scratch_bytes);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::reduce_by_key") || n == 0)
+  {
+    return thrust::make_pair(keys_result, values_result);
+  } // end if
+
+  bulk::future<void> done =
+    ns::reduce_by_key_n(chunk_scratch, chunk_scratch_bytes, keys_first, n, values_first, keys_result, values_result,
+                        ns::chunk_state<size_type,prefix_type>(result_size, 0, 0), pred, binary_op, stream);
+
+  size_type num_segments = bulk::async_get(done, result_size).get();
+
+  return thrust::make_pair(keys_result + num_segments, values_result + num_segments);
+} // end reduce_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate,
+         typename BinaryFunction>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred,
+                BinaryFunction binary_op)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::reduce_by_key(0, scratch_bytes, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  return bulk::device::reduce_by_key(scratch.data(), scratch_bytes, keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op);
+} // end reduce_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename BinaryPredicate>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result,
+                BinaryPredicate pred)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator4>::type value_type;
+
+  return bulk::device::reduce_by_key(keys_first, keys_last, values_first, keys_result, values_result, pred, thrust::plus<value_type>());
+} // end reduce_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4>
+thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
+  reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                RandomAccessIterator2 values_first,
+                RandomAccessIterator3 keys_result,
+                RandomAccessIterator4 values_result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  return bulk::device::reduce_by_key(keys_first, keys_last, values_first, keys_result, values_result, thrust::equal_to<key_type>());
+} // end reduce_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
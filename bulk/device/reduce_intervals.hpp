@@ -0,0 +1,156 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/tuner.hpp>
+#include <bulk/algorithm/reduce.hpp>
+#include <bulk/device/decomposition.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/type_traits.h>
+#include <thrust/detail/type_traits/iterator/is_output_iterator.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_reduce_intervals_detail
+{
+
+
+// each interval accumulates in the type of the result, which may be wider than the input
+// (e.g. double or bulk::compensated<float> sums of floats), unless the result is a pure output iterator
+template<typename InputIterator, typename OutputIterator>
+struct interval_accumulator
+  : thrust::detail::eval_if<
+      thrust::detail::is_output_iterator<OutputIterator>::value,
+      thrust::iterator_value<InputIterator>,
+      thrust::iterator_value<OutputIterator>
+    >
+{};
+
+
+struct reduce_intervals_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Decomposition, typename RandomAccessIterator2, typename BinaryFunction>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &this_group,
+                             RandomAccessIterator1 first,
+                             Decomposition decomp,
+                             RandomAccessIterator2 result,
+                             BinaryFunction binary_op)
+  {
+    typedef typename interval_accumulator<RandomAccessIterator1,RandomAccessIterator2>::type accumulator_type;
+    typedef typename Decomposition::size_type size_type;
+
+    for(size_type i = first_partition(this_group, decomp); i < decomp.size(); i = next_partition(this_group, decomp, i))
+    {
+      typename Decomposition::range rng = decomp[i];
+
+      accumulator_type init = first[rng.second-1];
+
+      accumulator_type sum = bulk::reduce(this_group, first + rng.first, first + rng.second - 1, init, binary_op);
+
+      if(this_group.this_exec.index() == 0)
+      {
+        result[i] = sum;
+      } // end if
+    } // end for i
+  } // end operator()
+}; // end reduce_intervals_kernel
+
+
+// launches reduce_intervals_kernel with whichever shape bulk::autotune picks
+template<typename RandomAccessIterator1, typename Decomposition, typename RandomAccessIterator2, typename BinaryFunction>
+struct reduce_intervals_launcher
+{
+  RandomAccessIterator1 first;
+  Decomposition decomp;
+  RandomAccessIterator2 result;
+  BinaryFunction binary_op;
+
+  reduce_intervals_launcher(RandomAccessIterator1 first, Decomposition decomp, RandomAccessIterator2 result, BinaryFunction binary_op)
+    : first(first), decomp(decomp), result(result), binary_op(binary_op)
+  {}
+
+  template<std::size_t groupsize, std::size_t grainsize>
+  void launch() const
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator2>::type result_type;
+    size_t heap_size = groupsize * sizeof(result_type);
+    bulk::async(bulk::named("bulk::device::reduce_intervals", bulk::grid<groupsize,grainsize>(num_groups_to_launch(decomp),heap_size)), reduce_intervals_kernel(), bulk::root.this_exec, first, decomp, result, binary_op);
+  }
+}; // end reduce_intervals_launcher
+
+
+template<typename Launcher, typename Decomposition>
+void tune_and_launch(const Launcher &launcher, const Decomposition &decomp)
+{
+  bulk::autotune(decomp.n(), launcher);
+} // end tune_and_launch()
+
+
+// tuning reruns the launch, but a dynamic_decomposition's counter would need resetting in between,
+// so these launch once with the shape reduce_intervals was hand-tuned with
+template<typename Launcher, typename Decomposition>
+void tune_and_launch(const Launcher &launcher, const bulk::device::dynamic_decomposition<Decomposition> &)
+{
+  launcher.template launch<128,7>();
+} // end tune_and_launch()
+
+
+} // end device_reduce_intervals_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// reduces each interval of decomp, writing the sum of interval i to result[i]
+// intervals must not be empty
+template<typename RandomAccessIterator1, typename Decomposition, typename RandomAccessIterator2, typename BinaryFunction>
+RandomAccessIterator2 reduce_intervals(RandomAccessIterator1 first, Decomposition decomp, RandomAccessIterator2 result, BinaryFunction binary_op)
+{
+  typedef bulk::detail::device_reduce_intervals_detail::reduce_intervals_launcher<
+    RandomAccessIterator1,
+    Decomposition,
+    RandomAccessIterator2,
+    BinaryFunction
+  > launcher_type;
+
+  bulk::detail::device_reduce_intervals_detail::tune_and_launch(launcher_type(first, decomp, result, binary_op), decomp);
+
+  return result + decomp.size();
+} // end reduce_intervals()
+
+
+template<typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename BinaryFunction>
+RandomAccessIterator2 reduce_intervals(RandomAccessIterator1 first, RandomAccessIterator1 last, Size interval_size, RandomAccessIterator2 result, BinaryFunction binary_op)
+{
+  return bulk::device::reduce_intervals(first, bulk::device::make_blocked_decomposition<Size>(last - first,interval_size), result, binary_op);
+} // end reduce_intervals()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,381 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/uninitialized.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/accumulate.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/detail/decoupled_look_back.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/iterator/transform_iterator.h>
+#include <thrust/detail/minmax.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_scan_detail
+{
+
+
+// scans inputs too small to be worth more than a single group
+template<bool inclusive>
+struct scan_with_one_group
+{
+  template<typename ConcurrentGroup, typename InputIterator, typename Size, typename OutputIterator, typename T, typename BinaryFunction>
+  __device__ void operator()(ConcurrentGroup &this_group, InputIterator first, Size n, OutputIterator result, T init, BinaryFunction binary_op)
+  {
+    if(inclusive)
+    {
+      bulk::inclusive_scan(this_group, first, first + n, result, init, binary_op);
+    }
+    else
+    {
+      bulk::exclusive_scan(this_group, first, first + n, result, init, binary_op);
+    }
+  }
+};
+
+
+// scans the input in a single pass using decoupled look-back:
+// each group stages its tile on chip, publishes the tile's aggregate, and waits only for as much of
+// its predecessors' statuses as it needs to compute its carry, so the input is read exactly once
+// when carry_in is not null, *carry_in replaces init, and when total is not null, the last tile
+// writes the sum of init & the entire input to *total, so that a scan of the next chunk may continue from it
+template<bool inclusive>
+struct scan_tiles
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &this_group,
+                             RandomAccessIterator1 first,
+                             Size n,
+                             RandomAccessIterator2 result,
+                             T init,
+                             BinaryFunction binary_op,
+                             bulk::detail::tile_status<T> *status,
+                             unsigned int *tile_counter,
+                             const T *carry_in,
+                             T *total)
+  {
+    // offsets into the input require Size's width, but positions within the tile fit in an int
+    const int tile_size = groupsize * grainsize;
+
+    // claim tiles in the order groups begin executing rather than by this_group.index(),
+    // which guarantees that every tile we wait on belongs to a group which is already running
+    __shared__ unsigned int s_tile;
+    __shared__ bulk::uninitialized<T> s_carry;
+
+    if(this_group.this_exec.index() == 0)
+    {
+      s_tile = atomicAdd(tile_counter, 1);
+    }
+    this_group.wait();
+
+    unsigned int tile = s_tile;
+
+    Size tile_begin = static_cast<Size>(tile) * tile_size;
+    Size tile_end   = thrust::min<Size>(n, tile_begin + tile_size);
+    int num_elements = tile_end - tile_begin;
+
+    // stage the tile on chip so we only read it from memory once
+    T *stage = reinterpret_cast<T*>(bulk::malloc(this_group, tile_size * sizeof(T)));
+    bulk::copy_n(this_group, first + tile_begin, num_elements, stage);
+    this_group.wait();
+
+    T aggregate = bulk::accumulate(this_group, stage + 1, stage + num_elements, stage[0], binary_op);
+
+    if(this_group.this_exec.index() == 0)
+    {
+      T carry = carry_in ? *carry_in : init;
+
+      if(tile == 0)
+      {
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<T>::prefix_ready, binary_op(carry, aggregate));
+      }
+      else
+      {
+        // let our successors make progress while we look back
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<T>::aggregate_ready, aggregate);
+
+        carry = bulk::detail::look_back(status, tile, binary_op);
+
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<T>::prefix_ready, binary_op(carry, aggregate));
+      }
+
+      if(total && tile_end == n)
+      {
+        *total = binary_op(carry, aggregate);
+      }
+
+      s_carry = carry;
+    }
+    this_group.wait();
+
+    T carry = s_carry;
+
+    if(inclusive)
+    {
+      bulk::inclusive_scan(this_group, stage, stage + num_elements, result + tile_begin, carry, binary_op);
+    }
+    else
+    {
+      bulk::exclusive_scan(this_group, stage, stage + num_elements, result + tile_begin, carry, binary_op);
+    }
+
+    bulk::free(this_group, stage);
+  }
+};
+
+
+// the shape of scan_tiles' launch
+template<typename T>
+struct scan_tiles_shape
+{
+  // determined from empirical testing on k20c
+  static const int groupsize = sizeof(T) <= sizeof(int) ? 128 : 256;
+  static const int grainsize = sizeof(T) <= sizeof(int) ?   9 :   5;
+};
+
+
+// scans with scan_tiles regardless of n, optionally continuing from *carry_in & recording the *total
+// the scratch space required depends only on n
+template<bool inclusive, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+void scan_tiles_n(void *scratch, std::size_t &scratch_bytes,
+                  const char *name,
+                  RandomAccessIterator1 first, Size n,
+                  RandomAccessIterator2 result,
+                  T init,
+                  BinaryFunction binary_op,
+                  const T *carry_in,
+                  T *total,
+                  cudaStream_t stream)
+{
+  const int groupsize = scan_tiles_shape<T>::groupsize;
+  const int grainsize = scan_tiles_shape<T>::grainsize;
+
+  const Size tile_size = groupsize * grainsize;
+  Size num_tiles = (n + tile_size - 1) / tile_size;
+
+  bulk::detail::scratch_partition partition(scratch);
+  bulk::detail::tile_status<T> *status = partition.allocate<bulk::detail::tile_status<T> >(num_tiles);
+  unsigned int *tile_counter           = partition.allocate<unsigned int>(1);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, name) || n == 0) return;
+
+  // every tile begins not_ready, and tiles are claimed starting from 0
+  bulk::detail::throw_on_error(cudaMemsetAsync(status, 0, num_tiles * sizeof(bulk::detail::tile_status<T>), stream), name);
+  bulk::detail::throw_on_error(cudaMemsetAsync(tile_counter, 0, sizeof(unsigned int), stream), name);
+
+  // the stage lives on the heap alongside scan's buffer
+  // accumulate's buffer is sized statically, so it doesn't come from the heap
+  typedef bulk::detail::scan_detail::scan_buffer<groupsize,grainsize,T*,RandomAccessIterator2,BinaryFunction> scan_buffer_type;
+  Size heap_size = tile_size * sizeof(T) + sizeof(scan_buffer_type);
+
+  bulk::async(bulk::named(name, bulk::grid<groupsize,grainsize>(num_tiles, heap_size, stream)),
+              scan_tiles<inclusive>(), bulk::root.this_exec, first, n, result, init, binary_op,
+              status,
+              tile_counter,
+              carry_in,
+              total);
+} // end scan_tiles_n()
+
+
+template<bool inclusive, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 scan_n(void *scratch, std::size_t &scratch_bytes,
+                             RandomAccessIterator1 first, Size n,
+                             RandomAccessIterator2 result,
+                             T init,
+                             BinaryFunction binary_op,
+                             cudaStream_t stream)
+{
+  typedef typename bulk::detail::scan_detail::scan_intermediate<
+    RandomAccessIterator1,
+    RandomAccessIterator2,
+    BinaryFunction
+  >::type intermediate_type;
+
+  const char *name = inclusive ? "bulk::device::inclusive_scan" : "bulk::device::exclusive_scan";
+
+  // below this size, a single group is faster than a single pass of many
+  const Size threshold_of_parallelism = 20000;
+
+  if(n < threshold_of_parallelism)
+  {
+    // a single group requires no scratch space
+    bulk::detail::scratch_partition partition(scratch);
+
+    if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, name) || n == 0) return result;
+
+    typedef bulk::concurrent_group<bulk::agent<3>,512> group_type;
+    typedef bulk::detail::scan_detail::scan_buffer<512,3,RandomAccessIterator1,RandomAccessIterator2,BinaryFunction> heap_type;
+
+    bulk::async(bulk::named(name, bulk::async_launch<group_type>(bulk::con<512,3>(sizeof(heap_type)), stream)),
+                scan_with_one_group<inclusive>(), bulk::root, first, n, result, init, binary_op);
+
+    return result + n;
+  }
+
+  scan_tiles_n<inclusive>(scratch, scratch_bytes, name,
+                          first, n, result,
+                          intermediate_type(init), binary_op,
+                          (const intermediate_type*)0, (intermediate_type*)0,
+                          stream);
+
+  return result + n;
+} // end scan_n()
+
+
+} // end device_scan_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// result[i] = init + first[0] + ... + first[i]
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(void *scratch, std::size_t &scratch_bytes,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op,
+                                     cudaStream_t stream = 0)
+{
+  return bulk::detail::device_scan_detail::scan_n<true>(scratch, scratch_bytes, first, last - first, result, init, binary_op, stream);
+} // end inclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::inclusive_scan(0, scratch_bytes, first, last, result, init, binary_op);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  return bulk::device::inclusive_scan(scratch.data(), scratch_bytes, first, last, result, init, binary_op);
+} // end inclusive_scan()
+
+
+// result[i] = init + first[0] + ... + first[i-1]
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 exclusive_scan(void *scratch, std::size_t &scratch_bytes,
+                                     RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op,
+                                     cudaStream_t stream = 0)
+{
+  return bulk::detail::device_scan_detail::scan_n<false>(scratch, scratch_bytes, first, last - first, result, init, binary_op, stream);
+} // end exclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
+RandomAccessIterator2 exclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                     RandomAccessIterator2 result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::exclusive_scan(0, scratch_bytes, first, last, result, init, binary_op);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  return bulk::device::exclusive_scan(scratch.data(), scratch_bytes, first, last, result, init, binary_op);
+} // end exclusive_scan()
+
+
+// result[i] = init + unary_op(first[0]) + ... + unary_op(first[i])
+// unary_op applies as each element is loaded; to fuse a stage after the scan as well,
+// pass a bulk::transform_output_iterator or a thrust::permutation_iterator as result
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename UnaryFunction, typename T, typename BinaryFunction>
+RandomAccessIterator2 transform_inclusive_scan(void *scratch, std::size_t &scratch_bytes,
+                                               RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 result,
+                                               UnaryFunction unary_op,
+                                               T init,
+                                               BinaryFunction binary_op,
+                                               cudaStream_t stream = 0)
+{
+  return bulk::device::inclusive_scan(scratch, scratch_bytes,
+                                      thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op),
+                                      result, init, binary_op,
+                                      stream);
+} // end transform_inclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename UnaryFunction, typename T, typename BinaryFunction>
+RandomAccessIterator2 transform_inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 result,
+                                               UnaryFunction unary_op,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return bulk::device::inclusive_scan(thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op),
+                                      result, init, binary_op);
+} // end transform_inclusive_scan()
+
+
+// result[i] = init + unary_op(first[0]) + ... + unary_op(first[i-1])
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename UnaryFunction, typename T, typename BinaryFunction>
+RandomAccessIterator2 transform_exclusive_scan(void *scratch, std::size_t &scratch_bytes,
+                                               RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 result,
+                                               UnaryFunction unary_op,
+                                               T init,
+                                               BinaryFunction binary_op,
+                                               cudaStream_t stream = 0)
+{
+  return bulk::device::exclusive_scan(scratch, scratch_bytes,
+                                      thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op),
+                                      result, init, binary_op,
+                                      stream);
+} // end transform_exclusive_scan()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename UnaryFunction, typename T, typename BinaryFunction>
+RandomAccessIterator2 transform_exclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                               RandomAccessIterator2 result,
+                                               UnaryFunction unary_op,
+                                               T init,
+                                               BinaryFunction binary_op)
+{
+  return bulk::device::exclusive_scan(thrust::make_transform_iterator(first, unary_op), thrust::make_transform_iterator(last, unary_op),
+                                      result, init, binary_op);
+} // end transform_exclusive_scan()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
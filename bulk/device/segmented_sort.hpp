@@ -0,0 +1,330 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/future.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/sort.hpp>
+#include <bulk/device/sort.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <vector>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_segmented_sort_detail
+{
+
+
+// segments are binned by size, and each bin is sorted by the cheapest executor which can hold a segment
+enum segment_bin
+{
+  // each agent sorts a segment in registers
+  agent_bin,
+
+  // each warp-sized group sorts a segment
+  small_group_bin,
+
+  // each block-sized group sorts a segment
+  large_group_bin,
+
+  // each segment is sorted by a device-wide merge sort
+  device_bin,
+
+  num_bins
+};
+
+
+const int max_agent_segment_size       = 16;
+const int max_small_group_segment_size = 32 * 8;
+const int max_large_group_segment_size = 256 * 8;
+
+
+// segments with fewer than two elements belong to no bin
+template<typename Size>
+__host__ __device__
+int which_bin(Size segment_size)
+{
+  return (segment_size < 2)                             ? -1 :
+         (segment_size <= max_agent_segment_size)       ? agent_bin :
+         (segment_size <= max_small_group_segment_size) ? small_group_bin :
+         (segment_size <= max_large_group_segment_size) ? large_group_bin :
+                                                          device_bin;
+} // end which_bin()
+
+
+struct bin_sizes_t
+{
+  int sizes[num_bins];
+};
+
+
+// offsets may exceed an int, and so may the size of a segment in the device_bin
+template<typename RandomAccessIterator>
+__device__
+typename thrust::iterator_value<RandomAccessIterator>::type
+  segment_size(RandomAccessIterator offsets_first, int segment)
+{
+  return offsets_first[segment + 1] - offsets_first[segment];
+} // end segment_size()
+
+
+struct count_bins
+{
+  template<typename RandomAccessIterator>
+  __device__
+  void operator()(bulk::agent<> &self, RandomAccessIterator offsets_first, bin_sizes_t *bin_sizes)
+  {
+    int bin = which_bin(segment_size(offsets_first, self.index()));
+
+    if(bin >= 0)
+    {
+      atomicAdd(&bin_sizes->sizes[bin], 1);
+    } // end if
+  } // end operator()
+};
+
+
+// groups each bin's segments contiguously, in no particular order
+struct scatter_bins
+{
+  template<typename RandomAccessIterator>
+  __device__
+  void operator()(bulk::agent<> &self, RandomAccessIterator offsets_first, const bin_sizes_t *bin_sizes, bin_sizes_t *bin_cursors, int *binned_segments)
+  {
+    int bin = which_bin(segment_size(offsets_first, self.index()));
+
+    if(bin >= 0)
+    {
+      int bin_begin = 0;
+      for(int i = 0; i < bin; ++i)
+      {
+        bin_begin += bin_sizes->sizes[i];
+      } // end for i
+
+      binned_segments[bin_begin + atomicAdd(&bin_cursors->sizes[bin], 1)] = self.index();
+    } // end if
+  } // end operator()
+};
+
+
+struct sort_segments_with_agents
+{
+  template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+  __device__
+  void operator()(bulk::agent<> &self, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, RandomAccessIterator3 offsets_first, const int *segments, Compare comp)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+    typedef typename thrust::iterator_value<RandomAccessIterator3>::type offset_type;
+
+    int segment       = segments[self.index()];
+    offset_type first = offsets_first[segment];
+    int n             = segment_size(offsets_first, segment);
+
+    key_type   local_keys[max_agent_segment_size];
+    value_type local_values[max_agent_segment_size];
+
+    bulk::copy_n(bulk::bound<max_agent_segment_size>(self), keys_first + first, n, local_keys);
+    bulk::copy_n(bulk::bound<max_agent_segment_size>(self), values_first + first, n, local_values);
+
+    bulk::stable_sort_by_key(bulk::bound<max_agent_segment_size>(self), local_keys, local_keys + n, local_values, comp);
+
+    bulk::copy_n(bulk::bound<max_agent_segment_size>(self), local_keys, n, keys_first + first);
+    bulk::copy_n(bulk::bound<max_agent_segment_size>(self), local_values, n, values_first + first);
+  } // end operator()
+};
+
+
+struct sort_segments_with_groups
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, RandomAccessIterator3 offsets_first, const int *segments, Compare comp)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator3>::type offset_type;
+
+    int segment       = segments[g.index()];
+    offset_type first = offsets_first[segment];
+    int n             = segment_size(offsets_first, segment);
+
+    bulk::stable_sort_by_key(bulk::bound<groupsize * grainsize>(g), keys_first + first, keys_first + first + n, values_first + first, comp);
+  } // end operator()
+};
+
+
+// collects the extent of each segment too large for a single group
+struct gather_device_segments
+{
+  template<typename RandomAccessIterator, typename Offset>
+  __device__
+  void operator()(bulk::agent<> &self, RandomAccessIterator offsets_first, const int *segments, Offset *extents)
+  {
+    int segment = segments[self.index()];
+
+    extents[2 * self.index()]     = offsets_first[segment];
+    extents[2 * self.index() + 1] = offsets_first[segment + 1];
+  } // end operator()
+};
+
+
+template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void sort_bin_with_groups(RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, RandomAccessIterator3 offsets_first, const int *segments, int num_segments, Compare comp, cudaStream_t stream)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  if(num_segments == 0) return;
+
+  std::size_t heap_size = groupsize * grainsize * thrust::max(sizeof(key_type), sizeof(value_type));
+
+  bulk::async(bulk::named("bulk::device::segmented_stable_sort_by_key", bulk::grid<groupsize,grainsize>(num_segments, heap_size, stream)),
+              sort_segments_with_groups(), bulk::root.this_exec, keys_first, values_first, offsets_first, segments, comp);
+} // end sort_bin_with_groups()
+
+
+} // end device_segmented_sort_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// sorts each of num_segments segments [keys_first + offsets_first[i], keys_first + offsets_first[i+1])
+// of [keys_first, keys_last) independently, permuting the corresponding values accordingly.
+// Segments are binned by size so that short segments are sorted by a single agent or group,
+// and only the rare segment too large for one group pays for a device-wide merge sort.
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+// XXX this waits for the size of each bin to arrive on the host
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void segmented_stable_sort_by_key(void *scratch, std::size_t &scratch_bytes,
+                                  RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                  RandomAccessIterator2 values_first,
+                                  int num_segments,
+                                  RandomAccessIterator3 offsets_first,
+                                  Compare comp,
+                                  cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::device_segmented_sort_detail;
+
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator3>::type      offset_type;
+
+  size_type n = keys_last - keys_first;
+
+  // at most this many segments are too large for a single group
+  int max_num_device_segments = thrust::min<size_type>(num_segments, n / (ns::max_large_group_segment_size + 1));
+
+  // a segment sorted by the device-wide merge sort needs no more scratch than the entire input would
+  std::size_t sort_scratch_bytes = 0;
+  if(max_num_device_segments > 0)
+  {
+    bulk::device::stable_merge_sort_by_key(0, sort_scratch_bytes, keys_first, keys_last, values_first, comp, stream);
+  } // end if
+
+  bulk::detail::scratch_partition partition(scratch);
+  ns::bin_sizes_t *bin_sizes   = partition.allocate<ns::bin_sizes_t>(1);
+  ns::bin_sizes_t *bin_cursors = partition.allocate<ns::bin_sizes_t>(1);
+  int *binned_segments         = partition.allocate<int>(num_segments);
+  offset_type *extents         = partition.allocate<offset_type>(2 * max_num_device_segments);
+  void *sort_scratch           = partition.allocate<char>(max_num_device_segments > 0 ? sort_scratch_bytes : 0);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::segmented_stable_sort_by_key") || num_segments == 0) return;
+
+  const char *name = "bulk::device::segmented_stable_sort_by_key";
+
+  bulk::detail::throw_on_error(cudaMemsetAsync(bin_sizes, 0, sizeof(ns::bin_sizes_t), stream), name);
+  bulk::detail::throw_on_error(cudaMemsetAsync(bin_cursors, 0, sizeof(ns::bin_sizes_t), stream), name);
+
+  // bin the segments by size
+  bulk::async(bulk::named(name, bulk::par(stream, num_segments)), ns::count_bins(), bulk::root.this_exec, offsets_first, bin_sizes);
+
+  bulk::future<void> binned =
+    bulk::async(bulk::named(name, bulk::par(stream, num_segments)), ns::scatter_bins(), bulk::root.this_exec, offsets_first, bin_sizes, bin_cursors, binned_segments);
+
+  ns::bin_sizes_t sizes = bulk::async_get(binned, bin_sizes).get();
+
+  const int *segments = binned_segments;
+
+  // sort each bin
+  if(sizes.sizes[ns::agent_bin] > 0)
+  {
+    bulk::async(bulk::named(name, bulk::par(stream, sizes.sizes[ns::agent_bin])),
+                ns::sort_segments_with_agents(), bulk::root.this_exec, keys_first, values_first, offsets_first, segments, comp);
+  } // end if
+  segments += sizes.sizes[ns::agent_bin];
+
+  ns::sort_bin_with_groups<32,8>(keys_first, values_first, offsets_first, segments, sizes.sizes[ns::small_group_bin], comp, stream);
+  segments += sizes.sizes[ns::small_group_bin];
+
+  ns::sort_bin_with_groups<256,8>(keys_first, values_first, offsets_first, segments, sizes.sizes[ns::large_group_bin], comp, stream);
+  segments += sizes.sizes[ns::large_group_bin];
+
+  int num_device_segments = sizes.sizes[ns::device_bin];
+
+  if(num_device_segments > 0)
+  {
+    // the last few segments are sorted one at a time, so their extents must be known on the host
+    bulk::async(bulk::named(name, bulk::par(stream, num_device_segments)),
+                ns::gather_device_segments(), bulk::root.this_exec, offsets_first, segments, extents);
+
+    std::vector<offset_type> host_extents(2 * num_device_segments);
+    bulk::detail::throw_on_error(cudaMemcpyAsync(&host_extents[0], extents, host_extents.size() * sizeof(offset_type), cudaMemcpyDeviceToHost, stream), name);
+    bulk::detail::throw_on_error(cudaStreamSynchronize(stream), name);
+
+    for(int i = 0; i < num_device_segments; ++i)
+    {
+      offset_type first = host_extents[2 * i];
+      offset_type last  = host_extents[2 * i + 1];
+
+      bulk::device::stable_merge_sort_by_key(sort_scratch, sort_scratch_bytes, keys_first + first, keys_first + last, values_first + first, comp, stream);
+    } // end for i
+  } // end if
+} // end segmented_stable_sort_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename RandomAccessIterator3, typename Compare>
+void segmented_stable_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                  RandomAccessIterator2 values_first,
+                                  int num_segments,
+                                  RandomAccessIterator3 offsets_first,
+                                  Compare comp)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::segmented_stable_sort_by_key(0, scratch_bytes, keys_first, keys_last, values_first, num_segments, offsets_first, comp);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::segmented_stable_sort_by_key(scratch.data(), scratch_bytes, keys_first, keys_last, values_first, num_segments, offsets_first, comp);
+} // end segmented_stable_sort_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
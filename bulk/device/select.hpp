@@ -0,0 +1,551 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/future.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/copy.hpp>
+#include <bulk/algorithm/scan.hpp>
+#include <bulk/detail/decoupled_look_back.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+#include <thrust/tuple.h>
+#include <thrust/pair.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_select_detail
+{
+
+
+// flags the elements of a staged tile which satisfy pred
+template<typename Predicate>
+struct select_if
+{
+  Predicate pred;
+
+  __host__ __device__
+  select_if(Predicate pred)
+    : pred(pred)
+  {}
+
+  template<typename RandomAccessIterator, typename T, typename Size>
+  __device__
+  bool operator()(RandomAccessIterator, const T *stage, Size, int i)
+  {
+    return pred(stage[i]);
+  }
+};
+
+
+// flags the elements of a staged tile which are not equivalent to their predecessor
+template<typename BinaryPredicate>
+struct select_unique
+{
+  BinaryPredicate pred;
+
+  __host__ __device__
+  select_unique(BinaryPredicate pred)
+    : pred(pred)
+  {}
+
+  template<typename RandomAccessIterator, typename T, typename Size>
+  __device__
+  bool operator()(RandomAccessIterator first, const T *stage, Size tile_begin, int i)
+  {
+    if(i == 0)
+    {
+      // XXX when unique operates in place, the predecessor may be overwritten by an earlier
+      //     tile while we read it, but only ever with its own value
+      return tile_begin == 0 || !pred(first[tile_begin - 1], stage[0]);
+    }
+
+    return !pred(stage[i-1], stage[i]);
+  }
+};
+
+
+// drops the rejected elements
+struct discard_rejected
+{
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size, const T &) {}
+};
+
+
+// writes the rejected elements to their own range, in order
+template<typename RandomAccessIterator>
+struct copy_rejected
+{
+  RandomAccessIterator result;
+
+  __host__ __device__
+  copy_rejected(RandomAccessIterator result)
+    : result(result)
+  {}
+
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size rank, const T &x)
+  {
+    result[rank] = x;
+  }
+};
+
+
+// writes the rejected elements backward from the end of the range
+template<typename RandomAccessIterator>
+struct reverse_copy_rejected
+{
+  RandomAccessIterator last;
+
+  __host__ __device__
+  reverse_copy_rejected(RandomAccessIterator last)
+    : last(last)
+  {}
+
+  template<typename Size, typename T>
+  __device__
+  void operator()(Size rank, const T &x)
+  {
+    last[-rank - 1] = x;
+  }
+};
+
+
+// compacts the selected elements of the input in a single pass using decoupled look-back:
+// each group stages its tile on chip, scans its selection flags and publishes the number of
+// elements the tile selects. After looking back through its predecessors' statuses,
+// a group knows where its selections begin in the output and scatters them directly
+struct select_tiles
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename Size,
+           typename RandomAccessIterator2,
+           typename Flagger,
+           typename RejectedSink,
+           typename ResultSize>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &this_group,
+                  RandomAccessIterator1 first,
+                  Size n,
+                  RandomAccessIterator2 result,
+                  bulk::detail::tile_status<Size> *status,
+                  unsigned int *tile_counter,
+                  ResultSize *num_selected,
+                  thrust::tuple<Flagger,RejectedSink> flagger_and_sink)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+    Flagger      flag     = thrust::get<0>(flagger_and_sink);
+    RejectedSink rejected = thrust::get<1>(flagger_and_sink);
+
+    // offsets into the input & the number selected before the tile require Size's width,
+    // but ranks within the tile fit in an int
+    const int tile_size = groupsize * grainsize;
+
+    // claim tiles in the order groups begin executing rather than by this_group.index(),
+    // which guarantees that every tile we wait on belongs to a group which is already running
+    __shared__ unsigned int s_tile;
+    __shared__ Size s_carry;
+
+    if(this_group.this_exec.index() == 0)
+    {
+      s_tile = atomicAdd(tile_counter, 1);
+    }
+    this_group.wait();
+
+    unsigned int tile = s_tile;
+
+    Size tile_begin = static_cast<Size>(tile) * tile_size;
+    Size tile_end   = thrust::min<Size>(n, tile_begin + tile_size);
+    int num_elements = tile_end - tile_begin;
+
+    // stage the tile on chip so we only read it from memory once
+    value_type *stage = 0;
+    int *offsets = 0;
+    bulk::malloc_all(this_group, stage, tile_size, offsets, tile_size);
+
+    bulk::copy_n(this_group, first + tile_begin, num_elements, stage);
+    this_group.wait();
+
+    for(int i = this_group.this_exec.index(); i < num_elements; i += this_group.size())
+    {
+      offsets[i] = flag(first, stage, tile_begin, i) ? 1 : 0;
+    }
+    this_group.wait();
+
+    // scan the flags in place into each selection's rank within the tile
+    int aggregate = bulk::detail::scan_detail::scan<false>(bulk::bound<groupsize * grainsize>(this_group),
+                                                          offsets, offsets + num_elements,
+                                                          offsets,
+                                                          0,
+                                                          thrust::plus<int>());
+
+    if(this_group.this_exec.index() == 0)
+    {
+      if(tile == 0)
+      {
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Size>::prefix_ready, Size(aggregate));
+
+        s_carry = 0;
+      }
+      else
+      {
+        // let our successors make progress while we look back
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Size>::aggregate_ready, Size(aggregate));
+
+        Size exclusive_prefix = bulk::detail::look_back(status, tile, thrust::plus<Size>());
+
+        bulk::detail::publish(&status[tile], bulk::detail::tile_status<Size>::prefix_ready, exclusive_prefix + aggregate);
+
+        s_carry = exclusive_prefix;
+      }
+    }
+    this_group.wait();
+
+    Size carry = s_carry;
+
+    for(int i = this_group.this_exec.index(); i < num_elements; i += this_group.size())
+    {
+      // recover the flag from the difference of successive ranks
+      int next_offset = (i + 1 < num_elements) ? offsets[i + 1] : aggregate;
+      Size num_selected_before = carry + offsets[i];
+
+      if(next_offset != offsets[i])
+      {
+        result[num_selected_before] = stage[i];
+      }
+      else
+      {
+        rejected(tile_begin + i - num_selected_before, stage[i]);
+      }
+    }
+
+    if(tile_end == n && this_group.this_exec.index() == 0)
+    {
+      *num_selected = carry + aggregate;
+    }
+
+    bulk::free_all(this_group, stage, offsets);
+  }
+};
+
+
+// launches select_tiles over [first, last) and writes the number of selected elements to *num_selected
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Flagger,
+         typename RejectedSink,
+         typename Size>
+void select(void *scratch, std::size_t &scratch_bytes,
+            const char *name,
+            RandomAccessIterator1 first, RandomAccessIterator1 last,
+            RandomAccessIterator2 result,
+            Size *num_selected,
+            Flagger flag,
+            RejectedSink rejected,
+            cudaStream_t stream)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type      value_type;
+
+  size_type n = last - first;
+
+  // XXX these sizes aren't tuned
+  const int groupsize = 128;
+  const int grainsize = (sizeof(value_type) <= sizeof(int)) ? 7 : 5;
+
+  const size_type tile_size = groupsize * grainsize;
+  size_type num_tiles = (n + tile_size - 1) / tile_size;
+
+  bulk::detail::scratch_partition partition(scratch);
+  bulk::detail::tile_status<size_type> *status = partition.allocate<bulk::detail::tile_status<size_type> >(num_tiles);
+  unsigned int *tile_counter                   = partition.allocate<unsigned int>(1);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, name)) return;
+
+  if(n == 0)
+  {
+    bulk::detail::throw_on_error(cudaMemsetAsync(num_selected, 0, sizeof(Size), stream), name);
+    return;
+  } // end if
+
+  // every tile begins not_ready, and tiles are claimed starting from 0
+  bulk::detail::throw_on_error(cudaMemsetAsync(status, 0, num_tiles * sizeof(bulk::detail::tile_status<size_type>), stream), name);
+  bulk::detail::throw_on_error(cudaMemsetAsync(tile_counter, 0, sizeof(unsigned int), stream), name);
+
+  // the scan uses the offsets as its scratch, so the heap need only hold the stage & the offsets
+  size_type heap_size = tile_size * (sizeof(value_type) + sizeof(int));
+
+  bulk::async(bulk::named(name, bulk::grid<groupsize,grainsize>(num_tiles, heap_size, stream)),
+              select_tiles(),
+              bulk::root.this_exec,
+              first, n, result,
+              status,
+              tile_counter,
+              num_selected,
+              thrust::make_tuple(flag, rejected));
+} // end select()
+
+
+} // end device_select_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// copies the elements of [first, last) which satisfy pred to result, preserving their order,
+// and writes the number of elements copied to *num_selected on the device.
+// The entire input is read once in a single launch, and nothing waits on the host,
+// so a subsequent launch on the same stream may consume *num_selected directly
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Size,
+         typename Predicate>
+void copy_if(void *scratch, std::size_t &scratch_bytes,
+             RandomAccessIterator1 first, RandomAccessIterator1 last,
+             RandomAccessIterator2 result,
+             Size *num_selected,
+             Predicate pred,
+             cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::device_select_detail;
+
+  ns::select(scratch, scratch_bytes, "bulk::device::copy_if",
+             first, last, result, num_selected,
+             ns::select_if<Predicate>(pred),
+             ns::discard_rejected(),
+             stream);
+} // end copy_if()
+
+
+// stably copies the elements of [first, last) which satisfy pred to out_true and the rest to out_false,
+// and writes the number of elements which satisfy pred to *num_selected on the device
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Size,
+         typename Predicate>
+void partition_copy(void *scratch, std::size_t &scratch_bytes,
+                    RandomAccessIterator1 first, RandomAccessIterator1 last,
+                    RandomAccessIterator2 out_true,
+                    RandomAccessIterator3 out_false,
+                    Size *num_selected,
+                    Predicate pred,
+                    cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::device_select_detail;
+
+  ns::select(scratch, scratch_bytes, "bulk::device::partition_copy",
+             first, last, out_true, num_selected,
+             ns::select_if<Predicate>(pred),
+             ns::copy_rejected<RandomAccessIterator3>(out_false),
+             stream);
+} // end partition_copy()
+
+
+// copies [first, last) to the range beginning at result, which must not overlap [first, last),
+// such that the elements which satisfy pred precede those which do not,
+// and writes the number of elements which satisfy pred to *num_selected on the device.
+// The elements which satisfy pred retain their order, while the rest appear in reverse order
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Size,
+         typename Predicate>
+void partition(void *scratch, std::size_t &scratch_bytes,
+               RandomAccessIterator1 first, RandomAccessIterator1 last,
+               RandomAccessIterator2 result,
+               Size *num_selected,
+               Predicate pred,
+               cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::device_select_detail;
+
+  ns::select(scratch, scratch_bytes, "bulk::device::partition",
+             first, last, result, num_selected,
+             ns::select_if<Predicate>(pred),
+             ns::reverse_copy_rejected<RandomAccessIterator2>(result + (last - first)),
+             stream);
+} // end partition()
+
+
+// copies the first element of each run of consecutive elements of [first, last) equivalent under pred to result,
+// and writes the number of runs to *num_selected on the device.
+// result may equal first
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Size,
+         typename BinaryPredicate>
+void unique_copy(void *scratch, std::size_t &scratch_bytes,
+                 RandomAccessIterator1 first, RandomAccessIterator1 last,
+                 RandomAccessIterator2 result,
+                 Size *num_selected,
+                 BinaryPredicate pred,
+                 cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::device_select_detail;
+
+  ns::select(scratch, scratch_bytes, "bulk::device::unique_copy",
+             first, last, result, num_selected,
+             ns::select_unique<BinaryPredicate>(pred),
+             ns::discard_rejected(),
+             stream);
+} // end unique_copy()
+
+
+// the overloads without a scratch space wait for the number of selected elements to arrive on the host
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Predicate>
+RandomAccessIterator2 copy_if(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                              RandomAccessIterator2 result,
+                              Predicate pred)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  std::size_t scratch_bytes = 0;
+  bulk::device::copy_if(0, scratch_bytes, first, last, result, (size_type*)0, pred);
+
+  bulk::detail::cached_array<size_type> num_selected(1);
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::copy_if(scratch.data(), scratch_bytes, first, last, result, num_selected.data(), pred);
+
+  return result + num_selected[0];
+} // end copy_if()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Predicate>
+thrust::pair<RandomAccessIterator2,RandomAccessIterator3>
+  partition_copy(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                 RandomAccessIterator2 out_true,
+                 RandomAccessIterator3 out_false,
+                 Predicate pred)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  std::size_t scratch_bytes = 0;
+  bulk::device::partition_copy(0, scratch_bytes, first, last, out_true, out_false, (size_type*)0, pred);
+
+  bulk::detail::cached_array<size_type> num_selected(1);
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::partition_copy(scratch.data(), scratch_bytes, first, last, out_true, out_false, num_selected.data(), pred);
+
+  size_type num_true = num_selected[0];
+
+  return thrust::make_pair(out_true + num_true, out_false + ((last - first) - num_true));
+} // end partition_copy()
+
+
+// returns the partition point in the range beginning at result
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename Predicate>
+RandomAccessIterator2 partition(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                RandomAccessIterator2 result,
+                                Predicate pred)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  std::size_t scratch_bytes = 0;
+  bulk::device::partition(0, scratch_bytes, first, last, result, (size_type*)0, pred);
+
+  bulk::detail::cached_array<size_type> num_selected(1);
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::partition(scratch.data(), scratch_bytes, first, last, result, num_selected.data(), pred);
+
+  return result + num_selected[0];
+} // end partition()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename BinaryPredicate>
+RandomAccessIterator2 unique_copy(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                  RandomAccessIterator2 result,
+                                  BinaryPredicate pred)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  std::size_t scratch_bytes = 0;
+  bulk::device::unique_copy(0, scratch_bytes, first, last, result, (size_type*)0, pred);
+
+  bulk::detail::cached_array<size_type> num_selected(1);
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::unique_copy(scratch.data(), scratch_bytes, first, last, result, num_selected.data(), pred);
+
+  return result + num_selected[0];
+} // end unique_copy()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2>
+RandomAccessIterator2 unique_copy(RandomAccessIterator1 first, RandomAccessIterator1 last,
+                                  RandomAccessIterator2 result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type value_type;
+
+  return bulk::device::unique_copy(first, last, result, thrust::equal_to<value_type>());
+} // end unique_copy()
+
+
+// removes all but the first element of each run of consecutive equivalent elements in place
+template<typename RandomAccessIterator,
+         typename BinaryPredicate>
+RandomAccessIterator unique(RandomAccessIterator first, RandomAccessIterator last,
+                            BinaryPredicate pred)
+{
+  return bulk::device::unique_copy(first, last, first, pred);
+} // end unique()
+
+
+template<typename RandomAccessIterator>
+RandomAccessIterator unique(RandomAccessIterator first, RandomAccessIterator last)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type value_type;
+
+  return bulk::device::unique(first, last, thrust::equal_to<value_type>());
+} // end unique()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,708 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/malloc.hpp>
+#include <bulk/algorithm/set_operations.hpp>
+#include <bulk/device/scan.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/functional.h>
+#include <thrust/tabulate.h>
+#include <thrust/tuple.h>
+#include <thrust/pair.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_set_operation_detail
+{
+
+
+template<typename Size, typename RandomAccessIterator1,typename RandomAccessIterator2, typename Compare>
+struct locate_paired_merge_path
+{
+  Size partition_size;
+  RandomAccessIterator1 first1;
+  Size n1;
+  RandomAccessIterator2 first2;
+  Size n2;
+  Compare comp;
+
+  locate_paired_merge_path(Size partition_size, RandomAccessIterator1 first1, Size n1, RandomAccessIterator2 first2, Size n2, Compare comp)
+    : partition_size(partition_size),
+      first1(first1), n1(n1),
+      first2(first2), n2(n2),
+      comp(comp)
+  {}
+
+  template<typename Index>
+  __device__
+  Size operator()(Index i)
+  {
+    Size diag = thrust::min<Size>(partition_size * i, n1 + n2);
+    return bulk::detail::set_operation_detail::paired_merge_path(first1, n1, first2, n2, diag, comp);
+  }
+};
+
+
+// the ranges of the inputs between two consecutive paired merge paths
+template<typename Size>
+struct tile_bounds
+{
+  Size begin1, begin2;
+  int  size1, size2;
+  bool is_last;
+
+  __device__
+  tile_bounds(const Size *merge_paths, Size n1, Size n2, Size tile_size, Size tile)
+  {
+    Size mp0  = merge_paths[tile];
+    Size mp1  = merge_paths[tile+1];
+    Size diag = tile_size * tile;
+    Size end  = thrust::min<Size>(n1 + n2, diag + tile_size);
+
+    begin1  = mp0;
+    begin2  = diag - mp0;
+    size1   = mp1 - mp0;
+    size2   = (end - mp1) - begin2;
+    is_last = (end == n1 + n2);
+  }
+};
+
+
+// the first pass only counts the elements each tile contributes to the result
+template<int operation>
+struct count_tiles
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2, typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 keys_first1, Size n1,
+                  RandomAccessIterator2 keys_first2, Size n2,
+                  const Size *merge_paths,
+                  Size *counts,
+                  Compare comp)
+  {
+    namespace ns = bulk::detail::set_operation_detail;
+
+    tile_bounds<Size> tile(merge_paths, n1, n2, Size(groupsize * grainsize), Size(g.index()));
+
+    int count = ns::set_operation_tile<operation>(bulk::bound<groupsize * grainsize>(g),
+                                                  keys_first1, n1, tile.begin1, tile.size1,
+                                                  keys_first2, n2, tile.begin2, tile.size2,
+                                                  ns::no_values(), ns::no_values(),
+                                                  ns::no_values(), ns::no_values(),
+                                                  Size(0),
+                                                  comp);
+
+    if(g.this_exec.index() == 0)
+    {
+      counts[g.index()] = count;
+    } // end if
+  } // end operator()
+}; // end count_tiles
+
+
+// the second pass recomputes each tile & scatters its result where the scan of the counts says it begins
+template<int operation>
+struct emit_tiles
+{
+  template<std::size_t groupsize, std::size_t grainsize,
+           typename RandomAccessIterator1, typename Size, typename RandomAccessIterator2,
+           typename RandomAccessIterator3, typename RandomAccessIterator4,
+           typename RandomAccessIterator5, typename RandomAccessIterator6,
+           typename ResultSize,
+           typename Compare>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                  RandomAccessIterator1 keys_first1, Size n1,
+                  RandomAccessIterator2 keys_first2, Size n2,
+                  thrust::tuple<RandomAccessIterator3,RandomAccessIterator4> values_first,
+                  const Size *merge_paths,
+                  const Size *offsets,
+                  thrust::tuple<RandomAccessIterator5,RandomAccessIterator6,ResultSize*> results,
+                  Compare comp)
+  {
+    namespace ns = bulk::detail::set_operation_detail;
+
+    tile_bounds<Size> tile(merge_paths, n1, n2, Size(groupsize * grainsize), Size(g.index()));
+
+    ns::set_operation_tile<operation>(bulk::bound<groupsize * grainsize>(g),
+                                      keys_first1, n1, tile.begin1, tile.size1,
+                                      keys_first2, n2, tile.begin2, tile.size2,
+                                      thrust::get<0>(values_first), thrust::get<1>(values_first),
+                                      thrust::get<0>(results), thrust::get<1>(results),
+                                      offsets[g.index()],
+                                      comp);
+
+    if(tile.is_last && g.this_exec.index() == 0)
+    {
+      *thrust::get<2>(results) = offsets[g.index()+1];
+    } // end if
+  } // end operator()
+}; // end emit_tiles
+
+
+// partitions the paired merge of the inputs into tiles, counts each tile's result,
+// scans the counts into the tiles' offsets in the result, and finally emits the result,
+// writing its size to *result_size on the device
+template<int operation,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename ResultSize,
+         typename Compare>
+void set_operation(void *scratch, std::size_t &scratch_bytes,
+                   const char *name,
+                   RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                   RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                   RandomAccessIterator3 values_first1,
+                   RandomAccessIterator4 values_first2,
+                   RandomAccessIterator5 keys_result,
+                   RandomAccessIterator6 values_result,
+                   ResultSize *result_size,
+                   Compare comp,
+                   cudaStream_t stream)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type      key_type;
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  // XXX these sizes aren't tuned
+  const int groupsize = 128;
+  const int grainsize = (sizeof(key_type) <= sizeof(int)) ? 7 : 5;
+
+  const size_type tile_size = groupsize * grainsize;
+
+  size_type n1 = keys_last1 - keys_first1;
+  size_type n2 = keys_last2 - keys_first2;
+  size_type num_tiles = (n1 + n2 + tile_size - 1) / tile_size;
+
+  bulk::detail::scratch_partition partition(scratch);
+  size_type *merge_paths = partition.allocate<size_type>(num_tiles + 1);
+  size_type *counts      = partition.allocate<size_type>(num_tiles + 1);
+  size_type *offsets     = partition.allocate<size_type>(num_tiles + 1);
+
+  std::size_t scan_scratch_bytes = 0;
+  bulk::device::exclusive_scan(0, scan_scratch_bytes, counts, counts + num_tiles + 1, offsets, size_type(0), thrust::plus<size_type>(), stream);
+  void *scan_scratch = partition.allocate<char>(scan_scratch_bytes);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, name)) return;
+
+  if(num_tiles == 0)
+  {
+    bulk::detail::throw_on_error(cudaMemsetAsync(result_size, 0, sizeof(ResultSize), stream), name);
+    return;
+  } // end if
+
+  thrust::tabulate(thrust::cuda::par.on(stream),
+                   merge_paths, merge_paths + num_tiles + 1,
+                   locate_paired_merge_path<size_type,RandomAccessIterator1,RandomAccessIterator2,Compare>(tile_size, keys_first1, n1, keys_first2, n2, comp));
+
+  // each tile stages its keys & the ranks of its selections
+  size_type heap_size = tile_size * (sizeof(key_type) + sizeof(int));
+
+  // the count past the last tile is zero, so that the exclusive scan also yields the total
+  bulk::detail::throw_on_error(cudaMemsetAsync(counts + num_tiles, 0, sizeof(size_type), stream), name);
+
+  bulk::async(bulk::named(name, bulk::grid<groupsize,grainsize>(num_tiles, heap_size, stream)),
+              count_tiles<operation>(),
+              bulk::root.this_exec,
+              keys_first1, n1,
+              keys_first2, n2,
+              merge_paths,
+              counts,
+              comp);
+
+  bulk::device::exclusive_scan(scan_scratch, scan_scratch_bytes, counts, counts + num_tiles + 1, offsets, size_type(0), thrust::plus<size_type>(), stream);
+
+  bulk::async(bulk::named(name, bulk::grid<groupsize,grainsize>(num_tiles, heap_size, stream)),
+              emit_tiles<operation>(),
+              bulk::root.this_exec,
+              keys_first1, n1,
+              keys_first2, n2,
+              thrust::make_tuple(values_first1, values_first2),
+              merge_paths,
+              offsets,
+              thrust::make_tuple(keys_result, values_result, result_size),
+              comp);
+} // end set_operation()
+
+
+// the overloads without a scratch space wait for the size of the result to arrive on the host
+template<int operation,
+         typename RandomAccessIterator1, typename RandomAccessIterator2,
+         typename RandomAccessIterator3, typename RandomAccessIterator4,
+         typename RandomAccessIterator5, typename RandomAccessIterator6,
+         typename Compare>
+typename thrust::iterator_difference<RandomAccessIterator1>::type
+  set_operation(const char *name,
+                RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                RandomAccessIterator3 values_first1,
+                RandomAccessIterator4 values_first2,
+                RandomAccessIterator5 keys_result,
+                RandomAccessIterator6 values_result,
+                Compare comp)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  std::size_t scratch_bytes = 0;
+  set_operation<operation>(0, scratch_bytes, name, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, (size_type*)0, comp, 0);
+
+  bulk::detail::cached_array<size_type> result_size(1);
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  set_operation<operation>(scratch.data(), scratch_bytes, name, keys_first1, keys_last1, keys_first2, keys_last2, values_first1, values_first2, keys_result, values_result, result_size.data(), comp, 0);
+
+  return result_size[0];
+} // end set_operation()
+
+
+} // end device_set_operation_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// the set operations below follow the std:: algorithms of the same name, including their treatment of
+// equivalent elements, and write the size of the result to *result_size on the device.
+// The scratch forms don't wait on the host, so a subsequent launch on the same stream may consume *result_size directly
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Size,
+         typename Compare>
+void set_union(void *scratch, std::size_t &scratch_bytes,
+               RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+               RandomAccessIterator3 result,
+               Size *result_size,
+               Compare comp,
+               cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_union_operation>(scratch, scratch_bytes, "bulk::device::set_union",
+                                                                                    first1, last1, first2, last2,
+                                                                                    ns::no_values(), ns::no_values(),
+                                                                                    result, ns::no_values(),
+                                                                                    result_size, comp, stream);
+} // end set_union()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Size,
+         typename Compare>
+void set_intersection(void *scratch, std::size_t &scratch_bytes,
+                      RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                      RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                      RandomAccessIterator3 result,
+                      Size *result_size,
+                      Compare comp,
+                      cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_intersection_operation>(scratch, scratch_bytes, "bulk::device::set_intersection",
+                                                                                           first1, last1, first2, last2,
+                                                                                           ns::no_values(), ns::no_values(),
+                                                                                           result, ns::no_values(),
+                                                                                           result_size, comp, stream);
+} // end set_intersection()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Size,
+         typename Compare>
+void set_difference(void *scratch, std::size_t &scratch_bytes,
+                    RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                    RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                    RandomAccessIterator3 result,
+                    Size *result_size,
+                    Compare comp,
+                    cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_difference_operation>(scratch, scratch_bytes, "bulk::device::set_difference",
+                                                                                         first1, last1, first2, last2,
+                                                                                         ns::no_values(), ns::no_values(),
+                                                                                         result, ns::no_values(),
+                                                                                         result_size, comp, stream);
+} // end set_difference()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Size,
+         typename Compare>
+void set_symmetric_difference(void *scratch, std::size_t &scratch_bytes,
+                              RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                              RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                              RandomAccessIterator3 result,
+                              Size *result_size,
+                              Compare comp,
+                              cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_symmetric_difference_operation>(scratch, scratch_bytes, "bulk::device::set_symmetric_difference",
+                                                                                                   first1, last1, first2, last2,
+                                                                                                   ns::no_values(), ns::no_values(),
+                                                                                                   result, ns::no_values(),
+                                                                                                   result_size, comp, stream);
+} // end set_symmetric_difference()
+
+
+// each value accompanies its key from whichever range the key came from
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Size,
+         typename Compare>
+void set_union_by_key(void *scratch, std::size_t &scratch_bytes,
+                      RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                      RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                      RandomAccessIterator3 values_first1,
+                      RandomAccessIterator4 values_first2,
+                      RandomAccessIterator5 keys_result,
+                      RandomAccessIterator6 values_result,
+                      Size *result_size,
+                      Compare comp,
+                      cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_union_operation>(scratch, scratch_bytes, "bulk::device::set_union_by_key",
+                                                                                    keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                    values_first1, values_first2,
+                                                                                    keys_result, values_result,
+                                                                                    result_size, comp, stream);
+} // end set_union_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Size,
+         typename Compare>
+void set_intersection_by_key(void *scratch, std::size_t &scratch_bytes,
+                             RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                             RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                             RandomAccessIterator3 values_first1,
+                             RandomAccessIterator4 values_first2,
+                             RandomAccessIterator5 keys_result,
+                             RandomAccessIterator6 values_result,
+                             Size *result_size,
+                             Compare comp,
+                             cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_intersection_operation>(scratch, scratch_bytes, "bulk::device::set_intersection_by_key",
+                                                                                           keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                           values_first1, values_first2,
+                                                                                           keys_result, values_result,
+                                                                                           result_size, comp, stream);
+} // end set_intersection_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Size,
+         typename Compare>
+void set_difference_by_key(void *scratch, std::size_t &scratch_bytes,
+                           RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                           RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                           RandomAccessIterator3 values_first1,
+                           RandomAccessIterator4 values_first2,
+                           RandomAccessIterator5 keys_result,
+                           RandomAccessIterator6 values_result,
+                           Size *result_size,
+                           Compare comp,
+                           cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_difference_operation>(scratch, scratch_bytes, "bulk::device::set_difference_by_key",
+                                                                                         keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                         values_first1, values_first2,
+                                                                                         keys_result, values_result,
+                                                                                         result_size, comp, stream);
+} // end set_difference_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Size,
+         typename Compare>
+void set_symmetric_difference_by_key(void *scratch, std::size_t &scratch_bytes,
+                                     RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                     RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                     RandomAccessIterator3 values_first1,
+                                     RandomAccessIterator4 values_first2,
+                                     RandomAccessIterator5 keys_result,
+                                     RandomAccessIterator6 values_result,
+                                     Size *result_size,
+                                     Compare comp,
+                                     cudaStream_t stream = 0)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  bulk::detail::device_set_operation_detail::set_operation<ns::set_symmetric_difference_operation>(scratch, scratch_bytes, "bulk::device::set_symmetric_difference_by_key",
+                                                                                                   keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                                   values_first1, values_first2,
+                                                                                                   keys_result, values_result,
+                                                                                                   result_size, comp, stream);
+} // end set_symmetric_difference_by_key()
+
+
+// the overloads without a scratch space wait for the size of the result to arrive on the host
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 set_union(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                RandomAccessIterator3 result,
+                                Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + bulk::detail::device_set_operation_detail::set_operation<ns::set_union_operation>("bulk::device::set_union",
+                                                                                                    first1, last1, first2, last2,
+                                                                                                    ns::no_values(), ns::no_values(),
+                                                                                                    result, ns::no_values(),
+                                                                                                    comp);
+} // end set_union()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                       RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                       RandomAccessIterator3 result,
+                                       Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + bulk::detail::device_set_operation_detail::set_operation<ns::set_intersection_operation>("bulk::device::set_intersection",
+                                                                                                           first1, last1, first2, last2,
+                                                                                                           ns::no_values(), ns::no_values(),
+                                                                                                           result, ns::no_values(),
+                                                                                                           comp);
+} // end set_intersection()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 set_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                     RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                     RandomAccessIterator3 result,
+                                     Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + bulk::detail::device_set_operation_detail::set_operation<ns::set_difference_operation>("bulk::device::set_difference",
+                                                                                                         first1, last1, first2, last2,
+                                                                                                         ns::no_values(), ns::no_values(),
+                                                                                                         result, ns::no_values(),
+                                                                                                         comp);
+} // end set_difference()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename Compare>
+RandomAccessIterator3 set_symmetric_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                               RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                               RandomAccessIterator3 result,
+                                               Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  return result + bulk::detail::device_set_operation_detail::set_operation<ns::set_symmetric_difference_operation>("bulk::device::set_symmetric_difference",
+                                                                                                                   first1, last1, first2, last2,
+                                                                                                                   ns::no_values(), ns::no_values(),
+                                                                                                                   result, ns::no_values(),
+                                                                                                                   comp);
+} // end set_symmetric_difference()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_union_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                   RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                   RandomAccessIterator3 values_first1,
+                   RandomAccessIterator4 values_first2,
+                   RandomAccessIterator5 keys_result,
+                   RandomAccessIterator6 values_result,
+                   Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n =
+    bulk::detail::device_set_operation_detail::set_operation<ns::set_union_operation>("bulk::device::set_union_by_key",
+                                                                                      keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                      values_first1, values_first2,
+                                                                                      keys_result, values_result,
+                                                                                      comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_union_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_intersection_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                          RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                          RandomAccessIterator3 values_first1,
+                          RandomAccessIterator4 values_first2,
+                          RandomAccessIterator5 keys_result,
+                          RandomAccessIterator6 values_result,
+                          Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n =
+    bulk::detail::device_set_operation_detail::set_operation<ns::set_intersection_operation>("bulk::device::set_intersection_by_key",
+                                                                                             keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                             values_first1, values_first2,
+                                                                                             keys_result, values_result,
+                                                                                             comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_intersection_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_difference_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                        RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                        RandomAccessIterator3 values_first1,
+                        RandomAccessIterator4 values_first2,
+                        RandomAccessIterator5 keys_result,
+                        RandomAccessIterator6 values_result,
+                        Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n =
+    bulk::detail::device_set_operation_detail::set_operation<ns::set_difference_operation>("bulk::device::set_difference_by_key",
+                                                                                           keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                           values_first1, values_first2,
+                                                                                           keys_result, values_result,
+                                                                                           comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_difference_by_key()
+
+
+template<typename RandomAccessIterator1,
+         typename RandomAccessIterator2,
+         typename RandomAccessIterator3,
+         typename RandomAccessIterator4,
+         typename RandomAccessIterator5,
+         typename RandomAccessIterator6,
+         typename Compare>
+thrust::pair<RandomAccessIterator5,RandomAccessIterator6>
+  set_symmetric_difference_by_key(RandomAccessIterator1 keys_first1, RandomAccessIterator1 keys_last1,
+                                  RandomAccessIterator2 keys_first2, RandomAccessIterator2 keys_last2,
+                                  RandomAccessIterator3 values_first1,
+                                  RandomAccessIterator4 values_first2,
+                                  RandomAccessIterator5 keys_result,
+                                  RandomAccessIterator6 values_result,
+                                  Compare comp)
+{
+  namespace ns = bulk::detail::set_operation_detail;
+
+  typename thrust::iterator_difference<RandomAccessIterator1>::type n =
+    bulk::detail::device_set_operation_detail::set_operation<ns::set_symmetric_difference_operation>("bulk::device::set_symmetric_difference_by_key",
+                                                                                                     keys_first1, keys_last1, keys_first2, keys_last2,
+                                                                                                     values_first1, values_first2,
+                                                                                                     keys_result, values_result,
+                                                                                                     comp);
+
+  return thrust::make_pair(keys_result + n, values_result + n);
+} // end set_symmetric_difference_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
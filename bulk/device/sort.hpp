@@ -0,0 +1,369 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/algorithm/sort.hpp>
+#include <bulk/algorithm/merge.hpp>
+#include <bulk/detail/scratch_partition.hpp>
+#include <bulk/device/multiway_merge.hpp>
+#include <thrust/system/cuda/execution_policy.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/integer_math.h>
+#include <thrust/detail/function.h>
+#include <thrust/tuple.h>
+#include <thrust/tabulate.h>
+#include <thrust/copy.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+namespace device_merge_sort_detail
+{
+
+
+// only the offset of each tile requires Size's width; within a tile, indices fit in an int
+struct stable_sort_each
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename Compare>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, Size count, Compare comp)
+  {
+    typedef typename bulk::concurrent_group<bulk::agent<grainsize>,groupsize>::size_type size_type;
+    const size_type tilesize = groupsize * grainsize;
+  
+    Size gid = static_cast<Size>(tilesize) * g.index();
+    size_type count2 = thrust::min<Size>(tilesize, count - gid);
+  
+    bulk::stable_sort_by_key(bulk::bound<tilesize>(g), keys_first + gid, keys_first + gid + count2, values_first + gid, comp);
+  }
+};
+
+
+template<typename Size>
+__device__
+thrust::tuple<Size,Size,Size,Size>
+  locate_merge_partitions(Size n, Size group_idx, Size num_groups_per_merge, Size num_elements_per_group, Size mp, Size right_mp)
+{
+  Size first_group_in_partition = ~(num_groups_per_merge - 1) & group_idx;
+  Size partition_size = num_elements_per_group * (num_groups_per_merge >> 1);
+
+  Size partition_first1 = num_elements_per_group * first_group_in_partition;
+  Size partition_first2 = partition_first1 + partition_size;
+
+  // Locate diag from the start of the A sublist.
+  Size diag = num_elements_per_group * group_idx - partition_first1;
+  Size start1 = partition_first1 + mp;
+  Size end1 = thrust::min<Size>(n, partition_first1 + right_mp);
+  Size start2 = thrust::min<Size>(n, partition_first2 + diag - mp);
+  Size end2 = thrust::min<Size>(n, partition_first2 + diag + num_elements_per_group - right_mp);
+  
+  // The end partition of the last group for each merge operation is computed
+  // and stored as the begin partition for the subsequent merge. i.e. it is
+  // the same partition but in the wrong coordinate system, so its 0 when it
+  // should be listSize. Correct that by checking if this is the last group
+  // in this merge operation.
+  if(num_groups_per_merge - 1 == ((num_groups_per_merge - 1) & group_idx))
+  {
+    end1 = thrust::min<Size>(n, partition_first1 + partition_size);
+    end2 = thrust::min<Size>(n, partition_first2 + partition_size);
+  }
+
+  return thrust::make_tuple(start1, end1, start2, end2);
+}
+
+
+struct merge_by_key
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1, 
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename RandomAccessIterator5,
+           typename Size,
+           typename Compare>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>, groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, Size n, RandomAccessIterator3 merge_paths, int num_groups_per_merge, RandomAccessIterator4 keys_result, RandomAccessIterator5 values_result, Compare comp)
+  {
+    Size a0, a1, b0, b1;
+    thrust::tie(a0, a1, b0, b1) = locate_merge_partitions<Size>(n, g.index(), num_groups_per_merge, groupsize * grainsize, merge_paths[g.index()], merge_paths[g.index()+1]);
+
+    Size tile_offset = static_cast<Size>(groupsize * grainsize) * g.index();
+    
+    bulk::merge_by_key(bulk::bound<groupsize*grainsize>(g),
+                       keys_first + a0, keys_first + a1,
+                       keys_first + b0, keys_first + b1,
+                       values_first + a0,
+                       values_first + b0,
+                       keys_result   + tile_offset,
+                       values_result + tile_offset,
+                       comp);
+  }
+};
+
+
+template<typename Iterator, typename Size, typename Compare>
+struct locate_merge_path
+{
+  Iterator haystack_first;
+  Size haystack_size;
+  Size num_elements_per_group;
+  Size num_groups_per_merge;
+  thrust::detail::wrapped_function<Compare,bool> comp;
+
+  locate_merge_path(Iterator haystack_first, Size haystack_size, Size num_elements_per_group, Size num_groups_per_merge, Compare comp)
+    : haystack_first(haystack_first),
+      haystack_size(haystack_size),
+      num_elements_per_group(num_elements_per_group),
+      num_groups_per_merge(num_groups_per_merge),
+      comp(comp)
+  {}
+
+  template<typename Index>
+  __host__ __device__
+  Index operator()(Index merge_path_idx)
+  {
+    // find the index of the first group that will participate in the eventual merge
+    Size first_group_in_partition = ~(num_groups_per_merge - 1) & merge_path_idx;
+
+    // the size of each group's input
+    Size size = num_elements_per_group * (num_groups_per_merge / 2);
+
+    // find pointers to the two input arrays
+    Size start1 = num_elements_per_group * first_group_in_partition;
+    Size start2 = thrust::min<Size>(haystack_size, start1 + size);
+
+    // the size of each input array
+    // note we clamp to the end of the total input to handle the last partial list
+    Size n1 = thrust::min<Size>(size, haystack_size - start1);
+    Size n2 = thrust::min<Size>(size, haystack_size - start2);
+    
+    // note that diag is computed as an offset from the beginning of the first list
+    Size diag = thrust::min<Size>(n1 + n2, num_elements_per_group * merge_path_idx - start1);
+
+    return bulk::merge_path(haystack_first + start1, n1, haystack_first + start2, n2, diag, comp);
+  }
+};
+
+
+template<typename Iterator1, typename Size1, typename Iterator2, typename Size2, typename Size3, typename Compare>
+void locate_merge_paths(cudaStream_t stream,
+                        Iterator1 result,
+                        Size1 n,
+                        Iterator2 haystack_first,
+                        Size2 haystack_size,
+                        Size3 num_elements_per_group,
+                        Size3 num_groups_per_merge,
+                        Compare comp)
+{
+  locate_merge_path<Iterator2,Size2,Compare> f(haystack_first, haystack_size, num_elements_per_group, num_groups_per_merge, comp);
+
+  thrust::tabulate(thrust::cuda::par.on(stream), result, result + n, f);
+}
+
+
+} // end device_merge_sort_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// sorts [keys_first, keys_last) in place & permutes values_first accordingly
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_merge_sort_by_key(void *scratch, std::size_t &scratch_bytes,
+                              RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                              RandomAccessIterator2 values_first,
+                              Compare comp,
+                              cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  // n & offsets into the input may exceed an int, but the number of tiles may not
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  // 78/77/92
+  const int groupsize = 128;
+  const int grainsize = 7;
+  
+  const int tilesize = groupsize * grainsize;
+  size_type n = keys_last - keys_first;
+  int num_groups = (n + tilesize - 1) / tilesize;
+  int num_passes = thrust::detail::log2_ri(thrust::max<int>(num_groups, 1));
+
+  bulk::detail::scratch_partition partition(scratch);
+
+  // ping-pong buffers are only required when there is more than one tile to merge
+  key_type   *keys_pong   = partition.allocate<key_type>(num_passes > 0 ? n : 0);
+  value_type *values_pong = partition.allocate<value_type>(num_passes > 0 ? n : 0);
+  size_type  *merge_paths = partition.allocate<size_type>(num_passes > 0 ? num_groups + 1 : 0);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::stable_merge_sort_by_key") || n <= 0) return;
+
+  namespace ns = bulk::detail::device_merge_sort_detail;
+
+  int heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(value_type));
+  bulk::async(bulk::named("bulk::device::stable_merge_sort_by_key", bulk::grid<groupsize,grainsize>(num_groups, heap_size, stream)), ns::stable_sort_each(), bulk::root.this_exec, keys_first, values_first, n, comp);
+
+  // ping being true means the latest data is in the source array
+  bool ping = true;
+
+  // merge_by_key's heap requirements differ: its stage is padded for bank-conflict-free exchange
+  heap_size = bulk::exchange_buffer_size<tilesize>::value * thrust::max(sizeof(key_type), sizeof(int));
+
+  for(int pass = 0; pass < num_passes; ++pass, ping = !ping) 
+  {
+    int num_groups_per_merge = 2 << pass;
+
+    if(ping)
+    {
+      ns::locate_merge_paths(stream, merge_paths, num_groups + 1, keys_first, n, tilesize, num_groups_per_merge, comp);
+      
+      bulk::async(bulk::named("bulk::device::stable_merge_sort_by_key", bulk::grid<groupsize,grainsize>(num_groups, heap_size, stream)), ns::merge_by_key(), bulk::root.this_exec, keys_first, values_first, n, merge_paths, num_groups_per_merge, keys_pong, values_pong, comp);
+    }
+    else
+    {
+      ns::locate_merge_paths(stream, merge_paths, num_groups + 1, keys_pong, n, tilesize, num_groups_per_merge, comp);
+      
+      bulk::async(bulk::named("bulk::device::stable_merge_sort_by_key", bulk::grid<groupsize,grainsize>(num_groups, heap_size, stream)), ns::merge_by_key(), bulk::root.this_exec, keys_pong, values_pong, n, merge_paths, num_groups_per_merge, keys_first, values_first, comp);
+    }
+  }
+
+  if(!ping)
+  {
+    thrust::copy_n(thrust::cuda::par.on(stream), keys_pong, n,   keys_first);
+    thrust::copy_n(thrust::cuda::par.on(stream), values_pong, n, values_first);
+  }
+} // end stable_merge_sort_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                              RandomAccessIterator2 values_first,
+                              Compare comp)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::stable_merge_sort_by_key(0, scratch_bytes, keys_first, keys_last, values_first, comp);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::stable_merge_sort_by_key(scratch.data(), scratch_bytes, keys_first, keys_last, values_first, comp);
+} // end stable_merge_sort_by_key()
+
+
+// sorts [keys_first, keys_last) in place & permutes values_first accordingly like stable_merge_sort_by_key,
+// but each pass merges many runs at once, so there are about log_ways(n / tilesize) passes over the input rather than log_2
+// when scratch is null, only records the size of the scratch space required in scratch_bytes
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_multiway_merge_sort_by_key(void *scratch, std::size_t &scratch_bytes,
+                                       RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                       RandomAccessIterator2 values_first,
+                                       Compare comp,
+                                       cudaStream_t stream = 0)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  // n & offsets into the input may exceed an int, but the number of tiles may not
+  typedef typename thrust::iterator_difference<RandomAccessIterator1>::type size_type;
+
+  namespace ns = bulk::detail::device_multiway_merge_detail;
+
+  // XXX the number of ways isn't tuned
+  const int ways = 8;
+
+  const int groupsize = ns::merge_groupsize;
+  const int grainsize = ns::merge_grainsize;
+
+  const int tilesize = groupsize * grainsize;
+  size_type n = keys_last - keys_first;
+  int num_groups = (n + tilesize - 1) / tilesize;
+
+  int num_passes = 0;
+  for(int num_runs = num_groups; num_runs > 1; num_runs = (num_runs + ways - 1) / ways)
+  {
+    ++num_passes;
+  } // end for
+
+  bulk::detail::scratch_partition partition(scratch);
+
+  // ping-pong buffers are only required when there is more than one tile to merge
+  key_type   *keys_pong   = partition.allocate<key_type>(num_passes > 0 ? n : 0);
+  value_type *values_pong = partition.allocate<value_type>(num_passes > 0 ? n : 0);
+  size_type  *paths       = partition.allocate<size_type>(num_passes > 0 ? ns::num_paths(n, ways) : 0);
+
+  if(!bulk::detail::check_scratch(scratch, scratch_bytes, partition, "bulk::device::stable_multiway_merge_sort_by_key") || n <= 0) return;
+
+  int heap_size = tilesize * thrust::max(sizeof(key_type), sizeof(value_type));
+  bulk::async(bulk::named("bulk::device::stable_multiway_merge_sort_by_key", bulk::grid<groupsize,grainsize>(num_groups, heap_size, stream)), bulk::detail::device_merge_sort_detail::stable_sort_each(), bulk::root.this_exec, keys_first, values_first, n, comp);
+
+  // ping being true means the latest data is in the source array
+  bool ping = true;
+
+  size_type run_size = tilesize;
+
+  for(int pass = 0; pass < num_passes; ++pass, ping = !ping)
+  {
+    ns::uniform_runs<size_type> runs(n, run_size, ways);
+
+    if(ping)
+    {
+      ns::merge_runs_by_key("bulk::device::stable_multiway_merge_sort_by_key", stream, keys_first, values_first, n, runs, paths, keys_pong, values_pong, comp);
+    }
+    else
+    {
+      ns::merge_runs_by_key("bulk::device::stable_multiway_merge_sort_by_key", stream, keys_pong, values_pong, n, runs, paths, keys_first, values_first, comp);
+    }
+
+    // avoid overflow after the last pass
+    if(pass + 1 < num_passes) run_size *= ways;
+  }
+
+  if(!ping)
+  {
+    thrust::copy_n(thrust::cuda::par.on(stream), keys_pong, n,   keys_first);
+    thrust::copy_n(thrust::cuda::par.on(stream), values_pong, n, values_first);
+  }
+} // end stable_multiway_merge_sort_by_key()
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename Compare>
+void stable_multiway_merge_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+                                       RandomAccessIterator2 values_first,
+                                       Compare comp)
+{
+  std::size_t scratch_bytes = 0;
+  bulk::device::stable_multiway_merge_sort_by_key(0, scratch_bytes, keys_first, keys_last, values_first, comp);
+
+  bulk::detail::temporary_scratch scratch(scratch_bytes);
+  bulk::device::stable_multiway_merge_sort_by_key(scratch.data(), scratch_bytes, keys_first, keys_last, values_first, comp);
+} // end stable_multiway_merge_sort_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,580 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/async.hpp>
+#include <bulk/future.hpp>
+#include <bulk/device/decomposition.hpp>
+#include <bulk/device/reduce.hpp>
+#include <bulk/device/scan.hpp>
+#include <bulk/device/reduce_by_key.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/caching_allocator.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <thrust/detail/minmax.h>
+#include <thrust/iterator/iterator_traits.h>
+#include <thrust/pair.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace device
+{
+
+
+// streams inputs which don't fit in device memory through a few device buffers one chunk at a time.
+// Each buffer has its own stream, so while one chunk computes, the next chunks' copies to the device
+// and the previous chunks' copies back to the host are in flight. Each chunk's computation begins after
+// the previous chunk's, so a chunk may consume a carry which its predecessor left on the device.
+// For the copies to overlap, the host ranges should be pinned, e.g. with cudaHostRegister for mmap'd files
+// XXX the streaming algorithms below accept only raw pointers to host memory
+class streaming_executor
+{
+  public:
+    static const int max_num_buffers = 4;
+
+    // the number of elements streamed through each buffer at once, unless the caller chooses otherwise
+    static const std::size_t default_chunk_size = 1 << 22;
+
+    inline explicit streaming_executor(std::size_t chunk_size = default_chunk_size, int num_buffers = 3)
+      : m_device(bulk::detail::current_device()),
+        m_chunk_size(thrust::max<std::size_t>(1, chunk_size)),
+        m_num_buffers(thrust::max(1, thrust::min(num_buffers, int(max_num_buffers))))
+    {
+      for(int i = 0; i < m_num_buffers; ++i)
+      {
+        m_streams[i]  = bulk::detail::acquire_stream(m_device);
+        m_computed[i] = bulk::detail::acquire_event(m_device);
+      } // end for i
+    } // end streaming_executor()
+
+    inline ~streaming_executor()
+    {
+      // XXX there's no way to report an error from a destructor
+      for(int i = 0; i < m_num_buffers; ++i)
+      {
+        bulk::detail::release_stream(m_device, m_streams[i]);
+        bulk::detail::release_event(m_device, m_computed[i]);
+      } // end for i
+    } // end ~streaming_executor()
+
+    inline std::size_t chunk_size() const
+    {
+      return m_chunk_size;
+    } // end chunk_size()
+
+    inline int num_buffers() const
+    {
+      return m_num_buffers;
+    } // end num_buffers()
+
+    // streams n elements through stage, which receives these calls for each chunk [first, first + count):
+    //
+    //   stage.copy_in(buffer, first, count, stream);
+    //   stage.compute(buffer, chunk, first, count, stream);
+    //   stage.copy_out(buffer, first, count, stream);
+    //
+    // Each enqueues work on stream, which belongs to buffer alone until the chunk's copy_out
+    // Returns once every chunk's copy_out is complete
+    template<typename Stage>
+    void operator()(std::size_t n, Stage &stage)
+    {
+      std::size_t num_chunks = (n + m_chunk_size - 1) / m_chunk_size;
+
+      std::size_t num_copied_in = 0;
+
+      for(std::size_t chunk = 0; chunk < num_chunks; ++chunk)
+      {
+        // before anything which might block the host, start copying as many of the upcoming chunks
+        // as have a buffer to land in: each buffer is free once its last chunk's copy_out is enqueued
+        for(; num_copied_in < num_chunks && num_copied_in < chunk + m_num_buffers; ++num_copied_in)
+        {
+          stage.copy_in(buffer(num_copied_in), first(num_copied_in), count(n, num_copied_in), stream(num_copied_in));
+        } // end for
+
+        if(chunk > 0)
+        {
+          bulk::detail::throw_on_error(cudaStreamWaitEvent(stream(chunk), m_computed[buffer(chunk - 1)], 0),
+                                       "cudaStreamWaitEvent in streaming_executor");
+        } // end if
+
+        stage.compute(buffer(chunk), chunk, first(chunk), count(n, chunk), stream(chunk));
+
+        bulk::detail::throw_on_error(cudaEventRecord(m_computed[buffer(chunk)], stream(chunk)),
+                                     "cudaEventRecord in streaming_executor");
+
+        stage.copy_out(buffer(chunk), first(chunk), count(n, chunk), stream(chunk));
+      } // end for chunk
+
+      for(int i = 0; i < m_num_buffers; ++i)
+      {
+        bulk::detail::throw_on_error(cudaStreamSynchronize(m_streams[i]), "cudaStreamSynchronize in streaming_executor");
+      } // end for i
+    } // end operator()()
+
+  private:
+    inline int buffer(std::size_t chunk) const
+    {
+      return static_cast<int>(chunk % m_num_buffers);
+    } // end buffer()
+
+    inline cudaStream_t stream(std::size_t chunk) const
+    {
+      return m_streams[buffer(chunk)];
+    } // end stream()
+
+    inline std::size_t first(std::size_t chunk) const
+    {
+      return chunk * m_chunk_size;
+    } // end first()
+
+    inline std::size_t count(std::size_t n, std::size_t chunk) const
+    {
+      return thrust::min(m_chunk_size, n - first(chunk));
+    } // end count()
+
+    int          m_device;
+    std::size_t  m_chunk_size;
+    int          m_num_buffers;
+    cudaStream_t m_streams[max_num_buffers];
+    cudaEvent_t  m_computed[max_num_buffers];
+
+    // non-copyable
+    streaming_executor(const streaming_executor &);
+    streaming_executor &operator=(const streaming_executor &);
+}; // end streaming_executor
+
+
+} // end device
+
+
+namespace detail
+{
+namespace streaming_detail
+{
+
+
+// rounds scratch spaces up so that each buffer's begins suitably aligned
+inline std::size_t align_scratch(std::size_t num_bytes)
+{
+  const std::size_t alignment = bulk::detail::scratch_partition::alignment;
+  return (num_bytes + alignment - 1) / alignment * alignment;
+} // end align_scratch()
+
+
+template<typename T>
+void copy_to_device(T *dst, const T *src, std::size_t n, cudaStream_t stream)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(dst, src, n * sizeof(T), cudaMemcpyHostToDevice, stream),
+                               "cudaMemcpyAsync in streaming_executor");
+} // end copy_to_device()
+
+
+template<typename T>
+void copy_to_host(T *dst, const T *src, std::size_t n, cudaStream_t stream)
+{
+  bulk::detail::throw_on_error(cudaMemcpyAsync(dst, src, n * sizeof(T), cudaMemcpyDeviceToHost, stream),
+                               "cudaMemcpyAsync in streaming_executor");
+} // end copy_to_host()
+
+
+// each chunk's scan continues from the total of the chunks before it, which stays on the device
+template<bool inclusive, typename InputType, typename OutputType, typename T, typename BinaryFunction>
+class scan_stage
+{
+  public:
+    scan_stage(const bulk::device::streaming_executor &exec, const InputType *first, OutputType *result, T init, BinaryFunction binary_op)
+      : m_first(first), m_result(result), m_init(init), m_binary_op(binary_op),
+        m_chunk_size(exec.chunk_size()),
+        m_scratch_bytes(query_scratch_bytes(exec.chunk_size(), init, binary_op)),
+        m_inputs(exec.num_buffers() * exec.chunk_size()),
+        m_outputs(exec.num_buffers() * exec.chunk_size()),
+        m_scratch(exec.num_buffers() * m_scratch_bytes),
+        m_totals(2)
+    {}
+
+    void copy_in(int buffer, std::size_t first, std::size_t count, cudaStream_t stream)
+    {
+      copy_to_device(inputs(buffer), m_first + first, count, stream);
+    }
+
+    void compute(int buffer, std::size_t chunk, std::size_t, std::size_t count, cudaStream_t stream)
+    {
+      const char *name = inclusive ? "bulk::device::streaming_inclusive_scan" : "bulk::device::streaming_exclusive_scan";
+
+      // chunk writes its total where chunk + 1 will read it
+      const T *carry_in = chunk > 0 ? m_totals.data() + (chunk + 1) % 2 : 0;
+      T *total          = m_totals.data() + chunk % 2;
+
+      std::size_t scratch_bytes = m_scratch_bytes;
+
+      bulk::detail::device_scan_detail::scan_tiles_n<inclusive>(m_scratch.data() + buffer * m_scratch_bytes, scratch_bytes, name,
+                                                                inputs(buffer), std::ptrdiff_t(count),
+                                                                outputs(buffer),
+                                                                m_init, m_binary_op,
+                                                                carry_in, total,
+                                                                stream);
+    }
+
+    void copy_out(int buffer, std::size_t first, std::size_t count, cudaStream_t stream)
+    {
+      copy_to_host(m_result + first, outputs(buffer), count, stream);
+    }
+
+  private:
+    static std::size_t query_scratch_bytes(std::size_t chunk_size, T init, BinaryFunction binary_op)
+    {
+      std::size_t result = 0;
+      bulk::detail::device_scan_detail::scan_tiles_n<inclusive>(0, result, "",
+                                                                (const InputType*)0, std::ptrdiff_t(chunk_size),
+                                                                (OutputType*)0,
+                                                                init, binary_op,
+                                                                (const T*)0, (T*)0,
+                                                                0);
+      return align_scratch(result);
+    }
+
+    InputType *inputs(int buffer)
+    {
+      return m_inputs.data() + buffer * m_chunk_size;
+    }
+
+    OutputType *outputs(int buffer)
+    {
+      return m_outputs.data() + buffer * m_chunk_size;
+    }
+
+    const InputType *m_first;
+    OutputType      *m_result;
+    T                m_init;
+    BinaryFunction   m_binary_op;
+    std::size_t      m_chunk_size;
+    std::size_t      m_scratch_bytes;
+
+    bulk::detail::cached_array<InputType>  m_inputs;
+    bulk::detail::cached_array<OutputType> m_outputs;
+    bulk::detail::cached_array<char>       m_scratch;
+    bulk::detail::cached_array<T>          m_totals;
+};
+
+
+// each chunk reduces to a few partial sums, which are reduced once the input is exhausted
+template<typename InputType, typename T, typename BinaryFunction>
+class reduce_stage
+{
+  public:
+    reduce_stage(const bulk::device::streaming_executor &exec, std::size_t n, const InputType *first, BinaryFunction binary_op)
+      : m_first(first), m_binary_op(binary_op),
+        m_chunk_size(exec.chunk_size()),
+        m_partials_per_chunk(bulk::detail::device_reduce_detail::num_partials<std::ptrdiff_t>(exec.chunk_size())),
+        m_inputs(exec.num_buffers() * exec.chunk_size()),
+        m_partials(m_partials_per_chunk * ((n + exec.chunk_size() - 1) / exec.chunk_size())),
+        m_num_partials(0)
+    {}
+
+    void copy_in(int buffer, std::size_t first, std::size_t count, cudaStream_t stream)
+    {
+      copy_to_device(inputs(buffer), m_first + first, count, stream);
+    }
+
+    void compute(int buffer, std::size_t chunk, std::size_t, std::size_t count, cudaStream_t stream)
+    {
+      namespace ns = bulk::detail::device_reduce_detail;
+
+      typedef std::ptrdiff_t size_type;
+
+      const size_type tile_size = ns::partials_groupsize * ns::partials_grainsize;
+
+      // only the last chunk may be short enough to produce fewer partials
+      bulk::device::aligned_decomposition<size_type> decomp(count, ns::num_partials<size_type>(count), tile_size);
+
+      ns::reduce_to_partials("bulk::device::streaming_reduce", inputs(buffer), decomp, m_partials.data() + chunk * m_partials_per_chunk, m_binary_op, stream);
+
+      m_num_partials = chunk * m_partials_per_chunk + decomp.size();
+    }
+
+    void copy_out(int, std::size_t, std::size_t, cudaStream_t) {}
+
+    T result(T init)
+    {
+      bulk::detail::cached_array<T> sum(1);
+
+      // every chunk has been reduced by the time the executor returns
+      bulk::future<void> done =
+        bulk::detail::device_reduce_detail::reduce_partials_with_one_group("bulk::device::streaming_reduce", m_partials.data(), m_num_partials, init, m_binary_op, sum.data(), 0);
+
+      return bulk::async_get(done, sum.data()).get();
+    }
+
+  private:
+    InputType *inputs(int buffer)
+    {
+      return m_inputs.data() + buffer * m_chunk_size;
+    }
+
+    const InputType *m_first;
+    BinaryFunction   m_binary_op;
+    std::size_t      m_chunk_size;
+    std::ptrdiff_t   m_partials_per_chunk;
+
+    bulk::detail::cached_array<InputType> m_inputs;
+    bulk::detail::cached_array<T>         m_partials;
+    std::ptrdiff_t                        m_num_partials;
+};
+
+
+// each chunk continues the segment the chunk before it left unfinished on the device,
+// and leaves its own last segment for the next chunk to finish
+template<typename Key, typename Value, typename BinaryPredicate, typename BinaryFunction>
+class reduce_by_key_stage
+{
+  public:
+    typedef std::ptrdiff_t size_type;
+    typedef typename bulk::detail::device_reduce_by_key_detail::segment_prefix_for<Key*,Value*>::type prefix_type;
+    typedef bulk::detail::device_reduce_by_key_detail::chunk_state<size_type,prefix_type> chunk_state_type;
+
+    reduce_by_key_stage(const bulk::device::streaming_executor &exec, std::size_t n,
+                        const Key *keys_first, const Value *values_first,
+                        Key *keys_result, Value *values_result,
+                        BinaryPredicate pred, BinaryFunction binary_op)
+      : m_keys_first(keys_first), m_values_first(values_first),
+        m_keys_result(keys_result), m_values_result(values_result),
+        m_pred(pred), m_binary_op(binary_op),
+        m_num_chunks((n + exec.chunk_size() - 1) / exec.chunk_size()),
+        m_chunk_size(exec.chunk_size()),
+        m_scratch_bytes(query_scratch_bytes(exec.chunk_size(), pred, binary_op)),
+        m_keys(exec.num_buffers() * exec.chunk_size()),
+        m_values(exec.num_buffers() * exec.chunk_size()),
+        m_keys_out(exec.num_buffers() * exec.chunk_size()),
+        m_values_out(exec.num_buffers() * exec.chunk_size()),
+        m_scratch(exec.num_buffers() * m_scratch_bytes),
+        m_result_sizes(exec.num_buffers()),
+        m_carries(2),
+        m_num_segments(0)
+    {}
+
+    void copy_in(int buffer, std::size_t first, std::size_t count, cudaStream_t stream)
+    {
+      copy_to_device(keys(buffer),   m_keys_first + first,   count, stream);
+      copy_to_device(values(buffer), m_values_first + first, count, stream);
+    }
+
+    void compute(int buffer, std::size_t chunk, std::size_t, std::size_t count, cudaStream_t stream)
+    {
+      // chunk leaves its last segment where chunk + 1 will read it, except for the last chunk, which outputs it
+      const prefix_type *carry_in = chunk > 0 ? m_carries.data() + (chunk + 1) % 2 : 0;
+      prefix_type *carry_out      = chunk + 1 < m_num_chunks ? m_carries.data() + chunk % 2 : 0;
+
+      std::size_t scratch_bytes = m_scratch_bytes;
+
+      m_done = bulk::detail::device_reduce_by_key_detail::reduce_by_key_n(m_scratch.data() + buffer * m_scratch_bytes, scratch_bytes,
+                                                                            keys(buffer), size_type(count), values(buffer),
+                                                                            keys_out(buffer), values_out(buffer),
+                                                                            chunk_state_type(m_result_sizes.data() + buffer, carry_in, carry_out),
+                                                                            m_pred, m_binary_op,
+                                                                            stream);
+    }
+
+    // XXX this waits for the chunk's number of segments to arrive on the host
+    void copy_out(int buffer, std::size_t, std::size_t, cudaStream_t stream)
+    {
+      size_type num_segments = bulk::async_get(m_done, m_result_sizes.data() + buffer).get();
+
+      copy_to_host(m_keys_result + m_num_segments,   keys_out(buffer),   num_segments, stream);
+      copy_to_host(m_values_result + m_num_segments, values_out(buffer), num_segments, stream);
+
+      m_num_segments += num_segments;
+    }
+
+    size_type num_segments() const
+    {
+      return m_num_segments;
+    }
+
+  private:
+    static std::size_t query_scratch_bytes(std::size_t chunk_size, BinaryPredicate pred, BinaryFunction binary_op)
+    {
+      std::size_t result = 0;
+      bulk::detail::device_reduce_by_key_detail::reduce_by_key_n(0, result,
+                                                                 (Key*)0, size_type(chunk_size), (Value*)0,
+                                                                 (Key*)0, (Value*)0,
+                                                                 chunk_state_type(0, 0, 0),
+                                                                 pred, binary_op,
+                                                                 0);
+      return align_scratch(result);
+    }
+
+    Key *keys(int buffer)         { return m_keys.data()       + buffer * m_chunk_size; }
+    Value *values(int buffer)     { return m_values.data()     + buffer * m_chunk_size; }
+    Key *keys_out(int buffer)     { return m_keys_out.data()   + buffer * m_chunk_size; }
+    Value *values_out(int buffer) { return m_values_out.data() + buffer * m_chunk_size; }
+
+    const Key       *m_keys_first;
+    const Value     *m_values_first;
+    Key             *m_keys_result;
+    Value           *m_values_result;
+    BinaryPredicate  m_pred;
+    BinaryFunction   m_binary_op;
+    std::size_t      m_num_chunks;
+    std::size_t      m_chunk_size;
+    std::size_t      m_scratch_bytes;
+
+    bulk::detail::cached_array<Key>         m_keys;
+    bulk::detail::cached_array<Value>       m_values;
+    bulk::detail::cached_array<Key>         m_keys_out;
+    bulk::detail::cached_array<Value>       m_values_out;
+    bulk::detail::cached_array<char>        m_scratch;
+    bulk::detail::cached_array<size_type>   m_result_sizes;
+    bulk::detail::cached_array<prefix_type> m_carries;
+
+    bulk::future<void> m_done;
+    size_type          m_num_segments;
+};
+
+
+} // end streaming_detail
+} // end detail
+
+
+namespace device
+{
+
+
+// like bulk::device::inclusive_scan, for host ranges too large to fit in device memory
+// [first, last) & result are in host memory; each chunk's scan continues from the last without a round trip to the host
+template<typename InputType, typename OutputType, typename T, typename BinaryFunction>
+OutputType *streaming_inclusive_scan(const InputType *first, const InputType *last,
+                                     OutputType *result,
+                                     T init,
+                                     BinaryFunction binary_op,
+                                     streaming_executor &exec)
+{
+  typedef typename bulk::detail::scan_detail::scan_intermediate<const InputType*,OutputType*,BinaryFunction>::type intermediate_type;
+
+  bulk::detail::streaming_detail::scan_stage<true,InputType,OutputType,intermediate_type,BinaryFunction> stage(exec, first, result, init, binary_op);
+  exec(last - first, stage);
+
+  return result + (last - first);
+} // end streaming_inclusive_scan()
+
+
+template<typename InputType, typename OutputType, typename T, typename BinaryFunction>
+OutputType *streaming_inclusive_scan(const InputType *first, const InputType *last,
+                                     OutputType *result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  streaming_executor exec;
+  return bulk::device::streaming_inclusive_scan(first, last, result, init, binary_op, exec);
+} // end streaming_inclusive_scan()
+
+
+// like bulk::device::exclusive_scan, for host ranges too large to fit in device memory
+template<typename InputType, typename OutputType, typename T, typename BinaryFunction>
+OutputType *streaming_exclusive_scan(const InputType *first, const InputType *last,
+                                     OutputType *result,
+                                     T init,
+                                     BinaryFunction binary_op,
+                                     streaming_executor &exec)
+{
+  typedef typename bulk::detail::scan_detail::scan_intermediate<const InputType*,OutputType*,BinaryFunction>::type intermediate_type;
+
+  bulk::detail::streaming_detail::scan_stage<false,InputType,OutputType,intermediate_type,BinaryFunction> stage(exec, first, result, init, binary_op);
+  exec(last - first, stage);
+
+  return result + (last - first);
+} // end streaming_exclusive_scan()
+
+
+template<typename InputType, typename OutputType, typename T, typename BinaryFunction>
+OutputType *streaming_exclusive_scan(const InputType *first, const InputType *last,
+                                     OutputType *result,
+                                     T init,
+                                     BinaryFunction binary_op)
+{
+  streaming_executor exec;
+  return bulk::device::streaming_exclusive_scan(first, last, result, init, binary_op, exec);
+} // end streaming_exclusive_scan()
+
+
+// returns init + first[0] + ... + first[n-1] for a host range too large to fit in device memory
+template<typename InputType, typename T, typename BinaryFunction>
+T streaming_reduce(const InputType *first, const InputType *last,
+                   T init,
+                   BinaryFunction binary_op,
+                   streaming_executor &exec)
+{
+  if(first == last) return init;
+
+  bulk::detail::streaming_detail::reduce_stage<InputType,T,BinaryFunction> stage(exec, last - first, first, binary_op);
+  exec(last - first, stage);
+
+  return stage.result(init);
+} // end streaming_reduce()
+
+
+template<typename InputType, typename T, typename BinaryFunction>
+T streaming_reduce(const InputType *first, const InputType *last,
+                   T init,
+                   BinaryFunction binary_op)
+{
+  streaming_executor exec;
+  return bulk::device::streaming_reduce(first, last, init, binary_op, exec);
+} // end streaming_reduce()
+
+
+// like bulk::device::reduce_by_key, for host ranges too large to fit in device memory
+// segments may span chunks: each chunk carries its last segment into the next on the device
+template<typename Key, typename Value, typename BinaryPredicate, typename BinaryFunction>
+thrust::pair<Key*,Value*>
+  streaming_reduce_by_key(const Key *keys_first, const Key *keys_last,
+                          const Value *values_first,
+                          Key *keys_result,
+                          Value *values_result,
+                          BinaryPredicate pred,
+                          BinaryFunction binary_op,
+                          streaming_executor &exec)
+{
+  bulk::detail::streaming_detail::reduce_by_key_stage<Key,Value,BinaryPredicate,BinaryFunction> stage(exec, keys_last - keys_first, keys_first, values_first, keys_result, values_result, pred, binary_op);
+  exec(keys_last - keys_first, stage);
+
+  return thrust::make_pair(keys_result + stage.num_segments(), values_result + stage.num_segments());
+} // end streaming_reduce_by_key()
+
+
+template<typename Key, typename Value, typename BinaryPredicate, typename BinaryFunction>
+thrust::pair<Key*,Value*>
+  streaming_reduce_by_key(const Key *keys_first, const Key *keys_last,
+                          const Value *values_first,
+                          Key *keys_result,
+                          Value *values_result,
+                          BinaryPredicate pred,
+                          BinaryFunction binary_op)
+{
+  streaming_executor exec;
+  return bulk::device::streaming_reduce_by_key(keys_first, keys_last, values_first, keys_result, values_result, pred, binary_op, exec);
+} // end streaming_reduce_by_key()
+
+
+} // end device
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,249 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// describes the portion of a launch spanning several devices which executes on a single device
+// the group with index g.index() within the slice has index first_group + g.index() within the whole launch
+struct device_slice_t
+{
+  int         device;
+  std::size_t first_group;
+  std::size_t num_groups;
+  std::size_t total_num_groups;
+};
+
+
+// a level of the hierarchy above the grid: device_group splits the groups of a parallel_group
+// evenly across the devices [first_device(), first_device() + size())
+template<typename ExecutionAgent>
+class device_group
+{
+  public:
+    typedef parallel_group<ExecutionAgent> group_type;
+
+    __host__
+    device_group(group_type g, int num_devices, int first_device = 0)
+      : m_exec(g), m_num_devices(num_devices), m_first_device(first_device)
+    {}
+
+    __host__
+    group_type exec() const
+    {
+      return m_exec;
+    }
+
+    // the number of devices
+    __host__
+    int size() const
+    {
+      return m_num_devices;
+    }
+
+    __host__
+    int first_device() const
+    {
+      return m_first_device;
+    }
+
+    __host__
+    device_slice_t slice(int i) const
+    {
+      std::size_t total = m_exec.size();
+
+      device_slice_t result;
+      result.device           = m_first_device + i;
+      result.first_group      = (total * i) / m_num_devices;
+      result.num_groups       = (total * (i + 1)) / m_num_devices - result.first_group;
+      result.total_num_groups = total;
+
+      return result;
+    }
+
+  private:
+    group_type m_exec;
+    int        m_num_devices;
+    int        m_first_device;
+};
+
+
+// shorthand for spanning the groups of g across the first num_devices devices
+template<typename ExecutionAgent>
+__host__
+device_group<ExecutionAgent> devices(int num_devices, parallel_group<ExecutionAgent> g)
+{
+  return device_group<ExecutionAgent>(g, num_devices);
+} // end devices()
+
+
+// shorthand for spanning the groups of g across every device
+template<typename ExecutionAgent>
+__host__
+device_group<ExecutionAgent> devices(parallel_group<ExecutionAgent> g)
+{
+  int num_devices = 0;
+  bulk::detail::throw_on_error(cudaGetDeviceCount(&num_devices), "cudaGetDeviceCount in bulk::devices");
+
+  return device_group<ExecutionAgent>(g, num_devices);
+} // end devices()
+
+
+namespace detail
+{
+
+
+// invokes f with the slice of the multi-device launch inserted after its first argument,
+// which is typically the execution group
+template<typename Function>
+class device_slice_function
+{
+  public:
+    __host__ __device__
+    device_slice_function(Function f, device_slice_t slice)
+      : m_f(f), m_slice(slice)
+    {}
+
+    template<typename Arg1>
+    __device__
+    void operator()(Arg1 &arg1)
+    {
+      m_f(arg1, m_slice);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2)
+    {
+      m_f(arg1, m_slice, arg2);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3)
+    {
+      m_f(arg1, m_slice, arg2, arg3);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4, arg5);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4, arg5, arg6);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4, arg5, arg6, arg7);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+    } // end operator()
+
+    template<typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+    __device__
+    void operator()(Arg1 &arg1, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8, Arg9 &arg9)
+    {
+      m_f(arg1, m_slice, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9);
+    } // end operator()
+
+  private:
+    Function       m_f;
+    device_slice_t m_slice;
+}; // end device_slice_function
+
+
+// launches a slice of c on each device and returns a future which becomes ready once every slice is complete
+// the future's stream belongs to the device which was current when async was called
+// XXX any memory the closure refers to must be accessible from every device, e.g. managed or peer-mapped
+template<typename ExecutionAgent, typename Function, typename Arguments>
+__host__
+future<void> async(device_group<ExecutionAgent> g, closure<Function,Arguments> c)
+{
+  int original_device = bulk::detail::current_device();
+
+  cudaStream_t join_stream = bulk::detail::acquire_stream(original_device);
+
+  try
+  {
+    for(int i = 0; i < g.size(); ++i)
+    {
+      device_slice_t slice = g.slice(i);
+
+      if(slice.num_groups == 0) continue;
+
+      bulk::detail::throw_on_error(cudaSetDevice(slice.device), "cudaSetDevice in bulk::async");
+
+      // each slice goes into a stream of its own device
+      closure<device_slice_function<Function>,Arguments> slice_c(device_slice_function<Function>(c.function(), slice), c.arguments());
+      future<void> slice_future = bulk::detail::async(bulk::par(g.exec().this_exec, slice.num_groups), slice_c, 0);
+
+      bulk::detail::throw_on_error(cudaSetDevice(original_device), "cudaSetDevice in bulk::async");
+
+      bulk::detail::throw_on_error(cudaStreamWaitEvent(join_stream, future_core_access::event(slice_future), 0), "cudaStreamWaitEvent in bulk::async");
+    } // end for i
+  } // end try
+  catch(...)
+  {
+    cudaSetDevice(original_device);
+    bulk::detail::release_stream(original_device, join_stream);
+    throw;
+  } // end catch
+
+  return future_core_access::create(join_stream, true);
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -19,6 +19,7 @@
 #include <bulk/future.hpp>
 #include <thrust/detail/type_traits.h>
 #include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/detail/host_launcher/fiber_group.hpp>
 #include <cstddef>
 
 
@@ -94,6 +95,18 @@ static const int use_default = INT_MAX;
 static const int dynamic_group_size = 0;
 
 
+// how a concurrent_group's on-chip heap hands out memory
+enum heap_policy
+{
+  // a general-purpose first-fit heap which serializes bulk::malloc & bulk::free through a lock
+  first_fit_heap,
+
+  // a lock-free bump allocator
+  // memory is reclaimed when it is freed in LIFO order or when the group exits
+  arena_heap
+};
+
+
 namespace detail
 {
 namespace group_detail
@@ -108,6 +121,9 @@ class group_base
 
     typedef int size_type;
 
+    // neither index() nor size() exceeds an int, but their product may
+    typedef long long global_size_type;
+
     static const size_type static_size = size_;
 
     __host__ __device__
@@ -129,9 +145,9 @@ class group_base
     }
 
     __device__
-    size_type global_index() const
+    global_size_type global_index() const
     {
-      return index() * size() + this_exec.index();
+      return static_cast<global_size_type>(index()) * size() + this_exec.index();
     }
 
     agent_type this_exec;
@@ -149,6 +165,9 @@ class group_base<ExecutionAgent,dynamic_group_size>
 
     typedef int size_type;
 
+    // neither index() nor size() exceeds an int, but their product may
+    typedef long long global_size_type;
+
     __host__ __device__
     group_base(size_type sz, agent_type exec = agent_type(), size_type i = invalid_index)
       : this_exec(exec),
@@ -169,9 +188,9 @@ class group_base<ExecutionAgent,dynamic_group_size>
     }
 
     __host__ __device__
-    size_type global_index() const
+    global_size_type global_index() const
     {
-      return index() * size() + this_exec.index();
+      return static_cast<global_size_type>(index()) * size() + this_exec.index();
     }
 
     agent_type this_exec;
@@ -235,6 +254,7 @@ class parallel_group<ExecutionAgent,dynamic_group_size>
 
 
 // shorthand for creating a parallel_group of agents
+// XXX size must not exceed INT_MAX; larger problems should give each agent more than one element
 inline __host__ __device__
 parallel_group<> par(size_t size)
 {
@@ -251,19 +271,62 @@ parallel_group<ExecutionAgent> par(ExecutionAgent exec, size_t size)
 }
 
 
+// how a launch shares the device with other work
+// the defaults leave the launch to compete for the device as usual
+struct launch_resources
+{
+  // the priority of the stream bulk::async borrows for the launch, as for cudaStreamCreateWithPriority:
+  // lower numbers are greater priorities, and 0 is the default
+  // a launch into a stream the caller names keeps that stream's priority
+  int priority;
+
+  // when access_window_bytes isn't 0, accesses to [access_window_base, access_window_base + access_window_bytes)
+  // persist in L2 during the launch with probability access_window_hit_ratio (sm_80 & better)
+  // XXX the device's persisting L2 set-aside, cudaLimitPersistingL2CacheSize, is left to the caller
+  const void *access_window_base;
+  std::size_t access_window_bytes;
+  float       access_window_hit_ratio;
+
+  // when the number of groups is left to use_default, the launch occupies no more than
+  // max_multiprocessors' worth of groups, and no more than max_groups_per_multiprocessor of them per multiprocessor
+  // 0 imposes no limit
+  int max_multiprocessors;
+  int max_groups_per_multiprocessor;
+
+  __host__ __device__
+  launch_resources()
+    : priority(0),
+      access_window_base(0),
+      access_window_bytes(0),
+      access_window_hit_ratio(1.f),
+      max_multiprocessors(0),
+      max_groups_per_multiprocessor(0)
+  {}
+};
+
+
+// an ExecutionAgent paired with the stream it launches into and the events
+// which must complete before it begins
 template<typename ExecutionAgent>
 class async_launch
 {
   public:
+    // the most events a single launch may wait on
+    static const int max_num_before_events = 8;
+
     __host__ __device__
     async_launch(ExecutionAgent exec, cudaStream_t s, cudaEvent_t be = 0)
-      : stream_valid(true),e(exec),s(s),be(be)
-    {}
+      : stream_valid(true),e(exec),s(s),num_be(0),m_name(0)
+    {
+      add_before_event(be);
+    }
 
     __host__
     async_launch(ExecutionAgent exec, cudaEvent_t be)
-      : stream_valid(false),e(exec),s(0),be(be)
-    {}
+      : stream_valid(false),e(exec),s(0),num_be(0),m_name(0)
+    {
+      add_before_event(be);
+    }
 
     __host__ __device__
     ExecutionAgent exec() const
@@ -277,10 +340,38 @@ class async_launch
       return s;
     }
 
+    // returns the first event this launch waits on, or 0 if there are none
     __host__ __device__
     cudaEvent_t before_event() const
     {
-      return be;
+      return num_be ? be[0] : 0;
+    }
+
+    __host__ __device__
+    cudaEvent_t before_event(int i) const
+    {
+      return be[i];
+    }
+
+    __host__ __device__
+    int num_before_events() const
+    {
+      return num_be;
+    }
+
+    // the launch will also wait on event
+    // null events are ignored
+    __host__ __device__
+    void add_before_event(cudaEvent_t event)
+    {
+      if(event == 0) return;
+
+      if(num_be == max_num_before_events)
+      {
+        bulk::detail::terminate_with_message("bulk::async_launch::add_before_event(): too many dependencies.");
+      }
+
+      be[num_be++] = event;
     }
 
     __host__ __device__
@@ -289,11 +380,40 @@ class async_launch
       return stream_valid;
     }
 
+    // the name which tags this launch's NVTX range when BULK_NVTX is 1 & its launch log entry when BULK_LAUNCH_LOG is 1
+    // name must outlive the launch
+    __host__ __device__
+    const char *name() const
+    {
+      return m_name;
+    }
+
+    __host__ __device__
+    void set_name(const char *name)
+    {
+      m_name = name;
+    }
+
+    __host__ __device__
+    const launch_resources &resources() const
+    {
+      return m_resources;
+    }
+
+    __host__ __device__
+    launch_resources &resources()
+    {
+      return m_resources;
+    }
+
   private:
     bool stream_valid;
     ExecutionAgent e;
     cudaStream_t s;
-    cudaEvent_t be;
+    int num_be;
+    cudaEvent_t be[max_num_before_events];
+    const char *m_name;
+    launch_resources m_resources;
 };
 
 
@@ -320,6 +440,70 @@ inline async_launch<bulk::parallel_group<> > par(bulk::future<void> &before, siz
 }
 
 
+namespace detail
+{
+
+
+// the type of after(before, g)
+template<typename ExecutionGroup>
+struct after_result
+{
+  typedef async_launch<ExecutionGroup> type;
+};
+
+
+template<typename ExecutionGroup>
+struct after_result<async_launch<ExecutionGroup> >
+{
+  typedef async_launch<ExecutionGroup> type;
+};
+
+
+} // end detail
+
+
+// returns a launch of g which begins after before completes
+template<typename ExecutionGroup>
+inline async_launch<ExecutionGroup> after(bulk::future<void> &before, ExecutionGroup g)
+{
+  return async_launch<ExecutionGroup>(g, bulk::detail::future_core_access::event(before));
+}
+
+
+// returns launch with before added to its dependencies
+template<typename ExecutionGroup>
+inline async_launch<ExecutionGroup> after(bulk::future<void> &before, async_launch<ExecutionGroup> launch)
+{
+  launch.add_before_event(bulk::detail::future_core_access::event(before));
+
+  return launch;
+}
+
+
+template<typename ExecutionGroup>
+inline typename detail::after_result<ExecutionGroup>::type
+  after(bulk::future<void> &before1, bulk::future<void> &before2, ExecutionGroup g)
+{
+  return bulk::after(before1, bulk::after(before2, g));
+}
+
+
+template<typename ExecutionGroup>
+inline typename detail::after_result<ExecutionGroup>::type
+  after(bulk::future<void> &before1, bulk::future<void> &before2, bulk::future<void> &before3, ExecutionGroup g)
+{
+  return bulk::after(before1, bulk::after(before2, before3, g));
+}
+
+
+template<typename ExecutionGroup>
+inline typename detail::after_result<ExecutionGroup>::type
+  after(bulk::future<void> &before1, bulk::future<void> &before2, bulk::future<void> &before3, bulk::future<void> &before4, ExecutionGroup g)
+{
+  return bulk::after(before1, bulk::after(before2, before3, before4, g));
+}
+
+
 // a group of concurrent ExecutionAgents which may synchronize
 template<typename ExecutionAgent      = agent<>,
          std::size_t size_      = dynamic_group_size>
@@ -340,17 +524,22 @@ class concurrent_group
     __host__ __device__
     concurrent_group(size_type heap_size = use_default,
                      agent_type exec = agent_type(),
-                     size_type i = invalid_index)
+                     size_type i = invalid_index,
+                     bulk::heap_policy policy = first_fit_heap)
       : super_t(exec,i),
-        m_heap_size(heap_size)
+        m_heap_size(heap_size),
+        m_heap_policy(policy)
     {}
 
-    __device__
+    // on the host, the group's agents are fibers which take turns
+    __host__ __device__
     void wait() const
     {
       // guard use of __syncthreads from foreign compilers
 #ifdef __CUDA_ARCH__
       __syncthreads();
+#else
+      bulk::detail::host_fiber_group::wait();
 #endif
     }
 
@@ -360,6 +549,12 @@ class concurrent_group
       return m_heap_size;
     }
 
+    __host__ __device__
+    bulk::heap_policy heap_policy() const
+    {
+      return m_heap_policy;
+    }
+
     // XXX this should go elsewhere
     __host__ __device__
     inline static size_type hardware_concurrency()
@@ -373,6 +568,7 @@ class concurrent_group
 
   private:
     size_type m_heap_size;
+    bulk::heap_policy m_heap_policy;
 };
 
 
@@ -396,17 +592,22 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
     concurrent_group(size_type size,
                      size_type heap_size = use_default,
                      agent_type exec = agent_type(),
-                     size_type i = invalid_index)
+                     size_type i = invalid_index,
+                     bulk::heap_policy policy = first_fit_heap)
       : super_t(size,exec,i),
-        m_heap_size(heap_size)
+        m_heap_size(heap_size),
+        m_heap_policy(policy)
     {}
 
-    __device__
+    // on the host, the group's agents are fibers which take turns
+    __host__ __device__
     void wait()
     {
       // guard use of __syncthreads from foreign compilers
 #ifdef __CUDA_ARCH__
       __syncthreads();
+#else
+      bulk::detail::host_fiber_group::wait();
 #endif
     }
 
@@ -416,6 +617,12 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
       return m_heap_size;
     }
 
+    __host__ __device__
+    bulk::heap_policy heap_policy() const
+    {
+      return m_heap_policy;
+    }
+
     // XXX this should go elsewhere
     __host__ __device__
     inline static size_type hardware_concurrency()
@@ -429,6 +636,7 @@ class concurrent_group<ExecutionAgent,dynamic_group_size>
 
   private:
     size_type m_heap_size;
+    bulk::heap_policy m_heap_policy;
 };
 
 
@@ -440,6 +648,14 @@ concurrent_group<> con(size_t size, size_t heap_size = use_default)
 }
 
 
+// shorthand for creating a concurrent_group of agents whose heap uses the given policy
+inline __host__ __device__
+concurrent_group<> con(size_t size, size_t heap_size, heap_policy policy)
+{
+  return concurrent_group<>(size,heap_size,agent<>(),invalid_index,policy);
+}
+
+
 // shorthand for creating a concurrent_group of ExecutionAgents
 template<typename ExecutionAgent>
 __host__ __device__
@@ -449,6 +665,15 @@ concurrent_group<ExecutionAgent> con(ExecutionAgent exec, size_t size, size_t he
 }
 
 
+// shorthand for creating a concurrent_group of ExecutionAgents whose heap uses the given policy
+template<typename ExecutionAgent>
+__host__ __device__
+concurrent_group<ExecutionAgent> con(ExecutionAgent exec, size_t size, size_t heap_size, heap_policy policy)
+{
+  return concurrent_group<ExecutionAgent>(size,heap_size,exec,invalid_index,policy);
+}
+
+
 // shorthand for creating a concurrent_group of agents with static sizing
 template<std::size_t groupsize, std::size_t grainsize>
 __host__ __device__
@@ -459,6 +684,62 @@ con(size_t heap_size)
 }
 
 
+// shorthand for creating a concurrent_group of agents with static sizing whose heap uses the given policy
+template<std::size_t groupsize, std::size_t grainsize>
+__host__ __device__
+concurrent_group<bulk::agent<grainsize>,groupsize>
+con(size_t heap_size, heap_policy policy)
+{
+  return concurrent_group<bulk::agent<grainsize>,groupsize>(heap_size,bulk::agent<grainsize>(),invalid_index,policy);
+}
+
+
+// a group of the 32 concurrent ExecutionAgents of a single warp
+// synchronization is a warp barrier rather than a CTA-wide barrier,
+// and the collectives on warp_group communicate through shuffles instead of the heap
+template<typename ExecutionAgent = agent<> >
+class warp_group
+  : public detail::group_detail::group_base<ExecutionAgent,32>
+{
+  private:
+    typedef detail::group_detail::group_base<
+      ExecutionAgent,
+      32
+    > super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+    typedef typename super_t::size_type  size_type;
+
+    // XXX the constructor taking an index should be made private
+    __host__ __device__
+    warp_group(agent_type exec = agent_type(), size_type i = invalid_index)
+      : super_t(exec,i)
+    {}
+
+    __device__
+    void wait() const
+    {
+      // guard use of __syncwarp from foreign compilers
+#if defined(__CUDA_ARCH__) && defined(CUDART_VERSION) && (CUDART_VERSION >= 9000)
+      __syncwarp();
+#endif
+    }
+};
+
+
+// returns a view of the warp containing the calling agent of a concurrent_group
+// the size of the concurrent_group must be a multiple of 32
+template<typename ConcurrentGroup>
+__device__
+warp_group<typename ConcurrentGroup::agent_type> this_warp(ConcurrentGroup &g)
+{
+  typedef typename ConcurrentGroup::agent_type agent_type;
+
+  return warp_group<agent_type>(agent_type(g.this_exec.index() % 32), g.this_exec.index() / 32);
+}
+
+
 // a way to statically bound the size of an ExecutionAgent's work
 template<std::size_t bound_, typename ExecutionAgent>
 class bounded
@@ -668,6 +949,131 @@ async_launch<
 }
 
 
+// names a launch so it can be told apart from others in a profiler's timeline, e.g.
+//
+//   bulk::async(bulk::named("reduce_partitions", bulk::grid<256,7>(num_groups)), f, ...);
+//
+// the name is only recorded when BULK_NVTX or BULK_LAUNCH_LOG is 1
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> named(const char *name, ExecutionGroup g)
+{
+  // leave the stream unset so the launcher borrows one from the pool, just like an unnamed g would
+  async_launch<ExecutionGroup> result(g, cudaEvent_t(0));
+  result.set_name(name);
+  return result;
+}
+
+
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> named(const char *name, async_launch<ExecutionGroup> launch)
+{
+  launch.set_name(name);
+  return launch;
+}
+
+
+// gives a launch a stream of the given priority, so that latency-sensitive work can overtake
+// background work at block boundaries, e.g.
+//
+//   bulk::async(bulk::prioritized(bulk::greatest_stream_priority(), bulk::grid<256,7>(num_groups)), f, ...);
+//
+// a launch of g alone borrows a stream of that priority rather than use the legacy default stream
+template<typename ExecutionGroup>
+inline __host__
+async_launch<ExecutionGroup> prioritized(int priority, ExecutionGroup g)
+{
+  async_launch<ExecutionGroup> result(g, cudaEvent_t(0));
+  result.resources().priority = priority;
+  return result;
+}
+
+
+// the launch's stream, if it names one, keeps its own priority
+template<typename ExecutionGroup>
+inline __host__
+async_launch<ExecutionGroup> prioritized(int priority, async_launch<ExecutionGroup> launch)
+{
+  launch.resources().priority = priority;
+  return launch;
+}
+
+
+// the greatest priority a stream on the current device may have
+inline __host__
+int greatest_stream_priority()
+{
+  int least = 0, greatest = 0;
+#if __BULK_HAS_CUDART__
+  bulk::detail::throw_on_error(cudaDeviceGetStreamPriorityRange(&least, &greatest), "cudaDeviceGetStreamPriorityRange in greatest_stream_priority");
+#endif
+  return greatest;
+}
+
+
+// keeps num_bytes beginning at base resident in L2 during a launch, e.g. a hot input read by many groups
+template<typename ExecutionGroup>
+inline __host__
+async_launch<ExecutionGroup> persisting(const void *base, std::size_t num_bytes, async_launch<ExecutionGroup> launch, float hit_ratio = 1.f)
+{
+  launch.resources().access_window_base      = base;
+  launch.resources().access_window_bytes     = num_bytes;
+  launch.resources().access_window_hit_ratio = hit_ratio;
+  return launch;
+}
+
+
+// a launch of g alone borrows a stream rather than use the legacy default stream, which has no attributes
+template<typename ExecutionGroup>
+inline __host__
+async_launch<ExecutionGroup> persisting(const void *base, std::size_t num_bytes, ExecutionGroup g, float hit_ratio = 1.f)
+{
+  return bulk::persisting(base, num_bytes, async_launch<ExecutionGroup>(g, cudaEvent_t(0)), hit_ratio);
+}
+
+
+// limits a launch whose number of groups is left to use_default to max_multiprocessors' worth of groups,
+// and to max_groups_per_multiprocessor groups per multiprocessor, so that background work leaves room for others, e.g.
+//
+//   bulk::async(bulk::capped(4, 2, bulk::grid<256,7>(bulk::use_default)), f, ...);
+//
+// XXX the hardware may still spread the groups over every multiprocessor; the cap bounds how many run at once
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> capped(int max_multiprocessors, int max_groups_per_multiprocessor, async_launch<ExecutionGroup> launch)
+{
+  launch.resources().max_multiprocessors           = max_multiprocessors;
+  launch.resources().max_groups_per_multiprocessor = max_groups_per_multiprocessor;
+  return launch;
+}
+
+
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> capped(int max_multiprocessors, int max_groups_per_multiprocessor, ExecutionGroup g)
+{
+  return bulk::capped(max_multiprocessors, max_groups_per_multiprocessor, async_launch<ExecutionGroup>(g, cudaEvent_t(0)));
+}
+
+
+// leaves the number of groups per multiprocessor to the launcher
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> capped(int max_multiprocessors, async_launch<ExecutionGroup> launch)
+{
+  return bulk::capped(max_multiprocessors, 0, launch);
+}
+
+
+template<typename ExecutionGroup>
+inline __host__ __device__
+async_launch<ExecutionGroup> capped(int max_multiprocessors, ExecutionGroup g)
+{
+  return bulk::capped(max_multiprocessors, 0, async_launch<ExecutionGroup>(g, cudaEvent_t(0)));
+}
+
+
 } // end bulk
 BULK_NAMESPACE_SUFFIX
 
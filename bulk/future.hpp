@@ -20,6 +20,11 @@
 #include <bulk/detail/guarded_cuda_runtime_api.hpp>
 #include <bulk/detail/throw_on_error.hpp>
 #include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/pinned_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/detail/launch_log.hpp>
+#include <bulk/heap_statistics.hpp>
 #include <thrust/detail/swap.h>
 #include <utility>
 #include <stdexcept>
@@ -52,26 +57,40 @@ class future<void>
       {
 #if __BULK_HAS_CUDART__
         // swallow errors
-        cudaError_t e = cudaEventDestroy(m_event);
+        cudaError_t e = bulk::detail::release_event(m_device, m_event);
 
 #if __BULK_HAS_PRINTF__
         if(e)
         {
-          printf("CUDA error after cudaEventDestroy in future dtor: %s", cudaGetErrorString(e));
+          printf("CUDA error after release_event in future dtor: %s", cudaGetErrorString(e));
         } // end if
 #endif // __BULK_HAS_PRINTF__
 
         if(m_owns_stream)
         {
-          e = cudaStreamDestroy(m_stream);
+          e = bulk::detail::release_stream(m_device, m_stream);
 
 #if __BULK_HAS_PRINTF__
           if(e)
           {
-            printf("CUDA error after cudaStreamDestroy in future dtor: %s", cudaGetErrorString(e));
+            printf("CUDA error after release_stream in future dtor: %s", cudaGetErrorString(e));
           } // end if
 #endif // __BULK_HAS_PRINTF__
         } // end if
+
+#if BULK_HEAP_STATISTICS
+        if(m_heap_statistics)
+        {
+          e = cudaFree(m_heap_statistics);
+
+#if __BULK_HAS_PRINTF__
+          if(e)
+          {
+            printf("CUDA error after cudaFree in future dtor: %s", cudaGetErrorString(e));
+          } // end if
+#endif // __BULK_HAS_PRINTF__
+        } // end if
+#endif // BULK_HEAP_STATISTICS
 #endif
       } // end if
     } // end ~future()
@@ -79,13 +98,18 @@ class future<void>
     __host__ __device__
     void wait() const
     {
-      // XXX should probably check for valid() here
+      // an invalid future, e.g. of a launch which completed on the host, has nothing to wait on
+      if(!valid()) return;
 
 #if __BULK_HAS_CUDART__
 
 #ifndef __CUDA_ARCH__
       // XXX need to capture the error as an exception and then throw it in .get()
+#  if BULK_LAUNCH_LOG
+      bulk::detail::throw_on_launch_error(cudaEventSynchronize(m_event), m_launch_sequence, "cudaEventSynchronize in future::wait");
+#  else
       bulk::detail::throw_on_error(cudaEventSynchronize(m_event), "cudaEventSynchronize in future::wait");
+#  endif
 #else
       // XXX need to capture the error as an exception and then throw it in .get()
       bulk::detail::throw_on_error(cudaDeviceSynchronize(), "cudaDeviceSynchronize in future::wait");
@@ -103,20 +127,82 @@ class future<void>
       return m_event != 0;
     } // end valid()
 
+    // returns true when the work this future tracks has completed
+    // never blocks
+    __host__
+    bool is_ready() const
+    {
+      if(!valid()) return true;
+
+#if __BULK_HAS_CUDART__
+      cudaError_t e = cudaEventQuery(m_event);
+
+      if(e == cudaErrorNotReady) return false;
+
+#  if BULK_LAUNCH_LOG
+      bulk::detail::throw_on_launch_error(e, m_launch_sequence, "cudaEventQuery in future::is_ready");
+#  else
+      bulk::detail::throw_on_error(e, "cudaEventQuery in future::is_ready");
+#  endif
+#endif
+
+      return true;
+    } // end is_ready()
+
+#if BULK_HEAP_STATISTICS
+    // waits for the launch to complete and returns how its groups used the on-chip heap
+    __host__
+    heap_statistics_t heap_statistics() const
+    {
+      heap_statistics_t result = {0,0,0};
+
+      if(m_heap_statistics)
+      {
+        wait();
+
+#if __BULK_HAS_CUDART__
+        bulk::detail::throw_on_error(cudaMemcpy(&result, m_heap_statistics, sizeof(heap_statistics_t), cudaMemcpyDeviceToHost),
+                                     "cudaMemcpy in future::heap_statistics");
+#endif
+      } // end if
+
+      return result;
+    } // end heap_statistics()
+#endif // BULK_HEAP_STATISTICS
+
     __host__ __device__
     future()
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_device(-1)
+#if BULK_HEAP_STATISTICS
+        , m_heap_statistics(0)
+#endif
+#if BULK_LAUNCH_LOG
+        , m_launch_sequence(0)
+#endif
     {}
 
     // simulate a move
     // XXX need to add rval_ref or something
     __host__ __device__
     future(const future &other)
-      : m_stream(0), m_event(0), m_owns_stream(false)
+      : m_stream(0), m_event(0), m_owns_stream(false), m_device(-1)
+#if BULK_HEAP_STATISTICS
+        , m_heap_statistics(0)
+#endif
+#if BULK_LAUNCH_LOG
+        , m_launch_sequence(0)
+#endif
     {
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_device,      const_cast<future&>(other).m_device);
+#if BULK_HEAP_STATISTICS
+      thrust::swap(m_heap_statistics, const_cast<future&>(other).m_heap_statistics);
+#endif
+#if BULK_LAUNCH_LOG
+      thrust::swap(m_launch_sequence, const_cast<future&>(other).m_launch_sequence);
+#endif
     } // end future()
 
     // simulate a move
@@ -127,29 +213,59 @@ class future<void>
       thrust::swap(m_stream,      const_cast<future&>(other).m_stream);
       thrust::swap(m_event,       const_cast<future&>(other).m_event);
       thrust::swap(m_owns_stream, const_cast<future&>(other).m_owns_stream);
+      thrust::swap(m_device,      const_cast<future&>(other).m_device);
+#if BULK_HEAP_STATISTICS
+      thrust::swap(m_heap_statistics, const_cast<future&>(other).m_heap_statistics);
+#endif
+#if BULK_LAUNCH_LOG
+      thrust::swap(m_launch_sequence, const_cast<future&>(other).m_launch_sequence);
+#endif
       return *this;
     } // end operator=()
 
   private:
     friend struct detail::future_core_access;
 
+    // launch_sequence numbers the launch this future tracks in the launch log, or is 0 when it tracks none
     __host__ __device__
-    future(cudaStream_t s, bool owns_stream)
-      : m_stream(s),m_owns_stream(owns_stream)
+    future(cudaStream_t s, bool owns_stream, unsigned long long launch_sequence)
+      : m_stream(s), m_event(0), m_owns_stream(owns_stream), m_device(-1)
+#if BULK_HEAP_STATISTICS
+        , m_heap_statistics(0)
+#endif
+#if BULK_LAUNCH_LOG
+        , m_launch_sequence(launch_sequence)
+#endif
     {
+#if !BULK_LAUNCH_LOG
+      (void) launch_sequence; // Suppress unused parameter warnings
+#endif
+
 #if __BULK_HAS_CUDART__
-      bulk::detail::throw_on_error(cudaEventCreateWithFlags(&m_event, create_flags), "cudaEventCreateWithFlags in future ctor");
+      // the event is borrowed from the pool, see stream_pool.hpp for its creation flags
+      m_device = bulk::detail::current_device();
+      m_event  = bulk::detail::acquire_event(m_device);
       bulk::detail::throw_on_error(cudaEventRecord(m_event, m_stream), "cudaEventRecord in future ctor");
 #endif
     } // end future()
 
-    // XXX this combination makes the constructor expensive
-    //static const int create_flags = cudaEventDisableTiming | cudaEventBlockingSync;
-    static const int create_flags = cudaEventDisableTiming;
-
     cudaStream_t m_stream;
     cudaEvent_t m_event;
     bool m_owns_stream;
+
+    // the device our event and stream were acquired on
+    int m_device;
+
+#if BULK_HEAP_STATISTICS
+    // owned
+    heap_statistics_t *m_heap_statistics;
+#endif
+
+#if BULK_LAUNCH_LOG
+    // the number of the launch this future tracks in the launch log, or 0 if it tracks none
+    // a successful wait retires the launches through it
+    unsigned long long m_launch_sequence;
+#endif
 }; // end future<void>
 
 
@@ -159,10 +275,12 @@ namespace detail
 
 struct future_core_access
 {
+  // launch_sequence is the launch log's number for the launch the future tracks,
+  // or 0 for a future which tracks no launch, e.g. of a join or a copy, whose wait retires nothing
   __host__ __device__
-  inline static future<void> create(cudaStream_t s, bool owns_stream)
+  inline static future<void> create(cudaStream_t s, bool owns_stream, unsigned long long launch_sequence = 0)
   {
-    return future<void>(s, owns_stream);
+    return future<void>(s, owns_stream, launch_sequence);
   } // end create_in_stream()
 
   __host__ __device__
@@ -170,12 +288,266 @@ struct future_core_access
   {
     return f.m_event;
   } // end event()
+
+  // result becomes ready along with ready
+  // the future takes ownership of both
+  template<typename T>
+  __host__
+  inline static future<T> create(future<void> &ready, T *result)
+  {
+    return future<T>(ready, result);
+  } // end create()
+
+#if BULK_HEAP_STATISTICS
+  // f takes ownership of stats
+  __host__ __device__
+  inline static void set_heap_statistics(future<void> &f, heap_statistics_t *stats)
+  {
+    f.m_heap_statistics = stats;
+  } // end set_heap_statistics()
+#endif
 }; // end future_core_access
 
 
 } // end detail
 
 
+namespace detail
+{
+
+
+// makes s wait on f without blocking the calling thread
+inline void stream_wait_on(cudaStream_t s, const future<void> &f)
+{
+  if(f.valid())
+  {
+#if __BULK_HAS_CUDART__
+    bulk::detail::throw_on_error(cudaStreamWaitEvent(s, future_core_access::event(f), 0), "cudaStreamWaitEvent in when_all");
+#endif
+  } // end if
+} // end stream_wait_on()
+
+
+} // end detail
+
+
+// returns a future which becomes ready once each future in [first,last) is ready
+// the join happens on the device, so this never blocks the calling thread
+template<typename Iterator>
+inline future<void> when_all(Iterator first, Iterator last)
+{
+  cudaStream_t s = bulk::detail::acquire_stream(bulk::detail::current_device());
+
+  for(; first != last; ++first)
+  {
+    bulk::detail::stream_wait_on(s, *first);
+  } // end for
+
+  // the result hands the stream back to the pool when it is destroyed
+  return detail::future_core_access::create(s, true);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2)
+{
+  cudaStream_t s = bulk::detail::acquire_stream(bulk::detail::current_device());
+
+  bulk::detail::stream_wait_on(s, f1);
+  bulk::detail::stream_wait_on(s, f2);
+
+  return detail::future_core_access::create(s, true);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3)
+{
+  cudaStream_t s = bulk::detail::acquire_stream(bulk::detail::current_device());
+
+  bulk::detail::stream_wait_on(s, f1);
+  bulk::detail::stream_wait_on(s, f2);
+  bulk::detail::stream_wait_on(s, f3);
+
+  return detail::future_core_access::create(s, true);
+} // end when_all()
+
+
+inline future<void> when_all(const future<void> &f1, const future<void> &f2, const future<void> &f3, const future<void> &f4)
+{
+  cudaStream_t s = bulk::detail::acquire_stream(bulk::detail::current_device());
+
+  bulk::detail::stream_wait_on(s, f1);
+  bulk::detail::stream_wait_on(s, f2);
+  bulk::detail::stream_wait_on(s, f3);
+  bulk::detail::stream_wait_on(s, f4);
+
+  return detail::future_core_access::create(s, true);
+} // end when_all()
+
+
+// returns the first future in [first,last) which is ready, or last if none are
+// never blocks
+template<typename Iterator>
+inline Iterator try_when_any(Iterator first, Iterator last)
+{
+  for(; first != last; ++first)
+  {
+    if(first->valid() && first->is_ready()) break;
+  } // end for
+
+  return first;
+} // end try_when_any()
+
+
+// returns the first future in [first,last) to become ready, or last if none are valid
+// XXX a stream can only wait on all of its dependencies, never on any one of them,
+//     so unlike when_all this has to wait in the calling thread
+//     use try_when_any to poll instead
+template<typename Iterator>
+inline Iterator when_any(Iterator first, Iterator last)
+{
+  bool any_valid = false;
+
+  for(Iterator i = first; i != last; ++i)
+  {
+    any_valid |= i->valid();
+  } // end for i
+
+  if(!any_valid) return last;
+
+  Iterator result = last;
+
+  while((result = bulk::try_when_any(first, last)) == last)
+  {
+    // cudaEventQuery is cheap, so just spin
+  } // end while
+
+  return result;
+} // end when_any()
+
+
+// a future<T> holds the result of an asynchronous computation in pinned host memory,
+// so get() need only wait on an event rather than perform a synchronous copy
+// XXX T must be trivially copyable
+template<typename T>
+class future
+{
+  public:
+    __host__
+    future()
+      : m_result(0)
+    {}
+
+    __host__
+    ~future()
+    {
+      if(m_result)
+      {
+        // swallow errors
+        cudaError_t e = cudaSuccess;
+
+#if __BULK_HAS_CUDART__
+        // the copy into m_result may still be in flight
+        e = cudaEventSynchronize(detail::future_core_access::event(m_ready));
+
+#if __BULK_HAS_PRINTF__
+        if(e)
+        {
+          printf("CUDA error after cudaEventSynchronize in future dtor: %s", cudaGetErrorString(e));
+        } // end if
+#endif // __BULK_HAS_PRINTF__
+#endif // __BULK_HAS_CUDART__
+
+        e = bulk::detail::global_pinned_pool().deallocate(m_result, sizeof(T));
+
+#if __BULK_HAS_PRINTF__
+        if(e)
+        {
+          printf("CUDA error after deallocate in future dtor: %s", cudaGetErrorString(e));
+        } // end if
+#endif // __BULK_HAS_PRINTF__
+      } // end if
+    } // end ~future()
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    __host__
+    future(const future &other)
+      : m_ready(other.m_ready), m_result(0)
+    {
+      thrust::swap(m_result, const_cast<future&>(other).m_result);
+    } // end future()
+
+    // simulate a move
+    // XXX need to add rval_ref or something
+    __host__
+    future &operator=(const future &other)
+    {
+      m_ready = other.m_ready;
+      thrust::swap(m_result, const_cast<future&>(other).m_result);
+      return *this;
+    } // end operator=()
+
+    __host__
+    void wait() const
+    {
+      m_ready.wait();
+    } // end wait()
+
+    __host__
+    bool valid() const
+    {
+      return m_ready.valid();
+    } // end valid()
+
+    __host__
+    bool is_ready() const
+    {
+      return m_ready.is_ready();
+    } // end is_ready()
+
+    __host__
+    T get() const
+    {
+      wait();
+      return *m_result;
+    } // end get()
+
+  private:
+    friend struct detail::future_core_access;
+
+    __host__
+    future(future<void> &ready, T *result)
+      : m_ready(ready), m_result(result)
+    {}
+
+    future<void> m_ready;
+
+    // owned, borrowed from global_pinned_pool()
+    T *m_result;
+}; // end future<T>
+
+
+// returns a future which receives *result once before completes
+// the copy is made asynchronously, so this never blocks the calling thread
+template<typename T>
+inline future<T> async_get(const future<void> &before, const T *result)
+{
+  T *host_result = static_cast<T*>(bulk::detail::global_pinned_pool().allocate(sizeof(T)));
+
+  cudaStream_t s = bulk::detail::acquire_stream(bulk::detail::current_device());
+
+  bulk::detail::stream_wait_on(s, before);
+
+#if __BULK_HAS_CUDART__
+  bulk::detail::throw_on_error(cudaMemcpyAsync(host_result, result, sizeof(T), cudaMemcpyDeviceToHost, s), "cudaMemcpyAsync in async_get");
+#endif
+
+  future<void> ready = detail::future_core_access::create(s, true);
+
+  return detail::future_core_access::create(ready, host_result);
+} // end async_get()
+
+
 } // end namespace bulk
 BULK_NAMESPACE_SUFFIX
 
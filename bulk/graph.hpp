@@ -0,0 +1,247 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/future.hpp>
+
+// in-place update of an instantiated graph first appeared in CUDA 10.2
+#if __BULK_HAS_CUDART__ && defined(CUDART_VERSION) && (CUDART_VERSION >= 10020)
+#  define __BULK_HAS_CUDA_GRAPHS__ 1
+#else
+#  define __BULK_HAS_CUDA_GRAPHS__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// graph records the launches bulk::async makes into graph.stream() between
+// begin_capture() and end_capture(), and replays them later as a single CUDA graph.
+// Because the kernels are recorded as they are launched, each recorded launch keeps
+// the grid, block & heap sizes that cuda_launcher chose for it.
+//
+// To change the arguments of the recorded launches, capture the same sequence again
+// with the new arguments; when the shapes haven't changed, end_capture() updates the
+// instantiated graph in place rather than instantiating it again.
+//
+// example:
+//
+//   bulk::graph g;
+//
+//   g.begin_capture();
+//   bulk::async(bulk::par(g.stream(), n), f, bulk::root.this_exec, ptr);
+//   bulk::async(bulk::par(g.stream(), n), f, bulk::root.this_exec, ptr);
+//   g.end_capture();
+//
+//   for(int i = 0; i < num_iterations; ++i)
+//   {
+//     g.replay();
+//   }
+//
+//   g.replay().wait();
+//
+// closures larger than 4096 bytes are allocated, uploaded & freed in the launch's stream,
+// and the device algorithms' temporaries come from the stream-ordered caching allocator,
+// so both are recorded along with the launches which use them
+// XXX without stream-ordered allocation (CUDART 11.2) oversized closures fall back to cudaMalloc, which can't be captured
+// XXX building with __THRUST_SYNCHRONOUS is incompatible with capture, because it synchronizes after each launch
+class graph
+{
+  public:
+    inline graph()
+      : m_device(-1), m_stream(0), m_graph(0), m_exec(0), m_capturing(false)
+    {
+#if __BULK_HAS_CUDA_GRAPHS__
+      m_device = bulk::detail::current_device();
+      m_stream = bulk::detail::acquire_stream(m_device);
+#else
+      bulk::detail::terminate_with_message("bulk::graph: CUDA graphs require CUDART 10.2 or better.");
+#endif
+    } // end graph()
+
+    inline ~graph()
+    {
+#if __BULK_HAS_CUDA_GRAPHS__
+      if(m_capturing)
+      {
+        // abandon the capture in progress
+        cudaGraph_t abandoned = 0;
+        cudaStreamEndCapture(m_stream, &abandoned);
+
+        if(abandoned)
+        {
+          cudaGraphDestroy(abandoned);
+        } // end if
+      } // end if
+
+      if(m_exec)
+      {
+        bulk::detail::terminate_on_error(cudaGraphExecDestroy(m_exec), "cudaGraphExecDestroy in graph dtor");
+      } // end if
+
+      if(m_graph)
+      {
+        bulk::detail::terminate_on_error(cudaGraphDestroy(m_graph), "cudaGraphDestroy in graph dtor");
+      } // end if
+
+      bulk::detail::terminate_on_error(bulk::detail::release_stream(m_device, m_stream), "release_stream in graph dtor");
+#endif
+    } // end ~graph()
+
+    // launches into this stream are recorded while capturing
+    inline cudaStream_t stream() const
+    {
+      return m_stream;
+    } // end stream()
+
+    inline bool is_capturing() const
+    {
+      return m_capturing;
+    } // end is_capturing()
+
+    // true when there is a recorded sequence to replay
+    inline bool valid() const
+    {
+      return m_exec != 0;
+    } // end valid()
+
+    inline void begin_capture()
+    {
+      if(m_capturing)
+      {
+        bulk::detail::terminate_with_message("bulk::graph::begin_capture(): capture is already in progress.");
+      } // end if
+
+#if __BULK_HAS_CUDA_GRAPHS__
+      bulk::detail::throw_on_error(cudaStreamBeginCapture(m_stream, cudaStreamCaptureModeThreadLocal), "cudaStreamBeginCapture in graph::begin_capture");
+#endif
+
+      m_capturing = true;
+    } // end begin_capture()
+
+    inline void end_capture()
+    {
+      if(!m_capturing)
+      {
+        bulk::detail::terminate_with_message("bulk::graph::end_capture(): no capture is in progress.");
+      } // end if
+
+      m_capturing = false;
+
+#if __BULK_HAS_CUDA_GRAPHS__
+      cudaGraph_t captured = 0;
+      bulk::detail::throw_on_error(cudaStreamEndCapture(m_stream, &captured), "cudaStreamEndCapture in graph::end_capture");
+
+      if(m_exec && try_update(captured))
+      {
+        // the instantiated graph now refers to the new arguments
+        bulk::detail::throw_on_error(cudaGraphDestroy(m_graph), "cudaGraphDestroy in graph::end_capture");
+        m_graph = captured;
+        return;
+      } // end if
+
+      // the shape of the sequence changed or this is our first capture, so instantiate from scratch
+      if(m_exec)
+      {
+        bulk::detail::throw_on_error(cudaGraphExecDestroy(m_exec), "cudaGraphExecDestroy in graph::end_capture");
+        m_exec = 0;
+      } // end if
+
+      if(m_graph)
+      {
+        bulk::detail::throw_on_error(cudaGraphDestroy(m_graph), "cudaGraphDestroy in graph::end_capture");
+      } // end if
+
+      m_graph = captured;
+
+#if CUDART_VERSION >= 12000
+      bulk::detail::throw_on_error(cudaGraphInstantiate(&m_exec, m_graph, 0), "cudaGraphInstantiate in graph::end_capture");
+#else
+      bulk::detail::throw_on_error(cudaGraphInstantiate(&m_exec, m_graph, 0, 0, 0), "cudaGraphInstantiate in graph::end_capture");
+#endif
+#endif // __BULK_HAS_CUDA_GRAPHS__
+    } // end end_capture()
+
+    // launches the recorded sequence into stream()
+    inline future<void> replay()
+    {
+      if(!valid())
+      {
+        bulk::detail::terminate_with_message("bulk::graph::replay(): nothing has been captured.");
+      } // end if
+
+#if __BULK_HAS_CUDA_GRAPHS__
+      bulk::detail::throw_on_error(cudaGraphLaunch(m_exec, m_stream), "cudaGraphLaunch in graph::replay");
+#endif
+
+      return detail::future_core_access::create(m_stream, false);
+    } // end replay()
+
+  private:
+#if __BULK_HAS_CUDA_GRAPHS__
+    inline bool try_update(cudaGraph_t captured)
+    {
+#if CUDART_VERSION >= 12000
+      cudaGraphExecUpdateResultInfo info;
+      cudaError_t error = cudaGraphExecUpdate(m_exec, captured, &info);
+#else
+      cudaGraphNode_t error_node = 0;
+      cudaGraphExecUpdateResult update_result;
+      cudaError_t error = cudaGraphExecUpdate(m_exec, captured, &error_node, &update_result);
+#endif
+
+      if(error == cudaErrorGraphExecUpdateFailure)
+      {
+        // the failure is not sticky, so clear it before a later call reports it
+        cudaGetLastError();
+        return false;
+      } // end if
+
+      bulk::detail::throw_on_error(error, "cudaGraphExecUpdate in graph::end_capture");
+
+      return true;
+    } // end try_update()
+#endif // __BULK_HAS_CUDA_GRAPHS__
+
+    int             m_device;
+    cudaStream_t    m_stream;
+#if __BULK_HAS_CUDA_GRAPHS__
+    cudaGraph_t     m_graph;
+    cudaGraphExec_t m_exec;
+#else
+    void           *m_graph;
+    void           *m_exec;
+#endif
+    bool            m_capturing;
+
+    // non-copyable
+    graph(const graph &);
+    graph &operator=(const graph &);
+}; // end graph
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
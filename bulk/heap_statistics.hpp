@@ -0,0 +1,75 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+
+// #define BULK_HEAP_STATISTICS 1 before #including Bulk to record how each launch
+// uses the on-chip heap. Retrieve the result with future<void>::heap_statistics().
+// XXX recording costs an atomic per allocation and a barrier at the end of each group
+#ifndef BULK_HEAP_STATISTICS
+#  define BULK_HEAP_STATISTICS 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the totals over every group of a single launch
+struct heap_statistics_t
+{
+  // the number of allocations satisfied by the on-chip heap
+  unsigned int num_allocations;
+
+  // the number of allocations which didn't fit on chip and fell back to global memory
+  unsigned int num_spills;
+
+  // the largest on-chip heap footprint of any single group, in bytes
+  unsigned int peak_on_chip_bytes;
+};
+
+
+namespace detail
+{
+
+
+// the returned counters are zeroed in stream s
+inline heap_statistics_t *make_heap_statistics(cudaStream_t s)
+{
+  heap_statistics_t *result = 0;
+
+#if __BULK_HAS_CUDART__
+  bulk::detail::throw_on_error(cudaMalloc(&result, sizeof(heap_statistics_t)), "cudaMalloc in make_heap_statistics");
+  bulk::detail::throw_on_error(cudaMemsetAsync(result, 0, sizeof(heap_statistics_t), s), "cudaMemsetAsync in make_heap_statistics");
+#else
+  (void) s; // Suppress unused parameter warnings
+  bulk::detail::terminate_with_message("make_heap_statistics(): cudaMalloc requires CUDART");
+#endif
+
+  return result;
+} // end make_heap_statistics()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,204 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/host_launcher/host_launcher.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a launch of ExecutionGroup on the host's threads rather than on the device
+// a parallel group's agents are dealt out to a pool of threads which steal work from one another,
+// and each concurrent group runs on a single thread with its agents as fibers which take turns at each wait(),
+// so that closures run on the host unchanged so long as they are __host__ __device__, e.g.
+//
+//   bulk::async(bulk::on_host(bulk::grid<32,1>(num_groups)), f, bulk::root, ...);
+//
+// the launch completes before bulk::async returns, and the future it returns is invalid
+// XXX there is no on-chip heap on the host, so neither bulk::malloc nor the algorithms which use it are available
+template<typename ExecutionGroup>
+class host_launch
+{
+  public:
+    __host__
+    host_launch(ExecutionGroup exec)
+      : m_exec(exec)
+    {}
+
+    __host__
+    ExecutionGroup exec() const
+    {
+      return m_exec;
+    }
+
+  private:
+    ExecutionGroup m_exec;
+};
+
+
+template<typename ExecutionGroup>
+__host__
+host_launch<ExecutionGroup> on_host(ExecutionGroup g)
+{
+  return host_launch<ExecutionGroup>(g);
+} // end on_host()
+
+
+// problems smaller than this many elements run on the host by default,
+// because the transfer & launch costs outweigh the device
+static const std::size_t default_host_threshold = 1 << 16;
+
+
+// a launch which goes to the device when its problem is large enough and a device is present,
+// and to the host otherwise
+template<typename ExecutionGroup>
+class adaptive_launch
+{
+  public:
+    typedef async_launch<ExecutionGroup> launch_type;
+
+    __host__
+    adaptive_launch(bool on_host, launch_type launch)
+      : m_on_host(on_host), m_launch(launch)
+    {}
+
+    __host__
+    bool on_host() const
+    {
+      return m_on_host;
+    }
+
+    __host__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    bool        m_on_host;
+    launch_type m_launch;
+};
+
+
+namespace detail
+{
+
+
+// true when the host may launch on a device
+inline bool has_device()
+{
+#if __BULK_HAS_CUDART__
+  static int num_devices = -1;
+
+  if(num_devices < 0)
+  {
+    if(cudaGetDeviceCount(&num_devices) != cudaSuccess)
+    {
+      // clear the error, there's just no device
+      cudaGetLastError();
+      num_devices = 0;
+    } // end if
+  } // end if
+
+  return num_devices > 0;
+#else
+  return false;
+#endif
+} // end has_device()
+
+
+} // end detail
+
+
+// shorthand for launching g on the device when problem_size is at least threshold and on the host otherwise, e.g.
+//
+//   bulk::async(bulk::adaptive(n, bulk::par(n)), saxpy(), bulk::root, a, x, y);
+//
+// f should be __host__ __device__, and its arguments must be accessible from both, e.g. in managed memory
+template<typename ExecutionGroup>
+__host__
+adaptive_launch<ExecutionGroup> adaptive(std::size_t problem_size, async_launch<ExecutionGroup> launch, std::size_t threshold = default_host_threshold)
+{
+  bool on_host = problem_size < threshold || !bulk::detail::has_device();
+
+  return adaptive_launch<ExecutionGroup>(on_host, launch);
+} // end adaptive()
+
+
+template<typename ExecutionGroup>
+__host__
+adaptive_launch<ExecutionGroup> adaptive(std::size_t problem_size, ExecutionGroup g, std::size_t threshold = default_host_threshold)
+{
+  return bulk::adaptive(problem_size, async_launch<ExecutionGroup>(g, cudaEvent_t(0)), threshold);
+} // end adaptive()
+
+
+namespace detail
+{
+
+
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(host_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  bulk::detail::host_launcher<ExecutionGroup, closure<Function,Arguments> > launcher;
+
+  launcher.launch(g.exec(), c);
+
+  return future<void>();
+} // end async()
+
+
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(adaptive_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  async_launch<ExecutionGroup> launch = g.launch();
+
+  if(g.on_host())
+  {
+    // the host must wait for the launch's dependencies itself
+    for(int i = 0; i < launch.num_before_events(); ++i)
+    {
+#if __BULK_HAS_CUDART__
+      bulk::detail::throw_on_error(cudaEventSynchronize(launch.before_event(i)), "cudaEventSynchronize in bulk::async");
+#endif
+    } // end for i
+
+    return bulk::detail::async(host_launch<ExecutionGroup>(launch.exec()), c);
+  } // end if
+
+  return bulk::detail::async(launch, c);
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -18,4 +18,7 @@
 
 #include <bulk/detail/config.hpp>
 #include <bulk/iterator/strided_iterator.hpp> 
+#include <bulk/iterator/transform_output_iterator.hpp>
+#include <bulk/iterator/read_only_iterator.hpp>
+#include <bulk/iterator/streaming_iterator.hpp>
 
@@ -0,0 +1,104 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/cache_hints.hpp>
+#include <thrust/iterator/iterator_adaptor.h>
+#include <thrust/detail/type_traits.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+template<typename T> class read_only_iterator;
+
+
+namespace detail
+{
+
+
+template<typename T>
+struct read_only_iterator_base
+{
+  typedef typename thrust::detail::remove_const<T>::type value_type;
+
+  typedef thrust::iterator_adaptor<
+    bulk::read_only_iterator<T>,
+    const value_type *,
+    value_type,
+    thrust::use_default,
+    thrust::use_default,
+    value_type
+  > type;
+};
+
+
+} // end detail
+
+
+// reads through a raw pointer to global memory via the read-only data cache (__ldg),
+// which keeps lookup tables & other data gathered with poor locality out of the way of L1
+// only use it for data which no agent writes during the kernel: the read-only cache isn't coherent
+// XXX dereferencing on the host reads the underlying pointer directly
+template<typename T>
+class read_only_iterator
+  : public bulk::detail::read_only_iterator_base<T>::type
+{
+  private:
+    typedef typename bulk::detail::read_only_iterator_base<T>::type super_t;
+
+  public:
+    inline __host__ __device__
+    read_only_iterator()
+      : super_t()
+    {}
+
+    inline __host__ __device__
+    explicit read_only_iterator(const T *ptr)
+      : super_t(ptr)
+    {}
+
+  private:
+    friend class thrust::iterator_core_access;
+
+    __host__ __device__
+    typename super_t::reference dereference() const
+    {
+#ifdef __CUDA_ARCH__
+      return bulk::detail::load_read_only(this->base());
+#else
+      return *this->base();
+#endif
+    }
+};
+
+
+template<typename T>
+inline __host__ __device__
+read_only_iterator<T> make_read_only_iterator(const T *ptr)
+{
+  return read_only_iterator<T>(ptr);
+}
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,135 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/cache_hints.hpp>
+#include <thrust/iterator/iterator_adaptor.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+template<typename T> class streaming_iterator;
+
+
+namespace detail
+{
+
+
+// assigning x through the proxy stores x with the evict-first policy
+template<typename T>
+class streaming_proxy
+{
+  public:
+    __host__ __device__
+    explicit streaming_proxy(T *ptr)
+      : m_ptr(ptr)
+    {}
+
+    __host__ __device__
+    streaming_proxy &operator=(const T &x)
+    {
+#ifdef __CUDA_ARCH__
+      bulk::detail::store_streaming(m_ptr, x);
+#else
+      *m_ptr = x;
+#endif
+      return *this;
+    }
+
+    // *dst = *src between two streaming_iterators copies the value, not the pointer
+    __host__ __device__
+    streaming_proxy &operator=(const streaming_proxy &other)
+    {
+      return *this = static_cast<T>(other);
+    }
+
+    __host__ __device__
+    operator T () const
+    {
+      return *m_ptr;
+    }
+
+  private:
+    T *m_ptr;
+};
+
+
+template<typename T>
+struct streaming_iterator_base
+{
+  typedef thrust::iterator_adaptor<
+    bulk::streaming_iterator<T>,
+    T *,
+    thrust::use_default,
+    thrust::use_default,
+    thrust::use_default,
+    streaming_proxy<T>
+  > type;
+};
+
+
+} // end detail
+
+
+// writes through a raw pointer to global memory with streaming stores (st.global.cs),
+// so that results which are written once & not read again by the kernel
+// (e.g., the destinations of a scatter) don't evict data which is still to be read
+template<typename T>
+class streaming_iterator
+  : public bulk::detail::streaming_iterator_base<T>::type
+{
+  private:
+    typedef typename bulk::detail::streaming_iterator_base<T>::type super_t;
+
+  public:
+    inline __host__ __device__
+    streaming_iterator()
+      : super_t()
+    {}
+
+    inline __host__ __device__
+    explicit streaming_iterator(T *ptr)
+      : super_t(ptr)
+    {}
+
+  private:
+    friend class thrust::iterator_core_access;
+
+    __host__ __device__
+    typename super_t::reference dereference() const
+    {
+      return bulk::detail::streaming_proxy<T>(this->base());
+    }
+};
+
+
+template<typename T>
+inline __host__ __device__
+streaming_iterator<T> make_streaming_iterator(T *ptr)
+{
+  return streaming_iterator<T>(ptr);
+}
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -25,16 +25,19 @@ namespace bulk
 {
 
 
+// visits every stride-th element of the underlying iterator
+// dereferences go through the underlying iterator, so striding over a
+// bulk::read_only_iterator reads through the read-only data cache
 template<typename Iterator,
          typename Size = typename thrust::iterator_difference<Iterator>::type>
 class strided_iterator
   : public thrust::iterator_adaptor<
-      strided_iterator<Iterator>,
+      strided_iterator<Iterator,Size>,
       Iterator
     >
 {
   private:
-    typedef thrust::iterator_adaptor<strided_iterator<Iterator>,Iterator> super_t;
+    typedef thrust::iterator_adaptor<strided_iterator<Iterator,Size>,Iterator> super_t;
 
   public:
     typedef Size stride_type;
@@ -83,7 +86,7 @@ class strided_iterator
 
     template<typename OtherIterator>
     __host__ __device__
-    typename super_t::difference_type distance_to(const strided_iterator<OtherIterator> &other) const
+    typename super_t::difference_type distance_to(const strided_iterator<OtherIterator,Size> &other) const
     {
       if(other.base() >= this->base())
       {
@@ -0,0 +1,124 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <thrust/iterator/iterator_adaptor.h>
+#include <thrust/iterator/iterator_traits.h>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+template<typename UnaryFunction, typename OutputIterator> class transform_output_iterator;
+
+
+namespace detail
+{
+
+
+// assigning x through the proxy stores f(x) through the underlying iterator
+template<typename UnaryFunction, typename OutputIterator>
+class transform_output_proxy
+{
+  public:
+    __host__ __device__
+    transform_output_proxy(const OutputIterator &out, UnaryFunction f)
+      : m_out(out), m_f(f)
+    {}
+
+    template<typename T>
+    __host__ __device__
+    transform_output_proxy &operator=(const T &x)
+    {
+      *m_out = m_f(x);
+      return *this;
+    }
+
+  private:
+    OutputIterator m_out;
+    UnaryFunction  m_f;
+};
+
+
+template<typename UnaryFunction, typename OutputIterator>
+struct transform_output_iterator_base
+{
+  typedef thrust::iterator_adaptor<
+    bulk::transform_output_iterator<UnaryFunction,OutputIterator>,
+    OutputIterator,
+    thrust::use_default,
+    thrust::use_default,
+    thrust::use_default,
+    transform_output_proxy<UnaryFunction,OutputIterator>
+  > type;
+};
+
+
+} // end detail
+
+
+// the store-side counterpart of thrust::transform_iterator:
+// writing x to *it writes f(x) to the underlying iterator, so that an element-wise
+// stage following a collective runs inside the collective's store rather than in a separate pass
+// XXX its value_type is the underlying iterator's, which an algorithm which deduces its intermediate type
+//     from its result may pick up when its function object has no result_type
+template<typename UnaryFunction, typename OutputIterator>
+class transform_output_iterator
+  : public bulk::detail::transform_output_iterator_base<UnaryFunction,OutputIterator>::type
+{
+  private:
+    typedef typename bulk::detail::transform_output_iterator_base<UnaryFunction,OutputIterator>::type super_t;
+
+  public:
+    inline __host__ __device__
+    transform_output_iterator(const OutputIterator &out, UnaryFunction f)
+      : super_t(out), m_f(f)
+    {}
+
+    inline __host__ __device__
+    UnaryFunction functor() const
+    {
+      return m_f;
+    }
+
+  private:
+    friend class thrust::iterator_core_access;
+
+    __host__ __device__
+    typename super_t::reference dereference() const
+    {
+      return bulk::detail::transform_output_proxy<UnaryFunction,OutputIterator>(this->base_reference(), m_f);
+    }
+
+    UnaryFunction m_f;
+};
+
+
+template<typename OutputIterator, typename UnaryFunction>
+inline __host__ __device__
+transform_output_iterator<UnaryFunction,OutputIterator> make_transform_output_iterator(OutputIterator out, UnaryFunction f)
+{
+  return transform_output_iterator<UnaryFunction,OutputIterator>(out, f);
+}
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
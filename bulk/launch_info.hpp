@@ -0,0 +1,123 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/execution_policy.hpp>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// describes the launch bulk::async would make for a policy & a function without making it
+struct launch_info_t
+{
+  // the configuration the launcher chooses for any of the policy's parameters left as use_default
+  std::size_t num_groups;
+  std::size_t group_size;
+
+  // the bytes of dynamic shared memory reserved for each group's heap
+  std::size_t heap_size;
+
+  // the number of groups which may be resident on a single multiprocessor at once
+  std::size_t max_active_groups_per_multiprocessor;
+
+  // the fraction of each multiprocessor's threads those groups keep busy
+  float       occupancy;
+
+  // the kernel's attributes on the current device
+  int         num_registers_per_thread;
+  std::size_t local_bytes_per_thread;
+  std::size_t static_smem_bytes;
+  int         max_group_size;
+  int         ptx_version;
+};
+
+
+// returns the launch bulk::async(g, f, args...) would make, e.g. to size a batch which fills the machine exactly once:
+//
+//   bulk::launch_info_t info = bulk::launch_info(bulk::grid<128,7>(num_groups), f, bulk::root.this_exec, ...);
+//   std::size_t batch_size = info.max_active_groups_per_multiprocessor * num_multiprocessors * 128 * 7;
+#if __BULK_HAS_VARIADIC_TEMPLATES__
+template<typename ExecutionGroup, typename Function, typename... Args>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Args&&... args);
+#else
+template<typename ExecutionGroup, typename Function>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9);
+
+
+template<typename ExecutionGroup, typename Function, typename Arg1, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9, typename Arg10>
+__host__ __device__
+launch_info_t launch_info(ExecutionGroup g, Function f, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4, Arg5 arg5, Arg6 arg6, Arg7 arg7, Arg8 arg8, Arg9 arg9, Arg10 arg10);
+#endif // __BULK_HAS_VARIADIC_TEMPLATES__
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
+#include <bulk/detail/launch_info.inl>
+
@@ -20,6 +20,8 @@
 #include <bulk/detail/pointer_traits.hpp>
 #include <bulk/detail/alignment.hpp>
 #include <bulk/uninitialized.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/heap_statistics.hpp>
 #include <thrust/detail/config.h>
 #include <cstdlib>
 
@@ -184,6 +186,13 @@ class singleton_unsafe_on_chip_allocator
     } // end deallocate()
 
 
+    // the number of bytes between the beginning of the heap and the program break
+    __device__ inline size_t footprint() const
+    {
+      return reinterpret_cast<char*>(heap_end()) - reinterpret_cast<char*>(heap_begin());
+    } // end footprint()
+
+
   private:
     // align to two words
     class block : public bulk::detail::aligned_type<sizeof(size_t) + sizeof(block*)>::type
@@ -351,27 +360,137 @@ class singleton_unsafe_on_chip_allocator
 }; // end singleton_unsafe_on_chip_allocator
 
 
+// only one instance of this class can logically exist per CTA
+// allocation bumps a pointer with atomicCAS, so its use is thread-safe without a lock
+class singleton_arena_on_chip_allocator
+{
+  public:
+    // XXX mark as __host__ to WAR a warning from uninitialized.construct
+    __device__ __host__ inline singleton_arena_on_chip_allocator(size_t max_data_segment_size)
+      : m_top(0),
+        m_max_data_segment_size(max_data_segment_size)
+    {}
+
+
+    __device__ inline void *allocate(size_t size)
+    {
+      // each allocation is preceded by a header recording its size, so that a LIFO free can pop it
+      unsigned int increment = align8(size) + sizeof(header);
+
+      unsigned int old_top = *reinterpret_cast<volatile unsigned int*>(&m_top);
+      unsigned int assumed_top;
+
+      do
+      {
+        assumed_top = old_top;
+
+        if(assumed_top + increment > m_max_data_segment_size)
+        {
+          // allocation failed
+          return 0;
+        } // end if
+
+        old_top = atomic_cas(&m_top, assumed_top, assumed_top + increment);
+      }
+      while(old_top != assumed_top);
+
+      header *h = reinterpret_cast<header*>(reinterpret_cast<char*>(s_data_segment_begin) + assumed_top);
+      h->size = increment;
+
+      return h + 1;
+    } // end allocate()
+
+
+    __device__ inline void deallocate(void *ptr)
+    {
+      if(ptr != 0)
+      {
+        header *h = reinterpret_cast<header*>(ptr) - 1;
+
+        unsigned int offset = reinterpret_cast<char*>(h) - reinterpret_cast<char*>(s_data_segment_begin);
+
+        // only the most recent allocation can be reclaimed
+        // the rest of the arena is reclaimed when the group exits
+        atomic_cas(&m_top, offset + h->size, offset);
+      } // end if
+    } // end deallocate()
+
+
+    // the number of bytes between the beginning of the arena and the bump pointer
+    __device__ inline size_t footprint() const
+    {
+      return *reinterpret_cast<const volatile unsigned int*>(&m_top);
+    } // end footprint()
+
+
+  private:
+    // keep the data which follows this 8-byte aligned
+    struct header
+    {
+      unsigned int size;
+      unsigned int padding;
+    };
+
+
+    __device__ inline static unsigned int atomic_cas(unsigned int *address, unsigned int compare, unsigned int val)
+    {
+#if __CUDA_ARCH__ >= 200
+      return atomicCAS(address, compare, val);
+#else
+      unsigned int old = *address;
+      if(old == compare) *address = val;
+      return old;
+#endif
+    } // end atomic_cas()
+
+
+    __device__ inline static unsigned int align8(size_t size)
+    {
+      return ((((size - 1) >> 3) << 3) + 8);
+    } // end align8()
+
+
+    unsigned int m_top;
+
+    // XXX this can safely be uint32
+    size_t m_max_data_segment_size;
+}; // end singleton_arena_on_chip_allocator
+
+
 class singleton_on_chip_allocator
 {
   public:
     // XXX mark as __host__ to WAR a warning from uninitialized.construct
     inline __device__ __host__
-    singleton_on_chip_allocator(size_t max_data_segment_size)
+    singleton_on_chip_allocator(size_t max_data_segment_size, heap_policy policy = first_fit_heap)
       : m_mutex(),
-        m_alloc(max_data_segment_size)
+        m_policy(policy),
+        m_alloc(max_data_segment_size),
+        m_arena(max_data_segment_size)
+#if BULK_HEAP_STATISTICS
+        , m_num_allocations(0),
+        m_num_spills(0),
+        m_peak_footprint(0)
+#endif
     {}
 
 
     inline __device__
     void *unsafe_allocate(size_t size)
     {
-      return m_alloc.allocate(size);
+      return (m_policy == arena_heap) ? m_arena.allocate(size) : m_alloc.allocate(size);
     }
 
 
     inline __device__
     void *allocate(size_t size)
     {
+      // the arena needs no lock
+      if(m_policy == arena_heap)
+      {
+        return m_arena.allocate(size);
+      } // end if
+
       void *result;
 
       m_mutex.lock();
@@ -387,13 +506,27 @@ class singleton_on_chip_allocator
     inline __device__
     void unsafe_deallocate(void *ptr)
     {
-      m_alloc.deallocate(ptr);
+      if(m_policy == arena_heap)
+      {
+        m_arena.deallocate(ptr);
+      } // end if
+      else
+      {
+        m_alloc.deallocate(ptr);
+      } // end else
     } // end unsafe_deallocate()
 
 
     inline __device__
     void deallocate(void *ptr)
     {
+      // the arena needs no lock
+      if(m_policy == arena_heap)
+      {
+        m_arena.deallocate(ptr);
+        return;
+      } // end if
+
       m_mutex.lock();
       {
         unsafe_deallocate(ptr);
@@ -402,6 +535,41 @@ class singleton_on_chip_allocator
     } // end deallocate()
 
 
+#if BULK_HEAP_STATISTICS
+    inline __device__
+    void record_allocation()
+    {
+      unsigned int footprint = (m_policy == arena_heap) ? m_arena.footprint() : m_alloc.footprint();
+
+#if __CUDA_ARCH__ >= 200
+      atomicAdd(&m_num_allocations, 1);
+      atomicMax(&m_peak_footprint, footprint);
+#endif
+    } // end record_allocation()
+
+
+    inline __device__
+    void record_spill()
+    {
+#if __CUDA_ARCH__ >= 200
+      atomicAdd(&m_num_spills, 1);
+#endif
+    } // end record_spill()
+
+
+    // accumulates this group's statistics into the launch's totals
+    inline __device__
+    void flush_statistics(heap_statistics_t *stats) const
+    {
+#if __CUDA_ARCH__ >= 200
+      atomicAdd(&stats->num_allocations,    m_num_allocations);
+      atomicAdd(&stats->num_spills,         m_num_spills);
+      atomicMax(&stats->peak_on_chip_bytes, m_peak_footprint);
+#endif
+    } // end flush_statistics()
+#endif // BULK_HEAP_STATISTICS
+
+
   private:
     class mutex
     {
@@ -447,7 +615,15 @@ class singleton_on_chip_allocator
 
 
     mutex m_mutex;
+    heap_policy m_policy;
     singleton_unsafe_on_chip_allocator m_alloc;
+    singleton_arena_on_chip_allocator m_arena;
+
+#if BULK_HEAP_STATISTICS
+    unsigned int m_num_allocations;
+    unsigned int m_num_spills;
+    unsigned int m_peak_footprint;
+#endif
 }; // end singleton_on_chip_allocator
 
 
@@ -460,15 +636,20 @@ __shared__  uninitialized<singleton_on_chip_allocator> s_on_chip_allocator;
 } // end anon namespace
 
 
-inline __device__ void init_on_chip_malloc(size_t max_data_segment_size)
+inline __device__ void init_on_chip_malloc(size_t max_data_segment_size, heap_policy policy = first_fit_heap)
 {
-  s_on_chip_allocator.construct(max_data_segment_size);
+  s_on_chip_allocator.construct(max_data_segment_size, policy);
 } // end init_on_chip_malloc()
 
 
 inline __device__ void *on_chip_malloc(size_t size)
 {
   void *result = s_on_chip_allocator.get().allocate(size);
+
+#if BULK_HEAP_STATISTICS
+  if(result) s_on_chip_allocator.get().record_allocation();
+#endif
+
   return on_chip_cast(result);
 } // end on_chip_malloc()
 
@@ -482,10 +663,32 @@ inline __device__ void on_chip_free(void *ptr)
 inline __device__ void *unsafe_on_chip_malloc(size_t size)
 {
   void *result = s_on_chip_allocator.get().unsafe_allocate(size);
+
+#if BULK_HEAP_STATISTICS
+  if(result) s_on_chip_allocator.get().record_allocation();
+#endif
+
   return on_chip_cast(result);
 } // end unsafe_on_chip_malloc()
 
 
+#if BULK_HEAP_STATISTICS
+inline __device__ void record_on_chip_malloc_spill()
+{
+  s_on_chip_allocator.get().record_spill();
+} // end record_on_chip_malloc_spill()
+
+
+inline __device__ void flush_on_chip_malloc_statistics(heap_statistics_t *stats)
+{
+  if(stats)
+  {
+    s_on_chip_allocator.get().flush_statistics(stats);
+  } // end if
+} // end flush_on_chip_malloc_statistics()
+#endif // BULK_HEAP_STATISTICS
+
+
 inline __device__ void unsafe_on_chip_free(void *ptr)
 {
   s_on_chip_allocator.get().unsafe_deallocate(ptr);
@@ -503,6 +706,9 @@ inline __device__ void *shmalloc(size_t num_bytes)
 #if __CUDA_ARCH__ >= 200
   if(!result)
   {
+#if BULK_HEAP_STATISTICS
+    detail::record_on_chip_malloc_spill();
+#endif
     result = std::malloc(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
@@ -519,6 +725,9 @@ inline __device__ void *unsafe_shmalloc(size_t num_bytes)
 #if __CUDA_ARCH__ >= 200
   if(!result)
   {
+#if BULK_HEAP_STATISTICS
+    detail::record_on_chip_malloc_spill();
+#endif
     result = std::malloc(num_bytes);
   } // end if
 #endif // __CUDA_ARCH__
@@ -595,6 +804,137 @@ inline void free(ConcurrentGroup &g, void *ptr)
 } // end free()
 
 
+namespace detail
+{
+
+
+// agent 0 reserves each buffer in turn, falling back to global memory
+// only for the buffers which don't fit on chip. Every agent receives the
+// results after a single barrier round trip for the whole batch.
+template<unsigned int N, typename ConcurrentGroup>
+__device__
+inline void malloc_all(ConcurrentGroup &g, const size_t *num_bytes, void **results)
+{
+  __shared__ void *s_results[N];
+
+  // we need to guard access to s_results from other
+  // invocations of malloc_all, so we put a wait at the beginning
+  g.wait();
+
+  if(g.this_exec.index() == 0)
+  {
+    for(unsigned int i = 0; i < N; ++i)
+    {
+      s_results[i] = bulk::unsafe_shmalloc(num_bytes[i]);
+    } // end for i
+  } // end if
+
+  g.wait();
+
+  for(unsigned int i = 0; i < N; ++i)
+  {
+    results[i] = s_results[i];
+  } // end for i
+} // end malloc_all()
+
+
+template<unsigned int N, typename ConcurrentGroup>
+__device__
+inline void free_all(ConcurrentGroup &g, void **ptrs)
+{
+  if(g.this_exec.index() == 0)
+  {
+    // free in the reverse order of allocation, which lets an arena_heap reclaim everything
+    for(unsigned int i = N; i > 0; --i)
+    {
+      bulk::unsafe_shfree(ptrs[i-1]);
+    } // end for i
+  } // end if
+
+  g.wait();
+} // end free_all()
+
+
+} // end detail
+
+
+// collectively allocates several typed buffers of n1, n2, ... elements
+template<typename ConcurrentGroup, typename T1, typename T2>
+__device__
+inline void malloc_all(ConcurrentGroup &g, T1 *&ptr1, size_t n1, T2 *&ptr2, size_t n2)
+{
+  size_t num_bytes[2] = {n1 * sizeof(T1), n2 * sizeof(T2)};
+  void *results[2];
+
+  bulk::detail::malloc_all<2>(g, num_bytes, results);
+
+  ptr1 = reinterpret_cast<T1*>(results[0]);
+  ptr2 = reinterpret_cast<T2*>(results[1]);
+} // end malloc_all()
+
+
+template<typename ConcurrentGroup, typename T1, typename T2, typename T3>
+__device__
+inline void malloc_all(ConcurrentGroup &g, T1 *&ptr1, size_t n1, T2 *&ptr2, size_t n2, T3 *&ptr3, size_t n3)
+{
+  size_t num_bytes[3] = {n1 * sizeof(T1), n2 * sizeof(T2), n3 * sizeof(T3)};
+  void *results[3];
+
+  bulk::detail::malloc_all<3>(g, num_bytes, results);
+
+  ptr1 = reinterpret_cast<T1*>(results[0]);
+  ptr2 = reinterpret_cast<T2*>(results[1]);
+  ptr3 = reinterpret_cast<T3*>(results[2]);
+} // end malloc_all()
+
+
+template<typename ConcurrentGroup, typename T1, typename T2, typename T3, typename T4>
+__device__
+inline void malloc_all(ConcurrentGroup &g, T1 *&ptr1, size_t n1, T2 *&ptr2, size_t n2, T3 *&ptr3, size_t n3, T4 *&ptr4, size_t n4)
+{
+  size_t num_bytes[4] = {n1 * sizeof(T1), n2 * sizeof(T2), n3 * sizeof(T3), n4 * sizeof(T4)};
+  void *results[4];
+
+  bulk::detail::malloc_all<4>(g, num_bytes, results);
+
+  ptr1 = reinterpret_cast<T1*>(results[0]);
+  ptr2 = reinterpret_cast<T2*>(results[1]);
+  ptr3 = reinterpret_cast<T3*>(results[2]);
+  ptr4 = reinterpret_cast<T4*>(results[3]);
+} // end malloc_all()
+
+
+// collectively frees buffers allocated with malloc_all
+template<typename ConcurrentGroup, typename T1, typename T2>
+__device__
+inline void free_all(ConcurrentGroup &g, T1 *ptr1, T2 *ptr2)
+{
+  void *ptrs[2] = {ptr1, ptr2};
+
+  bulk::detail::free_all<2>(g, ptrs);
+} // end free_all()
+
+
+template<typename ConcurrentGroup, typename T1, typename T2, typename T3>
+__device__
+inline void free_all(ConcurrentGroup &g, T1 *ptr1, T2 *ptr2, T3 *ptr3)
+{
+  void *ptrs[3] = {ptr1, ptr2, ptr3};
+
+  bulk::detail::free_all<3>(g, ptrs);
+} // end free_all()
+
+
+template<typename ConcurrentGroup, typename T1, typename T2, typename T3, typename T4>
+__device__
+inline void free_all(ConcurrentGroup &g, T1 *ptr1, T2 *ptr2, T3 *ptr3, T4 *ptr4)
+{
+  void *ptrs[4] = {ptr1, ptr2, ptr3, ptr4};
+
+  bulk::detail::free_all<4>(g, ptrs);
+} // end free_all()
+
+
 } // end namespace bulk
 BULK_NAMESPACE_SUFFIX
 
@@ -0,0 +1,287 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+
+
+// the tail launch & fire-and-forget streams of __device__ code first appeared in CUDA 12.0
+#if defined(__CUDA_ARCH__) && defined(cudaStreamTailLaunch) && defined(cudaStreamFireAndForget)
+#  define __BULK_HAS_NAMED_DEVICE_STREAMS__ 1
+#else
+#  define __BULK_HAS_NAMED_DEVICE_STREAMS__ 0
+#endif
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// the fields of device_properties_t which a cuda_launcher reads, narrowed to ints,
+// so that a kernel's parameters needn't carry the rest
+struct nested_device_properties
+{
+  int major;
+  int maxBlocksPerMultiProcessor;
+  int maxGridSize[2];
+  int maxThreadsPerBlock;
+  int maxThreadsPerMultiProcessor;
+  int minor;
+  int multiProcessorCount;
+  int regsPerBlock;
+  int regsPerMultiprocessor;
+  int reservedSharedMemPerBlock;
+  int sharedMemPerBlock;
+  int sharedMemPerBlockOptin;
+  int sharedMemPerMultiprocessor;
+  int warpSize;
+};
+
+
+__host__
+inline nested_device_properties make_nested_device_properties(const device_properties_t &props)
+{
+  nested_device_properties result;
+
+  result.major                       = props.major;
+  result.maxBlocksPerMultiProcessor  = props.maxBlocksPerMultiProcessor;
+  result.maxGridSize[0]              = props.maxGridSize[0];
+  result.maxGridSize[1]              = props.maxGridSize[1];
+  result.maxThreadsPerBlock          = props.maxThreadsPerBlock;
+  result.maxThreadsPerMultiProcessor = props.maxThreadsPerMultiProcessor;
+  result.minor                       = props.minor;
+  result.multiProcessorCount         = props.multiProcessorCount;
+  result.regsPerBlock                = props.regsPerBlock;
+  result.regsPerMultiprocessor       = props.regsPerMultiprocessor;
+  result.reservedSharedMemPerBlock   = static_cast<int>(props.reservedSharedMemPerBlock);
+  result.sharedMemPerBlock           = static_cast<int>(props.sharedMemPerBlock);
+  result.sharedMemPerBlockOptin      = static_cast<int>(props.sharedMemPerBlockOptin);
+  result.sharedMemPerMultiprocessor  = static_cast<int>(props.sharedMemPerMultiprocessor);
+  result.warpSize                    = props.warpSize;
+
+  return result;
+} // end make_nested_device_properties()
+
+
+// the fields a cuda_launcher doesn't read are zero
+__host__ __device__
+inline device_properties_t unpack(const nested_device_properties &props)
+{
+  device_properties_t result = {0,0,0,0,{0,0,0},{0,0,0},0,0,0,0,0,0,0,0,0,0,0};
+
+  result.major                       = props.major;
+  result.maxBlocksPerMultiProcessor  = props.maxBlocksPerMultiProcessor;
+  result.maxGridSize[0]              = props.maxGridSize[0];
+  result.maxGridSize[1]              = props.maxGridSize[1];
+  result.maxThreadsPerBlock          = props.maxThreadsPerBlock;
+  result.maxThreadsPerMultiProcessor = props.maxThreadsPerMultiProcessor;
+  result.minor                       = props.minor;
+  result.multiProcessorCount         = props.multiProcessorCount;
+  result.regsPerBlock                = props.regsPerBlock;
+  result.regsPerMultiprocessor       = props.regsPerMultiprocessor;
+  result.reservedSharedMemPerBlock   = props.reservedSharedMemPerBlock;
+  result.sharedMemPerBlock           = props.sharedMemPerBlock;
+  result.sharedMemPerBlockOptin      = props.sharedMemPerBlockOptin;
+  result.sharedMemPerMultiprocessor  = props.sharedMemPerMultiprocessor;
+  result.warpSize                    = props.warpSize;
+
+  return result;
+} // end unpack()
+
+
+} // end detail
+
+
+// the device a kernel runs on and its properties, captured on the host and passed to the kernel
+// so that the kernel's own launches needn't query them, e.g.
+//
+//   bulk::async(bulk::con(1,0), parent(), bulk::root, bulk::nested_launch_config(), ...);
+//
+//   struct parent
+//   {
+//     __device__ void operator()(bulk::concurrent_group<> &self, bulk::nested_launch_config cfg, ...)
+//     {
+//       bulk::async(bulk::nested(cfg, bulk::con(256, 1024), bulk::tail_launch_stream()), child(), bulk::root, ...);
+//     }
+//   };
+class nested_launch_config
+{
+  public:
+    // captures the current device
+    __host__
+    nested_launch_config()
+      : m_device(bulk::detail::current_device()),
+        m_device_properties(bulk::detail::make_nested_device_properties(bulk::detail::device_properties(m_device)))
+    {}
+
+    __host__
+    explicit nested_launch_config(int device)
+      : m_device(device),
+        m_device_properties(bulk::detail::make_nested_device_properties(bulk::detail::device_properties(m_device)))
+    {}
+
+    __host__ __device__
+    int device() const
+    {
+      return m_device;
+    }
+
+    // only the fields a launcher reads are valid
+    __host__ __device__
+    detail::device_properties_t device_properties() const
+    {
+      return bulk::detail::unpack(m_device_properties);
+    }
+
+  private:
+    int                              m_device;
+    detail::nested_device_properties m_device_properties;
+};
+
+
+// a launch which takes its device's properties from a nested_launch_config
+template<typename ExecutionGroup>
+class nested_launch
+{
+  public:
+    typedef async_launch<ExecutionGroup> launch_type;
+
+    __host__ __device__
+    nested_launch(const nested_launch_config &config, launch_type launch)
+      : m_config(config), m_launch(launch)
+    {}
+
+    __host__ __device__
+    const nested_launch_config &config() const
+    {
+      return m_config;
+    }
+
+    __host__ __device__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    nested_launch_config m_config;
+    launch_type          m_launch;
+};
+
+
+// shorthand for launching g with the device properties in config, e.g. from __device__ code
+// a launch whose group size & heap size are explicit queries nothing, doesn't allocate its parameters,
+// and doesn't wait for its child grid unless BULK_DEVICE_SYNCHRONOUS is 1
+// the future it returns is invalid; the launch is ordered by its stream alone
+template<typename ExecutionGroup>
+__host__ __device__
+nested_launch<ExecutionGroup> nested(const nested_launch_config &config, ExecutionGroup g, cudaStream_t stream = 0)
+{
+  return nested_launch<ExecutionGroup>(config, async_launch<ExecutionGroup>(g, stream));
+} // end nested()
+
+
+template<typename ExecutionGroup>
+__host__ __device__
+nested_launch<ExecutionGroup> nested(const nested_launch_config &config, async_launch<ExecutionGroup> launch)
+{
+  return nested_launch<ExecutionGroup>(config, launch);
+} // end nested()
+
+
+// a stream for launches from __device__ code which begin only once the launching grid has completed,
+// so that a recursive algorithm may hand its continuation to a child rather than wait on it
+// elsewhere, the launching block's default stream
+__device__
+inline cudaStream_t tail_launch_stream()
+{
+#if __BULK_HAS_NAMED_DEVICE_STREAMS__
+  return cudaStreamTailLaunch;
+#else
+  return 0;
+#endif
+} // end tail_launch_stream()
+
+
+// a stream for launches from __device__ code which begin independently of the launching grid's other work
+// elsewhere, the launching block's default stream
+__device__
+inline cudaStream_t fire_and_forget_stream()
+{
+#if __BULK_HAS_NAMED_DEVICE_STREAMS__
+  return cudaStreamFireAndForget;
+#else
+  return 0;
+#endif
+} // end fire_and_forget_stream()
+
+
+namespace detail
+{
+
+
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__ __device__
+future<void> async(nested_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  typedef closure<Function,Arguments>                     closure_type;
+  typedef cuda_launcher<ExecutionGroup,closure_type>      launcher_type;
+  typedef typename launcher_type::task_type               task_type;
+
+  // reject tasks too large for the parameter buffer,
+  // because marshalling them from __device__ code would allocate per launch
+  if(sizeof(task_type) > 4096)
+  {
+    bulk::detail::terminate_with_message("bulk::async(): a nested launch's parameters may not exceed 4096 bytes.");
+  } // end if
+
+  async_launch<ExecutionGroup> launch = g.launch();
+
+  cudaStream_t s = launch.is_stream_valid() ? launch.stream() : 0;
+
+  bulk::detail::wait_on_before_events(s, launch);
+
+  launcher_type launcher(g.config().device(), g.config().device_properties());
+
+#if __BULK_HAS_LAUNCH_NAMES__
+  launcher.set_name(launch.name());
+#endif
+
+  launcher.launch(launch.exec(), c, s);
+
+  // recording an event would cost a cudaEventCreate per launch, and the tail launch
+  // & fire-and-forget streams can't record one anyway
+  return future<void>();
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
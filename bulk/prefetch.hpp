@@ -0,0 +1,272 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/pointer_traits.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+#include <thrust/detail/type_traits.h>
+#include <cstddef>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+namespace detail
+{
+
+
+// true when device may migrate managed memory while the host runs, so that prefetches & advice take effect
+// everywhere else (e.g. Windows or pre-Pascal devices) managed memory migrates wholesale at each launch anyway
+inline __host__ bool has_concurrent_managed_access(int device)
+{
+  int result = 0;
+#if __BULK_HAS_CUDART__
+  bulk::detail::throw_on_error(cudaDeviceGetAttribute(&result, cudaDevAttrConcurrentManagedAccess, device), "cudaDeviceGetAttribute in has_concurrent_managed_access");
+#endif
+  return result != 0;
+} // end has_concurrent_managed_access()
+
+
+// migrates [ptr, ptr + num_bytes) to device (or to the host, when device is cudaCpuDeviceId) in stream s
+inline __host__ void prefetch_in_stream(const void *ptr, std::size_t num_bytes, int device, cudaStream_t s)
+{
+#if __BULK_HAS_CUDART__
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 13000)
+  cudaMemLocation location;
+  location.type = (device == cudaCpuDeviceId) ? cudaMemLocationTypeHost : cudaMemLocationTypeDevice;
+  location.id   = (device == cudaCpuDeviceId) ? 0 : device;
+
+  bulk::detail::throw_on_error(cudaMemPrefetchAsync(ptr, num_bytes, location, 0, s), "cudaMemPrefetchAsync in prefetch_in_stream");
+#  else
+  bulk::detail::throw_on_error(cudaMemPrefetchAsync(ptr, num_bytes, device, s), "cudaMemPrefetchAsync in prefetch_in_stream");
+#  endif
+#else
+  (void) ptr;
+  (void) num_bytes;
+  (void) device;
+  (void) s;
+#endif
+} // end prefetch_in_stream()
+
+
+// keeps device's mapping to [ptr, ptr + num_bytes) wherever the pages live,
+// so that it reads them remotely rather than fault if they migrate away
+// XXX unlike a prefetch, advice isn't stream-ordered
+inline __host__ void advise_accessed_by(const void *ptr, std::size_t num_bytes, int device)
+{
+#if __BULK_HAS_CUDART__
+#  if defined(CUDART_VERSION) && (CUDART_VERSION >= 13000)
+  cudaMemLocation location;
+  location.type = cudaMemLocationTypeDevice;
+  location.id   = device;
+
+  bulk::detail::throw_on_error(cudaMemAdvise(ptr, num_bytes, cudaMemAdviseSetAccessedBy, location), "cudaMemAdvise in advise_accessed_by");
+#  else
+  bulk::detail::throw_on_error(cudaMemAdvise(ptr, num_bytes, cudaMemAdviseSetAccessedBy, device), "cudaMemAdvise in advise_accessed_by");
+#  endif
+#else
+  (void) ptr;
+  (void) num_bytes;
+  (void) device;
+#endif
+} // end advise_accessed_by()
+
+
+// prefetches the managed allocation each of a closure's pointer arguments points into
+// other arguments pass through untouched
+class managed_argument_prefetcher
+{
+  public:
+    __host__ __device__
+    managed_argument_prefetcher(int device, cudaStream_t s)
+      : m_device(device), m_stream(s)
+    {}
+
+    template<typename T>
+    __host__ __device__
+    T *operator()(T *ptr) const
+    {
+#ifndef __CUDA_ARCH__
+      const void *base = 0;
+      std::size_t size = 0;
+
+      if(bulk::detail::find_managed_allocation(ptr, base, size))
+      {
+        bulk::detail::advise_accessed_by(base, size, m_device);
+        bulk::detail::prefetch_in_stream(base, size, m_device, m_stream);
+      } // end if
+#endif
+
+      return ptr;
+    } // end operator()
+
+    template<typename T>
+    __host__ __device__
+    const T &operator()(const T &x) const
+    {
+      return x;
+    } // end operator()
+
+  private:
+    int          m_device;
+    cudaStream_t m_stream;
+}; // end managed_argument_prefetcher
+
+
+} // end detail
+
+
+// a launch which first prefetches its closure's managed pointer arguments to the device in its own stream,
+// so that its groups find the pages resident rather than fault them in one at a time, e.g.
+//
+//   bulk::async(bulk::prefetched(bulk::par(n)), saxpy(), bulk::root.this_exec, a, x, y);
+//
+// each argument which is a raw pointer into a managed allocation migrates the whole allocation;
+// mapped host memory & device memory are left alone, as are iterators
+// XXX finding an allocation's extent requires CUDA 11.3; older toolkits launch without prefetching
+//     bulk::prefetch names ranges explicitly & may be pipelined ahead of the launch instead
+template<typename ExecutionGroup>
+class prefetch_launch
+{
+  public:
+    typedef async_launch<ExecutionGroup> launch_type;
+
+    __host__
+    prefetch_launch(launch_type launch)
+      : m_launch(launch)
+    {}
+
+    __host__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    launch_type m_launch;
+};
+
+
+template<typename ExecutionGroup>
+__host__
+prefetch_launch<ExecutionGroup> prefetched(async_launch<ExecutionGroup> launch)
+{
+  return prefetch_launch<ExecutionGroup>(launch);
+} // end prefetched()
+
+
+// a launch of g alone borrows a stream from the pool, just like g would
+template<typename ExecutionGroup>
+__host__
+prefetch_launch<ExecutionGroup> prefetched(ExecutionGroup g)
+{
+  return bulk::prefetched(async_launch<ExecutionGroup>(g, cudaEvent_t(0)));
+} // end prefetched()
+
+
+// migrates [ptr, ptr + num_bytes), which must be managed, to device once before is ready
+// the migration happens in a borrowed stream, so a launch which waits on the result may overlap
+// the next prefetch with its work, e.g.
+//
+//   bulk::future<void> ready = bulk::prefetch(chunk, chunk_bytes);
+//   bulk::async(bulk::par(ready, n), f, ...);
+//
+// devices without concurrent managed access ignore the hint, and the result is ready once before is
+inline __host__
+future<void> prefetch(const future<void> &before, const void *ptr, std::size_t num_bytes, int device = bulk::detail::current_device())
+{
+  int stream_device = bulk::detail::current_device();
+  cudaStream_t s = bulk::detail::acquire_stream(stream_device);
+
+  // the stream goes back to the pool if anything below throws before the future takes it,
+  // e.g. when ptr isn't managed
+  try
+  {
+    bulk::detail::stream_wait_on(s, before);
+
+    if(num_bytes > 0 && (device == cudaCpuDeviceId || bulk::detail::has_concurrent_managed_access(device)))
+    {
+      bulk::detail::prefetch_in_stream(ptr, num_bytes, device, s);
+    } // end if
+
+    // the result hands the stream back to the pool when it is destroyed
+    return detail::future_core_access::create(s, true);
+  } // end try
+  catch(...)
+  {
+    bulk::detail::release_stream(stream_device, s);
+    throw;
+  } // end catch
+} // end prefetch()
+
+
+inline __host__
+future<void> prefetch(const void *ptr, std::size_t num_bytes, int device = bulk::detail::current_device())
+{
+  return bulk::prefetch(future<void>(), ptr, num_bytes, device);
+} // end prefetch()
+
+
+namespace detail
+{
+
+
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(prefetch_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  async_launch<ExecutionGroup> launch = g.launch();
+
+  int device = bulk::detail::current_device();
+
+  // borrow a stream from the pool when the launch doesn't name one
+  bool owns_stream = !launch.is_stream_valid();
+  cudaStream_t s = owns_stream ? bulk::detail::acquire_stream(device, launch.resources().priority) : launch.stream();
+
+  // a borrowed stream goes back to the pool if anything below throws before the future takes it
+  try
+  {
+    bulk::detail::wait_on_before_events(s, launch);
+
+    if(bulk::detail::has_concurrent_managed_access(device))
+    {
+      bulk::detail::closure_arguments_transform<thrust::detail::identity_>(c.arguments(), managed_argument_prefetcher(device, s));
+    } // end if
+
+    return bulk::detail::launch_in_stream(launch.exec(), c, s, owns_stream, launch.name(), launch.resources());
+  } // end try
+  catch(...)
+  {
+    if(owns_stream) bulk::detail::release_stream(device, s);
+    throw;
+  } // end catch
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,371 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/stream_pool.hpp>
+#include <bulk/detail/closure.hpp>
+#include <bulk/detail/cuda_task.hpp>
+#include <bulk/detail/cuda_launcher/cuda_launcher.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <bulk/execution_policy.hpp>
+#include <bulk/future.hpp>
+#include <bulk/async.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the extents of a shape of up to three dimensions, or the coordinates of a point within one
+struct index3
+{
+  int x, y, z;
+
+  __host__ __device__
+  index3(int x = 1, int y = 1, int z = 1)
+    : x(x), y(y), z(z)
+  {}
+
+  // the number of points in the shape
+  __host__ __device__
+  int size() const
+  {
+    return x * y * z;
+  }
+};
+
+
+// the view of a shaped launch its groups receive: a parallel_group whose groups & agents also
+// have coordinates, which map directly onto the hardware's grid & block dimensions
+// so that 2D & 3D problems need no division to recover them, e.g.
+//
+//   bulk::index3 p = g.global_coordinates();
+//   image[p.y * width + p.x] = ...;
+//
+// index() & size() remain linear, x varying fastest
+template<typename ExecutionGroup>
+class shaped_grid
+  : public parallel_group<ExecutionGroup>
+{
+  private:
+    typedef parallel_group<ExecutionGroup> super_t;
+
+  public:
+    typedef typename super_t::agent_type agent_type;
+    typedef typename super_t::size_type  size_type;
+
+    __host__ __device__
+    shaped_grid(const super_t &g)
+      : super_t(g)
+    {}
+
+    // these read CUDA built-ins, so they are guarded from foreign compilers
+
+    // the extents of this grid, in groups
+    __device__
+    index3 shape() const
+    {
+#ifdef __CUDA_ARCH__
+      return index3(gridDim.x, gridDim.y, gridDim.z);
+#else
+      return index3();
+#endif
+    }
+
+    // the extents of each group, in agents
+    __device__
+    index3 group_shape() const
+    {
+#ifdef __CUDA_ARCH__
+      return index3(blockDim.x, blockDim.y, blockDim.z);
+#else
+      return index3();
+#endif
+    }
+
+    // the coordinates of the calling agent's group within this grid
+    __device__
+    index3 group_coordinates() const
+    {
+#ifdef __CUDA_ARCH__
+      return index3(blockIdx.x, blockIdx.y, blockIdx.z);
+#else
+      return index3();
+#endif
+    }
+
+    // the coordinates of the calling agent within its group
+    __device__
+    index3 agent_coordinates() const
+    {
+#ifdef __CUDA_ARCH__
+      return index3(threadIdx.x, threadIdx.y, threadIdx.z);
+#else
+      return index3();
+#endif
+    }
+
+    // the coordinates of the calling agent within the agents of the whole grid
+    __device__
+    index3 global_coordinates() const
+    {
+#ifdef __CUDA_ARCH__
+      return index3(blockIdx.x * blockDim.x + threadIdx.x,
+                    blockIdx.y * blockDim.y + threadIdx.y,
+                    blockIdx.z * blockDim.z + threadIdx.z);
+#else
+      return index3();
+#endif
+    }
+};
+
+
+// a launch of a grid of grid_shape() groups, each of group_shape() agents
+template<typename ExecutionGroup>
+class shaped_launch
+{
+  public:
+    typedef async_launch<parallel_group<ExecutionGroup> > launch_type;
+
+    __host__
+    shaped_launch(index3 grid_shape, index3 group_shape, launch_type launch)
+      : m_grid_shape(grid_shape), m_group_shape(group_shape), m_launch(launch)
+    {}
+
+    __host__
+    index3 grid_shape() const
+    {
+      return m_grid_shape;
+    }
+
+    __host__
+    index3 group_shape() const
+    {
+      return m_group_shape;
+    }
+
+    __host__
+    launch_type launch() const
+    {
+      return m_launch;
+    }
+
+  private:
+    index3      m_grid_shape;
+    index3      m_group_shape;
+    launch_type m_launch;
+};
+
+
+// shorthand for shaping the groups of g into grid_shape & their agents into group_shape, e.g.
+//
+//   bulk::async(bulk::shaped(bulk::index3(width / 16, height / 16), bulk::index3(16, 16), bulk::grid()), f, bulk::root, ...);
+//
+// f receives a shaped_grid in place of bulk::root
+// the shapes override g's sizes; a static group size must equal group_shape.size()
+// XXX bulk::root must be f's first argument
+template<typename ExecutionGroup>
+__host__
+shaped_launch<ExecutionGroup> shaped(index3 grid_shape, index3 group_shape, parallel_group<ExecutionGroup> g)
+{
+  return shaped_launch<ExecutionGroup>(grid_shape, group_shape, async_launch<parallel_group<ExecutionGroup> >(g, cudaEvent_t(0)));
+} // end shaped()
+
+
+template<typename ExecutionGroup>
+__host__
+shaped_launch<ExecutionGroup> shaped(index3 grid_shape, index3 group_shape, async_launch<parallel_group<ExecutionGroup> > launch)
+{
+  return shaped_launch<ExecutionGroup>(grid_shape, group_shape, launch);
+} // end shaped()
+
+
+namespace detail
+{
+
+
+// invokes f with its first argument, the grid, replaced with a shaped_grid
+template<typename Function>
+class shaped_function
+{
+  public:
+    __host__ __device__
+    shaped_function(Function f)
+      : m_f(f)
+    {}
+
+    template<typename Grid>
+    __device__
+    void operator()(Grid &g)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg);
+    } // end operator()
+
+    template<typename Grid, typename Arg2>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4, arg5);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4, arg5, arg6);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4, arg5, arg6, arg7);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4, arg5, arg6, arg7, arg8);
+    } // end operator()
+
+    template<typename Grid, typename Arg2, typename Arg3, typename Arg4, typename Arg5, typename Arg6, typename Arg7, typename Arg8, typename Arg9>
+    __device__
+    void operator()(Grid &g, Arg2 &arg2, Arg3 &arg3, Arg4 &arg4, Arg5 &arg5, Arg6 &arg6, Arg7 &arg7, Arg8 &arg8, Arg9 &arg9)
+    {
+      shaped_grid<typename Grid::agent_type> sg(g);
+      m_f(sg, arg2, arg3, arg4, arg5, arg6, arg7, arg8, arg9);
+    } // end operator()
+
+  private:
+    Function m_f;
+}; // end shaped_function
+
+
+// launches c with the shapes of g and returns a future for its completion
+template<typename ExecutionGroup, typename Function, typename Arguments>
+__host__
+future<void> async(shaped_launch<ExecutionGroup> g, closure<Function,Arguments> c)
+{
+  typedef parallel_group<ExecutionGroup>                   grid_type;
+  typedef typename grid_type::agent_type                   block_type;
+  typedef typename block_type::agent_type                  thread_type;
+  typedef closure<shaped_function<Function>,Arguments>     closure_type;
+  typedef typename grid_type::size_type                    size_type;
+
+  async_launch<grid_type> launch = g.launch();
+
+  index3 grid_shape  = g.grid_shape();
+  index3 group_shape = g.group_shape();
+
+  int device = bulk::detail::current_device();
+  const device_properties_t &props = bulk::detail::device_properties(device);
+
+  if(grid_shape.x < 1 || grid_shape.y < 1 || grid_shape.z < 1 ||
+     grid_shape.x > props.maxGridSize[0] || grid_shape.y > props.maxGridSize[1] || grid_shape.z > props.maxGridSize[2])
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async(): the grid shape exceeds the device's grid dimensions");
+  } // end if
+
+  if(group_shape.x < 1 || group_shape.y < 1 || group_shape.z < 1 ||
+     group_shape.x > props.maxThreadsDim[0] || group_shape.y > props.maxThreadsDim[1] || group_shape.z > props.maxThreadsDim[2] ||
+     group_shape.size() > props.maxThreadsPerBlock)
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async(): the group shape exceeds the device's block dimensions");
+  } // end if
+
+  bulk::detail::cuda_launcher<grid_type,closure_type> launcher;
+
+  launcher.set_resources(launch.resources());
+
+  block_type requested_block = launch.exec().this_exec;
+  grid_type request = bulk::par(make_block<block_type>(group_shape.size(), requested_block.heap_size(), thread_type(), invalid_index, requested_block.heap_policy()), grid_shape.size());
+
+  size_type num_groups = 0, group_size = 0, heap_size = 0;
+  thrust::tie(num_groups, group_size, heap_size) = launcher.configuration(request);
+
+  if(group_size != group_shape.size())
+  {
+    bulk::detail::throw_on_error(cudaErrorInvalidValue, "bulk::async(): the group shape disagrees with the group's static size");
+  } // end if
+
+  // borrow a stream from the pool when the launch doesn't name one
+  bool owns_stream = !launch.is_stream_valid();
+  cudaStream_t s = owns_stream ? bulk::detail::acquire_stream(device, launch.resources().priority) : launch.stream();
+
+  // a borrowed stream goes back to the pool if anything below throws before the future takes it
+  try
+  {
+    bulk::detail::wait_on_before_events(s, launch);
+
+#if __BULK_HAS_LAUNCH_NAMES__
+    launcher.set_name(launch.name());
+#endif
+
+    closure_type shaped_c(shaped_function<Function>(c.function()), c.arguments());
+
+    launcher.set_shape(dim3(grid_shape.x, grid_shape.y, grid_shape.z), dim3(group_shape.x, group_shape.y, group_shape.z));
+    launcher.launch(request, shaped_c, s);
+
+    return future_core_access::create(s, owns_stream, launcher.launch_sequence());
+  } // end try
+  catch(...)
+  {
+    if(owns_stream) bulk::detail::release_stream(device, s);
+    throw;
+  } // end catch
+} // end async()
+
+
+} // end detail
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
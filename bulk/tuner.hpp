@@ -0,0 +1,374 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/spin_lock.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <map>
+#include <typeinfo>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// the static shape of a concurrent_group<agent<grainsize>, groupsize>
+struct group_shape_t
+{
+  std::size_t groupsize;
+  std::size_t grainsize;
+};
+
+
+namespace detail
+{
+namespace tuner_detail
+{
+
+
+// the shapes we try
+// XXX these span the shapes the examples were hand-tuned with
+template<int i> struct candidate;
+template<> struct candidate<0> { static const std::size_t groupsize = 128; static const std::size_t grainsize =  5; };
+template<> struct candidate<1> { static const std::size_t groupsize = 128; static const std::size_t grainsize =  7; };
+template<> struct candidate<2> { static const std::size_t groupsize = 128; static const std::size_t grainsize = 11; };
+template<> struct candidate<3> { static const std::size_t groupsize = 256; static const std::size_t grainsize =  3; };
+template<> struct candidate<4> { static const std::size_t groupsize = 256; static const std::size_t grainsize =  5; };
+template<> struct candidate<5> { static const std::size_t groupsize = 256; static const std::size_t grainsize =  7; };
+template<> struct candidate<6> { static const std::size_t groupsize = 512; static const std::size_t grainsize =  3; };
+template<> struct candidate<7> { static const std::size_t groupsize = 512; static const std::size_t grainsize =  5; };
+
+const int num_candidates = 8;
+
+
+template<int i>
+inline group_shape_t shape()
+{
+  group_shape_t result = {candidate<i>::groupsize, candidate<i>::grainsize};
+  return result;
+} // end shape()
+
+
+inline group_shape_t shape(int i)
+{
+  switch(i)
+  {
+    case 0:  return shape<0>();
+    case 1:  return shape<1>();
+    case 2:  return shape<2>();
+    case 3:  return shape<3>();
+    case 4:  return shape<4>();
+    case 5:  return shape<5>();
+    case 6:  return shape<6>();
+    default: return shape<7>();
+  } // end switch
+} // end shape()
+
+
+template<typename Tunable>
+inline void launch(int i, const Tunable &t)
+{
+  switch(i)
+  {
+    case 0:  t.template launch<candidate<0>::groupsize, candidate<0>::grainsize>(); break;
+    case 1:  t.template launch<candidate<1>::groupsize, candidate<1>::grainsize>(); break;
+    case 2:  t.template launch<candidate<2>::groupsize, candidate<2>::grainsize>(); break;
+    case 3:  t.template launch<candidate<3>::groupsize, candidate<3>::grainsize>(); break;
+    case 4:  t.template launch<candidate<4>::groupsize, candidate<4>::grainsize>(); break;
+    case 5:  t.template launch<candidate<5>::groupsize, candidate<5>::grainsize>(); break;
+    case 6:  t.template launch<candidate<6>::groupsize, candidate<6>::grainsize>(); break;
+    default: t.template launch<candidate<7>::groupsize, candidate<7>::grainsize>(); break;
+  } // end switch
+} // end launch()
+
+
+// problems of similar size share a winner
+inline int size_bucket(std::size_t n)
+{
+  int result = 0;
+
+  for(; n > 1; n >>= 1, ++result);
+
+  return result;
+} // end size_bucket()
+
+
+// the winners, keyed by device, algorithm & problem size
+// the cache is read from and appended to the file named by $BULK_TUNING_CACHE,
+// or $HOME/.bulk_tuning_cache when that isn't set
+// each line of the file is "<key> <groupsize> <grainsize>"
+class tuning_cache
+{
+  public:
+    inline tuning_cache()
+      : m_loaded(false)
+    {}
+
+    inline bool find(const std::string &key, int &result)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      load();
+
+      std::map<std::string,int>::iterator i = m_winners.find(key);
+
+      if(i == m_winners.end()) return false;
+
+      result = i->second;
+      return true;
+    } // end find()
+
+    inline void insert(const std::string &key, int winner)
+    {
+      scoped_spin_lock guard(m_lock);
+
+      m_winners[key] = winner;
+
+      std::string path = file_name();
+
+      if(!path.empty())
+      {
+        // failing to persist the winner is harmless, we'll just tune again next time
+        if(std::FILE *file = std::fopen(path.c_str(), "a"))
+        {
+          group_shape_t s = shape(winner);
+          std::fprintf(file, "%s %lu %lu\n", key.c_str(), (unsigned long)s.groupsize, (unsigned long)s.grainsize);
+          std::fclose(file);
+        } // end if
+      } // end if
+    } // end insert()
+
+  private:
+    inline static std::string file_name()
+    {
+      if(const char *path = std::getenv("BULK_TUNING_CACHE"))
+      {
+        return path;
+      } // end if
+
+      if(const char *home = std::getenv("HOME"))
+      {
+        return std::string(home) + "/.bulk_tuning_cache";
+      } // end if
+
+      return std::string();
+    } // end file_name()
+
+    // the caller holds m_lock
+    inline void load()
+    {
+      if(m_loaded) return;
+
+      m_loaded = true;
+
+      std::string path = file_name();
+
+      if(path.empty()) return;
+
+      std::FILE *file = std::fopen(path.c_str(), "r");
+
+      if(!file) return;
+
+      char key[1024];
+      unsigned long groupsize = 0, grainsize = 0;
+
+      while(std::fscanf(file, "%1023s %lu %lu", key, &groupsize, &grainsize) == 3)
+      {
+        // ignore shapes we no longer try
+        for(int i = 0; i < num_candidates; ++i)
+        {
+          if(shape(i).groupsize == groupsize && shape(i).grainsize == grainsize)
+          {
+            // later lines win
+            m_winners[key] = i;
+          } // end if
+        } // end for i
+      } // end while
+
+      std::fclose(file);
+    } // end load()
+
+    spin_lock                 m_lock;
+    bool                      m_loaded;
+    std::map<std::string,int> m_winners;
+}; // end tuning_cache
+
+
+inline tuning_cache &the_tuning_cache()
+{
+  static tuning_cache cache;
+  return cache;
+} // end the_tuning_cache()
+
+
+// names the current device by name & compute capability, so that the file may be shared across machines
+inline std::string device_key()
+{
+  static const int max_num_devices = 16;
+  static std::string names[max_num_devices];
+  static spin_lock lock;
+
+  int device = bulk::detail::current_device();
+
+  scoped_spin_lock guard(lock);
+
+  if(device < 0 || device >= max_num_devices || names[device].empty())
+  {
+    cudaDeviceProp props;
+    bulk::detail::throw_on_error(cudaGetDeviceProperties(&props, device), "cudaGetDeviceProperties in device_key");
+
+    char buffer[512];
+    std::sprintf(buffer, "%s/sm_%d%d", props.name, props.major, props.minor);
+
+    // the cache's file is whitespace-delimited
+    for(char *c = buffer; *c; ++c)
+    {
+      if(*c == ' ') *c = '_';
+    } // end for c
+
+    if(device < 0 || device >= max_num_devices) return buffer;
+
+    names[device] = buffer;
+  } // end if
+
+  return names[device];
+} // end device_key()
+
+
+// returns the time in ms that candidate i takes to run t, or a negative number if it can't run on this device
+template<typename Tunable>
+inline float time_candidate(int i, const Tunable &t)
+{
+  const int num_trials = 3;
+
+  // skip shapes too large for the device
+  if(shape(i).groupsize > static_cast<std::size_t>(bulk::detail::device_properties().maxThreadsPerBlock))
+  {
+    return -1;
+  } // end if
+
+  // warm up, compiling & caching the instantiation's launch configuration
+  launch(i, t);
+
+  if(cudaDeviceSynchronize() != cudaSuccess)
+  {
+    // e.g. the instantiation needs more resources than the device has
+    cudaGetLastError();
+    return -1;
+  } // end if
+
+  // the pooled events can't time, so make our own
+  cudaEvent_t start = 0, stop = 0;
+  bulk::detail::throw_on_error(cudaEventCreate(&start), "cudaEventCreate in time_candidate");
+  bulk::detail::throw_on_error(cudaEventCreate(&stop),  "cudaEventCreate in time_candidate");
+
+  cudaEventRecord(start);
+
+  for(int trial = 0; trial < num_trials; ++trial)
+  {
+    launch(i, t);
+  } // end for trial
+
+  cudaEventRecord(stop);
+
+  float result = -1;
+
+  if(cudaEventSynchronize(stop) == cudaSuccess)
+  {
+    cudaEventElapsedTime(&result, start, stop);
+  }
+  else
+  {
+    cudaGetLastError();
+  } // end else
+
+  cudaEventDestroy(start);
+  cudaEventDestroy(stop);
+
+  return result;
+} // end time_candidate()
+
+
+} // end tuner_detail
+} // end detail
+
+
+// autotune(n, t) launches t.launch<groupsize,grainsize>() with the shape which runs t fastest
+// on the current device. The first time a device sees a Tunable type at a given problem size,
+// each candidate shape is timed by running t several times; the winner is remembered
+// in memory and in an on-disk cache, and later calls launch it without timing.
+//
+// Tunable requirements:
+//
+//   template<std::size_t groupsize, std::size_t grainsize> void launch() const;
+//
+// which launches the algorithm across concurrent_group<agent<grainsize>, groupsize>.
+// Because tuning runs t repeatedly, launch() must leave the same result no matter how many
+// times it runs. The element types are part of Tunable's type, so they key the cache too.
+//
+// Returns the shape which was launched.
+//
+// XXX bulk::choose_sizes picks the sizes of dynamically-sized groups; static shapes like these
+//     have to be chosen among instantiations, which is why this is a separate entry point
+template<typename Tunable>
+inline group_shape_t autotune(std::size_t n, const Tunable &t)
+{
+  using namespace bulk::detail::tuner_detail;
+
+  char bucket[32];
+  std::sprintf(bucket, "/%d", size_bucket(n));
+
+  const std::string key = device_key() + "/" + typeid(Tunable).name() + bucket;
+
+  int winner = 0;
+
+  if(!the_tuning_cache().find(key, winner))
+  {
+    float best_time = -1;
+
+    for(int i = 0; i < num_candidates; ++i)
+    {
+      float time = time_candidate(i, t);
+
+      if(time >= 0 && (best_time < 0 || time < best_time))
+      {
+        best_time = time;
+        winner = i;
+      } // end if
+    } // end for i
+
+    the_tuning_cache().insert(key, winner);
+  } // end if
+
+  launch(winner, t);
+
+  return shape(winner);
+} // end autotune()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,63 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/cuda_launcher/runtime_introspection.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// eagerly populates the cached properties of a device, so that the
+// first launch from each host thread doesn't have to query them
+inline void warm_up(int device_id)
+{
+#if __BULK_HAS_CUDART__
+  bulk::detail::device_properties(device_id);
+#else
+  (void) device_id; // Suppress unused parameter warnings
+  bulk::detail::terminate_with_message("bulk::warm_up(): requires CUDART");
+#endif
+} // end warm_up()
+
+
+// eagerly populates the cached properties of every visible device
+inline void warm_up()
+{
+#if __BULK_HAS_CUDART__
+  int num_devices = 0;
+  bulk::detail::throw_on_error(cudaGetDeviceCount(&num_devices), "cudaGetDeviceCount in bulk::warm_up");
+
+  for(int i = 0; i < num_devices; ++i)
+  {
+    bulk::warm_up(i);
+  } // end for i
+#else
+  bulk::detail::terminate_with_message("bulk::warm_up(): requires CUDART");
+#endif
+} // end warm_up()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
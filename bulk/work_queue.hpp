@@ -0,0 +1,343 @@
+/*
+ *  Copyright 2008-2013 NVIDIA Corporation
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <bulk/detail/config.hpp>
+#include <bulk/detail/guarded_cuda_runtime_api.hpp>
+#include <bulk/detail/throw_on_error.hpp>
+#include <bulk/detail/terminate.hpp>
+#include <bulk/detail/host_atomic.hpp>
+
+
+BULK_NAMESPACE_PREFIX
+namespace bulk
+{
+
+
+// a half-open range of indices for a persistent group to process
+struct work_item_t
+{
+  int begin;
+  int end;
+};
+
+
+namespace detail
+{
+
+
+// a slot of the work queue's ring buffer, which lives in mapped host memory
+// sequence tracks the slot's state for ticket t:
+//   sequence == t     -- the slot is free for the host to fill with ticket t
+//   sequence == t + 1 -- ticket t has been published for a group to claim
+struct work_queue_slot
+{
+  host_atomic_int sequence;
+  int             begin;
+  int             end;
+};
+
+
+// the state the host publishes besides the slots, also in mapped host memory
+struct work_queue_state
+{
+  host_atomic_int num_pushed;
+  host_atomic_int closed;
+};
+
+
+} // end detail
+
+
+// the device's handle to a work_queue, which is passed to a kernel by value
+// groups claim tickets in order with an atomic counter in device memory,
+// then spin until the host has published the ticket's slot
+class work_queue_view
+{
+  public:
+    // claims the next item on behalf of the whole group
+    // must be called by a single agent; returns false once the queue is closed & drained
+    __device__
+    inline bool claim(work_item_t &item)
+    {
+#if __CUDA_ARCH__ >= 200
+      unsigned int ticket = atomicAdd(m_num_claimed, 1);
+
+      volatile detail::work_queue_slot *slot = m_slots + (ticket % m_capacity);
+
+      while(static_cast<unsigned int>(slot->sequence) != ticket + 1)
+      {
+        // the host won't publish any more tickets after closing
+        if(m_state->closed && ticket >= static_cast<unsigned int>(m_state->num_pushed))
+        {
+          return false;
+        } // end if
+      } // end while
+
+      item.begin = slot->begin;
+      item.end   = slot->end;
+
+      // don't return the slot to the host before we've read it
+      __threadfence_system();
+
+      slot->sequence = ticket + m_capacity;
+
+      return true;
+#else
+      (void) item; // Suppress unused parameter warnings
+      bulk::detail::terminate_with_message("bulk::work_queue_view::claim(): work queues require sm_20 or better.");
+      return false;
+#endif
+    } // end claim()
+
+  private:
+    friend class work_queue;
+
+    volatile detail::work_queue_slot  *m_slots;
+    volatile detail::work_queue_state *m_state;
+    unsigned int                      *m_num_claimed;
+    unsigned int                       m_capacity;
+}; // end work_queue_view
+
+
+// work_queue feeds ranges of indices from the host to a persistent launch, which keeps a fixed set of groups
+// resident and has each of them repeatedly claim an item and process it, so that a stream of small jobs
+// pays for a single kernel launch rather than one apiece
+//
+// example:
+//
+//   bulk::work_queue q;
+//
+//   // keep enough groups resident to fill the machine
+//   bulk::future<void> done = bulk::async(bulk::par(s, bulk::con(128), num_resident_groups), bulk::persistent(f), bulk::root.this_exec, q.view());
+//
+//   for(int i = 0; i < n; i += 1000)
+//   {
+//     q.push(i, std::min(n, i + 1000));
+//   }
+//
+//   q.close();
+//   done.wait();
+//
+// XXX the persistent launch should be made into a stream other than the legacy default stream,
+//     which would otherwise block unrelated work until the queue is closed
+// XXX push() spins while the queue is full, so the persistent launch must begin before more than capacity() items are pushed
+class work_queue
+{
+  public:
+    inline explicit work_queue(unsigned int capacity = 4096)
+      : m_capacity(capacity), m_num_pushed(0), m_slots(0), m_state(0), m_num_claimed(0)
+    {
+      bulk::detail::throw_on_error(cudaHostAlloc(&m_slots, m_capacity * sizeof(detail::work_queue_slot), cudaHostAllocMapped), "cudaHostAlloc in work_queue ctor");
+      bulk::detail::throw_on_error(cudaHostAlloc(&m_state, sizeof(detail::work_queue_state), cudaHostAllocMapped), "cudaHostAlloc in work_queue ctor");
+      bulk::detail::throw_on_error(cudaMalloc(&m_num_claimed, sizeof(unsigned int)), "cudaMalloc in work_queue ctor");
+      bulk::detail::throw_on_error(cudaMemset(m_num_claimed, 0, sizeof(unsigned int)), "cudaMemset in work_queue ctor");
+
+      for(unsigned int i = 0; i < m_capacity; ++i)
+      {
+        m_slots[i].sequence = i;
+      } // end for i
+
+      m_state->num_pushed = 0;
+      m_state->closed = false;
+    } // end work_queue()
+
+    inline ~work_queue()
+    {
+      bulk::detail::terminate_on_error(cudaFree(m_num_claimed), "cudaFree in work_queue dtor");
+      bulk::detail::terminate_on_error(cudaFreeHost(m_state), "cudaFreeHost in work_queue dtor");
+      bulk::detail::terminate_on_error(cudaFreeHost(m_slots), "cudaFreeHost in work_queue dtor");
+    } // end ~work_queue()
+
+    inline unsigned int capacity() const
+    {
+      return m_capacity;
+    } // end capacity()
+
+    // publishes [begin, end) for a persistent group to process
+    // must not be called concurrently with push() or close() from other threads
+    inline void push(int begin, int end)
+    {
+      if(m_state->closed)
+      {
+        bulk::detail::terminate_with_message("bulk::work_queue::push(): the queue has been closed.");
+      } // end if
+
+      unsigned int ticket = m_num_pushed;
+
+      detail::work_queue_slot &slot = m_slots[ticket % m_capacity];
+
+      // wait for a group to finish reading the slot's previous occupant
+      while(static_cast<unsigned int>(bulk::detail::host_atomic_load(&slot.sequence)) != ticket)
+      {
+        ;
+      } // end while
+
+      slot.begin = begin;
+      slot.end   = end;
+
+      // publish the slot after its contents
+      bulk::detail::host_atomic_store(&slot.sequence, ticket + 1);
+
+      ++m_num_pushed;
+      bulk::detail::host_atomic_store(&m_state->num_pushed, m_num_pushed);
+    } // end push()
+
+    // the resident groups exit once they have drained the queue
+    inline void close()
+    {
+      bulk::detail::host_atomic_store(&m_state->closed, true);
+    } // end close()
+
+    inline work_queue_view view() const
+    {
+      work_queue_view result;
+
+      bulk::detail::throw_on_error(cudaHostGetDevicePointer((void**)&result.m_slots, m_slots, 0), "cudaHostGetDevicePointer in work_queue::view");
+      bulk::detail::throw_on_error(cudaHostGetDevicePointer((void**)&result.m_state, m_state, 0), "cudaHostGetDevicePointer in work_queue::view");
+      result.m_num_claimed = m_num_claimed;
+      result.m_capacity = m_capacity;
+
+      return result;
+    } // end view()
+
+  private:
+    unsigned int              m_capacity;
+    unsigned int              m_num_pushed;
+    detail::work_queue_slot  *m_slots;
+    detail::work_queue_state *m_state;
+    unsigned int             *m_num_claimed;
+
+    // non-copyable
+    work_queue(const work_queue &);
+    work_queue &operator=(const work_queue &);
+}; // end work_queue
+
+
+namespace detail
+{
+
+
+// the body of a persistent launch: each group claims items from the queue until it is drained,
+// and invokes f(g, begin, end, args...) on each
+template<typename Function>
+class persistent_function
+{
+  public:
+    __host__ __device__
+    persistent_function(Function f)
+      : m_f(f)
+    {}
+
+    template<typename ConcurrentGroup>
+    __device__
+    void operator()(ConcurrentGroup &g, work_queue_view queue)
+    {
+      work_item_t item;
+      while(claim(g, queue, item))
+      {
+        m_f(g, item.begin, item.end);
+      } // end while
+    } // end operator()
+
+    template<typename ConcurrentGroup, typename Arg1>
+    __device__
+    void operator()(ConcurrentGroup &g, work_queue_view queue, Arg1 arg1)
+    {
+      work_item_t item;
+      while(claim(g, queue, item))
+      {
+        m_f(g, item.begin, item.end, arg1);
+      } // end while
+    } // end operator()
+
+    template<typename ConcurrentGroup, typename Arg1, typename Arg2>
+    __device__
+    void operator()(ConcurrentGroup &g, work_queue_view queue, Arg1 arg1, Arg2 arg2)
+    {
+      work_item_t item;
+      while(claim(g, queue, item))
+      {
+        m_f(g, item.begin, item.end, arg1, arg2);
+      } // end while
+    } // end operator()
+
+    template<typename ConcurrentGroup, typename Arg1, typename Arg2, typename Arg3>
+    __device__
+    void operator()(ConcurrentGroup &g, work_queue_view queue, Arg1 arg1, Arg2 arg2, Arg3 arg3)
+    {
+      work_item_t item;
+      while(claim(g, queue, item))
+      {
+        m_f(g, item.begin, item.end, arg1, arg2, arg3);
+      } // end while
+    } // end operator()
+
+    template<typename ConcurrentGroup, typename Arg1, typename Arg2, typename Arg3, typename Arg4>
+    __device__
+    void operator()(ConcurrentGroup &g, work_queue_view queue, Arg1 arg1, Arg2 arg2, Arg3 arg3, Arg4 arg4)
+    {
+      work_item_t item;
+      while(claim(g, queue, item))
+      {
+        m_f(g, item.begin, item.end, arg1, arg2, arg3, arg4);
+      } // end while
+    } // end operator()
+
+  private:
+    // agent 0 claims the group's next item and shares it with the rest of the group
+    template<typename ConcurrentGroup>
+    __device__
+    static bool claim(ConcurrentGroup &g, work_queue_view &queue, work_item_t &item)
+    {
+      __shared__ work_item_t s_item;
+      __shared__ bool s_claimed;
+
+      // the previous item must be finished before we overwrite s_item
+      g.wait();
+
+      if(g.this_exec.index() == 0)
+      {
+        s_claimed = queue.claim(s_item);
+      } // end if
+
+      g.wait();
+
+      item = s_item;
+
+      return s_claimed;
+    } // end claim()
+
+    Function m_f;
+}; // end persistent_function
+
+
+} // end detail
+
+
+// adapts f(g, begin, end, args...) into the body of a persistent launch, whose first parameter after the group is a work_queue_view
+template<typename Function>
+__host__ __device__
+detail::persistent_function<Function> persistent(Function f)
+{
+  return detail::persistent_function<Function>(f);
+} // end persistent()
+
+
+} // end bulk
+BULK_NAMESPACE_SUFFIX
+
@@ -0,0 +1,115 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/reduce.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+
+
+// each group reduces its slice, then the first group of each cluster sums its neighbors' sums
+// straight out of their on-chip memory, so the cluster produces a single partial without going through L2
+struct reduce_clusters
+{
+  template<typename ClusterGrid>
+  __device__
+  void operator()(ClusterGrid &grid, const int *data, int n, int *partials)
+  {
+    typedef typename ClusterGrid::agent_type cluster_type;
+
+    cluster_type &cluster = grid.this_exec;
+
+    int num_groups = grid.size() * cluster.size();
+    int group_index = cluster.global_index();
+
+    int slice_size = (n + num_groups - 1) / num_groups;
+    int first = thrust::min(n, group_index * slice_size);
+    int last  = thrust::min(n, first + slice_size);
+
+    int *sum = static_cast<int*>(bulk::on_chip_malloc(cluster, sizeof(int)));
+
+    int my_sum = bulk::reduce(cluster.this_exec, data + first, data + last, 0, thrust::plus<int>());
+
+    if(cluster.this_exec.this_exec.index() == 0)
+    {
+      *sum = my_sum;
+    }
+
+    // the neighbors' sums are visible after the cluster-wide barrier
+    cluster.wait();
+
+    if(cluster.this_exec.index() == 0 && cluster.this_exec.this_exec.index() == 0)
+    {
+      int cluster_sum = 0;
+
+      for(int rank = 0; rank < cluster.size(); ++rank)
+      {
+        cluster_sum += *cluster.map(sum, rank);
+      }
+
+      partials[cluster.index()] = cluster_sum;
+    }
+
+    // the neighbors must not exit until the first group is done reading
+    bulk::on_chip_free(cluster, sum);
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_input, int cluster_size)
+{
+  int n = h_input.size();
+  int ref = thrust::reduce(h_input.begin(), h_input.end());
+
+  thrust::device_vector<int> data = h_input;
+
+  int num_clusters = 64;
+  thrust::device_vector<int> partials(num_clusters);
+
+  bulk::future<void> done = bulk::async(bulk::clustered(cluster_size, bulk::grid<256,1>(num_clusters * cluster_size, 256 * sizeof(int) + 64)),
+                                        reduce_clusters(),
+                                        bulk::root,
+                                        thrust::raw_pointer_cast(data.data()),
+                                        n,
+                                        thrust::raw_pointer_cast(partials.data()));
+  done.wait();
+
+  assert(ref == thrust::reduce(partials.begin(), partials.end()));
+}
+
+
+int main()
+{
+  int device = 0;
+  cudaGetDevice(&device);
+
+  int major = 0;
+  cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device);
+
+  if(major < 9)
+  {
+    std::cout << "This device does not support clusters" << std::endl;
+    return 0;
+  }
+
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 24; n <<= 2)
+  {
+    thrust::host_vector<int> input(n);
+    for(int i = 0; i < n; ++i)
+    {
+      input[i] = rng() % 10;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+
+    for(int cluster_size = 1; cluster_size <= 8; cluster_size *= 2)
+    {
+      validate(input, cluster_size);
+    }
+  }
+
+  return 0;
+}
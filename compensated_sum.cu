@@ -0,0 +1,56 @@
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/functional.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device/reduce.hpp>
+
+
+// sums n copies of a value which has no exact float representation
+// & compares a float accumulator, a double accumulator, and a compensated float accumulator
+int main()
+{
+  const int n = 1 << 24;
+  const float x = 0.1f;
+
+  thrust::device_vector<float> input(n, x);
+  const float *first = thrust::raw_pointer_cast(input.data());
+
+  double exact = static_cast<double>(x) * n;
+
+  float naive = bulk::device::reduce(first, first + n, 0.f, thrust::plus<float>());
+
+  // accumulate in double, but deliver a float
+  thrust::device_vector<float> result(1);
+  std::size_t scratch_bytes = 0;
+  bulk::device::reduce(0, scratch_bytes, first, first + n, thrust::raw_pointer_cast(result.data()), 0., thrust::plus<double>());
+
+  thrust::device_vector<char> scratch(scratch_bytes);
+  bulk::device::reduce(thrust::raw_pointer_cast(scratch.data()), scratch_bytes,
+                       first, first + n,
+                       thrust::raw_pointer_cast(result.data()),
+                       0., thrust::plus<double>()).wait();
+
+  float widened = result[0];
+
+  // accumulate in float, carrying each addition's rounding error along
+  float compensated = bulk::device::reduce(first, first + n, bulk::compensated<float>(0.f), bulk::compensated_plus<float>());
+
+  double naive_error       = std::fabs(naive - exact);
+  double widened_error     = std::fabs(widened - exact);
+  double compensated_error = std::fabs(compensated - exact);
+
+  std::cout << "float accumulator error:             " << naive_error << std::endl;
+  std::cout << "double accumulator error:            " << widened_error << std::endl;
+  std::cout << "compensated float accumulator error: " << compensated_error << std::endl;
+
+  // the widened & compensated sums are within a float rounding of the exact sum
+  assert(widened_error     <= std::fabs(exact) * 1e-6);
+  assert(compensated_error <= std::fabs(exact) * 1e-6);
+  assert(compensated_error <= naive_error);
+
+  return 0;
+}
+
@@ -0,0 +1,117 @@
+#include <iostream>
+#include <climits>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/reduce.h>
+#include <thrust/transform.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+
+
+// subtracts the input's minimum from each element in a single launch:
+// each group reduces its slice of the input, the grid waits, then each group reduces the partial minima
+struct subtract_minimum
+{
+  template<typename ConcurrentGrid>
+  __device__
+  void operator()(ConcurrentGrid &grid, int *data, int n, int *partials)
+  {
+    int num_groups = grid.size();
+
+    int slice_size = (n + num_groups - 1) / num_groups;
+    int first = thrust::min(n, grid.index() * slice_size);
+    int last  = thrust::min(n, first + slice_size);
+
+    int minimum = bulk::reduce(grid.this_exec, data + first, data + last, INT_MAX, thrust::minimum<int>());
+
+    if(grid.this_exec.this_exec.index() == 0)
+    {
+      partials[grid.index()] = minimum;
+    }
+
+    // every group's partial is visible after the grid-wide barrier
+    grid.wait();
+
+    minimum = bulk::reduce(grid.this_exec, partials, partials + num_groups, INT_MAX, thrust::minimum<int>());
+
+    for(int i = first + grid.this_exec.this_exec.index(); i < last; i += grid.this_exec.size())
+    {
+      data[i] -= minimum;
+    }
+  }
+};
+
+
+struct minus_constant
+{
+  int c;
+
+  minus_constant(int c) : c(c) {}
+
+  __host__ __device__
+  int operator()(int x) const
+  {
+    return x - c;
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_input)
+{
+  int n = h_input.size();
+
+  thrust::host_vector<int> ref(n);
+  int minimum = thrust::reduce(h_input.begin(), h_input.end(), INT_MAX, thrust::minimum<int>());
+  thrust::transform(h_input.begin(), h_input.end(), ref.begin(), minus_constant(minimum));
+
+  thrust::device_vector<int> data = h_input;
+
+  // the launch may cap the number of groups at however many fit on the device at once,
+  // so allocate a partial for every group requested
+  const int num_groups = 1024;
+  thrust::device_vector<int> partials(num_groups);
+
+  bulk::future<void> done = bulk::async(bulk::cooperative(bulk::grid<256,1>(num_groups, 256 * sizeof(int))),
+                                        subtract_minimum(),
+                                        bulk::root,
+                                        thrust::raw_pointer_cast(data.data()),
+                                        n,
+                                        thrust::raw_pointer_cast(partials.data()));
+  done.wait();
+
+  assert(ref == data);
+}
+
+
+int main()
+{
+  int device = 0;
+  cudaGetDevice(&device);
+
+  int supported = 0;
+  cudaDeviceGetAttribute(&supported, cudaDevAttrCooperativeLaunch, device);
+
+  if(!supported)
+  {
+    std::cout << "This device does not support cooperative launch" << std::endl;
+    return 0;
+  }
+
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 24; n <<= 2)
+  {
+    thrust::host_vector<int> input(n);
+    for(int i = 0; i < n; ++i)
+    {
+      input[i] = rng() % 1000 + 7;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+    validate(input);
+  }
+
+  return 0;
+}
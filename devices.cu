@@ -0,0 +1,53 @@
+#include <iostream>
+#include <cassert>
+#include <bulk/bulk.hpp>
+
+
+struct saxpy
+{
+  __device__
+  void operator()(bulk::agent<> &self, bulk::device_slice_t slice, float a, float *x, float *y)
+  {
+    // the agent's index within the whole launch
+    int i = slice.first_group + self.index();
+    y[i] = a * x[i] + y[i];
+  }
+};
+
+
+int main()
+{
+  int num_devices = 0;
+  cudaGetDeviceCount(&num_devices);
+
+  size_t n = 1 << 24;
+
+  // every device must be able to reach the data
+  float *x = 0, *y = 0;
+  cudaMallocManaged(&x, n * sizeof(float));
+  cudaMallocManaged(&y, n * sizeof(float));
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    x[i] = 1;
+    y[i] = 1;
+  }
+
+  float a = 13;
+
+  // split the launch across every device and wait for all of it
+  bulk::future<void> done = bulk::async(bulk::devices(num_devices, bulk::par(n)), saxpy(), bulk::root.this_exec, a, x, y);
+  done.wait();
+
+  for(size_t i = 0; i < n; ++i)
+  {
+    assert(y[i] == 14);
+  }
+
+  std::cout << "It worked on " << num_devices << " devices!" << std::endl;
+
+  cudaFree(x);
+  cudaFree(y);
+
+  return 0;
+}
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/transform.h>
+#include <thrust/transform_reduce.h>
+#include <thrust/transform_scan.h>
+#include <thrust/scatter.h>
+#include <thrust/sequence.h>
+#include <thrust/reverse.h>
+#include <thrust/iterator/permutation_iterator.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/iterator.hpp>
+#include <bulk/device.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+struct square
+{
+  typedef int result_type;
+
+  __host__ __device__
+  int operator()(int x) const
+  {
+    return x * x;
+  }
+};
+
+
+struct negate_and_halve
+{
+  typedef int result_type;
+
+  __host__ __device__
+  int operator()(int x) const
+  {
+    return -x / 2;
+  }
+};
+
+
+// the unfused chain: transform, scan, transform & scatter each make a pass through memory
+void unfused(const thrust::device_vector<int> *input, const thrust::device_vector<int> *map, thrust::device_vector<int> *tmp, thrust::device_vector<int> *result)
+{
+  thrust::transform(input->begin(), input->end(), tmp->begin(), square());
+  bulk::device::inclusive_scan(tmp->begin(), tmp->end(), tmp->begin(), 13, thrust::plus<int>());
+  thrust::transform(tmp->begin(), tmp->end(), tmp->begin(), negate_and_halve());
+  thrust::scatter(tmp->begin(), tmp->end(), map->begin(), result->begin());
+}
+
+
+// the fused chain: the transforms run in the scan's load & store, and the scatter is the store's address
+void fused(const thrust::device_vector<int> *input, const thrust::device_vector<int> *map, thrust::device_vector<int> *result)
+{
+  bulk::device::transform_inclusive_scan(input->begin(), input->end(),
+                                         bulk::make_transform_output_iterator(thrust::make_permutation_iterator(result->begin(), map->begin()), negate_and_halve()),
+                                         square(),
+                                         13,
+                                         thrust::plus<int>());
+}
+
+
+void validate(const thrust::host_vector<int> &h_input)
+{
+  int n = h_input.size();
+  thrust::device_vector<int> input = h_input;
+
+  // transform_reduce
+  {
+    int ref = thrust::transform_reduce(h_input.begin(), h_input.end(), square(), 13, thrust::plus<int>());
+
+    assert(ref == bulk::device::transform_reduce(input.begin(), input.end(), square(), 13, thrust::plus<int>()));
+  }
+
+  // transform_exclusive_scan
+  {
+    thrust::host_vector<int> ref(n);
+    thrust::transform_exclusive_scan(h_input.begin(), h_input.end(), ref.begin(), square(), 13, thrust::plus<int>());
+
+    thrust::device_vector<int> result(n);
+    bulk::device::transform_exclusive_scan(input.begin(), input.end(), result.begin(), square(), 13, thrust::plus<int>());
+
+    assert(ref == result);
+  }
+
+  // transform, scan, transform & scatter in one launch
+  {
+    thrust::device_vector<int> map(n);
+    thrust::sequence(map.begin(), map.end());
+    thrust::reverse(map.begin(), map.end());
+
+    thrust::device_vector<int> tmp(n), ref(n), result(n);
+
+    unfused(&input, &map, &tmp, &ref);
+    fused(&input, &map, &result);
+
+    assert(ref == result);
+  }
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 24; n <<= 2)
+  {
+    thrust::host_vector<int> input(n);
+    for(int i = 0; i < n; ++i)
+    {
+      input[i] = rng() % 10;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+    validate(input);
+  }
+
+  int n = 1 << 24;
+  thrust::device_vector<int> input(n, 1), map(n), tmp(n), result(n);
+  thrust::sequence(map.begin(), map.end());
+
+  double unfused_msecs = time_invocation_cuda(50, unfused, &input, &map, &tmp, &result);
+  double fused_msecs   = time_invocation_cuda(50, fused, &input, &map, &result);
+
+  std::cout << "Unfused time: " << unfused_msecs << " ms" << std::endl;
+  std::cout << "Fused time: " << fused_msecs << " ms" << std::endl;
+
+  return 0;
+}
@@ -20,6 +20,15 @@ struct task2
   }
 };
 
+struct task4
+{
+  __device__
+  void operator()(int i)
+  {
+    printf("Hello world from task4(%d)\n", i);
+  }
+};
+
 void task3()
 {
   printf("Hello world from task3\n");
@@ -39,11 +48,21 @@ int main()
   // or we can make a new task depend on a previous future
   bulk::future<void> t2 = async(par(t1, 1), task2());
 
-  // task3 is independent of both task1 & task2 and executes in this thread
+  // continuations chain work after a future without blocking this thread
+  bulk::future<void> t3 = bulk::then(t1, par(1), task4(), 0);
+
+  // a launch may wait on several futures at once
+  bulk::future<void> t4 = async(bulk::after(t2, t3, par(1)), task4(), 1);
+
+  // when_all joins futures into a single future
+  bulk::future<void> all = bulk::when_all(t2, t3, t4);
+
+  // task3 is independent of the other tasks and executes in this thread
   task3();
 
+  all.wait();
+
   t1.wait();
-  t2.wait();
 
   cudaStreamDestroy(s1);
 
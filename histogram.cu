@@ -0,0 +1,61 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
+
+
+void validate(const thrust::host_vector<float> &h_samples, int num_bins)
+{
+  float lower = 0, upper = 1000;
+  bulk::even_bins<float> bin(lower, upper, num_bins);
+
+  thrust::host_vector<unsigned int> ref(num_bins, 0);
+  for(int i = 0; i < h_samples.size(); ++i)
+  {
+    int b = bin(h_samples[i]);
+    if(b >= 0) ++ref[b];
+  }
+
+  thrust::device_vector<float> samples = h_samples;
+  thrust::device_vector<unsigned int> result(num_bins);
+
+  bulk::device::histogram_even(samples.begin(), samples.end(), num_bins, lower, upper, thrust::raw_pointer_cast(result.data()));
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(ref == result);
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  // some samples fall outside of the bins
+  thrust::uniform_real_distribution<float> dist(-10, 1010);
+
+  for(int n = 1; n <= 1 << 24; n <<= 4)
+  {
+    thrust::host_vector<float> samples(n);
+    for(int i = 0; i < n; ++i)
+    {
+      samples[i] = dist(rng);
+    }
+
+    // per-warp, per-group, and global bins
+    for(int num_bins = 256; num_bins <= 1 << 16; num_bins <<= 4)
+    {
+      std::cout << "Testing n = " << n << " with " << num_bins << " bins" << std::endl;
+      validate(samples, num_bins);
+    }
+  }
+
+  return 0;
+}
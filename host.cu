@@ -0,0 +1,149 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <bulk/bulk.hpp>
+
+
+// agent 0 records whether the launch ran on the device
+struct saxpy
+{
+  __host__ __device__
+  void operator()(bulk::agent<> &self, float a, float *x, float *y, int *ran_on_device)
+  {
+    int i = self.index();
+    y[i] = a * x[i] + y[i];
+
+    if(i == 0)
+    {
+#ifdef __CUDA_ARCH__
+      *ran_on_device = 1;
+#else
+      *ran_on_device = 0;
+#endif
+    }
+  }
+};
+
+
+// managed memory when there's a device to share it with, and plain host memory otherwise
+template<typename T>
+T *allocate(std::vector<T> &host_storage, int n)
+{
+  if(!bulk::detail::has_device())
+  {
+    host_storage.resize(n);
+    return &host_storage[0];
+  }
+
+  T *result = 0;
+  cudaMallocManaged(&result, n * sizeof(T));
+  return result;
+}
+
+
+template<typename T>
+void deallocate(T *ptr)
+{
+  if(bulk::detail::has_device())
+  {
+    cudaFree(ptr);
+  }
+}
+
+
+// each group sums its slice of the input through a tree in a scratch array,
+// so that its agents must wait on one another whether they are CUDA threads or host fibers
+struct sum_slices
+{
+  template<typename Grid>
+  __host__ __device__
+  void operator()(Grid &grid, const int *data, int slice_size, int *scratch, int *sums)
+  {
+    int group_size = grid.this_exec.size();
+    int tid = grid.this_exec.this_exec.index();
+
+    int *partials = scratch + grid.this_exec.index() * group_size;
+    const int *slice = data + grid.this_exec.index() * slice_size;
+
+    int sum = 0;
+    for(int i = tid; i < slice_size; i += group_size)
+    {
+      sum += slice[i];
+    }
+
+    partials[tid] = sum;
+    grid.this_exec.wait();
+
+    for(int offset = group_size / 2; offset > 0; offset /= 2)
+    {
+      if(tid < offset)
+      {
+        partials[tid] += partials[tid + offset];
+      }
+
+      grid.this_exec.wait();
+    }
+
+    if(tid == 0)
+    {
+      sums[grid.this_exec.index()] = partials[0];
+    }
+  }
+};
+
+
+int main()
+{
+  // small problems run on the host, and so does everything when there's no device
+  // the problems straddle bulk::default_host_threshold
+  for(int n = 1 << 10; n <= 1 << 20; n <<= 5)
+  {
+    std::vector<float> x_storage, y_storage;
+    std::vector<int> ran_on_device_storage;
+
+    float *x = allocate(x_storage, n);
+    float *y = allocate(y_storage, n);
+    int *ran_on_device = allocate(ran_on_device_storage, 1);
+
+    for(int i = 0; i < n; ++i)
+    {
+      x[i] = 1;
+      y[i] = 1;
+    }
+
+    *ran_on_device = -1;
+
+    bulk::future<void> done = bulk::async(bulk::adaptive(n, bulk::par(n)), saxpy(), bulk::root.this_exec, 13.f, x, y, ran_on_device);
+    done.wait();
+
+    for(int i = 0; i < n; ++i)
+    {
+      assert(y[i] == 14);
+    }
+
+    bool expect_device = bulk::detail::has_device() && std::size_t(n) >= bulk::default_host_threshold;
+    assert(*ran_on_device == (expect_device ? 1 : 0));
+
+    deallocate(x);
+    deallocate(y);
+    deallocate(ran_on_device);
+  }
+
+  const int num_groups = 16, group_size = 64, slice_size = 1000;
+
+  std::vector<int> data(num_groups * slice_size, 1);
+  std::vector<int> scratch(num_groups * group_size);
+  std::vector<int> sums(num_groups);
+
+  bulk::async(bulk::on_host(bulk::grid<group_size,1>(num_groups)), sum_slices(), bulk::root, &data[0], slice_size, &scratch[0], &sums[0]);
+
+  for(int i = 0; i < num_groups; ++i)
+  {
+    assert(sums[i] == slice_size);
+  }
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
+
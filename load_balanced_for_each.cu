@@ -0,0 +1,84 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/scan.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
+
+
+// expands each segment into one (segment, rank) record per item
+struct expand_records
+{
+  int *segments;
+  int *ranks;
+
+  expand_records(int *segments, int *ranks)
+    : segments(segments), ranks(ranks)
+  {}
+
+  __device__
+  void operator()(int item, int segment, int rank)
+  {
+    segments[item] = segment;
+    ranks[item] = rank;
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_counts)
+{
+  int num_segments = h_counts.size();
+
+  thrust::host_vector<int> h_offsets(num_segments);
+  thrust::exclusive_scan(h_counts.begin(), h_counts.end(), h_offsets.begin());
+  int num_items = num_segments ? h_offsets.back() + h_counts.back() : 0;
+
+  thrust::host_vector<int> ref_segments(num_items), ref_ranks(num_items);
+  for(int i = 0; i < num_segments; ++i)
+  {
+    for(int j = 0; j < h_counts[i]; ++j)
+    {
+      ref_segments[h_offsets[i] + j] = i;
+      ref_ranks[h_offsets[i] + j] = j;
+    }
+  }
+
+  thrust::device_vector<int> offsets = h_offsets;
+  thrust::device_vector<int> segments(num_items), ranks(num_items);
+
+  bulk::device::load_balanced_for_each(offsets.begin(), num_segments, num_items,
+                                       expand_records(thrust::raw_pointer_cast(segments.data()), thrust::raw_pointer_cast(ranks.data())));
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(ref_segments == segments);
+  assert(ref_ranks == ranks);
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int num_segments = 1; num_segments <= 1 << 16; num_segments <<= 2)
+  {
+    // mostly empty & short segments, with the occasional enormous one
+    thrust::host_vector<int> counts(num_segments);
+    for(int i = 0; i < num_segments; ++i)
+    {
+      int r = rng() % 100;
+      counts[i] = (r < 30) ? 0 : (r < 98) ? (rng() % 8) : (rng() % 10000);
+    }
+
+    std::cout << "Testing " << num_segments << " segments" << std::endl;
+    validate(counts);
+  }
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+// nested launches require relocatable device code, e.g.
+//
+//   nvcc -arch=sm_35 -rdc=true nested_quicksort.cu -lcudadevrt
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/sort.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+
+
+// the CUDA runtime allows 24 levels of nested launches
+const int max_depth = 16;
+
+// smaller ranges aren't worth a launch
+const int cutoff = 32;
+
+
+__device__ void insertion_sort(int *first, int *last)
+{
+  for(int *i = first + 1; i < last; ++i)
+  {
+    int x = *i;
+
+    int *j = i;
+    for(; j > first && x < j[-1]; --j)
+    {
+      *j = j[-1];
+    }
+
+    *j = x;
+  }
+}
+
+
+// partitions its range and sorts each side in a launch of its own
+// the children go out in fire-and-forget streams so that they proceed independently of one another,
+// and each launch takes the device's properties from cfg rather than querying them
+// XXX a single agent partitions serially to keep the example short
+struct quicksort
+{
+  __device__
+  void operator()(bulk::concurrent_group<> &, bulk::nested_launch_config cfg, int *first, int *last, int depth)
+  {
+    if(last - first <= cutoff || depth == max_depth)
+    {
+      insertion_sort(first, last);
+      return;
+    }
+
+    int pivot = first[(last - first) / 2];
+
+    // Hoare partition
+    int *i = first - 1;
+    int *j = last;
+
+    while(true)
+    {
+      do { ++i; } while(*i < pivot);
+      do { --j; } while(*j > pivot);
+
+      if(i >= j) break;
+
+      int tmp = *i;
+      *i = *j;
+      *j = tmp;
+    }
+
+    int *middle = j + 1;
+
+    bulk::async(bulk::nested(cfg, bulk::con(1,0), bulk::fire_and_forget_stream()), quicksort(), bulk::root, cfg, first, middle, depth + 1);
+    bulk::async(bulk::nested(cfg, bulk::con(1,0), bulk::fire_and_forget_stream()), quicksort(), bulk::root, cfg, middle, last, depth + 1);
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_input)
+{
+  thrust::device_vector<int> data = h_input;
+
+  thrust::host_vector<int> ref = h_input;
+  thrust::sort(ref.begin(), ref.end());
+
+  int *first = thrust::raw_pointer_cast(data.data());
+
+  // the root launch goes out from the host as usual
+  // the grid isn't complete until all of its descendants are
+  bulk::future<void> done = bulk::async(bulk::con(1,0), quicksort(), bulk::root, bulk::nested_launch_config(), first, first + data.size(), 0);
+  done.wait();
+
+  assert(ref == data);
+}
+
+
+int main()
+{
+  int device = 0;
+  cudaGetDevice(&device);
+
+  int major = 0, minor = 0;
+  cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, device);
+  cudaDeviceGetAttribute(&minor, cudaDevAttrComputeCapabilityMinor, device);
+
+  if(10 * major + minor < 35)
+  {
+    std::cout << "This device does not support nested launches" << std::endl;
+    return 0;
+  }
+
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 16; n <<= 2)
+  {
+    thrust::host_vector<int> input(n);
+    for(int i = 0; i < n; ++i)
+    {
+      input[i] = rng() % 1000;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+
+    validate(input);
+  }
+
+  std::cout << "OK" << std::endl;
+
+  return 0;
+}
+
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <bulk/bulk.hpp>
+
+
+struct saxpy
+{
+  __device__
+  void operator()(bulk::agent<> &self, float a, float *x, float *y)
+  {
+    int i = self.index();
+    y[i] = a * x[i] + y[i];
+  }
+};
+
+
+// the device to which [ptr, ptr + num_bytes) was last prefetched
+int last_prefetch_location(const void *ptr, size_t num_bytes)
+{
+  int result = cudaInvalidDeviceId;
+  cudaMemRangeGetAttribute(&result, sizeof(int), cudaMemRangeAttributeLastPrefetchLocation, ptr, num_bytes);
+  return result;
+}
+
+
+int main()
+{
+  int n = 1 << 24;
+
+  int device = 0;
+  cudaGetDevice(&device);
+
+  float *x = 0, *y = 0;
+  cudaMallocManaged(&x, n * sizeof(float));
+  cudaMallocManaged(&y, n * sizeof(float));
+
+  for(int i = 0; i < n; ++i)
+  {
+    x[i] = 1;
+    y[i] = 1;
+  }
+
+  // the launch migrates x & y to the device in its stream before its groups touch them
+  bulk::async(bulk::prefetched(bulk::par(n)), saxpy(), bulk::root.this_exec, 13.f, x, y).wait();
+
+  assert(last_prefetch_location(x, n * sizeof(float)) == device);
+  assert(last_prefetch_location(y, n * sizeof(float)) == device);
+
+  for(int i = 0; i < n; ++i)
+  {
+    assert(y[i] == 14);
+  }
+
+  // or, pipeline each chunk's migration ahead of the previous chunk's work
+  const int num_chunks = 8;
+  int chunk_size = n / num_chunks;
+
+  std::vector<bulk::future<void> > done(num_chunks);
+
+  bulk::future<void> ready = bulk::prefetch(y, chunk_size * sizeof(float));
+
+  for(int chunk = 0; chunk < num_chunks; ++chunk)
+  {
+    float *first = y + chunk * chunk_size;
+
+    bulk::future<void> next_ready;
+    if(chunk + 1 < num_chunks)
+    {
+      next_ready = bulk::prefetch(first + chunk_size, chunk_size * sizeof(float));
+    }
+
+    done[chunk] = bulk::async(bulk::par(ready, chunk_size), saxpy(), bulk::root.this_exec, 1.f, x + chunk * chunk_size, first);
+
+    ready = next_ready;
+  }
+
+  bulk::when_all(done.begin(), done.end()).wait();
+
+  for(int i = 0; i < n; ++i)
+  {
+    assert(y[i] == 15);
+  }
+
+  cudaFree(x);
+  cudaFree(y);
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
+
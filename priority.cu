@@ -0,0 +1,124 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/logical.h>
+#include <thrust/sequence.h>
+#include <bulk/bulk.hpp>
+
+
+// a nanosecond clock that every multiprocessor agrees on
+__device__ unsigned long long now()
+{
+  unsigned long long result;
+  asm volatile("mov.u64 %0, %%globaltimer;" : "=l"(result));
+  return result;
+}
+
+
+// widens [span[0], span[1]] to cover the calling thread's current time
+__device__ void record(unsigned long long *span, unsigned long long t)
+{
+  atomicMin(span, t);
+  atomicMax(span + 1, t);
+}
+
+
+// strides over the whole input, so that any number of groups suffices
+// the first agent records how many groups were launched
+struct scale
+{
+  template<typename Grid>
+  __device__
+  void operator()(Grid &grid, float a, float *x, int n, unsigned long long *span, int *num_groups)
+  {
+    record(span, now());
+
+    if(grid.this_exec.index() == 0 && grid.this_exec.this_exec.index() == 0)
+    {
+      *num_groups = grid.size();
+    }
+
+    int stride = grid.size() * grid.this_exec.size();
+
+    for(int i = grid.this_exec.index() * grid.this_exec.size() + grid.this_exec.this_exec.index(); i < n; i += stride)
+    {
+      x[i] *= a;
+    }
+
+    record(span, now());
+  }
+};
+
+
+// every group gathers from the same small table, which is worth keeping in L2
+struct gather
+{
+  __device__
+  void operator()(bulk::agent<> &self, const float *table, int table_size, const int *indices, float *result, unsigned long long *span)
+  {
+    record(span, now());
+
+    int i = self.index();
+    result[i] = table[indices[i] % table_size];
+  }
+};
+
+
+int main()
+{
+  int n = 1 << 24;
+
+  thrust::device_vector<float> background(n, 1);
+
+  // the time span each launch ran over, as [earliest, latest] pairs
+  thrust::device_vector<unsigned long long> spans(4, 0);
+  spans[0] = spans[2] = ~0ull;
+  unsigned long long *background_span = thrust::raw_pointer_cast(spans.data());
+  unsigned long long *gather_span     = background_span + 2;
+
+  thrust::device_vector<int> background_num_groups(1, 0);
+  int *background_num_groups_ptr = thrust::raw_pointer_cast(background_num_groups.data());
+
+  // the background work takes a few multiprocessors with a few groups each,
+  // so that it leaves room for the latency-sensitive work below
+  bulk::async_launch<bulk::parallel_group<bulk::concurrent_group<bulk::agent<1>,256> > > background_launch = bulk::capped(4, 2, bulk::grid<256,1>(bulk::use_default));
+
+  // launch_info sees the same cap as the launch
+  bulk::launch_info_t background_info = bulk::launch_info(background_launch, scale(), bulk::root, 2.f, thrust::raw_pointer_cast(background.data()), n, background_span, background_num_groups_ptr);
+  assert(background_info.num_groups <= 4 * 2);
+
+  bulk::future<void> background_done = bulk::async(background_launch, scale(), bulk::root, 2.f, thrust::raw_pointer_cast(background.data()), n, background_span, background_num_groups_ptr);
+
+  int table_size = 1 << 16;
+  int m = 1 << 20;
+
+  thrust::device_vector<float> table(table_size, 7);
+  thrust::device_vector<int>   indices(m);
+  thrust::sequence(indices.begin(), indices.end());
+  thrust::device_vector<float> result(m);
+
+  const float *table_ptr = thrust::raw_pointer_cast(table.data());
+
+  // the latency-sensitive work overtakes the background work at block boundaries & keeps its table in L2
+  bulk::future<void> gather_done =
+    bulk::async(bulk::persisting(table_ptr, table_size * sizeof(float), bulk::prioritized(bulk::greatest_stream_priority(), bulk::par(m))),
+                gather(), bulk::root.this_exec, table_ptr, table_size, thrust::raw_pointer_cast(indices.data()), thrust::raw_pointer_cast(result.data()), gather_span);
+
+  gather_done.wait();
+  background_done.wait();
+
+  assert(thrust::all_of(result.begin(), result.end(), thrust::placeholders::_1 == 7));
+  assert(thrust::all_of(background.begin(), background.end(), thrust::placeholders::_1 == 2));
+
+  assert(background_num_groups[0] == static_cast<int>(background_info.num_groups));
+
+  // neither launch went to the legacy default stream, so the two overlapped rather than ran back to back
+  unsigned long long background_begin = spans[0], background_end = spans[1];
+  unsigned long long gather_begin     = spans[2], gather_end     = spans[3];
+  assert(gather_begin < background_end && background_begin < gather_end);
+
+  std::cout << "It worked!" << std::endl;
+
+  return 0;
+}
+
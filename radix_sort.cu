@@ -0,0 +1,534 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <stdint.h>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/sort.h>
+#include <thrust/scan.h>
+#include <thrust/tabulate.h>
+#include <thrust/sequence.h>
+#include <thrust/detail/minmax.h>
+#include <thrust/detail/temporary_array.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+// counts the keys of each tile with each digit
+// tile_counts is digit-major so that a single exclusive scan of it yields each tile's offset for each digit
+template<std::size_t radix_bits>
+struct count_digits_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator, typename Size>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                             RandomAccessIterator keys_first,
+                             Size n,
+                             int shift,
+                             int num_bits,
+                             int num_tiles,
+                             int *tile_counts)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator>::type key_type;
+
+    const int tile_size = groupsize * grainsize;
+    const int num_digits = 1 << radix_bits;
+
+    Size tile_begin = tile_size * g.index();
+    int tile_n = thrust::min<Size>(tile_size, n - tile_begin);
+
+    key_type *keys = 0;
+    int *counts = 0;
+    bulk::malloc_all(g,
+                     keys, tile_size,
+                     counts, bulk::detail::radix_sort_detail::num_counts<radix_bits,groupsize>::value);
+
+    // stage the tile so that each agent can read its chunk from on chip
+    bulk::copy_n(g, keys_first + tile_begin, tile_n, keys);
+    g.wait();
+
+    bulk::detail::radix_sort_detail::rank_digits<radix_bits>(g, keys, tile_n, shift, num_bits, counts);
+
+    // the number of keys with digit d is the distance between the offsets of successive digits
+    for(int d = g.this_exec.index(); d < num_digits; d += groupsize)
+    {
+      int begin = counts[d * groupsize];
+      int end   = (d + 1 < num_digits) ? counts[(d + 1) * groupsize] : tile_n;
+
+      tile_counts[d * num_tiles + g.index()] = end - begin;
+    }
+
+    bulk::free_all(g, keys, counts);
+  }
+};
+
+
+// stably partitions each tile by digit on chip, then writes each digit's run of keys to its offset in the result
+template<std::size_t radix_bits, bool has_values>
+struct scatter_digits_kernel
+{
+  template<std::size_t groupsize,
+           std::size_t grainsize,
+           typename RandomAccessIterator1,
+           typename RandomAccessIterator2,
+           typename Size,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g,
+                             RandomAccessIterator1 keys_first,
+                             RandomAccessIterator2 values_first,
+                             Size n,
+                             int shift,
+                             int num_bits,
+                             int num_tiles,
+                             const int *tile_offsets,
+                             RandomAccessIterator3 keys_result,
+                             RandomAccessIterator4 values_result)
+  {
+    typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+    typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+    const int tile_size = groupsize * grainsize;
+    const int num_digits = 1 << radix_bits;
+
+    int tid = g.this_exec.index();
+
+    Size tile_begin = tile_size * g.index();
+    int tile_n = thrust::min<Size>(tile_size, n - tile_begin);
+
+    key_type *keys = 0;
+    int *counts = 0;
+    int *digit_begin = 0;
+    bulk::malloc_all(g,
+                     keys, 2 * tile_size,
+                     counts, bulk::detail::radix_sort_detail::num_counts<radix_bits,groupsize>::value,
+                     digit_begin, num_digits);
+
+    value_type *values = 0;
+    if(has_values)
+    {
+      values = reinterpret_cast<value_type*>(bulk::malloc(g, 2 * tile_size * sizeof(value_type)));
+      bulk::copy_n(g, values_first + tile_begin, tile_n, values);
+    }
+
+    bulk::copy_n(g, keys_first + tile_begin, tile_n, keys);
+    g.wait();
+
+    bulk::detail::radix_sort_detail::rank_digits<radix_bits>(g, keys, tile_n, shift, num_bits, counts);
+
+    for(int d = tid; d < num_digits; d += groupsize)
+    {
+      digit_begin[d] = counts[d * groupsize];
+    }
+
+    // agent 0's ranks below advance the same counts which were just read
+    g.wait();
+
+    // partition the tile by digit on chip
+    thrust::pair<int,int> chunk = bulk::detail::radix_sort_detail::agent_chunk<groupsize>(tid, tile_n);
+
+    key_type   *partitioned_keys   = keys + tile_size;
+    value_type *partitioned_values = has_values ? values + tile_size : 0;
+
+    for(int i = chunk.first; i < chunk.second; ++i)
+    {
+      int result = counts[bulk::detail::radix_sort_detail::digit(keys[i], shift, num_bits) * groupsize + tid]++;
+
+      partitioned_keys[result] = keys[i];
+
+      if(has_values)
+      {
+        partitioned_values[result] = values[i];
+      }
+    }
+
+    g.wait();
+
+    // consecutive agents write consecutive keys of each digit's run
+    for(int i = tid; i < tile_n; i += groupsize)
+    {
+      key_type key = partitioned_keys[i];
+      int d = bulk::detail::radix_sort_detail::digit(key, shift, num_bits);
+
+      Size result = tile_offsets[d * num_tiles + g.index()] + (i - digit_begin[d]);
+
+      keys_result[result] = key;
+
+      if(has_values)
+      {
+        values_result[result] = partitioned_values[i];
+      }
+    }
+
+    if(has_values)
+    {
+      bulk::free(g, values);
+    }
+
+    bulk::free_all(g, keys, counts, digit_begin);
+  }
+};
+
+
+template<std::size_t radix_bits, bool has_values, std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2, typename Size, typename RandomAccessIterator3, typename RandomAccessIterator4>
+void radix_sort_pass(RandomAccessIterator1 keys_first,
+                     RandomAccessIterator2 values_first,
+                     Size n,
+                     int shift,
+                     int num_bits,
+                     thrust::detail::temporary_array<int,thrust::cuda::tag> &tile_counts,
+                     RandomAccessIterator3 keys_result,
+                     RandomAccessIterator4 values_result)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  const int tile_size = groupsize * grainsize;
+  const int num_digits = 1 << radix_bits;
+  const int num_counts = bulk::detail::radix_sort_detail::num_counts<radix_bits,groupsize>::value;
+
+  int num_tiles = (n + tile_size - 1) / tile_size;
+
+  // leave some room for the heap's bookkeeping of each allocation
+  const int slack = 4 * 64;
+
+  int *tile_counts_ptr = thrust::raw_pointer_cast(&*tile_counts.begin());
+
+  int heap_size = tile_size * sizeof(key_type) + num_counts * sizeof(int) + slack;
+  bulk::async(bulk::grid<groupsize,grainsize>(num_tiles, heap_size), count_digits_kernel<radix_bits>(), bulk::root.this_exec, keys_first, n, shift, num_bits, num_tiles, tile_counts_ptr);
+
+  thrust::cuda::tag exec;
+  thrust::exclusive_scan(exec, tile_counts.begin(), tile_counts.end(), tile_counts.begin());
+
+  heap_size = 2 * tile_size * sizeof(key_type) + (num_counts + num_digits) * sizeof(int) + slack;
+  if(has_values)
+  {
+    heap_size += 2 * tile_size * sizeof(value_type);
+  }
+
+  bulk::async(bulk::grid<groupsize,grainsize>(num_tiles, heap_size), scatter_digits_kernel<radix_bits,has_values>(), bulk::root.this_exec, keys_first, values_first, n, shift, num_bits, num_tiles, tile_counts_ptr, keys_result, values_result);
+}
+
+
+// each pass of the LSD radix sort reads the keys twice: once to count each tile's digits,
+// and again to scatter them after the counts have been scanned
+template<std::size_t radix_bits, bool has_values, typename RandomAccessIterator1, typename RandomAccessIterator2>
+void radix_sort_by_key_(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, int begin_bit, int end_bit)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
+
+  typedef int size_type;
+
+  size_type n = keys_last - keys_first;
+
+  if(n <= 0 || begin_bit >= end_bit) return;
+
+  const size_type groupsize = 128;
+  const size_type grainsize = 9;
+
+  const size_type tile_size = groupsize * grainsize;
+  size_type num_tiles = (n + tile_size - 1) / tile_size;
+
+  // XXX forward exec from parameters here
+  thrust::cuda::tag exec;
+
+  thrust::detail::temporary_array<int,thrust::cuda::tag> tile_counts(exec, num_tiles << radix_bits);
+
+  // ping being true means the latest data is in the source array
+  bool ping = true;
+  thrust::detail::temporary_array<key_type,thrust::cuda::tag>   keys_pong(exec, n);
+  thrust::detail::temporary_array<value_type,thrust::cuda::tag> values_pong(exec, has_values ? n : 0);
+
+  for(int shift = begin_bit; shift < end_bit; shift += radix_bits, ping = !ping)
+  {
+    int num_bits = thrust::min<int>(radix_bits, end_bit - shift);
+
+    if(ping)
+    {
+      radix_sort_pass<radix_bits,has_values,groupsize,grainsize>(keys_first, values_first, n, shift, num_bits, tile_counts, keys_pong.begin(), values_pong.begin());
+    }
+    else
+    {
+      radix_sort_pass<radix_bits,has_values,groupsize,grainsize>(keys_pong.begin(), values_pong.begin(), n, shift, num_bits, tile_counts, keys_first, values_first);
+    }
+  }
+
+  if(!ping)
+  {
+    thrust::copy_n(exec, keys_pong.begin(), n, keys_first);
+
+    if(has_values)
+    {
+      thrust::copy_n(exec, values_pong.begin(), n, values_first);
+    }
+  }
+}
+
+
+template<std::size_t radix_bits, typename RandomAccessIterator1, typename RandomAccessIterator2>
+void radix_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first, int begin_bit, int end_bit)
+{
+  radix_sort_by_key_<radix_bits,true>(keys_first, keys_last, values_first, begin_bit, end_bit);
+}
+
+
+template<std::size_t radix_bits, typename RandomAccessIterator>
+void radix_sort(RandomAccessIterator first, RandomAccessIterator last, int begin_bit, int end_bit)
+{
+  // the keys stand in for the values, which are never touched
+  radix_sort_by_key_<radix_bits,false>(first, last, first, begin_bit, end_bit);
+}
+
+
+template<typename RandomAccessIterator1, typename RandomAccessIterator2>
+void radix_sort_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last, RandomAccessIterator2 values_first)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
+
+  radix_sort_by_key<bulk::default_radix_bits>(keys_first, keys_last, values_first, 0, 8 * sizeof(key_type));
+}
+
+
+template<typename RandomAccessIterator>
+void radix_sort(RandomAccessIterator first, RandomAccessIterator last)
+{
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type key_type;
+
+  radix_sort<bulk::default_radix_bits>(first, last, 0, 8 * sizeof(key_type));
+}
+
+
+// sorts each tile of the input independently with the group radix sort
+struct radix_sort_each_kernel
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename RandomAccessIterator1, typename RandomAccessIterator2>
+  __device__ void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, RandomAccessIterator1 keys_first, RandomAccessIterator2 values_first, int n)
+  {
+    const int tile_size = groupsize * grainsize;
+
+    int tile_begin = tile_size * g.index();
+    int tile_n = thrust::min<int>(tile_size, n - tile_begin);
+
+    bulk::radix_sort_by_key(g, keys_first + tile_begin, keys_first + tile_begin + tile_n, values_first + tile_begin);
+  }
+};
+
+
+template<typename T>
+struct hash
+{
+  template<typename Integer>
+  __device__ __device__
+  T operator()(Integer x)
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+
+    // center the keys around zero to exercise signed & floating point keys
+    return T(x) - T(1 << 30);
+  }
+};
+
+
+template<typename Vector>
+void random_fill(Vector &vec)
+{
+  thrust::tabulate(vec.begin(), vec.end(), hash<typename Vector::value_type>());
+}
+
+
+struct low_bits_less
+{
+  int num_bits;
+
+  low_bits_less(int num_bits) : num_bits(num_bits) {}
+
+  __host__ __device__
+  bool operator()(unsigned int x, unsigned int y)
+  {
+    unsigned int mask = (1u << num_bits) - 1;
+    return (x & mask) < (y & mask);
+  }
+};
+
+
+template<typename T>
+void validate(size_t n)
+{
+  thrust::device_vector<T> unsorted_keys(n);
+  thrust::device_vector<int> unsorted_values(n);
+
+  random_fill(unsorted_keys);
+  thrust::sequence(unsorted_values.begin(), unsorted_values.end());
+
+  thrust::device_vector<T> ref_keys = unsorted_keys;
+  thrust::device_vector<int> ref_values = unsorted_values;
+  thrust::stable_sort_by_key(ref_keys.begin(), ref_keys.end(), ref_values.begin());
+
+  thrust::device_vector<T> sorted_keys = unsorted_keys;
+  thrust::device_vector<int> sorted_values = unsorted_values;
+  radix_sort_by_key(sorted_keys.begin(), sorted_keys.end(), sorted_values.begin());
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(sorted_keys == ref_keys);
+  assert(sorted_values == ref_values);
+
+  sorted_keys = unsorted_keys;
+  radix_sort(sorted_keys.begin(), sorted_keys.end());
+
+  error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(sorted_keys == ref_keys);
+}
+
+
+void validate_bit_range(size_t n)
+{
+  // sort only the low 12 bits, 3 at a time
+  const int num_bits = 12;
+
+  thrust::device_vector<unsigned int> unsorted_keys(n);
+  random_fill(unsorted_keys);
+
+  thrust::device_vector<unsigned int> ref_keys = unsorted_keys;
+  thrust::stable_sort(ref_keys.begin(), ref_keys.end(), low_bits_less(num_bits));
+
+  thrust::device_vector<unsigned int> sorted_keys = unsorted_keys;
+  radix_sort<3>(sorted_keys.begin(), sorted_keys.end(), 0, num_bits);
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(sorted_keys == ref_keys);
+}
+
+
+void validate_group_sort(size_t n)
+{
+  const int groupsize = 128;
+  const int grainsize = 7;
+  const int tile_size = groupsize * grainsize;
+
+  thrust::device_vector<int> keys(n), values(n);
+  random_fill(keys);
+  thrust::sequence(values.begin(), values.end());
+
+  thrust::host_vector<int> ref_keys = keys;
+  thrust::host_vector<int> ref_values = values;
+
+  for(size_t i = 0; i < n; i += tile_size)
+  {
+    size_t last = std::min<size_t>(n, i + tile_size);
+    thrust::stable_sort_by_key(ref_keys.begin() + i, ref_keys.begin() + last, ref_values.begin() + i);
+  }
+
+  int num_groups = (n + tile_size - 1) / tile_size;
+  int heap_size = tile_size * 2 * (sizeof(int) + sizeof(int)) + bulk::detail::radix_sort_detail::num_counts<bulk::default_radix_bits,groupsize>::value * sizeof(int) + 4 * 64;
+
+  bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size), radix_sort_each_kernel(), bulk::root.this_exec, keys.begin(), values.begin(), n);
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(thrust::host_vector<int>(keys) == ref_keys);
+  assert(thrust::host_vector<int>(values) == ref_values);
+}
+
+
+template<typename T>
+void my_sort(const thrust::device_vector<T> *unsorted, thrust::device_vector<T> *sorted)
+{
+  *sorted = *unsorted;
+  radix_sort(sorted->begin(), sorted->end());
+}
+
+
+template<typename T>
+void thrust_sort(const thrust::device_vector<T> *unsorted, thrust::device_vector<T> *sorted)
+{
+  *sorted = *unsorted;
+  thrust::sort(sorted->begin(), sorted->end());
+}
+
+
+template<typename T>
+void compare(size_t n)
+{
+  thrust::device_vector<T> unsorted(n), sorted(n);
+
+  random_fill(unsorted);
+
+  my_sort(&unsorted, &sorted);
+  double my_msecs = time_invocation_cuda(20, my_sort<T>, &unsorted, &sorted);
+
+  thrust_sort(&unsorted, &sorted);
+  double thrust_msecs = time_invocation_cuda(20, thrust_sort<T>, &unsorted, &sorted);
+
+  std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
+  std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+
+  std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
+}
+
+
+int main()
+{
+  for(size_t n = 1; n <= 1 << 20; n <<= 1)
+  {
+    std::cout << "Testing n = " << n << std::endl;
+    validate<int>(n);
+    validate<unsigned int>(n);
+    validate<float>(n);
+    validate_bit_range(n);
+    validate_group_sort(n);
+  }
+
+  thrust::default_random_engine rng;
+  for(int i = 0; i < 20; ++i)
+  {
+    size_t n = rng() % (1 << 20);
+   
+    std::cout << "Testing n = " << n << std::endl;
+    validate<int>(n);
+    validate<double>(n);
+
+    // int64_t & uint64_t are long & unsigned long on LP64 platforms
+    validate<int64_t>(n);
+    validate<uint64_t>(n);
+  }
+
+  size_t n = 12345678;
+
+  std::cout << "Large input: " << std::endl;
+  std::cout << "int: " << std::endl;
+  compare<int>(n);
+
+  std::cout << "float: " << std::endl;
+  compare<float>(n);
+
+  std::cout << "double: " << std::endl;
+  compare<double>(n);
+  std::cout << std::endl;
+
+  return 0;
+}
@@ -6,8 +6,8 @@
 #include <thrust/extrema.h>
 #include <cassert>
 #include <iostream>
+#include <bulk/device/decomposition.hpp>
 #include "time_invocation_cuda.hpp"
-#include "decomposition.hpp"
 
 
 struct reduce_partitions
@@ -55,6 +55,140 @@ struct reduce_partitions
 };
 
 
+// like reduce_partitions, but stages each tile on chip asynchronously,
+// overlapping the load of the next tile with the reduction of the current one
+struct pipelined_reduce_partitions
+{
+  template<std::size_t groupsize, std::size_t grainsize, typename Iterator1, typename Decomposition, typename Iterator2, typename T, typename BinaryFunction>
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &this_group, Iterator1 first, Decomposition decomp, Iterator2 result, T init, BinaryFunction binary_op)
+  {
+    typedef typename thrust::iterator_value<Iterator1>::type value_type;
+
+    const int tile_size = groupsize * grainsize;
+
+    typename Decomposition::range range = decomp[this_group.index()];
+
+    Iterator1 last = first + range.second;
+    first += range.first;
+
+    if(this_group.index() != 0)
+    {
+      // noticeably faster to pass the last element as the init 
+      init = last[-1];
+      --last;
+    } // end if
+
+    int n = last - first;
+    int tid = this_group.this_exec.index();
+
+    value_type *stage0 = 0, *stage1 = 0;
+    T *sums = 0;
+    bulk::malloc_all(this_group, stage0, tile_size, stage1, tile_size, sums, groupsize);
+
+    value_type *stages[2] = {stage0, stage1};
+
+    // begin loading the first tile
+    bulk::async_copy_n(this_group, first, thrust::min<int>(tile_size, n), stages[0]);
+
+    T sum;
+    bool sum_defined = false;
+
+    for(int offset = 0, tile = 0; offset < n; offset += tile_size, ++tile)
+    {
+      int partition_size = thrust::min<int>(tile_size, n - offset);
+      int next_offset = offset + tile_size;
+
+      if(next_offset < n)
+      {
+        // begin loading the next tile into the other stage, then wait for this one
+        bulk::async_copy_n(this_group, first + next_offset, thrust::min<int>(tile_size, n - next_offset), stages[(tile + 1) % 2]);
+        bulk::wait_for_async_copies<1>(this_group);
+      }
+      else
+      {
+        bulk::wait_for_async_copies<0>(this_group);
+      }
+
+      value_type *stage = stages[tile % 2];
+
+      for(int i = tid; i < partition_size; i += groupsize)
+      {
+        sum = sum_defined ? binary_op(sum, stage[i]) : T(stage[i]);
+        sum_defined = true;
+      }
+
+      // the load after next reuses this stage
+      this_group.wait();
+    }
+
+    // every agent with an index below n has reduced at least one element
+    if(sum_defined)
+    {
+      sums[tid] = sum;
+    }
+
+    this_group.wait();
+
+    sum = bulk::reduce(this_group, sums, sums + thrust::min<int>(groupsize, n), init, binary_op);
+
+    if(tid == 0)
+    {
+      result[this_group.index()] = sum;
+    }
+
+    bulk::free_all(this_group, stage0, stage1, sums);
+  }
+};
+
+
+template<typename RandomAccessIterator,
+         typename T,
+         typename BinaryOperation>
+T my_pipelined_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation binary_op)
+{
+  typedef typename thrust::iterator_difference<RandomAccessIterator>::type size_type;
+  typedef typename thrust::iterator_value<RandomAccessIterator>::type value_type;
+
+  const size_type n = last - first;
+
+  if(n <= 0) return init;
+
+  const size_type groupsize = 128;
+  const size_type grainsize = 7;
+  const size_type tile_size = groupsize * grainsize;
+  const size_type num_tiles = (n + tile_size - 1) / tile_size;
+  const size_type subscription = 10;
+
+  bulk::concurrent_group<
+    bulk::agent<grainsize>,
+    groupsize
+  > g;
+
+  const size_type num_groups = thrust::min<size_type>(subscription * g.hardware_concurrency(), num_tiles);
+
+  bulk::device::aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
+
+  thrust::cuda::tag t;
+  thrust::detail::temporary_array<T,thrust::cuda::tag> partial_sums(t, decomp.size());
+
+  // two stages of input, the agents' sums, and bulk::reduce's buffer, with some room for the heap's bookkeeping
+  size_type heap_size = 2 * tile_size * sizeof(value_type) + 2 * groupsize * sizeof(T) + 4 * 64;
+
+  // reduce into partial sums
+  bulk::future<void> done = bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(), heap_size), pipelined_reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums.begin(), init, binary_op);
+
+  if(partial_sums.size() > 1)
+  {
+    // reduce the partial sums
+    done = bulk::async(g, reduce_partitions(), bulk::root, partial_sums.begin(), partial_sums.end(), partial_sums.begin(), binary_op);
+  } // end if
+
+  // receive the sum in pinned memory rather than with a synchronous copy
+  return bulk::async_get(done, thrust::raw_pointer_cast(&partial_sums[0])).get();
+} // end my_pipelined_reduce()
+
+
 template<typename RandomAccessIterator,
          typename T,
          typename BinaryOperation>
@@ -79,21 +213,22 @@ T my_reduce(RandomAccessIterator first, RandomAccessIterator last, T init, Binar
 
   const size_type num_groups = thrust::min<size_type>(subscription * g.hardware_concurrency(), num_tiles);
 
-  aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
+  bulk::device::aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
 
   thrust::cuda::tag t;
   thrust::detail::temporary_array<T,thrust::cuda::tag> partial_sums(t, decomp.size());
 
   // reduce into partial sums
-  bulk::async(bulk::par(g, decomp.size()), reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums.begin(), init, binary_op);
+  bulk::future<void> done = bulk::async(bulk::par(g, decomp.size()), reduce_partitions(), bulk::root.this_exec, first, decomp, partial_sums.begin(), init, binary_op);
 
   if(partial_sums.size() > 1)
   {
     // reduce the partial sums
-    bulk::async(g, reduce_partitions(), bulk::root, partial_sums.begin(), partial_sums.end(), partial_sums.begin(), binary_op);
+    done = bulk::async(g, reduce_partitions(), bulk::root, partial_sums.begin(), partial_sums.end(), partial_sums.begin(), binary_op);
   } // end while
 
-  return partial_sums[0];
+  // receive the sum in pinned memory rather than with a synchronous copy
+  return bulk::async_get(done, thrust::raw_pointer_cast(&partial_sums[0])).get();
 } // end my_reduce()
 
 
@@ -104,6 +239,13 @@ T my_reduce(const thrust::device_vector<T> *vec)
 }
 
 
+template<typename T>
+T my_pipelined_reduce(const thrust::device_vector<T> *vec)
+{
+  return my_pipelined_reduce(vec->begin(), vec->end(), T(0), thrust::plus<T>());
+}
+
+
 template<typename T>
 T thrust_reduce(const thrust::device_vector<T> *vec)
 {
@@ -122,8 +264,12 @@ void compare()
   my_reduce(&vec);
   double my_msecs = time_invocation_cuda(50, my_reduce<T>, &vec);
 
+  my_pipelined_reduce(&vec);
+  double my_pipelined_msecs = time_invocation_cuda(50, my_pipelined_reduce<T>, &vec);
+
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "My pipelined time: " << my_pipelined_msecs << " ms" << std::endl;
 
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
 }
@@ -147,6 +293,12 @@ int main()
 
   assert(thrust_result == my_result);
 
+  int my_pipelined_result = my_pipelined_reduce(vec.begin(), vec.end(), 13, thrust::plus<int>());
+
+  std::cout << "my_pipelined_result: " << my_pipelined_result << std::endl;
+
+  assert(thrust_result == my_pipelined_result);
+
   std::cout << "int: " << std::endl;
   compare<int>();
 
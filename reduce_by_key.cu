@@ -4,13 +4,12 @@
 #include <thrust/iterator/zip_iterator.h>
 #include <thrust/iterator/transform_iterator.h>
 #include <thrust/iterator/constant_iterator.h>
-#include <thrust/detail/temporary_array.h>
 #include <thrust/random.h>
 #include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
 #include "head_flags.hpp"
 #include "tail_flags.hpp"
 #include "time_invocation_cuda.hpp"
-#include "reduce_intervals.hpp"
 
 
 struct reduce_by_key_kernel
@@ -28,18 +27,19 @@ struct reduce_by_key_kernel
            typename BinaryFunction>
   __device__
   thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
-  operator()(ConcurrentGroup &g,
-             RandomAccessIterator1 keys_first,
-             Decomposition decomp,
-             RandomAccessIterator2 values_first,
-             RandomAccessIterator3 keys_result,
-             RandomAccessIterator4 values_result,
-             RandomAccessIterator5 interval_output_offsets,
-             RandomAccessIterator6 interval_values,
-             RandomAccessIterator7 is_carry,
-             //BinaryPredicate pred,
-             //BinaryFunction binary_op)
-             thrust::tuple<BinaryPredicate,BinaryFunction> pred_and_binary_op)
+  reduce_interval(ConcurrentGroup &g,
+                  typename Decomposition::size_type interval,
+                  RandomAccessIterator1 keys_first,
+                  Decomposition decomp,
+                  RandomAccessIterator2 values_first,
+                  RandomAccessIterator3 keys_result,
+                  RandomAccessIterator4 values_result,
+                  RandomAccessIterator5 interval_output_offsets,
+                  RandomAccessIterator6 interval_values,
+                  RandomAccessIterator7 is_carry,
+                  //BinaryPredicate pred,
+                  //BinaryFunction binary_op)
+                  thrust::tuple<BinaryPredicate,BinaryFunction> pred_and_binary_op)
   {
     typedef typename thrust::iterator_value<RandomAccessIterator1>::type key_type;
     typedef typename thrust::iterator_value<RandomAccessIterator2>::type value_type;
@@ -50,9 +50,9 @@ struct reduce_by_key_kernel
     tail_flags<RandomAccessIterator1> tail_flags(keys_first, keys_first + decomp.n(), pred);
 
     typename Decomposition::size_type input_first, input_last;
-    thrust::tie(input_first,input_last) = decomp[g.index()];
+    thrust::tie(input_first,input_last) = decomp[interval];
 
-    typename Decomposition::size_type output_first = g.index() == 0 ? 0 : interval_output_offsets[g.index() - 1];
+    typename Decomposition::size_type output_first = interval == 0 ? 0 : interval_output_offsets[interval - 1];
 
     key_type init_key     = keys_first[input_first];
     value_type init_value = values_first[input_first];
@@ -76,7 +76,7 @@ struct reduce_by_key_kernel
 
       if(interval_has_carry)
       {
-        interval_values[g.index()] = init_value;
+        interval_values[interval] = init_value;
       } // end if
       else
       {
@@ -87,13 +87,45 @@ struct reduce_by_key_kernel
         ++values_result;
       } // end else
 
-      is_carry[g.index()] = interval_has_carry;
+      is_carry[interval] = interval_has_carry;
     } // end if
 
     return thrust::make_pair(keys_result, values_result);
   }
 
 
+  template<typename ConcurrentGroup,
+           typename RandomAccessIterator1,
+           typename Decomposition,
+           typename RandomAccessIterator2,
+           typename RandomAccessIterator3,
+           typename RandomAccessIterator4,
+           typename RandomAccessIterator5,
+           typename RandomAccessIterator6,
+           typename RandomAccessIterator7,
+           typename BinaryPredicate,
+           typename BinaryFunction>
+  __device__
+  void operator()(ConcurrentGroup &g,
+                  RandomAccessIterator1 keys_first,
+                  Decomposition decomp,
+                  RandomAccessIterator2 values_first,
+                  RandomAccessIterator3 keys_result,
+                  RandomAccessIterator4 values_result,
+                  RandomAccessIterator5 interval_output_offsets,
+                  RandomAccessIterator6 interval_values,
+                  RandomAccessIterator7 is_carry,
+                  thrust::tuple<BinaryPredicate,BinaryFunction> pred_and_binary_op)
+  {
+    typedef typename Decomposition::size_type size_type;
+
+    for(size_type i = bulk::device::first_partition(g, decomp); i < decomp.size(); i = bulk::device::next_partition(g, decomp, i))
+    {
+      reduce_interval(g, i, keys_first, decomp, values_first, keys_result, values_result, interval_output_offsets, interval_values, is_carry, pred_and_binary_op);
+    } // end for i
+  }
+
+
   template<typename ConcurrentGroup,
            typename RandomAccessIterator1,
            typename RandomAccessIterator2,
@@ -116,7 +148,7 @@ struct reduce_by_key_kernel
     RandomAccessIterator3 old_keys_result = keys_result;
 
     thrust::tie(keys_result, values_result) =
-      operator()(g, keys_first, make_trivial_decomposition(keys_last - keys_first), values_first, keys_result, values_result,
+      reduce_interval(g, 0, keys_first, bulk::device::make_trivial_decomposition(keys_last - keys_first), values_first, keys_result, values_result,
                  thrust::make_constant_iterator<int>(0),
                  thrust::make_discard_iterator(),
                  thrust::make_discard_iterator(),
@@ -180,7 +212,7 @@ template<typename RandomAccessIterator1,
          typename BinaryPredicate,
          typename BinaryFunction>
 thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
-  my_reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
+  multi_pass_reduce_by_key(RandomAccessIterator1 keys_first, RandomAccessIterator1 keys_last,
                    RandomAccessIterator2 values_first,
                    RandomAccessIterator3 keys_result,
                    RandomAccessIterator4 values_result,
@@ -196,8 +228,7 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
 
   if(n <= threshold_of_parallelism)
   {
-    thrust::cuda::tag t;
-    thrust::detail::temporary_array<size_type,thrust::cuda::tag> result_size_storage(t, 1);
+    bulk::detail::cached_array<size_type> result_size_storage(1);
 
     // XXX these sizes aren't actually optimal, but anything larger
     //     will cause sm_1x to run out of smem at compile time
@@ -225,7 +256,7 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
 
   size_type subscription = 100;
   size_type num_groups = thrust::min<size_type>(subscription * bulk::concurrent_group<>::hardware_concurrency(), (n + interval_size - 1) / interval_size);
-  aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
+  bulk::device::aligned_decomposition<size_type> decomp(n, num_groups, tile_size);
 
   // count the number of tail flags in each interval
   tail_flags<
@@ -234,21 +265,28 @@ thrust::pair<RandomAccessIterator3,RandomAccessIterator4>
     size_type
   > tail_flags(keys_first, keys_last, pred);
 
-  thrust::cuda::tag t;
-  thrust::detail::temporary_array<size_type,thrust::cuda::tag> interval_output_offsets(t, decomp.size());
+  // draw the temporaries from bulk's cache, so freeing them doesn't synchronize the device
+  bulk::detail::cached_array<size_type> interval_output_offsets(decomp.size());
 
-  reduce_intervals(tail_flags.begin(), decomp, interval_output_offsets.begin(), thrust::plus<size_type>());
+  bulk::device::reduce_intervals(tail_flags.begin(), decomp, interval_output_offsets.begin(), thrust::plus<size_type>());
 
   // scan the interval counts
   thrust::inclusive_scan(interval_output_offsets.begin(), interval_output_offsets.end(), interval_output_offsets.begin());
 
   // reduce each interval
-  thrust::detail::temporary_array<bool,thrust::cuda::tag> is_carry(t, decomp.size());
-  thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> interval_values(t, decomp.size());
+  bulk::detail::cached_array<bool> is_carry(decomp.size());
+  bulk::detail::cached_array<intermediate_type> interval_values(decomp.size());
+
+  // the cost of an interval varies with its number of segments, so let fewer groups claim intervals dynamically
+  bulk::detail::cached_array<unsigned int> interval_counter(1);
+  cudaMemsetAsync(thrust::raw_pointer_cast(&*interval_counter.begin()), 0, sizeof(unsigned int), 0);
+
+  bulk::device::dynamic_decomposition<bulk::device::aligned_decomposition<size_type> > dynamic_decomp =
+    bulk::device::make_dynamic_decomposition(decomp, 8 * bulk::concurrent_group<>::hardware_concurrency(), thrust::raw_pointer_cast(&*interval_counter.begin()));
 
   size_type heap_size = tile_size * (sizeof(size_type) + sizeof(value_type));
-  bulk::async(bulk::grid<groupsize,grainsize>(decomp.size(),heap_size), reduce_by_key_kernel(),
-    bulk::root.this_exec, keys_first, decomp, values_first, keys_result, values_result, interval_output_offsets.begin(), interval_values.begin(), is_carry.begin(), thrust::make_tuple(pred, binary_op)
+  bulk::async(bulk::grid<groupsize,grainsize>(bulk::device::num_groups_to_launch(dynamic_decomp),heap_size), reduce_by_key_kernel(),
+    bulk::root.this_exec, keys_first, dynamic_decomp, values_first, keys_result, values_result, interval_output_offsets.begin(), interval_values.begin(), is_carry.begin(), thrust::make_tuple(pred, binary_op)
   );
 
   // scan by key the carries
@@ -278,12 +316,28 @@ size_t my_reduce_by_key(const thrust::device_vector<T> *keys,
                         thrust::device_vector<T> *keys_result,
                         thrust::device_vector<T> *values_result)
 {
-  return my_reduce_by_key(keys->begin(), keys->end(),
-                          values->begin(),
-                          keys_result->begin(),
-                          values_result->begin(),
-                          thrust::equal_to<T>(),
-                          thrust::plus<T>()).first -
+  return bulk::device::reduce_by_key(keys->begin(), keys->end(),
+                                     values->begin(),
+                                     keys_result->begin(),
+                                     values_result->begin(),
+                                     thrust::equal_to<T>(),
+                                     thrust::plus<T>()).first -
+         keys_result->begin();
+}
+
+
+template<typename T>
+size_t my_multi_pass_reduce_by_key(const thrust::device_vector<T> *keys,
+                                   const thrust::device_vector<T> *values,
+                                   thrust::device_vector<T> *keys_result,
+                                   thrust::device_vector<T> *values_result)
+{
+  return multi_pass_reduce_by_key(keys->begin(), keys->end(),
+                                  values->begin(),
+                                  keys_result->begin(),
+                                  values_result->begin(),
+                                  thrust::equal_to<T>(),
+                                  thrust::plus<T>()).first -
          keys_result->begin();
 }
 
@@ -340,11 +394,15 @@ void compare(size_t n)
   size_t my_size = my_reduce_by_key(&keys, &values, &keys_result, &values_result);
   double my_msecs = time_invocation_cuda(50, my_reduce_by_key<T>, &keys, &values, &keys_result, &values_result);
 
+  my_multi_pass_reduce_by_key(&keys, &values, &keys_result, &values_result);
+  double multi_pass_msecs = time_invocation_cuda(50, my_multi_pass_reduce_by_key<T>, &keys, &values, &keys_result, &values_result);
+
   thrust_reduce_by_key(&keys, &values, &keys_result, &values_result);
   double thrust_msecs = time_invocation_cuda(50, thrust_reduce_by_key<T>, &keys, &values, &keys_result, &values_result);
 
   std::cout << "Thrust's time: " << thrust_msecs << " ms" << std::endl;
   std::cout << "My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "Multi-pass:    " << multi_pass_msecs << " ms" << std::endl;
   std::cout << "Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
 
   double my_secs = my_msecs / 1000;
@@ -375,6 +433,11 @@ void validate(size_t n)
   keys_ref.resize(thrust_size);
   values_ref.resize(thrust_size);
 
+  thrust::device_vector<T> keys_multi_pass(n), values_multi_pass(n);
+  size_t multi_pass_size = my_multi_pass_reduce_by_key(&keys, &values, &keys_multi_pass, &values_multi_pass);
+  keys_multi_pass.resize(multi_pass_size);
+  values_multi_pass.resize(multi_pass_size);
+
   size_t my_size = my_reduce_by_key(&keys, &values, &keys_result, &values_result);
   keys_result.resize(my_size);
   values_result.resize(my_size);
@@ -399,6 +462,9 @@ void validate(size_t n)
 
   assert(keys_result == keys_ref);
   assert(values_result == values_ref);
+
+  assert(keys_multi_pass == keys_ref);
+  assert(values_multi_pass == values_ref);
 }
 
 
@@ -9,7 +9,7 @@
 #include <thrust/detail/temporary_array.h>
 #include <thrust/detail/type_traits/function_traits.h>
 #include <bulk/bulk.hpp>
-#include "decomposition.hpp"
+#include <bulk/device.hpp>
 
 
 struct inclusive_scan_n
@@ -84,8 +84,10 @@ struct accumulate_tiles
 }; // end accumulate_tiles
 
 
+// the original three-pass formulation: an upsweep, a scan of the carries, and a downsweep,
+// which reads the input twice
 template<typename RandomAccessIterator1, typename RandomAccessIterator2, typename T, typename BinaryFunction>
-RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
+RandomAccessIterator2 three_pass_inclusive_scan(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, T init, BinaryFunction binary_op)
 {
   typedef typename bulk::detail::scan_detail::scan_intermediate<
     RandomAccessIterator1,
@@ -118,7 +120,7 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
     int subscription = 20;
     Size num_groups = thrust::min<Size>(subscription * bulk::concurrent_group<>::hardware_concurrency(), num_tiles);
 
-    aligned_decomposition<Size> decomp(n, num_groups, tile_size);
+    bulk::device::aligned_decomposition<Size> decomp(n, num_groups, tile_size);
 
     thrust::cuda::tag t;
     thrust::detail::temporary_array<intermediate_type,thrust::cuda::tag> carries(t, num_groups);
@@ -145,13 +147,20 @@ RandomAccessIterator2 inclusive_scan(RandomAccessIterator1 first, RandomAccessIt
   } // end else
 
   return result + n;
-} // end inclusive_scan()
+} // end three_pass_inclusive_scan()
 
 
 template<typename T>
 void my_scan(thrust::device_vector<T> *data, T init)
 {
-  ::inclusive_scan(data->begin(), data->end(), data->begin(), init, thrust::plus<T>());
+  bulk::device::inclusive_scan(data->begin(), data->end(), data->begin(), init, thrust::plus<T>());
+}
+
+
+template<typename T>
+void my_three_pass_scan(thrust::device_vector<T> *data, T init)
+{
+  ::three_pass_inclusive_scan(data->begin(), data->end(), data->begin(), init, thrust::plus<T>());
 }
 
 
@@ -171,7 +180,7 @@ void validate(size_t n)
   thrust::device_vector<T> d_input = h_input;
   thrust::device_vector<T> d_result(d_input.size());
 
-  ::inclusive_scan(d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
+  bulk::device::inclusive_scan(d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
 
   cudaError_t error = cudaDeviceSynchronize();
 
@@ -181,6 +190,42 @@ void validate(size_t n)
   }
 
   assert(h_result == d_result);
+
+  // check the exclusive scan against the inclusive result shifted right by one
+  thrust::host_vector<T> h_exclusive_result(n);
+  if(n > 0)
+  {
+    h_exclusive_result[0] = init;
+    thrust::copy(h_result.begin(), h_result.end() - 1, h_exclusive_result.begin() + 1);
+  }
+
+  // reuse a single scratch space for both exclusive scans
+  std::size_t scratch_bytes = 0;
+  bulk::device::exclusive_scan(0, scratch_bytes, d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
+
+  thrust::device_vector<char> scratch(scratch_bytes);
+  bulk::device::exclusive_scan(thrust::raw_pointer_cast(scratch.data()), scratch_bytes, d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
+
+  error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(h_exclusive_result == d_result);
+
+  thrust::fill(d_result.begin(), d_result.end(), 0);
+  bulk::device::exclusive_scan(thrust::raw_pointer_cast(scratch.data()), scratch_bytes, d_input.begin(), d_input.end(), d_result.begin(), init, thrust::plus<T>());
+
+  error = cudaDeviceSynchronize();
+
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(h_exclusive_result == d_result);
 }
 
 
@@ -202,9 +247,13 @@ void compare(size_t n = 1 << 28)
   my_scan(&vec, T(13));
   double my_msecs = time_invocation_cuda(50, my_scan<T>, &vec, 13);
 
+  my_three_pass_scan(&vec, T(13));
+  double three_pass_msecs = time_invocation_cuda(50, my_three_pass_scan<T>, &vec, 13);
+
   std::cout << "N: " << n << std::endl;
   std::cout << "  Thrust's time:                  " << thrust_msecs << " ms" << std::endl;
   std::cout << "  My time:                        " << my_msecs << " ms" << std::endl;
+  std::cout << "  My three-pass time:             " << three_pass_msecs << " ms" << std::endl;
   std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
   std::cout << std::endl;
 }
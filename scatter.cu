@@ -0,0 +1,145 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/scatter.h>
+#include <thrust/sequence.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+
+
+const std::size_t groupsize = 128;
+const std::size_t grainsize = 4;
+
+
+// each group scatters its own slice of the input, reading through the read-only cache
+// & writing with streaming stores
+struct sorted_scatter_kernel
+{
+  __device__
+  void operator()(bulk::concurrent_group<bulk::agent<grainsize>,groupsize> &g, const int *values, const int *map, int slice_size, int n, int *result)
+  {
+    int first = g.index() * slice_size;
+    int last  = thrust::min(first + slice_size, n);
+
+    if(first < last)
+    {
+      bulk::sorted_scatter(g,
+                           bulk::make_read_only_iterator(values + first),
+                           bulk::make_read_only_iterator(values + last),
+                           map + first,
+                           bulk::make_streaming_iterator(result));
+    }
+  }
+};
+
+
+// copies through a proxy on either side, so that *dst = *src assigns one streaming_proxy to another
+struct streaming_copy
+{
+  __device__
+  void operator()(bulk::agent<> &self, int *src, int *dst)
+  {
+    int i = self.index();
+    *bulk::make_streaming_iterator(dst + i) = *bulk::make_streaming_iterator(src + i);
+  }
+};
+
+
+// copies from the read-only cache to streaming stores
+struct read_only_copy
+{
+  __device__
+  void operator()(bulk::agent<> &self, const int *src, int *dst)
+  {
+    int i = self.index();
+    *bulk::make_streaming_iterator(dst + i) = *bulk::make_read_only_iterator(src + i);
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_map)
+{
+  int n = h_map.size();
+
+  thrust::host_vector<int> h_values(n);
+  thrust::sequence(h_values.begin(), h_values.end(), 13);
+
+  thrust::device_vector<int> values = h_values;
+  thrust::device_vector<int> map = h_map;
+
+  // sorted_scatter
+  {
+    thrust::device_vector<int> ref(n, -1);
+    thrust::scatter(values.begin(), values.end(), map.begin(), ref.begin());
+
+    int slice_size = 4 * groupsize * grainsize;
+    int num_groups = (n + slice_size - 1) / slice_size;
+    std::size_t heap_size = 2 * groupsize * grainsize * (sizeof(int) + sizeof(int));
+
+    thrust::device_vector<int> result(n, -1);
+    bulk::async(bulk::grid<groupsize,grainsize>(num_groups, heap_size),
+                sorted_scatter_kernel(),
+                bulk::root.this_exec,
+                thrust::raw_pointer_cast(values.data()),
+                thrust::raw_pointer_cast(map.data()),
+                slice_size,
+                n,
+                thrust::raw_pointer_cast(result.data()));
+
+    assert(ref == result);
+  }
+
+  // round trip through read_only_iterator & streaming_iterator
+  {
+    thrust::device_vector<int> temp(n, -1), result(n, -1);
+
+    bulk::async(bulk::par(n), read_only_copy(), bulk::root.this_exec, thrust::raw_pointer_cast(values.data()), thrust::raw_pointer_cast(temp.data()));
+    bulk::async(bulk::par(n), streaming_copy(), bulk::root.this_exec, thrust::raw_pointer_cast(temp.data()), thrust::raw_pointer_cast(result.data()));
+
+    assert(values == result);
+  }
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 22; n <<= 2)
+  {
+    thrust::host_vector<int> map(n);
+
+    // bucketed destinations: scattered at a coarse grain, but neighbors within a bucket
+    int num_buckets = 64;
+    for(int i = 0; i < n; ++i)
+    {
+      int bucket = i % num_buckets;
+      int offset = i / num_buckets;
+      int bucket_size = n / num_buckets;
+
+      map[i] = (i < bucket_size * num_buckets) ? bucket * bucket_size + offset : i;
+    }
+
+    std::cout << "Testing n = " << n << ", bucketed map" << std::endl;
+    validate(map);
+
+    // a random permutation
+    for(int i = n - 1; i > 0; --i)
+    {
+      std::swap(map[i], map[rng() % (i + 1)]);
+    }
+
+    std::cout << "Testing n = " << n << ", random map" << std::endl;
+    validate(map);
+  }
+
+  return 0;
+}
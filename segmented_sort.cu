@@ -0,0 +1,171 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/sort.h>
+#include <thrust/scan.h>
+#include <thrust/tabulate.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
+#include "time_invocation_cuda.hpp"
+
+
+struct my_less
+{
+  template<typename T>
+  __host__ __device__
+  bool operator()(const T &x, const T& y)
+  {
+    return x < y;
+  }
+};
+
+
+template<typename T>
+struct hash
+{
+  template<typename Integer>
+  __host__ __device__
+  T operator()(Integer x)
+  {
+    x = (x+0x7ed55d16) + (x<<12);
+    x = (x^0xc761c23c) ^ (x>>19);
+    x = (x+0x165667b1) + (x<<5);
+    x = (x+0xd3a2646c) ^ (x<<9);
+    x = (x+0xfd7046c5) + (x<<3);
+    x = (x^0xb55a4f09) ^ (x>>16);
+    return x;
+  }
+};
+
+
+// returns num_segments + 1 offsets delimiting segments of random size in [0, max_segment_size]
+thrust::host_vector<int> random_offsets(size_t num_segments, int max_segment_size, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<int> result(num_segments + 1);
+  result[0] = 0;
+
+  for(size_t i = 0; i < num_segments; ++i)
+  {
+    result[i + 1] = result[i] + rng() % (max_segment_size + 1);
+  }
+
+  return result;
+}
+
+
+template<typename T>
+void reference_segmented_sort_by_key(const thrust::host_vector<int> &offsets, thrust::host_vector<T> &keys, thrust::host_vector<T> &values)
+{
+  for(size_t i = 0; i + 1 < offsets.size(); ++i)
+  {
+    thrust::stable_sort_by_key(keys.begin() + offsets[i], keys.begin() + offsets[i+1], values.begin() + offsets[i], my_less());
+  }
+}
+
+
+template<typename T>
+void validate(size_t num_segments, int max_segment_size, thrust::default_random_engine &rng)
+{
+  thrust::host_vector<int> h_offsets = random_offsets(num_segments, max_segment_size, rng);
+  size_t n = h_offsets.back();
+
+  thrust::device_vector<T> keys(n), values(n);
+  thrust::tabulate(keys.begin(), keys.end(), hash<T>());
+  thrust::tabulate(values.begin(), values.end(), thrust::identity<T>());
+
+  thrust::host_vector<T> ref_keys = keys;
+  thrust::host_vector<T> ref_values = values;
+  reference_segmented_sort_by_key(h_offsets, ref_keys, ref_values);
+
+  thrust::device_vector<int> offsets = h_offsets;
+  bulk::device::segmented_stable_sort_by_key(keys.begin(), keys.end(), values.begin(), num_segments, offsets.begin(), my_less());
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+
+  assert(ref_keys == keys);
+  assert(ref_values == values);
+}
+
+
+template<typename T>
+void my_segmented_sort(thrust::device_vector<T> *keys, thrust::device_vector<T> *values, const thrust::device_vector<int> *offsets, void *scratch, size_t scratch_bytes)
+{
+  bulk::device::segmented_stable_sort_by_key(scratch, scratch_bytes, keys->begin(), keys->end(), values->begin(), offsets->size() - 1, offsets->begin(), my_less());
+}
+
+
+// sorts the segments with a single global sort by (segment, key)
+template<typename T>
+void thrust_segmented_sort(thrust::device_vector<T> *keys, thrust::device_vector<T> *values, const thrust::device_vector<int> *segment_ids)
+{
+  thrust::device_vector<int> ids = *segment_ids;
+  thrust::stable_sort_by_key(keys->begin(), keys->end(), thrust::make_zip_iterator(thrust::make_tuple(values->begin(), ids.begin())), my_less());
+  thrust::stable_sort_by_key(ids.begin(), ids.end(), thrust::make_zip_iterator(thrust::make_tuple(keys->begin(), values->begin())));
+}
+
+
+template<typename T>
+void compare(size_t num_segments, int max_segment_size)
+{
+  thrust::default_random_engine rng;
+  thrust::host_vector<int> h_offsets = random_offsets(num_segments, max_segment_size, rng);
+  size_t n = h_offsets.back();
+
+  thrust::host_vector<int> h_segment_ids(n);
+  for(size_t i = 0; i < num_segments; ++i)
+  {
+    thrust::fill(h_segment_ids.begin() + h_offsets[i], h_segment_ids.begin() + h_offsets[i+1], int(i));
+  }
+
+  thrust::device_vector<int> offsets = h_offsets;
+  thrust::device_vector<int> segment_ids = h_segment_ids;
+
+  thrust::device_vector<T> keys(n), values(n);
+  thrust::tabulate(keys.begin(), keys.end(), hash<T>());
+
+  // reuse a single scratch space across trials
+  size_t scratch_bytes = 0;
+  my_segmented_sort(&keys, &values, &offsets, 0, scratch_bytes);
+  thrust::device_vector<char> scratch(scratch_bytes);
+  void *raw_scratch = thrust::raw_pointer_cast(scratch.data());
+
+  my_segmented_sort(&keys, &values, &offsets, raw_scratch, scratch_bytes);
+  double my_msecs = time_invocation_cuda(20, my_segmented_sort<T>, &keys, &values, &offsets, raw_scratch, scratch_bytes);
+
+  thrust_segmented_sort(&keys, &values, &segment_ids);
+  double thrust_msecs = time_invocation_cuda(20, thrust_segmented_sort<T>, &keys, &values, &segment_ids);
+
+  std::cout << "Segments: " << num_segments << ", max segment size: " << max_segment_size << std::endl;
+  std::cout << "  Thrust's time: " << thrust_msecs << " ms" << std::endl;
+  std::cout << "  My time:       " << my_msecs << " ms" << std::endl;
+  std::cout << "  Performance relative to Thrust: " << thrust_msecs / my_msecs << std::endl;
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  int max_segment_sizes[] = {1, 16, 100, 256, 2000, 5000};
+
+  for(int i = 0; i < 6; ++i)
+  {
+    for(size_t num_segments = 1; num_segments <= 1 << 12; num_segments <<= 2)
+    {
+      std::cout << "Testing " << num_segments << " segments of up to " << max_segment_sizes[i] << " elements" << std::endl;
+      validate<int>(num_segments, max_segment_sizes[i], rng);
+    }
+  }
+
+  compare<int>(1 << 20, 16);
+  compare<int>(1 << 16, 2000);
+  compare<double>(1 << 16, 2000);
+
+  return 0;
+}
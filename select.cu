@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/copy.h>
+#include <thrust/partition.h>
+#include <thrust/unique.h>
+#include <thrust/reverse.h>
+#include <thrust/count.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
+
+
+struct is_odd
+{
+  __host__ __device__
+  bool operator()(int x) const
+  {
+    return x & 1;
+  }
+};
+
+
+void validate(const thrust::host_vector<int> &h_input)
+{
+  int n = h_input.size();
+  thrust::device_vector<int> input = h_input;
+
+  // copy_if
+  {
+    thrust::host_vector<int> ref(n);
+    ref.erase(thrust::copy_if(h_input.begin(), h_input.end(), ref.begin(), is_odd()), ref.end());
+
+    thrust::device_vector<int> result(n);
+    result.erase(bulk::device::copy_if(input.begin(), input.end(), result.begin(), is_odd()), result.end());
+
+    assert(ref == result);
+  }
+
+  // partition_copy
+  {
+    thrust::host_vector<int> ref_true(n), ref_false(n);
+    thrust::pair<thrust::host_vector<int>::iterator, thrust::host_vector<int>::iterator> ref_ends =
+      thrust::partition_copy(h_input.begin(), h_input.end(), ref_true.begin(), ref_false.begin(), is_odd());
+    ref_true.erase(ref_ends.first, ref_true.end());
+    ref_false.erase(ref_ends.second, ref_false.end());
+
+    thrust::device_vector<int> out_true(n), out_false(n);
+    thrust::pair<thrust::device_vector<int>::iterator, thrust::device_vector<int>::iterator> ends =
+      bulk::device::partition_copy(input.begin(), input.end(), out_true.begin(), out_false.begin(), is_odd());
+    out_true.erase(ends.first, out_true.end());
+    out_false.erase(ends.second, out_false.end());
+
+    assert(ref_true == out_true);
+    assert(ref_false == out_false);
+  }
+
+  // partition: the rejected elements arrive in reverse order
+  {
+    thrust::host_vector<int> ref = h_input;
+    thrust::host_vector<int>::iterator ref_middle = thrust::stable_partition(ref.begin(), ref.end(), is_odd());
+    thrust::reverse(ref_middle, ref.end());
+
+    thrust::device_vector<int> result(n);
+    thrust::device_vector<int>::iterator middle = bulk::device::partition(input.begin(), input.end(), result.begin(), is_odd());
+
+    assert(ref_middle - ref.begin() == middle - result.begin());
+    assert(ref == result);
+  }
+
+  // unique, in place
+  {
+    thrust::host_vector<int> ref = h_input;
+    ref.erase(thrust::unique(ref.begin(), ref.end()), ref.end());
+
+    thrust::device_vector<int> result = input;
+    result.erase(bulk::device::unique(result.begin(), result.end()), result.end());
+
+    assert(ref == result);
+  }
+
+  // the count stays on the device, so nothing waits on the host between launches
+  {
+    thrust::device_vector<int> num_selected(1);
+
+    std::size_t scratch_bytes = 0;
+    bulk::device::copy_if(0, scratch_bytes, input.begin(), input.end(), (int*)0, (int*)0, is_odd());
+
+    thrust::device_vector<char> scratch(scratch_bytes);
+    thrust::device_vector<int> result(n);
+    bulk::device::copy_if(thrust::raw_pointer_cast(scratch.data()), scratch_bytes,
+                          input.begin(), input.end(),
+                          result.begin(),
+                          thrust::raw_pointer_cast(num_selected.data()),
+                          is_odd());
+
+    int expected = thrust::count_if(h_input.begin(), h_input.end(), is_odd());
+    assert(expected == num_selected[0]);
+  }
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 24; n <<= 2)
+  {
+    // small values produce long runs for unique
+    thrust::host_vector<int> input(n);
+    for(int i = 0; i < n; ++i)
+    {
+      input[i] = rng() % 4;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+    validate(input);
+  }
+
+  return 0;
+}
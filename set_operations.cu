@@ -0,0 +1,138 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/set_operations.h>
+#include <thrust/sort.h>
+#include <thrust/sequence.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device.hpp>
+
+
+void validate(const thrust::host_vector<int> &h_a, const thrust::host_vector<int> &h_b)
+{
+  int n = h_a.size() + h_b.size();
+  thrust::device_vector<int> a = h_a, b = h_b;
+
+  thrust::less<int> comp;
+
+  // set_union
+  {
+    thrust::host_vector<int> ref(n);
+    ref.erase(thrust::set_union(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), ref.begin(), comp), ref.end());
+
+    thrust::device_vector<int> result(n);
+    result.erase(bulk::device::set_union(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp), result.end());
+
+    assert(ref == result);
+  }
+
+  // set_intersection
+  {
+    thrust::host_vector<int> ref(n);
+    ref.erase(thrust::set_intersection(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), ref.begin(), comp), ref.end());
+
+    thrust::device_vector<int> result(n);
+    result.erase(bulk::device::set_intersection(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp), result.end());
+
+    assert(ref == result);
+  }
+
+  // set_difference
+  {
+    thrust::host_vector<int> ref(n);
+    ref.erase(thrust::set_difference(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), ref.begin(), comp), ref.end());
+
+    thrust::device_vector<int> result(n);
+    result.erase(bulk::device::set_difference(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp), result.end());
+
+    assert(ref == result);
+  }
+
+  // set_symmetric_difference
+  {
+    thrust::host_vector<int> ref(n);
+    ref.erase(thrust::set_symmetric_difference(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), ref.begin(), comp), ref.end());
+
+    thrust::device_vector<int> result(n);
+    result.erase(bulk::device::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), result.begin(), comp), result.end());
+
+    assert(ref == result);
+  }
+
+  // set_union_by_key: the values identify the range & position each key came from
+  {
+    thrust::host_vector<int> h_values_a(h_a.size()), h_values_b(h_b.size());
+    thrust::sequence(h_values_a.begin(), h_values_a.end());
+    thrust::sequence(h_values_b.begin(), h_values_b.end(), -n);
+
+    thrust::host_vector<int> ref_keys(n), ref_values(n);
+    thrust::pair<thrust::host_vector<int>::iterator, thrust::host_vector<int>::iterator> ref_ends =
+      thrust::set_union_by_key(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), h_values_a.begin(), h_values_b.begin(), ref_keys.begin(), ref_values.begin(), comp);
+    ref_keys.erase(ref_ends.first, ref_keys.end());
+    ref_values.erase(ref_ends.second, ref_values.end());
+
+    thrust::device_vector<int> values_a = h_values_a, values_b = h_values_b;
+    thrust::device_vector<int> keys(n), values(n);
+    thrust::pair<thrust::device_vector<int>::iterator, thrust::device_vector<int>::iterator> ends =
+      bulk::device::set_union_by_key(a.begin(), a.end(), b.begin(), b.end(), values_a.begin(), values_b.begin(), keys.begin(), values.begin(), comp);
+    keys.erase(ends.first, keys.end());
+    values.erase(ends.second, values.end());
+
+    assert(ref_keys == keys);
+    assert(ref_values == values);
+  }
+
+  // the size of the result stays on the device, so nothing waits on the host between launches
+  {
+    thrust::device_vector<int> result_size(1);
+
+    std::size_t scratch_bytes = 0;
+    bulk::device::set_intersection(0, scratch_bytes, a.begin(), a.end(), b.begin(), b.end(), (int*)0, (int*)0, comp);
+
+    thrust::device_vector<char> scratch(scratch_bytes);
+    thrust::device_vector<int> result(n);
+    bulk::device::set_intersection(thrust::raw_pointer_cast(scratch.data()), scratch_bytes,
+                                   a.begin(), a.end(),
+                                   b.begin(), b.end(),
+                                   result.begin(),
+                                   thrust::raw_pointer_cast(result_size.data()),
+                                   comp);
+
+    thrust::host_vector<int> ref(n);
+    int expected = thrust::set_intersection(h_a.begin(), h_a.end(), h_b.begin(), h_b.end(), ref.begin(), comp) - ref.begin();
+    assert(expected == result_size[0]);
+  }
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 22; n <<= 2)
+  {
+    // few distinct values produce runs of equivalent keys which span many tiles
+    for(int num_values = 4; num_values <= 1 << 16; num_values <<= 6)
+    {
+      thrust::host_vector<int> a(n), b(n / 2 + 1);
+      for(int i = 0; i < a.size(); ++i) a[i] = rng() % num_values;
+      for(int i = 0; i < b.size(); ++i) b[i] = rng() % num_values;
+
+      thrust::sort(a.begin(), a.end());
+      thrust::sort(b.begin(), b.end());
+
+      std::cout << "Testing n = " << n << ", " << num_values << " distinct values" << std::endl;
+      validate(a, b);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include <iostream>
+#include <cassert>
+#include <thrust/device_vector.h>
+#include <thrust/host_vector.h>
+#include <thrust/sequence.h>
+#include <bulk/bulk.hpp>
+
+
+// each agent transposes the element at its coordinates,
+// which come straight from the hardware rather than from dividing a linear index by the width
+struct transpose
+{
+  template<typename ShapedGrid>
+  __device__
+  void operator()(ShapedGrid &grid, const int *input, int width, int height, int *output)
+  {
+    bulk::index3 p = grid.global_coordinates();
+
+    if(p.x < width && p.y < height)
+    {
+      output[p.x * height + p.y] = input[p.y * width + p.x];
+    }
+  }
+};
+
+
+void validate(int width, int height)
+{
+  thrust::device_vector<int> input(width * height);
+  thrust::sequence(input.begin(), input.end());
+
+  thrust::device_vector<int> output(width * height);
+
+  bulk::index3 group_shape(16, 16);
+  bulk::index3 grid_shape((width + group_shape.x - 1) / group_shape.x, (height + group_shape.y - 1) / group_shape.y);
+
+  bulk::future<void> done = bulk::async(bulk::shaped(grid_shape, group_shape, bulk::grid()),
+                                        transpose(),
+                                        bulk::root,
+                                        thrust::raw_pointer_cast(input.data()),
+                                        width,
+                                        height,
+                                        thrust::raw_pointer_cast(output.data()));
+  done.wait();
+
+  thrust::host_vector<int> h_output = output;
+
+  for(int y = 0; y < height; ++y)
+  {
+    for(int x = 0; x < width; ++x)
+    {
+      assert(h_output[x * height + y] == y * width + x);
+    }
+  }
+}
+
+
+int main()
+{
+  for(int width = 1; width <= 1 << 11; width <<= 2)
+  {
+    for(int height = 3; height <= 1 << 11; height <<= 2)
+    {
+      std::cout << "Testing " << width << " x " << height << std::endl;
+
+      validate(width, height);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <thrust/host_vector.h>
+#include <thrust/scan.h>
+#include <thrust/reduce.h>
+#include <thrust/functional.h>
+#include <thrust/random.h>
+#include <bulk/bulk.hpp>
+#include <bulk/device/streaming.hpp>
+
+
+// pins a host vector for the duration of a scope, so its copies overlap with computation
+template<typename T>
+class scoped_pin
+{
+  public:
+    scoped_pin(std::vector<T> &v)
+      : m_ptr(&v[0])
+    {
+      cudaHostRegister(m_ptr, v.size() * sizeof(T), cudaHostRegisterDefault);
+    }
+
+    ~scoped_pin()
+    {
+      cudaHostUnregister(m_ptr);
+    }
+
+  private:
+    T *m_ptr;
+};
+
+
+void validate(const std::vector<int> &input, std::size_t chunk_size, int num_buffers)
+{
+  int n = input.size();
+
+  std::vector<int> keys(n), values(n);
+  for(int i = 0; i < n; ++i)
+  {
+    // runs of keys span chunks
+    keys[i] = input[i] / 4;
+    values[i] = input[i] % 7;
+  }
+
+  std::vector<int> result(n), keys_result(n), values_result(n);
+
+  scoped_pin<int> pin_keys(keys), pin_values(values), pin_result(result), pin_keys_result(keys_result), pin_values_result(values_result);
+
+  bulk::device::streaming_executor exec(chunk_size, num_buffers);
+
+  // inclusive_scan
+  {
+    thrust::host_vector<int> ref(n);
+    thrust::inclusive_scan(values.begin(), values.end(), ref.begin());
+    for(int i = 0; i < n; ++i) ref[i] += 13;
+
+    bulk::device::streaming_inclusive_scan(&values[0], &values[0] + n, &result[0], 13, thrust::plus<int>(), exec);
+
+    assert(thrust::host_vector<int>(result.begin(), result.end()) == ref);
+  }
+
+  // exclusive_scan
+  {
+    thrust::host_vector<int> ref(n);
+    thrust::exclusive_scan(values.begin(), values.end(), ref.begin(), 13);
+
+    bulk::device::streaming_exclusive_scan(&values[0], &values[0] + n, &result[0], 13, thrust::plus<int>(), exec);
+
+    assert(thrust::host_vector<int>(result.begin(), result.end()) == ref);
+  }
+
+  // reduce
+  {
+    int ref = thrust::reduce(values.begin(), values.end(), 13);
+
+    assert(ref == bulk::device::streaming_reduce(&values[0], &values[0] + n, 13, thrust::plus<int>(), exec));
+  }
+
+  // reduce_by_key
+  {
+    thrust::host_vector<int> ref_keys(n), ref_values(n);
+    thrust::pair<thrust::host_vector<int>::iterator, thrust::host_vector<int>::iterator> ref_ends =
+      thrust::reduce_by_key(keys.begin(), keys.end(), values.begin(), ref_keys.begin(), ref_values.begin());
+    ref_keys.erase(ref_ends.first, ref_keys.end());
+    ref_values.erase(ref_ends.second, ref_values.end());
+
+    thrust::pair<int*,int*> ends =
+      bulk::device::streaming_reduce_by_key(&keys[0], &keys[0] + n, &values[0], &keys_result[0], &values_result[0],
+                                            thrust::equal_to<int>(), thrust::plus<int>(), exec);
+
+    assert(thrust::host_vector<int>(&keys_result[0], ends.first) == ref_keys);
+    assert(thrust::host_vector<int>(&values_result[0], ends.second) == ref_values);
+  }
+
+  cudaError_t error = cudaDeviceSynchronize();
+  if(error)
+  {
+    std::cerr << "CUDA error: " << cudaGetErrorString(error) << std::endl;
+  }
+}
+
+
+int main()
+{
+  thrust::default_random_engine rng;
+
+  for(int n = 1; n <= 1 << 24; n <<= 2)
+  {
+    // a nondecreasing input, so that the keys form runs
+    std::vector<int> input(n);
+    int x = 0;
+    for(int i = 0; i < n; ++i)
+    {
+      x += rng() % 2;
+      input[i] = x;
+    }
+
+    std::cout << "Testing n = " << n << std::endl;
+
+    // small chunks exercise the carries between chunks
+    validate(input, 1 << 10, 2);
+    validate(input, 1 << 20, 3);
+    validate(input, bulk::device::streaming_executor::default_chunk_size, bulk::device::streaming_executor::max_num_buffers);
+  }
+
+  return 0;
+}
@@ -58,9 +58,12 @@ int main()
   using bulk::con;
 
   // let the runtime size the heap
-  bulk::async(con(group_size), sum(), bulk::root, vec.data(), result.data());
+  bulk::future<void> done = bulk::async(con(group_size), sum(), bulk::root, vec.data(), result.data());
 
-  assert(512 == result[0]);
+  // the result arrives in pinned memory without a synchronous copy
+  bulk::future<int> sum_result = bulk::async_get(done, thrust::raw_pointer_cast(result.data()));
+
+  assert(512 == sum_result.get());
 
   // size the heap ourself
   size_t heap_size = group_size * sizeof(int);
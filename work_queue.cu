@@ -0,0 +1,66 @@
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <bulk/bulk.hpp>
+#include <thrust/device_vector.h>
+#include <thrust/logical.h>
+
+
+// each item of the queue is a small saxpy
+struct saxpy_range
+{
+  template<typename ConcurrentGroup>
+  __device__
+  void operator()(ConcurrentGroup &g, int begin, int end, float a, float *x, float *y)
+  {
+    for(int i = begin + g.this_exec.index(); i < end; i += g.size())
+    {
+      y[i] = a * x[i] + y[i];
+    }
+  }
+};
+
+
+int main()
+{
+  int n = 1 << 24;
+  thrust::device_vector<float> x(n, 1);
+  thrust::device_vector<float> y(n, 1);
+
+  float a = 13;
+
+  cudaStream_t s;
+  cudaStreamCreate(&s);
+
+  bulk::work_queue q;
+
+  // keep a few groups resident on each multiprocessor
+  const int groupsize = 256;
+  int num_resident_groups = 4 * bulk::concurrent_group<>::hardware_concurrency();
+
+  bulk::future<void> done = bulk::async(bulk::par(s, bulk::con(groupsize), num_resident_groups),
+                                        bulk::persistent(saxpy_range()),
+                                        bulk::root.this_exec,
+                                        q.view(),
+                                        a,
+                                        thrust::raw_pointer_cast(x.data()),
+                                        thrust::raw_pointer_cast(y.data()));
+
+  // feed the resident groups many tiny jobs
+  const int job_size = 1000;
+  for(int i = 0; i < n; i += job_size)
+  {
+    q.push(i, std::min(n, i + job_size));
+  }
+
+  q.close();
+  done.wait();
+
+  assert(thrust::all_of(y.begin(), y.end(), thrust::placeholders::_1 == 14));
+
+  std::cout << "It worked!" << std::endl;
+
+  cudaStreamDestroy(s);
+
+  return 0;
+}